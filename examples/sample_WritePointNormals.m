@@ -17,7 +17,9 @@
 % found confirmation in the specification.
 % This option can be turned on by setting "write_as_uint16" to true
 %
-% For simplicity: Normals have already been calculated and are laoded from
+% The normals are estimated from the 16 nearest neighbours of every point
+% with estimateNormals, if its mex file is compiled (src/build_pointNeighbours.m).
+% Otherwise the normals have already been calculated and are loaded from
 % file mat/pCloudNormals.mat
 
 write_as_uint16 = false;
@@ -42,8 +44,13 @@ fprintf('     Reading File: %s\n', lasFilePath);
 pcloud = readLASfile(lasFilePath);
 
 %% Calculate Point Cloud Normals
-fprintf('     Load Normals...\n');
-load('mat/pCloudNormals.mat')
+if exist('pointNeighbours_cpp', 'file') == 3
+    fprintf('     Estimate Normals...\n');
+    pCloudNormals = estimateNormals(pcloud.x, pcloud.y, pcloud.z, 16, Inf, 0);
+else
+    fprintf('     Load Normals...\n');
+    load('mat/pCloudNormals.mat')
+end
 
 %% Add extrabytes
 fprintf('     Creating Extra Bytes...\n');
@@ -10,6 +10,8 @@
 %     operates on a different principle which is not shown here
 %   - The more points or the more vertices a polygon has, the longer the
 %     execution time. Which you can test yourself.
+%   - If only the points inside of the polygon are needed, then
+%     clipLASfile finds them while reading the file
 
 close all; clc; clear;
 fprintf('-------------------------------------------------------------\n');
@@ -87,6 +89,19 @@ t3 = toc;
 resultsAreSame = resultsAreSame & all(isInsideIdentityTest == isInside);
 
 fprintf('     Execution Time (Built-In Matlab Function) \t: %6.1fms\n', t3*1000);
+
+%% Clip the file directly while its records are streamed
+% Instead of reading all points, building a mask and copying every field,
+% only the points inside of the polygon are read (winding number)
+tic;
+pcloudClipped = clipLASfile(lasFilePath, polyX, polyY);
+t4 = toc;
+
+if searchAlgorithm == 0
+    resultsAreSame = resultsAreSame & numel(pcloudClipped.x) == sum(isInsideIdentityTest);
+end
+
+fprintf('     Execution Time (Clip while reading the file) \t: %6.1fms\n', t4*1000);
 fprintf('-------------------------------------------------------------\n');
 
 if resultsAreSame
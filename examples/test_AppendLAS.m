@@ -0,0 +1,162 @@
+function test_AppendLAS(test_cloud_point_count)
+%test_AppendLAS Tests appending points to LAS-Files with extended VLRs
+%   function test_AppendLAS(test_cloud_point_count)
+%
+%   Writes random point clouds with two extended VLRs to subfolder
+%   unit_test_files and appends a second random cloud with the append
+%   option of writeLASfile. The file is read again and compared with both
+%   clouds: points in order, point counts of the header and extended VLRs
+%   after the appended points. Then points whose coordinates do not fit
+%   the scale factors and offsets of the file are appended, which has to
+%   fail and leave the file unchanged.
+%   Which tests succeeded and which failed is printed to console
+%
+%   Arguments:
+%       test_cloud_point_count [numeric] : Number of random points per cloud
+%                                          Default: 100000
+%
+%   Example:
+%       test_AppendLAS(100000);
+%
+%   Uses and thereby (partially) tests the following functions and classes:
+%   \lib\addLASLibPaths.m
+%   \lib\classes\PCloudFun.m
+%   \lib\mex\readLASfile_cpp.mex(platform)
+%   \lib\mex\writeLASfile_cpp.mex(platform)
+%   \lib\readLASfile.m
+%   \lib\writeLASfile.m
+fprintf('\nRunning: test_AppendLAS.m\n\n');
+
+%% Test parameter
+if nargin < 1
+    test_cloud_point_count = 100000; % How many points per written cloud
+end
+
+%% Add and get required paths
+if ~isdeployed
+    mpath = mfilename('fullpath');
+    [root_path,~,~] = fileparts(fileparts(mpath));
+    addpath(fullfile(root_path, 'lib'));
+    addLASLibPaths()
+
+    out_dir = fullfile(root_path, 'examples', 'unit_test_files');
+else
+    out_dir = fullfile(pwd, 'unit_test_files');
+end
+
+if ~isdir(out_dir) %#ok
+   [status, msg, msgID]  = mkdir(out_dir);
+   if ~status
+       error('Could not create unit test dir:\n%s: %s', msgID, msg);
+   end
+end
+
+%% Append to files of a legacy and an extended point data record format
+error_count = 0;
+test_formats = [3, 6];
+for record_format = test_formats
+    fprintf('--- Start Test Record Format %d ---\n', record_format);
+    testfile_name = fullfile(out_dir, strcat('unit_test_append_', num2str(record_format), '.las'));
+
+    % Two clouds with the same scale factors and offsets, the first one
+    % with extended VLRs
+    lasFirst  = createCloud(test_cloud_point_count, record_format, 0);
+    lasSecond = createCloud(test_cloud_point_count + 7, record_format, 1e6);
+
+    evlr_data = {uint8(mod(0:4999, 256)), uint8(1:100)};
+    for i = 1:numel(evlr_data)
+        lasFirst.extendedvariables(i).reserved      = 0;
+        lasFirst.extendedvariables(i).user_id       = 'LASLibraryTest';
+        lasFirst.extendedvariables(i).record_id     = i;
+        lasFirst.extendedvariables(i).record_length = numel(evlr_data{i});
+        lasFirst.extendedvariables(i).description   = 'Moved by append';
+        lasFirst.extendedvariables(i).data          = evlr_data{i};
+    end
+
+    % Let writeLASfile count the extended VLRs and place them after the points
+    lasFirst.header = rmfield(lasFirst.header, {'start_of_extended_variable_length_record', 'number_of_extended_variable_length_record'});
+
+    try
+        writeLASfile(lasFirst, testfile_name, 1, 4, record_format, struct('computeHeaderStats', true));
+        writeLASfile(lasSecond, testfile_name, 1, 4, record_format, struct('append', true));
+        lasIn = readLASfile(testfile_name);
+    catch ME
+        fprintf('   Failure Record Format %d: Could not write, append or read cloud\n', record_format);
+        fprintf('                             ErrorID: %s | ErrorMSg: %s\n', ME.identifier, ME.message);
+        error_count = error_count + 1;
+        continue;
+    end
+
+    % Points of both clouds in order
+    if isequal(lasIn.x, [lasFirst.x; lasSecond.x]) && isequal(lasIn.y, [lasFirst.y; lasSecond.y]) && ...
+            isequal(lasIn.z, [lasFirst.z; lasSecond.z]) && isequal(lasIn.gps_time, [lasFirst.gps_time; lasSecond.gps_time]) && ...
+            isequal(lasIn.intensity, [lasFirst.intensity; lasSecond.intensity])
+        fprintf('   Success Record Format %d: Appended points are read after the existing ones\n', record_format);
+    else
+        fprintf('   Failure Record Format %d: Points of the appended file differ\n', record_format);
+        error_count = error_count + 1;
+    end
+
+    % Header counts and extended VLRs after the appended points
+    point_count = 2 * test_cloud_point_count + 7;
+    evlr_start  = lasIn.header.offset_to_point_data + point_count * lasIn.header.point_data_record_length;
+    if lasIn.header.number_of_point_records == point_count && ...
+            lasIn.header.start_of_extended_variable_length_record == evlr_start && ...
+            numel(lasIn.extendedvariables) == numel(evlr_data) && ...
+            isequal(lasIn.extendedvariables(1).data(:), evlr_data{1}(:)) && ...
+            isequal(lasIn.extendedvariables(2).data(:), evlr_data{2}(:))
+        fprintf('   Success Record Format %d: Header and extended VLRs are updated\n', record_format);
+    else
+        fprintf('   Failure Record Format %d: Header or extended VLRs are wrong after append\n', record_format);
+        error_count = error_count + 1;
+    end
+
+    % Points that can not be quantized with the scale factors of the file
+    % are rejected before anything in the file is changed
+    fileID = fopen(testfile_name, 'r');
+    bytesBefore = fread(fileID, Inf, '*uint8');
+    fclose(fileID);
+
+    lasInvalid = createCloud(70000, record_format, 0);
+    lasInvalid.x(end) = 1e12;
+    try
+        writeLASfile(lasInvalid, testfile_name, 1, 4, record_format, struct('append', true));
+        fprintf('   Failure Record Format %d: Appending overflowing coordinates did not fail\n', record_format);
+        error_count = error_count + 1;
+    catch
+        fileID = fopen(testfile_name, 'r');
+        bytesAfter = fread(fileID, Inf, '*uint8');
+        fclose(fileID);
+
+        if isequal(bytesBefore, bytesAfter)
+            fprintf('   Success Record Format %d: Failing append leaves the file unchanged\n', record_format);
+        else
+            fprintf('   Failure Record Format %d: Failing append changed the file\n', record_format);
+            error_count = error_count + 1;
+        end
+    end
+end
+
+fprintf('--- Results ---\n');
+if error_count > 0
+    fprintf('!!! Failure: Encountered %d errors !!!!\n', error_count);
+else
+    fprintf('Success: No errors encountered\n');
+end
+fprintf('\nFinished: test_AppendLAS.m\n');
+end
+
+function las = createCloud(point_count, record_format, time_offset)
+% Random cloud on the 1 mm grid of its scale factors, so the coordinates
+% are read back exactly
+las = PCloudFun.Allocate(point_count, 4, record_format);
+las.header.scale_factor_x = 0.001;
+las.header.scale_factor_y = 0.001;
+las.header.scale_factor_z = 0.001;
+las.x = round(rand(point_count, 1) * 1e5) * las.header.scale_factor_x;
+las.y = round(rand(point_count, 1) * 1e5) * las.header.scale_factor_y;
+las.z = round(rand(point_count, 1) * 1e4) * las.header.scale_factor_z;
+las.intensity = cast(rand(point_count, 1) * 65535, 'uint16');
+las.bits      = uint8(17 * ones(point_count, 1));
+las.gps_time  = time_offset + (1:point_count)' * 1e-3;
+end
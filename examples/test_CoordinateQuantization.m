@@ -0,0 +1,113 @@
+function test_CoordinateQuantization()
+%test_CoordinateQuantization Tests the int32 range check of the writer
+%   function test_CoordinateQuantization()
+%
+%   Coordinates are rounded half away from zero to the int32 values of
+%   the point records. -2147483648.5 and 2147483647.5 round to the next
+%   integer outside of int32, so writing them has to fail, while values
+%   just inside of these bounds are written and read back as INT32_MIN
+%   and INT32_MAX. Scale factor 1 and offset 0 keep the values unchanged.
+%   The value is placed at every position of a small cloud, so every lane
+%   of the SSE2 and AVX kernels and the scalar loop is tested.
+%   Which tests succeeded and which failed is printed to console
+%
+%   Example:
+%       test_CoordinateQuantization();
+%
+%   Uses and thereby (partially) tests the following functions and classes:
+%   \lib\addLASLibPaths.m
+%   \lib\classes\PCloudFun.m
+%   \lib\mex\readLASfile_cpp.mex(platform)
+%   \lib\mex\writeLASfile_cpp.mex(platform)
+%   \lib\readLASfile.m
+%   \lib\writeLASfile.m
+fprintf('\nRunning: test_CoordinateQuantization.m\n\n');
+
+%% Add and get required paths
+if ~isdeployed
+    mpath = mfilename('fullpath');
+    [root_path,~,~] = fileparts(fileparts(mpath));
+    addpath(fullfile(root_path, 'lib'));
+    addLASLibPaths()
+
+    out_dir = fullfile(root_path, 'examples', 'unit_test_files');
+else
+    out_dir = fullfile(pwd, 'unit_test_files');
+end
+
+if ~isdir(out_dir) %#ok
+   [status, msg, msgID]  = mkdir(out_dir);
+   if ~status
+       error('Could not create unit test dir:\n%s: %s', msgID, msg);
+   end
+end
+
+error_count = 0;
+testfile_name = fullfile(out_dir, 'unit_test_quantization.las');
+point_count = 11;
+
+% Bounds that have to fail and values inside of them with their int32 value
+bounds = [-2147483648.5, 2147483647.5];
+inside = [-2147483648.25, 2147483647.25];
+expected = [-2147483648, 2147483647];
+
+for b = 1:numel(bounds)
+    fprintf('--- Start Test Bound %.1f ---\n', bounds(b));
+    failed_positions = 0;
+    wrong_positions = 0;
+
+    for position = 1:point_count
+        las = PCloudFun.Allocate(point_count, 4, 6);
+        las.header.scale_factor_x = 1;
+        las.header.scale_factor_y = 1;
+        las.header.scale_factor_z = 1;
+        las.header.x_offset = 0;
+        las.header.y_offset = 0;
+        las.header.z_offset = 0;
+        las.bits = uint8(17 * ones(point_count, 1));
+
+        % Bound has to be rejected
+        las.x = zeros(point_count, 1);
+        las.x(position) = bounds(b);
+        try
+            writeLASfile(las, testfile_name, 1, 4, 6);
+            failed_positions = failed_positions + 1;
+        catch
+        end
+
+        % Value inside of the bound has to be written as int32 bound
+        las.x(position) = inside(b);
+        try
+            writeLASfile(las, testfile_name, 1, 4, 6);
+            lasIn = readLASfile(testfile_name);
+            if lasIn.x(position) ~= expected(b)
+                wrong_positions = wrong_positions + 1;
+            end
+        catch
+            wrong_positions = wrong_positions + 1;
+        end
+    end
+
+    if failed_positions == 0
+        fprintf('   Success Bound %.1f: Writing fails at every position\n', bounds(b));
+    else
+        fprintf('   Failure Bound %.1f: Writing succeeded at %d positions\n', bounds(b), failed_positions);
+        error_count = error_count + 1;
+    end
+
+    if wrong_positions == 0
+        fprintf('   Success Bound %.1f: %.2f is written as %d\n', bounds(b), inside(b), expected(b));
+    else
+        fprintf('   Failure Bound %.1f: %.2f is not written as %d at %d positions\n', bounds(b), inside(b), expected(b), wrong_positions);
+        error_count = error_count + 1;
+    end
+end
+
+fprintf('--- Results ---\n');
+if error_count > 0
+    fprintf('!!! Failure: Encountered %d errors !!!!\n', error_count);
+else
+    fprintf('Success: No errors encountered\n');
+end
+fprintf('\nFinished: test_CoordinateQuantization.m\n');
+end
@@ -0,0 +1,161 @@
+function test_HeaderStatistics(test_cloud_point_count)
+%test_HeaderStatistics Tests the header statistics computed while writing
+%   function test_HeaderStatistics(test_cloud_point_count)
+%
+%   Writes random point clouds with random return numbers and a stale
+%   header (bounding box and point counts of zero) to subfolder
+%   unit_test_files with option computeHeaderStats and reads them again.
+%   Bounding box, point count and points by return of the read header have
+%   to match the points. The legacy point counts of the LAS 1.4 header hold
+%   the counts for point data record formats 0 to 5 and have to be zero
+%   for 6 to 10. A file of format 1 is transcoded to format 6, which has
+%   to zero the legacy counts as well.
+%   Which tests succeeded and which failed is printed to console
+%
+%   Arguments:
+%       test_cloud_point_count [numeric] : Number of random points
+%                                          Default: 100000
+%
+%   Example:
+%       test_HeaderStatistics(100000);
+%
+%   Uses and thereby (partially) tests the following functions and classes:
+%   \lib\addLASLibPaths.m
+%   \lib\classes\PCloudFun.m
+%   \lib\mex\readLASfile_cpp.mex(platform)
+%   \lib\mex\writeLASfile_cpp.mex(platform)
+%   \lib\mex\transcodeLASfile_cpp.mex(platform)
+%   \lib\readLASfile.m
+%   \lib\writeLASfile.m
+%   \lib\transcodeLASfile.m
+fprintf('\nRunning: test_HeaderStatistics.m\n\n');
+
+%% Test parameter
+if nargin < 1
+    test_cloud_point_count = 100000; % How many points to write in test LAS
+end
+
+%% Add and get required paths
+if ~isdeployed
+    mpath = mfilename('fullpath');
+    [root_path,~,~] = fileparts(fileparts(mpath));
+    addpath(fullfile(root_path, 'lib'));
+    addLASLibPaths()
+
+    out_dir = fullfile(root_path, 'examples', 'unit_test_files');
+else
+    out_dir = fullfile(pwd, 'unit_test_files');
+end
+
+if ~isdir(out_dir) %#ok
+   [status, msg, msgID]  = mkdir(out_dir);
+   if ~status
+       error('Could not create unit test dir:\n%s: %s', msgID, msg);
+   end
+end
+
+%% Write legacy and extended point data record formats as LAS 1.4
+error_count = 0;
+test_formats = [1, 3, 6, 7];
+for record_format = test_formats
+    fprintf('--- Start Test Record Format %d ---\n', record_format);
+    testfile_name = fullfile(out_dir, strcat('unit_test_statistics_', num2str(record_format), '.las'));
+
+    % Return numbers 1-5 of 5 returns for formats 0-5, 1-15 of 15 returns for 6-10
+    max_return = 5 + 10 * (record_format > 5);
+    return_number = randi(max_return, test_cloud_point_count, 1);
+
+    las = PCloudFun.Allocate(test_cloud_point_count, 4, record_format);
+    las.x = round(rand(test_cloud_point_count, 1) * 1e6) * las.header.scale_factor_x + 500;
+    las.y = round(rand(test_cloud_point_count, 1) * 1e6) * las.header.scale_factor_y - 200;
+    las.z = round(rand(test_cloud_point_count, 1) * 1e5) * las.header.scale_factor_z;
+    if record_format > 5
+        las.bits = uint8(return_number + 16 * max_return);
+    else
+        las.bits = uint8(return_number + 8 * max_return);
+    end
+    las.gps_time = (1:test_cloud_point_count)' * 1e-3;
+
+    % Stale header, everything has to be computed while writing
+    las.header.max_x = 0; las.header.min_x = 0;
+    las.header.max_y = 0; las.header.min_y = 0;
+    las.header.max_z = 0; las.header.min_z = 0;
+    las.header.number_of_points_by_return(:) = 0;
+
+    try
+        writeLASfile(las, testfile_name, 1, 4, record_format, struct('computeHeaderStats', true));
+        lasIn = readLASfile(testfile_name);
+    catch ME
+        fprintf('   Failure Record Format %d: Could not write or read cloud\n', record_format);
+        fprintf('                             ErrorID: %s | ErrorMSg: %s\n', ME.identifier, ME.message);
+        error_count = error_count + 1;
+        continue;
+    end
+
+    error_count = error_count + checkStatistics(lasIn, return_number, record_format);
+end
+
+%% Transcode format 1 to format 6, the legacy counts have to be zeroed
+fprintf('--- Start Test Transcoding Record Format 1 to 6 ---\n');
+try
+    testfile_name = fullfile(out_dir, 'unit_test_statistics_transcoded_6.las');
+    transcodeLASfile(fullfile(out_dir, 'unit_test_statistics_1.las'), testfile_name, struct('targetPointFormat', 6));
+    lasIn = readLASfile(testfile_name);
+    error_count = error_count + checkStatistics(lasIn, double(bitand(lasIn.bits, 15)), 6);
+catch ME
+    fprintf('   Failure Transcoding: Could not transcode or read cloud\n');
+    fprintf('                        ErrorID: %s | ErrorMSg: %s\n', ME.identifier, ME.message);
+    error_count = error_count + 1;
+end
+
+fprintf('--- Results ---\n');
+if error_count > 0
+    fprintf('!!! Failure: Encountered %d errors !!!!\n', error_count);
+else
+    fprintf('Success: No errors encountered\n');
+end
+fprintf('\nFinished: test_HeaderStatistics.m\n');
+end
+
+function error_count = checkStatistics(lasIn, return_number, record_format)
+% Compares the header of a read LAS 1.4 file with its points, returns the
+% number of failed checks
+error_count = 0;
+point_count = numel(lasIn.x);
+header      = lasIn.header;
+
+if header.max_x == max(lasIn.x) && header.min_x == min(lasIn.x) && ...
+        header.max_y == max(lasIn.y) && header.min_y == min(lasIn.y) && ...
+        header.max_z == max(lasIn.z) && header.min_z == min(lasIn.z)
+    fprintf('   Success Record Format %d: Bounding box matches the points\n', record_format);
+else
+    fprintf('   Failure Record Format %d: Bounding box does not match the points\n', record_format);
+    error_count = error_count + 1;
+end
+
+points_by_return = accumarray(return_number(:), 1, [15, 1]);
+if header.number_of_point_records == point_count && isequal(header.number_of_points_by_return(:), points_by_return)
+    fprintf('   Success Record Format %d: Point count and points by return match the points\n', record_format);
+else
+    fprintf('   Failure Record Format %d: Point count or points by return do not match the points\n', record_format);
+    error_count = error_count + 1;
+end
+
+% LAS 1.4 requires zero legacy counts for point data record formats 6-10
+if record_format > 5
+    legacy_count = 0;
+    legacy_by_return = zeros(5, 1);
+else
+    legacy_count = point_count;
+    legacy_by_return = points_by_return(1:5);
+end
+
+if header.legacy_number_of_point_records_READ_ONLY == legacy_count && ...
+        isequal(header.legacy_number_of_points_by_return_READ_ONLY(:), legacy_by_return)
+    fprintf('   Success Record Format %d: Legacy point counts are valid\n', record_format);
+else
+    fprintf('   Failure Record Format %d: Legacy point counts are %d instead of %d\n', record_format, ...
+        header.legacy_number_of_point_records_READ_ONLY, legacy_count);
+    error_count = error_count + 1;
+end
+end
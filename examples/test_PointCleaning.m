@@ -0,0 +1,119 @@
+function test_PointCleaning(test_cloud_point_count)
+%test_PointCleaning Tests the search for duplicate points and outliers
+%   function test_PointCleaning(test_cloud_point_count)
+%
+%   Plants exact duplicates and far away outliers into a random point
+%   cloud. findDuplicates has to flag all but the first point of every
+%   group of equal coordinates, like unique(..., 'stable'), and return the
+%   same result for 1 and 4 threads. findOutliers has to flag the planted
+%   outliers and no other point.
+%   Which tests succeeded and which failed is printed to console
+%
+%   Arguments:
+%       test_cloud_point_count [numeric] : Number of random points
+%                                          Default: 100000
+%
+%   Example:
+%       test_PointCleaning(100000);
+%
+%   Uses and thereby (partially) tests the following functions and classes:
+%   \lib\addLASLibPaths.m
+%   \lib\mex\pointCleaning_cpp.mex(platform)
+%   \lib\utility\findDuplicates.m
+%   \lib\utility\findOutliers.m
+fprintf('\nRunning: test_PointCleaning.m\n\n');
+
+%% Test parameter
+if nargin < 1
+    test_cloud_point_count = 100000; % How many random points
+end
+
+%% Add required paths
+if ~isdeployed
+    mpath = mfilename('fullpath');
+    [root_path,~,~] = fileparts(fileparts(mpath));
+    addpath(fullfile(root_path, 'lib'));
+    addLASLibPaths()
+end
+
+error_count = 0;
+
+%% Duplicates
+fprintf('--- Start Test Duplicates ---\n');
+
+% Random points on a 1 cm grid and copies of a tenth of them, shuffled
+xyz = round(rand(test_cloud_point_count, 3) * 1e4) / 100;
+copies = randi(test_cloud_point_count, round(test_cloud_point_count / 10), 1);
+xyz = [xyz; xyz(copies, :)];
+xyz = xyz(randperm(size(xyz, 1)), :);
+
+% Index of the first point with the same coordinates
+[~, first_rows, groups] = unique(xyz, 'rows', 'stable');
+expected_first = uint64(first_rows(groups));
+expected_duplicate = expected_first ~= (1:size(xyz, 1))';
+
+try
+    [is_duplicate, first_indices] = findDuplicates(xyz(:, 1), xyz(:, 2), xyz(:, 3), 0, [], 0, 1);
+
+    if isequal(is_duplicate, expected_duplicate) && isequal(first_indices, expected_first)
+        fprintf('   Success Duplicates: %d duplicates are found\n', sum(is_duplicate));
+    else
+        fprintf('   Failure Duplicates: %d instead of %d duplicates are found\n', sum(is_duplicate), sum(expected_duplicate));
+        error_count = error_count + 1;
+    end
+
+    [is_duplicate_threads, first_indices_threads] = findDuplicates(xyz(:, 1), xyz(:, 2), xyz(:, 3), 0, [], 0, 4);
+
+    if isequal(is_duplicate_threads, is_duplicate) && isequal(first_indices_threads, first_indices)
+        fprintf('   Success Duplicates: 4 threads return the single thread result\n');
+    else
+        fprintf('   Failure Duplicates: 4 threads return another result than a single thread\n');
+        error_count = error_count + 1;
+    end
+catch ME
+    fprintf('   Failure Duplicates: Could not search duplicates\n');
+    fprintf('                       ErrorID: %s | ErrorMSg: %s\n', ME.identifier, ME.message);
+    error_count = error_count + 1;
+end
+
+%% Outliers
+fprintf('--- Start Test Outliers ---\n');
+
+% Dense cube of 100 m and single points far away from it and each other
+outlier_count = 20;
+xyz = [rand(test_cloud_point_count, 3) * 100; 1000 + rand(outlier_count, 3) * 1000];
+is_planted = [false(test_cloud_point_count, 1); true(outlier_count, 1)];
+
+try
+    [is_outlier, mean_distances] = findOutliers(xyz(:, 1), xyz(:, 2), xyz(:, 3), 8, 3, 1);
+
+    if isequal(is_outlier, is_planted)
+        fprintf('   Success Outliers: The planted outliers are found\n');
+    else
+        fprintf('   Failure Outliers: %d of %d planted outliers and %d other points are found\n', ...
+            sum(is_outlier & is_planted), outlier_count, sum(is_outlier & ~is_planted));
+        error_count = error_count + 1;
+    end
+
+    [is_outlier_threads, mean_distances_threads] = findOutliers(xyz(:, 1), xyz(:, 2), xyz(:, 3), 8, 3, 4);
+
+    if isequal(is_outlier_threads, is_outlier) && isequal(mean_distances_threads, mean_distances)
+        fprintf('   Success Outliers: 4 threads return the single thread result\n');
+    else
+        fprintf('   Failure Outliers: 4 threads return another result than a single thread\n');
+        error_count = error_count + 1;
+    end
+catch ME
+    fprintf('   Failure Outliers: Could not search outliers\n');
+    fprintf('                     ErrorID: %s | ErrorMSg: %s\n', ME.identifier, ME.message);
+    error_count = error_count + 1;
+end
+
+fprintf('--- Results ---\n');
+if error_count > 0
+    fprintf('!!! Failure: Encountered %d errors !!!!\n', error_count);
+else
+    fprintf('Success: No errors encountered\n');
+end
+fprintf('\nFinished: test_PointCleaning.m\n');
+end
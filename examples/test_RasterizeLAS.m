@@ -0,0 +1,150 @@
+function test_RasterizeLAS(test_cloud_point_count)
+%test_RasterizeLAS Tests rasterization with percentiles in bands of rows
+%   function test_RasterizeLAS(test_cloud_point_count)
+%
+%   Writes a random point cloud to subfolder unit_test_files and rasterizes
+%   it with the reducers min, p50, p95 and count. Percentiles are collected
+%   in bands of rows that fit into rasterBufferBytes, so a small buffer
+%   splits the raster into many bands. The raster has to be the same for
+%   the default buffer, a buffer of a few rows and a buffer below one row.
+%   Every layer is compared with the values of the cells computed in
+%   Matlab, percentiles with the nearest rank ceil(p / 100 * n).
+%   Which tests succeeded and which failed is printed to console
+%
+%   Arguments:
+%       test_cloud_point_count [numeric] : Number of random points
+%                                          Default: 100000
+%
+%   Example:
+%       test_RasterizeLAS(100000);
+%
+%   Uses and thereby (partially) tests the following functions and classes:
+%   \lib\addLASLibPaths.m
+%   \lib\classes\PCloudFun.m
+%   \lib\mex\readLASfile_cpp.mex(platform)
+%   \lib\mex\writeLASfile_cpp.mex(platform)
+%   \lib\mex\rasterizeLASfiles_cpp.mex(platform)
+%   \lib\readLASfile.m
+%   \lib\writeLASfile.m
+%   \lib\rasterizeLASfiles.m
+fprintf('\nRunning: test_RasterizeLAS.m\n\n');
+
+%% Test parameter
+if nargin < 1
+    test_cloud_point_count = 100000; % How many points to write in test LAS
+end
+
+%% Add and get required paths
+if ~isdeployed
+    mpath = mfilename('fullpath');
+    [root_path,~,~] = fileparts(fileparts(mpath));
+    addpath(fullfile(root_path, 'lib'));
+    addLASLibPaths()
+
+    out_dir = fullfile(root_path, 'examples', 'unit_test_files');
+else
+    out_dir = fullfile(pwd, 'unit_test_files');
+end
+
+if ~isdir(out_dir) %#ok
+   [status, msg, msgID]  = mkdir(out_dir);
+   if ~status
+       error('Could not create unit test dir:\n%s: %s', msgID, msg);
+   end
+end
+
+error_count = 0;
+testfile_name = fullfile(out_dir, 'unit_test_rasterize.las');
+
+% Random cloud inside of the extent on the 1 mm grid of its scale factors
+las = PCloudFun.Allocate(test_cloud_point_count, 4, 6);
+las.header.scale_factor_x = 0.001;
+las.header.scale_factor_y = 0.001;
+las.header.scale_factor_z = 0.001;
+las.x = round(rand(test_cloud_point_count, 1) * 99999) * las.header.scale_factor_x;
+las.y = round(rand(test_cloud_point_count, 1) * 99999) * las.header.scale_factor_y;
+las.z = round(randn(test_cloud_point_count, 1) * 1e4) * las.header.scale_factor_z;
+las.bits = uint8(17 * ones(test_cloud_point_count, 1));
+las.gps_time = (1:test_cloud_point_count)' * 1e-3;
+
+try
+    writeLASfile(las, testfile_name, 1, 4, 6, struct('computeHeaderStats', true));
+    lasIn = readLASfile(testfile_name);
+catch ME
+    fprintf('   Failure: Could not write or read cloud\n');
+    fprintf('            ErrorID: %s | ErrorMSg: %s\n', ME.identifier, ME.message);
+    fprintf('--- Results ---\n');
+    fprintf('!!! Failure: Encountered 1 errors !!!!\n');
+    return;
+end
+
+%% Rasterize with the default, a small and a too small buffer
+cell_size = 10;
+extent    = [0 0 100 100];
+reducers  = {'min', 'p50', 'p95', 'count'};
+buffer_bytes = {[], 250000, 1}; % Default, about three rows, one row
+
+rasters = cell(size(buffer_bytes));
+for i = 1:numel(buffer_bytes)
+    opt = struct('reducers', {reducers}, 'extent', extent);
+    if ~isempty(buffer_bytes{i})
+        opt.rasterBufferBytes = buffer_bytes{i};
+    end
+
+    try
+        rasters{i} = rasterizeLASfiles({testfile_name}, cell_size, opt);
+    catch ME
+        fprintf('   Failure Buffer %d: Could not rasterize cloud\n', i);
+        fprintf('                      ErrorID: %s | ErrorMSg: %s\n', ME.identifier, ME.message);
+        error_count = error_count + 1;
+    end
+end
+
+fprintf('--- Start Test Bands of Rows ---\n');
+for i = 2:numel(buffer_bytes)
+    if isequaln(rasters{i}, rasters{1})
+        fprintf('   Success Buffer of %d bytes: Raster equals the one of the default buffer\n', buffer_bytes{i});
+    else
+        fprintf('   Failure Buffer of %d bytes: Raster differs from the one of the default buffer\n', buffer_bytes{i});
+        error_count = error_count + 1;
+    end
+end
+
+%% Compare the layers with the cells computed in Matlab
+fprintf('--- Start Test Reducers ---\n');
+if ~isempty(rasters{end})
+    % Row 1 is the top row, cells hold their left and top border
+    rows = min(floor((extent(4) - lasIn.y) / cell_size) + 1, 10);
+    columns = floor((lasIn.x - extent(1)) / cell_size) + 1;
+    raster_size = [10, 10];
+
+    expected = cat(3, ...
+        accumarray([rows, columns], lasIn.z, raster_size, @min, NaN), ...
+        accumarray([rows, columns], lasIn.z, raster_size, @(v) nearestRank(v, 50), NaN), ...
+        accumarray([rows, columns], lasIn.z, raster_size, @(v) nearestRank(v, 95), NaN), ...
+        accumarray([rows, columns], 1, raster_size));
+
+    for layer = 1:numel(reducers)
+        if isequaln(rasters{end}(:, :, layer), expected(:, :, layer))
+            fprintf('   Success Reducer %s: Layer matches the values of the cells\n', reducers{layer});
+        else
+            fprintf('   Failure Reducer %s: Layer does not match the values of the cells\n', reducers{layer});
+            error_count = error_count + 1;
+        end
+    end
+end
+
+fprintf('--- Results ---\n');
+if error_count > 0
+    fprintf('!!! Failure: Encountered %d errors !!!!\n', error_count);
+else
+    fprintf('Success: No errors encountered\n');
+end
+fprintf('\nFinished: test_RasterizeLAS.m\n');
+end
+
+function value = nearestRank(values, percentile)
+% Value of nearest rank ceil(p / 100 * n) of the n values
+values = sort(values);
+value = values(max(ceil(percentile / 100 * numel(values)), 1));
+end
@@ -0,0 +1,114 @@
+function test_SpatialSort(test_cloud_point_count)
+%test_SpatialSort Tests the parallel spatial sorting while writing
+%   function test_SpatialSort(test_cloud_point_count)
+%
+%   The radix sort of spatialSort splits the points into fixed blocks that
+%   are distributed over the granted threads. With dynamic adjustment of
+%   threads (OMP_DYNAMIC=true) the OpenMP runtime may grant fewer threads
+%   than requested, which must not drop or duplicate points. OpenMP reads
+%   the variable when it is loaded, so start MATLAB with OMP_DYNAMIC=true
+%   to test this case; the variable is set here for the mex files of a
+%   fresh MATLAB session.
+%
+%   A random cloud is written to subfolder unit_test_files with spatialSort
+%   'hilbert' and read again, the read points have to be the written ones
+%   in a spatially coherent order.
+%   Which tests succeeded and which failed is printed to console
+%
+%   Arguments:
+%       test_cloud_point_count [numeric] : Number of random points, more
+%                                          than 65536 to sort in parallel
+%                                          Default: 300000
+%
+%   Example:
+%       test_SpatialSort(300000);
+%
+%   Uses and thereby (partially) tests the following functions and classes:
+%   \lib\addLASLibPaths.m
+%   \lib\classes\PCloudFun.m
+%   \lib\mex\readLASfile_cpp.mex(platform)
+%   \lib\mex\writeLASfile_cpp.mex(platform)
+%   \lib\readLASfile.m
+%   \lib\writeLASfile.m
+fprintf('\nRunning: test_SpatialSort.m\n\n');
+
+%% Test parameter
+if nargin < 1
+    test_cloud_point_count = 300000; % How many points to write in test LAS
+end
+
+setenv('OMP_DYNAMIC', 'true');
+
+%% Add and get required paths
+if ~isdeployed
+    mpath = mfilename('fullpath');
+    [root_path,~,~] = fileparts(fileparts(mpath));
+    addpath(fullfile(root_path, 'lib'));
+    addLASLibPaths()
+
+    out_dir = fullfile(root_path, 'examples', 'unit_test_files');
+else
+    out_dir = fullfile(pwd, 'unit_test_files');
+end
+
+if ~isdir(out_dir) %#ok
+   [status, msg, msgID]  = mkdir(out_dir);
+   if ~status
+       error('Could not create unit test dir:\n%s: %s', msgID, msg);
+   end
+end
+
+error_count = 0;
+
+% Random cloud on the 1 mm grid of its scale factors, so the coordinates
+% are read back exactly. GPS times are unique and identify the points
+las = PCloudFun.Allocate(test_cloud_point_count, 4, 6);
+las.header.scale_factor_x = 0.001;
+las.header.scale_factor_y = 0.001;
+las.header.scale_factor_z = 0.001;
+las.x = round(rand(test_cloud_point_count, 1) * 1e5) * las.header.scale_factor_x;
+las.y = round(rand(test_cloud_point_count, 1) * 1e5) * las.header.scale_factor_y;
+las.z = round(rand(test_cloud_point_count, 1) * 1e4) * las.header.scale_factor_z;
+las.bits = uint8(17 * ones(test_cloud_point_count, 1));
+las.gps_time = (1:test_cloud_point_count)' * 1e-3;
+
+%% Spatial sort while writing
+fprintf('--- Start Test Spatial Sort ---\n');
+testfile_name = fullfile(out_dir, 'unit_test_spatial_sort.las');
+try
+    writeLASfile(las, testfile_name, 1, 4, 6, struct('spatialSort', 'hilbert'));
+    lasIn = readLASfile(testfile_name);
+
+    % Every point exactly once
+    [time_sorted, order] = sort(lasIn.gps_time);
+    if isequal(time_sorted, las.gps_time) && isequal(lasIn.x(order), las.x) && ...
+            isequal(lasIn.y(order), las.y) && isequal(lasIn.z(order), las.z)
+        fprintf('   Success Spatial Sort: Every point is written once\n');
+    else
+        fprintf('   Failure Spatial Sort: Points are missing or written more than once\n');
+        error_count = error_count + 1;
+    end
+
+    % Consecutive points of a Hilbert curve are close, random points are not
+    sorted_step   = mean(hypot(diff(lasIn.x), diff(lasIn.y)));
+    unsorted_step = mean(hypot(diff(las.x), diff(las.y)));
+    if sorted_step < unsorted_step / 10
+        fprintf('   Success Spatial Sort: Points are spatially ordered\n');
+    else
+        fprintf('   Failure Spatial Sort: Mean step of %g is not shorter than %g of the unsorted points\n', sorted_step, unsorted_step);
+        error_count = error_count + 1;
+    end
+catch ME
+    fprintf('   Failure Spatial Sort: Could not write or read cloud\n');
+    fprintf('                         ErrorID: %s | ErrorMSg: %s\n', ME.identifier, ME.message);
+    error_count = error_count + 1;
+end
+
+fprintf('--- Results ---\n');
+if error_count > 0
+    fprintf('!!! Failure: Encountered %d errors !!!!\n', error_count);
+else
+    fprintf('Success: No errors encountered\n');
+end
+fprintf('\nFinished: test_SpatialSort.m\n');
+end
@@ -0,0 +1,91 @@
+function test_VoxelGridFilter(test_cloud_point_count)
+%test_VoxelGridFilter Tests the parallel voxel grouping of voxelGridFilter
+%   function test_VoxelGridFilter(test_cloud_point_count)
+%
+%   voxelGridFilter splits the points into fixed blocks that are
+%   distributed over the granted threads. With dynamic adjustment of
+%   threads (OMP_DYNAMIC=true) the OpenMP runtime may grant fewer threads
+%   than requested, which must not drop points. OpenMP reads the variable
+%   when it is loaded, so start MATLAB with OMP_DYNAMIC=true to test this
+%   case; the variable is set here for the mex files of a fresh MATLAB
+%   session.
+%
+%   Every point of a random cloud has to be in one voxel, and 4 and all
+%   threads have to return the voxels of a single thread, with hash tables
+%   and sorted.
+%   Which tests succeeded and which failed is printed to console
+%
+%   Arguments:
+%       test_cloud_point_count [numeric] : Number of random points, more
+%                                          than 1e4 to group in parallel
+%                                          Default: 300000
+%
+%   Example:
+%       test_VoxelGridFilter(300000);
+%
+%   Uses and thereby (partially) tests the following functions and classes:
+%   \lib\addLASLibPaths.m
+%   \lib\mex\voxelGridFilter_cpp.mex(platform)
+%   \lib\utility\voxelGridFilter.m
+fprintf('\nRunning: test_VoxelGridFilter.m\n\n');
+
+%% Test parameter
+if nargin < 1
+    test_cloud_point_count = 300000; % How many random points
+end
+
+setenv('OMP_DYNAMIC', 'true');
+
+%% Add required paths
+if ~isdeployed
+    mpath = mfilename('fullpath');
+    [root_path,~,~] = fileparts(fileparts(mpath));
+    addpath(fullfile(root_path, 'lib'));
+    addLASLibPaths()
+end
+
+error_count = 0;
+
+x = rand(test_cloud_point_count, 1) * 100;
+y = rand(test_cloud_point_count, 1) * 100;
+z = rand(test_cloud_point_count, 1) * 10;
+
+%% Voxel grouping with different numbers of threads
+voxel_size = 2;
+for sorted = [false, true]
+    fprintf('--- Start Test Voxel Grouping (sorted: %d) ---\n', sorted);
+    try
+        [indices_single, ~, counts_single] = voxelGridFilter(x, y, z, voxel_size, 'first', 1, sorted);
+
+        if sum(counts_single) == test_cloud_point_count
+            fprintf('   Success Voxel Grouping: Every point is in one voxel\n');
+        else
+            fprintf('   Failure Voxel Grouping: %d of %d points are in a voxel\n', sum(counts_single), test_cloud_point_count);
+            error_count = error_count + 1;
+        end
+
+        for num_threads = [4, 0]
+            [indices, ~, counts] = voxelGridFilter(x, y, z, voxel_size, 'first', num_threads, sorted);
+
+            if isequal(indices, indices_single) && isequal(counts, counts_single)
+                fprintf('   Success Voxel Grouping: Threads %d return the single thread voxels\n', num_threads);
+            else
+                fprintf('   Failure Voxel Grouping: Threads %d return other voxels than a single thread\n', num_threads);
+                error_count = error_count + 1;
+            end
+        end
+    catch ME
+        fprintf('   Failure Voxel Grouping: Could not group points\n');
+        fprintf('                           ErrorID: %s | ErrorMSg: %s\n', ME.identifier, ME.message);
+        error_count = error_count + 1;
+    end
+end
+
+fprintf('--- Results ---\n');
+if error_count > 0
+    fprintf('!!! Failure: Encountered %d errors !!!!\n', error_count);
+else
+    fprintf('Success: No errors encountered\n');
+end
+fprintf('\nFinished: test_VoxelGridFilter.m\n');
+end
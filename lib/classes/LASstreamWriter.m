@@ -0,0 +1,208 @@
+classdef LASstreamWriter < handle
+    %LASstreamWriter : Writes a LAS-File chunk by chunk
+    %   Header and variable length records are written when the writer is
+    %   created. Chunks of points are written with writeChunk. Point
+    %   counts, points by return, bounding box and extended variable
+    %   length records are written on close. Only one chunk has to be in
+    %   memory at a time, so files larger than the memory can be written.
+    %
+    %   Example:
+    %       writer = LASstreamWriter('C:\out.las', las);
+    %       writer.writeChunk(chunk1);
+    %       writer.writeChunk(chunk2);
+    %       writer.close();
+    %
+    %   The header of las must contain point_data_format, version and
+    %   valid scale factors and offsets for all chunks. (Extended)
+    %   variable length records have to be in the format of readLASfile.
+    %   Chunks are LAS structures containing the point fields of the point
+    %   data record format. Coordinates that can not be represented with
+    %   the scale factors and offsets of the header cause an error.
+    %
+    % Copyright (c) 2022, Patrick Kmmerle
+    % Licence: see the included file
+
+    properties (SetAccess = private)
+        Filename                % Path of the written LAS-File
+        PointDataFormat         % Point data record format of the file
+        PointCount = 0          % Number of points written so far
+    end
+
+    properties (Access = private)
+        Handle = []             % Handle of the writeLASstream_cpp session
+    end
+
+    methods
+        function obj = LASstreamWriter(filename, las, optional)
+            %LASstreamWriter Creates the file and writes header and VLRs
+            %
+            %   Arguments:
+            %       filename [char]   : Full path to output file
+            %       las [struct]      : LAS structure with header,
+            %                           variablerecords and extendedvariables
+            %       optional [struct] : Optional writer settings
+            %           asyncWrite    : If true then chunks are encoded
+            %                           while a background thread writes
+            %                           (Default: false)
+            writerOptions = struct();
+            if nargin > 2 && isfield(optional, 'asyncWrite')
+                writerOptions.asyncWrite = double(optional.asyncWrite);
+            end
+
+            if ~isfield(las, 'variablerecords')
+                las.variablerecords = [];
+            end
+            if ~isfield(las, 'extendedvariables')
+                las.extendedvariables = [];
+            end
+
+            las.header = LASstreamWriter.PrepareHeader(las);
+
+            obj.Filename        = char(filename);
+            obj.PointDataFormat = las.header.point_data_format;
+            obj.Handle          = writeLASstream_cpp('open', las, obj.Filename, writerOptions);
+        end
+
+        function writeChunk(obj, chunk)
+            %writeChunk Writes the points of a LAS structure chunk
+            %   Fields are cast to the types of the point data record
+            %   format if necessary. If writing a chunk fails, the file
+            %   is incomplete and the writer only accepts close
+            %
+            %   Arguments:
+            %       chunk [struct] : LAS structure with point fields
+            if isempty(obj.Handle)
+                error('LASstreamWriter:closed', 'Writer is already closed!');
+            end
+
+            chunk = LASstreamWriter.FixDataTypes(chunk, obj.PointDataFormat);
+            writeLASstream_cpp('write', obj.Handle, chunk);
+            obj.PointCount = obj.PointCount + numel(chunk.x);
+        end
+
+        function close(obj)
+            %close Writes header statistics and extended VLRs and
+            %   closes the file
+            if ~isempty(obj.Handle)
+                handle = obj.Handle;
+                obj.Handle = [];
+                writeLASstream_cpp('close', handle);
+            end
+        end
+
+        function delete(obj)
+            %delete Closes the file if the writer is destroyed
+            obj.close();
+        end
+    end
+
+    methods (Static, Access = private)
+        function lasHeader = PrepareHeader(las)
+            % lasHeader = PrepareHeader(las)
+            %
+            %   Sets header size, VLR counts, offset to point data and
+            %   record length. Point counts and bounding box are set to
+            %   zero, they are computed while writing
+            lasHeader     = las.header;
+            headerSizes   = [227, 227, 227, 235, 375];
+            recordLength  = PCloudFun.record_lengths(PCloudFun.supported_record_formats == lasHeader.point_data_format);
+
+            if isempty(recordLength) || lasHeader.version_major ~= 1 || ~any(lasHeader.version_minor == 1:4)
+                error('LASstreamWriter:header', 'Version or point data record format not supported!');
+            end
+            if lasHeader.point_data_format > 5 && lasHeader.version_minor < 4
+                error('LASstreamWriter:header', 'Point data record formats 6 to 10 need LAS 1.4!');
+            end
+
+            % Keep a longer record length for extra bytes
+            if ~isfield(lasHeader, 'point_data_record_length') || lasHeader.point_data_record_length < recordLength
+                lasHeader.point_data_record_length = recordLength;
+            end
+
+            lasHeader.header_size                = headerSizes(lasHeader.version_minor + 1);
+            lasHeader.number_of_variable_records = numel(las.variablerecords);
+            lasHeader.offset_to_point_data       = lasHeader.header_size;
+            if ~isempty(las.variablerecords)
+                lasHeader.offset_to_point_data = lasHeader.offset_to_point_data + ...
+                    sum(54 + double([las.variablerecords.record_length]));
+            end
+
+            lasHeader.number_of_point_records    = 0;
+            lasHeader.number_of_points_by_return = zeros(1, 5 + 10 * (lasHeader.version_minor > 3));
+            boundingBoxFields = {'max_x', 'min_x', 'max_y', 'min_y', 'max_z', 'min_z'};
+            for i = 1:numel(boundingBoxFields)
+                lasHeader.(boundingBoxFields{i}) = 0;
+            end
+
+            if ~isfield(lasHeader, 'start_of_waveform_data')
+                lasHeader.start_of_waveform_data = 0;
+            end
+
+            % Start of extended VLRs is set on close
+            lasHeader.number_of_extended_variable_length_record = numel(las.extendedvariables);
+            lasHeader.start_of_extended_variable_length_record  = 0;
+
+            % Zero terminated char arrays of fixed length
+            lasHeader.system_identifier   = LASstreamWriter.FixedLengthString(lasHeader.system_identifier, 32);
+            lasHeader.generating_software = LASstreamWriter.FixedLengthString(lasHeader.generating_software, 32);
+
+            % The C++ writer reads all numeric header fields as double
+            headerFields = fieldnames(lasHeader);
+            for k = 1:numel(headerFields)
+                if isnumeric(lasHeader.(headerFields{k}))
+                    lasHeader.(headerFields{k}) = double(lasHeader.(headerFields{k}));
+                end
+            end
+        end
+
+        function chunk = FixDataTypes(chunk, recordFormat)
+            % chunk = FixDataTypes(chunk, recordFormat)
+            %
+            %   Casts the point fields of a chunk to the types that are
+            %   written for the given point data record format
+            fieldTypes = {'x', 'double'; 'y', 'double'; 'z', 'double';
+                'intensity', 'uint16'; 'bits', 'uint8'; 'classification', 'uint8';
+                'user_data', 'uint8'; 'point_source_id', 'uint16'};
+
+            if any(recordFormat == PCloudFun.LASContains16bitAngle)
+                fieldTypes = [fieldTypes; {'scan_angle', 'int16'; 'bits2', 'uint8'}];
+            else
+                fieldTypes = [fieldTypes; {'scan_angle', 'int8'}];
+            end
+            if any(recordFormat == PCloudFun.LASContainsTime)
+                fieldTypes = [fieldTypes; {'gps_time', 'double'}];
+            end
+            if any(recordFormat == PCloudFun.LASContainsColor)
+                fieldTypes = [fieldTypes; {'red', 'uint16'; 'green', 'uint16'; 'blue', 'uint16'}];
+            end
+            if any(recordFormat == PCloudFun.LASContainsNIR)
+                fieldTypes = [fieldTypes; {'nir', 'uint16'}];
+            end
+            if any(recordFormat == PCloudFun.LASContainsWavePackets)
+                fieldTypes = [fieldTypes; {'wave_packet_descriptor', 'uint8'; 'wave_byte_offset', 'uint64';
+                    'wave_packet_size', 'uint32'; 'wave_return_point', 'single';
+                    'Xt', 'single'; 'Yt', 'single'; 'Zt', 'single'}];
+            end
+            if isfield(chunk, 'extradata')
+                fieldTypes = [fieldTypes; {'extradata', 'uint8'}];
+            end
+
+            for i = 1:size(fieldTypes, 1)
+                if isfield(chunk, fieldTypes{i,1}) && ~isa(chunk.(fieldTypes{i,1}), fieldTypes{i,2})
+                    chunk.(fieldTypes{i,1}) = cast(chunk.(fieldTypes{i,1}), fieldTypes{i,2});
+                end
+            end
+        end
+
+        function stringOutput = FixedLengthString(stringInput, strlength)
+            % stringOutput = FixedLengthString(stringInput, strlength)
+            %
+            %   Turns input into a zero padded char array of length
+            %   strlength + 1
+            terminatedArray = zeros(1, strlength + 1, 'uint8');
+            charCount = min(length(stringInput), strlength);
+            terminatedArray(1:charCount) = uint8(stringInput(1:charCount));
+            stringOutput = char(terminatedArray);
+        end
+    end
+end
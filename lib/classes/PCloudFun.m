@@ -309,6 +309,37 @@ classdef PCloudFun
             las = PCloudFun.SetAtIndex(las, lasAppend, index);
         end
         
+        function las = SetClass(las, indices, classValue)
+            % las = SetClass(las, indices, classValue)
+            %
+            %   Sets the classification of points, e.g. of the noise
+            %   found by findOutliers or findDuplicates to class 7. Record
+            %   formats 0 to 5 keep the flags in bits 5 to 7 of their
+            %   classification byte, so their class has to be below 32
+            %
+            %   Arguments:
+            %       las (struct)           : LAS Point Cloud structure
+            %       indices (numeric array): array with point indices or
+            %                                logical vector
+            %       classValue (numeric)   : class to set (default 7,
+            %                                low noise)
+            %
+            %   Returns:
+            %       las (struct)           : LAS Point Cloud structure
+            if nargin < 3
+                classValue = 7;
+            end
+            
+            if las.header.point_data_format < 6
+                if classValue > 31
+                    error('Classes of record formats 0 to 5 have to be below 32')
+                end
+                las.classification(indices) = bitor(bitand(las.classification(indices), 224), uint8(classValue));
+            else
+                las.classification(indices) = uint8(classValue);
+            end
+        end
+        
         function recordFormatInfo = RecordFormatInfo(recordFormat)
             % recordFormatInfo = RecordFormatInfo(recordFormat)
             %
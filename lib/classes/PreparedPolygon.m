@@ -0,0 +1,145 @@
+classdef PreparedPolygon < handle
+    %PreparedPolygon : Polygon that is prepared once for many point in
+    %   polygon tests
+    %   The edges of the polygon are binned into slabs and the coefficients
+    %   of the tests are computed when the object is created. They are kept
+    %   by the mex function until the object is released or destroyed, so
+    %   one polygon can be tested against the points of many tiles without
+    %   preparing it again. The tests are the same as in isPointInPolygon.
+    %
+    %   Example:
+    %       parcel = PreparedPolygon(polyX, polyY);
+    %       for i = 1:numel(tiles)
+    %           las = readLASfile(tiles{i});
+    %           isInside = parcel.isInside(las.x, las.y, 0);
+    %       end
+    %       parcel.release();
+    %
+    %   The polygon is stored as single if both coordinate vectors are
+    %   single and as double otherwise. Points are cast to that type.
+    %
+    %   With the scale and offset of a LAS-File the polygon is quantized
+    %   once to the integer coordinates of the point records (ClassName
+    %   'int32'). The points are then given as int32 record coordinates,
+    %   round((x - x_offset) / scale_factor_x), and the tests are computed
+    %   exactly with 64 bit integers, so points on an edge or vertex are
+    %   always classified correctly and no points are converted to double.
+    %   The quantized polygon has to be smaller than 2^31 records.
+    %       parcel = PreparedPolygon(polyX, polyY, las.header);
+    %       isInside = parcel.isInside(recordX, recordY, 0, 1);
+    %   Rings of polygons with holes are separated by NaN, as described in
+    %   isPointInPolygon.
+    %
+    % Copyright (c) 2022, Patrick Kmmerle
+    % Licence: see the included file
+
+    properties (SetAccess = private)
+        ClassName               % Type of the polygon, 'double', 'single' or 'int32'
+        VertexCount             % Number of polygon vertices
+    end
+
+    properties (Access = private)
+        Handle = []             % Handle of the isPointInPolygon_cpp polygon
+    end
+
+    methods
+        function obj = PreparedPolygon(polyX, polyY, quantization)
+            %PreparedPolygon Prepares the polygon for the tests
+            %
+            %   Arguments:
+            %       polyX [nx1 float] : X-Coordinates of polygon vertices,
+            %                           rings separated by NaN
+            %       polyY [nx1 float] : Y-Coordinates of polygon vertices,
+            %                           rings separated by NaN
+            %       quantization      : (optional) LAS header struct with
+            %                           scale factors and offsets, or
+            %                           [xScale yScale xOffset yOffset]
+            %                           to test int32 record coordinates
+            obj.VertexCount = numel(polyX);
+
+            if nargin > 2
+                if isstruct(quantization)
+                    quantization = [quantization.scale_factor_x, quantization.scale_factor_y, ...
+                        quantization.x_offset, quantization.y_offset];
+                end
+
+                obj.ClassName = 'int32';
+                obj.Handle = isPointInPolygon_cpp('prepare', double(polyX), double(polyY), ...
+                    double(quantization(:)));
+                return;
+            end
+
+            if isa(polyX, 'single') && isa(polyY, 'single')
+                obj.ClassName = 'single';
+            else
+                obj.ClassName = 'double';
+            end
+
+            obj.Handle = isPointInPolygon_cpp('prepare', ...
+                cast(polyX, obj.ClassName), cast(polyY, obj.ClassName));
+        end
+
+        function isInside = isInside(obj, pointsX, pointsY, numThreads, algorithm, outputMode)
+            %isInside Tests points against the prepared polygon
+            %
+            %   Arguments:
+            %       pointsX [nx1 float] : X-Coordinates of query points
+            %                             (int32 records if quantized)
+            %       pointsY [nx1 float] : Y-Coordinates of query points
+            %                             (int32 records if quantized)
+            %       numThreads [double] : Max. number of threads used if
+            %                             above threshold (default is 1)
+            %       algorithm [int]     : 0 == Winding Number (default)
+            %                             1 == WN but edges count inside
+            %                             2 == Ray Casting
+            %       outputMode [char]   : 'mask' (default), 'indices' or
+            %                             'bits' (see isPointInPolygon)
+            %
+            %   Returns:
+            %       isInside [nx1 bool] : true if point is inside, or
+            %                             indices or bit mask of the
+            %                             inside points
+            if isempty(obj.Handle)
+                error('PreparedPolygon:released', 'Polygon was already released!');
+            end
+            if nargin < 4
+                numThreads = 1;
+            end
+            if nargin < 5
+                algorithm = 0;
+            end
+            if nargin < 6
+                outputMode = 'mask';
+            end
+
+            % Casting coordinates to records would silently drop scale and offset
+            if strcmp(obj.ClassName, 'int32') && ~(isa(pointsX, 'int32') && isa(pointsY, 'int32'))
+                error('PreparedPolygon:type', 'Quantized polygon needs int32 record coordinates!');
+            end
+
+            if ~isa(pointsX, obj.ClassName)
+                pointsX = cast(pointsX, obj.ClassName);
+            end
+            if ~isa(pointsY, obj.ClassName)
+                pointsY = cast(pointsY, obj.ClassName);
+            end
+
+            isInside = isPointInPolygon_cpp('test', obj.Handle, pointsX, pointsY, numThreads, ...
+                algorithm, lower(char(outputMode)));
+        end
+
+        function release(obj)
+            %release Frees the prepared polygon of the mex function
+            if ~isempty(obj.Handle)
+                handle = obj.Handle;
+                obj.Handle = [];
+                isPointInPolygon_cpp('release', handle);
+            end
+        end
+
+        function delete(obj)
+            %delete Releases the polygon if the object is destroyed
+            obj.release();
+        end
+    end
+end
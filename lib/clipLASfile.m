@@ -0,0 +1,88 @@
+function result = clipLASfile(inputFiles, polyX, polyY, outputFile, optional)
+% lasStruct  = clipLASfile(inputFiles, polyX, polyY)
+% pointCount = clipLASfile(inputFiles, polyX, polyY, outputFile)
+% ...        = clipLASfile(inputFiles, polyX, polyY, outputFile, optional)
+%
+%   Supports Versions LAS 1.0 - 1.4
+%   Supports Point Data Record Format 0 to 10
+%
+%   Keeps only the points of one or more LAS-Files that are inside of a
+%   polygon. The point records are streamed through the C++ transcoder,
+%   which rejects points outside of the bounding box of the polygon on
+%   their raw integer coordinates and tests the others with the winding
+%   number of isPointInPolygon, so the input files are never loaded into
+%   Matlab as a whole. Points on the border of the polygon are not kept.
+%
+%   Without outputFile the inside points are returned as a LAS structure
+%   of readLASfile. They are written to a temporary file that is read and
+%   deleted, so only the clipped points have to fit into memory.
+%   Several inputs are merged as described in mergeLASfiles.
+%
+%   Input:
+%       inputFiles (string or cell) : Full path(s) to input LAS-File(s)
+%       polyX [nx1 double]   : X-Coordinates of polygon vertices,
+%                              rings separated by NaN
+%       polyY [nx1 double]   : Y-Coordinates of polygon vertices,
+%                              rings separated by NaN
+%       outputFile (string)  : Full path to output LAS-File (optional,
+%                              can be empty to return a LAS structure)
+%       optional (struct)    : Further filters and transformations of
+%                              transcodeLASfile or mergeLASfiles
+%
+%   Returns:
+%       lasStruct [struct]   : Clipped points if no output file is given
+%       pointCount           : Number of points written to outputFile
+%
+%   Example:
+%       parcel = clipLASfile('C:\tile.las', polyX, polyY);
+%       clipLASfile({'C:\a.las', 'C:\b.las'}, polyX, polyY, 'C:\parcel.las');
+%
+%   Source: transcodeLASfile_cpp.cpp mergeLASfiles_cpp.cpp LASTranscoder.cpp
+%
+% Copyright (c) 2022, Patrick Kmmerle
+% Licence: see the included file
+
+if nargin < 3
+    error('Not enough input arguments! Needs at least inputFiles, polyX and polyY')
+end
+if numel(polyX) ~= numel(polyY)
+    error('clipLASfile:polygon', 'Polygon X and Y have to be of same size!')
+end
+if nargin < 4
+    outputFile = [];
+end
+if nargin < 5
+    optional = struct();
+end
+
+optional.polygon = [double(polyX(:)), double(polyY(:))];
+
+% Without output file the clipped points go through a temporary file
+returnStruct = isempty(outputFile);
+if returnStruct
+    outputFile = [tempname '.las'];
+    cleanupTemporary = onCleanup(@() DeleteIfExists(outputFile));
+end
+
+if ischar(inputFiles) || (isstring(inputFiles) && isscalar(inputFiles))
+    pointCount = transcodeLASfile(char(inputFiles), outputFile, optional);
+else
+    pointCount = mergeLASfiles(inputFiles, outputFile, optional);
+end
+
+if returnStruct
+    result = readLASfile(outputFile);
+else
+    result = pointCount;
+end
+end
+
+%% --- Subfunction Block ---
+function DeleteIfExists(filePath)
+% DeleteIfExists(filePath)
+%
+%   Deletes the temporary file of the clipped points
+if exist(filePath, 'file') == 2
+    delete(filePath);
+end
+end
@@ -0,0 +1,105 @@
+function pointCount = mergeLASfiles(inputFiles, outputFile, optional)
+% pointCount = mergeLASfiles(inputFiles, outputFile)
+% pointCount = mergeLASfiles(inputFiles, outputFile, optional)
+%
+%   Supports Versions LAS 1.0 - 1.4
+%   Supports Point Data Record Formats 0 to 10
+%
+%   Concatenates the point records of several LAS-Files into one LAS-File
+%   without reading them into Matlab. The inputs are read concurrently and
+%   the output is written sequentially in the order of the inputs, so only
+%   a few megabytes of memory are used independent of the file sizes.
+%
+%   If the inputs differ, a common point data record format is chosen that
+%   holds the fields of all inputs, as well as the finest scale factors of
+%   the inputs. Offsets are kept if they are the same for all inputs and
+%   the merged extent fits, otherwise the center of the merged extent is
+%   used. Coordinates are requantized with integers if the scale factors
+%   and offsets allow it. VLRs and extended VLRs are taken over once per
+%   user and record ID (a warning is shown if the coordinate reference
+%   systems differ), extra bytes only if all inputs describe them the same
+%   way. Bounding box and point counts are recomputed.
+%
+%   Input:
+%       inputFiles (cell)   : Full paths to the input LAS-Files
+%       outputFile (string) : Full path to output LAS-File
+%       optional (struct)   : Optional filters and transformations
+%
+%       optional struct fields:
+%          bbox             : Keep only points inside of the box
+%                             [xmin ymin xmax ymax] or
+%                             [xmin ymin zmin xmax ymax zmax]
+%          classes          : Keep only points of these classes
+%          returnNumbers    : Keep only points with these return numbers
+%          timeWindow       : Keep only points with a GPS time inside of
+%                             [tmin tmax]
+%          polygon          : Keep only points inside of the polygon
+%                             [x y] with one vertex per row. Rings of
+%                             polygons with holes are separated by NaN
+%                             (winding number of isPointInPolygon, points
+%                             on the border are not kept)
+%          scale            : Scale factors of the output [sx sy sz]
+%          offset           : Coordinate offsets of the output [ox oy oz]
+%          targetPointFormat : Point data record format of the output
+%          dropExtraBytes   : If true then the extra bytes of the records
+%                             and their description VLR are not copied
+%
+%   Returns:
+%       pointCount          : Number of points written to the output
+%
+%   Example:
+%       files = dir('C:\tiles\*.las');
+%       paths = fullfile({files.folder}, {files.name});
+%       mergeLASfiles(paths, 'C:\merged.las');
+%
+%   Source: mergeLASfiles_cpp.cpp LASTranscoder.cpp
+%   To rebuild this function run the provided script 'build_mergeLASfiles.m'
+%
+% Copyright (c) 2022, Patrick Kmmerle
+% Licence: see the included file
+
+if nargin < 2
+    error('Not enough input arguments! Needs at least inputFiles and outputFile')
+end
+
+if ischar(inputFiles)
+    inputFiles = {inputFiles};
+end
+inputFiles = cellfun(@char, cellstr(inputFiles), 'UniformOutput', false);
+
+mergeOptions = struct();
+if nargin > 2
+    mergeOptions = GetMergeOptions(optional);
+end
+
+% Create output directory if doesn't exist (isdir for backwards comp)
+pathtmp = fileparts(outputFile);
+if ~isempty(pathtmp) && ~isdir(pathtmp) %#ok
+    mkdir(pathtmp);
+end
+
+pointCount = mergeLASfiles_cpp(inputFiles, char(outputFile), mergeOptions);
+end
+
+%% --- Subfunction Block ---
+function mergeOptions = GetMergeOptions(optional)
+% mergeOptions = GetMergeOptions(optional)
+%
+%   Copies the fields of the optional input struct, that are handled by
+%   the C++ transcoder, to a new struct. Numeric options are cast to double
+%
+%   Arguments:
+%       optional [struct]     : optional input struct of mergeLASfiles
+%
+%   Returns:
+%       mergeOptions [struct] : options struct for mergeLASfiles_cpp
+optionNames = {'bbox', 'classes', 'returnNumbers', 'timeWindow', 'polygon', 'scale', ...
+    'offset', 'targetPointFormat', 'dropExtraBytes'};
+mergeOptions = struct();
+
+for i = 1:numel(optionNames)
+    if isfield(optional, optionNames{i})
+        mergeOptions.(optionNames{i}) = double(optional.(optionNames{i}));
+    end
+end
+end
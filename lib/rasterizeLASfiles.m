@@ -0,0 +1,115 @@
+function [raster, extent] = rasterizeLASfiles(inputFiles, cellSize, optional)
+% [raster, extent] = rasterizeLASfiles(inputFiles, cellSize)
+% [raster, extent] = rasterizeLASfiles(inputFiles, cellSize, optional)
+%
+%   Supports Versions LAS 1.0 - 1.4
+%   Supports Point Data Record Formats 0 to 10
+%
+%   Bins the points of one or several LAS-Files into a grid of square
+%   cells without reading them into Matlab. Every layer of the raster
+%   reduces the z coordinates or intensities of the points of a cell to
+%   one value. Minimum, maximum, mean and count are computed while the
+%   files are read once. Percentiles need the values of the cells, they
+%   are collected in bands of rows that fit into rasterBufferBytes and the
+%   files are read once more for every band. So the memory is bounded by
+%   the raster and the buffer independent of the file sizes. Rasters that
+%   do not fit into the physical memory, e.g. of a too small cell size,
+%   are rejected before they are allocated. A single row of values may
+%   exceed the buffer, but it has to fit next to the raster as well.
+%
+%   Row 1 of the raster is the top row (largest y) and column 1 the left
+%   column (smallest x). Cells hold their left and top border. Without an
+%   extent, the bounding boxes of the file headers are widened to whole
+%   multiples of the cell size. Empty cells are NaN, except for counts.
+%
+%   Input:
+%       inputFiles (cell)   : Full paths to the input LAS-Files
+%       cellSize (double)   : Edge length of the cells
+%       optional (struct)   : Optional raster settings and filters
+%
+%       optional struct fields:
+%          reducers         : Reducer of every layer as cell array of
+%                             'min', 'max', 'mean', 'count' or a
+%                             percentile 'p0' to 'p100' like 'p95'
+%                             (default 'max')
+%          values           : Value of the reducers, 'z' or 'intensity',
+%                             or a cell array with one value per reducer
+%                             (default 'z')
+%          extent           : Extent of the raster [xmin ymin xmax ymax],
+%                             widened to whole cells at xmax and ymin
+%          rasterBufferBytes : Bytes of values of a band of rows for the
+%                             percentiles (default 256 MiB)
+%          bbox             : Keep only points inside of the box
+%                             [xmin ymin xmax ymax] or
+%                             [xmin ymin zmin xmax ymax zmax]
+%          classes          : Keep only points of these classes
+%          returnNumbers    : Keep only points with these return numbers
+%          timeWindow       : Keep only points with a GPS time inside of
+%                             [tmin tmax]
+%          polygon          : Keep only points inside of the polygon
+%                             [x y] with one vertex per row. Rings of
+%                             polygons with holes are separated by NaN
+%
+%   Returns:
+%       raster              : rows x columns x reducers array
+%       extent              : Extent of the raster [xmin ymin xmax ymax]
+%
+%   Example:
+%       opt = struct('reducers', {{'min', 'p50', 'count'}}, 'classes', 2);
+%       [dtm, extent] = rasterizeLASfiles({'C:\tile1.las', 'C:\tile2.las'}, 1, opt);
+%       imagesc(extent([1 3]), extent([4 2]), dtm(:,:,2)); axis xy image;
+%
+%   Source: rasterizeLASfiles_cpp.cpp LASTranscoder.cpp
+%   To rebuild this function run the provided script 'build_rasterizeLASfiles.m'
+%
+% Copyright (c) 2022, Patrick Kmmerle
+% Licence: see the included file
+
+if nargin < 2
+    error('Not enough input arguments! Needs at least inputFiles and cellSize')
+end
+
+if ischar(inputFiles)
+    inputFiles = {inputFiles};
+end
+inputFiles = cellfun(@char, cellstr(inputFiles), 'UniformOutput', false);
+
+rasterOptions = struct();
+if nargin > 2
+    rasterOptions = GetRasterOptions(optional);
+end
+rasterOptions.cellSize = double(cellSize);
+
+[raster, extent] = rasterizeLASfiles_cpp(inputFiles, rasterOptions);
+end
+
+%% --- Subfunction Block ---
+function rasterOptions = GetRasterOptions(optional)
+% rasterOptions = GetRasterOptions(optional)
+%
+%   Copies the fields of the optional input struct, that are handled by
+%   the C++ rasterizer, to a new struct. Numeric options are cast to
+%   double, reducers and values are passed as they are
+%
+%   Arguments:
+%       optional [struct]      : optional input struct of rasterizeLASfiles
+%
+%   Returns:
+%       rasterOptions [struct] : options struct for rasterizeLASfiles_cpp
+optionNames = {'extent', 'rasterBufferBytes', 'bbox', 'classes', 'returnNumbers', ...
+    'timeWindow', 'polygon'};
+rasterOptions = struct();
+
+for i = 1:numel(optionNames)
+    if isfield(optional, optionNames{i})
+        rasterOptions.(optionNames{i}) = double(optional.(optionNames{i}));
+    end
+end
+
+textNames = {'reducers', 'values'};
+for i = 1:numel(textNames)
+    if isfield(optional, textNames{i})
+        rasterOptions.(textNames{i}) = optional.(textNames{i});
+    end
+end
+end
@@ -1,6 +1,7 @@
-function lasStruct = readLASfile(lasFilePath, optsString)
+function lasStruct = readLASfile(lasFilePath, optsString, lodOptions)
 % function lasStruct = readLasFile(lasFilePath)
 % or       lasStruct = readLasFile(lasFilePath, optsString)
+% or       lasStruct = readLasFile(lasFilePath, optsString, lodOptions)
 % 
 % Supports Versions LAS 1.1 - 1.4
 % Supports Point Data Record Format 0 to 10. Partially supports other PDRF.
@@ -18,6 +19,9 @@ function lasStruct = readLASfile(lasFilePath, optsString)
 %
 % Input:        lasFilePath [char array]:	Full Path to LAS-File
 % (optional)    optsString  [char array]:   Optional input option string
+% (optional)    lodOptions  [struct]:       Read only nodes of the level of
+%                                           detail octree (see writeLASfile
+%                                           option lodOctree)
 %
 % optsString:   'LoadOnlyHeader' - Fill header struct only
 %               'VLR'			 - Get header and variable length records
@@ -25,6 +29,15 @@ function lasStruct = readLASfile(lasFilePath, optsString)
 %               'XYZInt'         - Loads header, VLR, X, Y, Z and intensities
 %               'LoadAll'        - Loads all of the point data
 %                                  (same as with only one given input)
+%
+% lodOptions:   bbox     - Read the nodes whose cube intersects the box
+%                          [xmin ymin xmax ymax] or
+%                          [xmin ymin zmin xmax ymax zmax]. Points of these
+%                          nodes outside of the box are included
+%                          (Default: whole extent)
+%               maxDepth - Read nodes down to this depth, 0 is the root
+%                          with the coarsest sample (Default: all depths)
+%               The points are returned coarse nodes first
 % 
 % Output:       lasStruct [struct]:         lasdata style struct
 %			
@@ -43,4 +56,8 @@ function lasStruct = readLASfile(lasFilePath, optsString)
 if nargin == 1
     optsString = 'LoadAll'; 
 end
-lasStruct = readLASfile_cpp(char(lasFilePath), optsString);
\ No newline at end of file
+if nargin > 2
+    lasStruct = readLASfile_cpp(char(lasFilePath), optsString, lodOptions);
+else
+    lasStruct = readLASfile_cpp(char(lasFilePath), optsString);
+end
\ No newline at end of file
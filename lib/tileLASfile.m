@@ -0,0 +1,93 @@
+function [tileFiles, pointCounts] = tileLASfile(inputFile, outputFolder, tileSize, optional)
+% [tileFiles, pointCounts] = tileLASfile(inputFile, outputFolder, tileSize)
+% [tileFiles, pointCounts] = tileLASfile(inputFile, outputFolder, tileSize, optional)
+%
+%   Supports Versions LAS 1.0 - 1.4
+%   Supports Point Data Record Format 0 to 10
+%
+%   Splits a LAS-File into a grid of square tiles. The input file is read
+%   only once by a C++ Mex-File, every record is routed into the file of
+%   its tile. The records of all tiles are buffered up to a fixed amount of
+%   memory, then the largest buffers are written. Every tile gets the
+%   header, VLRs and extended VLRs of the input file with its own bounding
+%   box and point counts. Only tiles that contain points are written.
+%
+%   Input:
+%       inputFile (string)    : Full path to input LAS-File
+%       outputFolder (string) : Folder of the tile files. Files are named
+%                               <input name>_<x>_<y>.las after the lower
+%                               left corner of the tile
+%       tileSize (double)     : Edge length of the tiles
+%       optional (struct)     : Optional tiling settings and the filters
+%                               and transformations of transcodeLASfile
+%
+%       optional struct fields:
+%          tileOrigin       : Lower left corner [x y] of a tile the grid
+%                             is aligned to (Default: [0 0])
+%          tileOverlap      : Points closer than this distance to a
+%                             neighbouring tile are written to it as well,
+%                             must be smaller than tileSize (Default: 0)
+%          tileBufferBytes  : Memory for the buffered records of all tiles
+%                             in bytes (Default: 268435456)
+%          bbox, classes, returnNumbers, timeWindow, polygon, scale,
+%          offset, targetPointFormat, dropExtraBytes : see transcodeLASfile
+%
+%   Returns:
+%       tileFiles (cell)      : Paths of the written tile files
+%       pointCounts (double)  : Number of points in each tile file
+%
+%   Example:
+%       opts.tileOverlap = 10;
+%       tiles = tileLASfile('C:\flight.las', 'C:\tiles', 500, opts);
+%
+%   Source: tileLASfile_cpp.cpp LASTranscoder.cpp
+%   To rebuild this function run the provided script 'build_tileLASfile.m'
+%
+% Copyright (c) 2022, Patrick Kmmerle
+% Licence: see the included file
+
+if nargin < 3
+    error('Not enough input arguments! Needs at least inputFile, outputFolder and tileSize')
+end
+
+if nargin < 4
+    optional = struct();
+end
+
+tilerOptions = GetTilerOptions(optional);
+tilerOptions.tileSize = double(tileSize);
+
+% Create output directory if doesn't exist (isdir for backwards comp)
+if ~isempty(outputFolder) && ~isdir(outputFolder) %#ok
+    mkdir(outputFolder);
+end
+
+[~, inputName] = fileparts(char(inputFile));
+outputPrefix = fullfile(char(outputFolder), inputName);
+
+[tileFiles, pointCounts] = tileLASfile_cpp(char(inputFile), outputPrefix, tilerOptions);
+end
+
+%% --- Subfunction Block ---
+function tilerOptions = GetTilerOptions(optional)
+% tilerOptions = GetTilerOptions(optional)
+%
+%   Copies the fields of the optional input struct, that are handled by
+%   the C++ tiler, to a new struct. Numeric options are cast to double
+%
+%   Arguments:
+%       optional [struct]     : optional input struct of tileLASfile
+%
+%   Returns:
+%       tilerOptions [struct] : options struct for tileLASfile_cpp
+optionNames = {'bbox', 'classes', 'returnNumbers', 'timeWindow', 'polygon', 'scale', ...
+    'offset', 'targetPointFormat', 'dropExtraBytes', 'tileOrigin', ...
+    'tileOverlap', 'tileBufferBytes'};
+tilerOptions = struct();
+
+for i = 1:numel(optionNames)
+    if isfield(optional, optionNames{i})
+        tilerOptions.(optionNames{i}) = double(optional.(optionNames{i}));
+    end
+end
+end
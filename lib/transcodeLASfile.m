@@ -0,0 +1,113 @@
+function pointCount = transcodeLASfile(inputFile, outputFile, optional)
+% pointCount = transcodeLASfile(inputFile, outputFile)
+% pointCount = transcodeLASfile(inputFile, outputFile, optional)
+%
+%   Supports Versions LAS 1.0 - 1.4
+%   Supports Point Data Record Format 0 to 10
+%
+%   Copies the point records of a LAS-File to a new LAS-File without
+%   reading them into Matlab. The records are filtered and transformed on
+%   the fly by a C++ Mex-File, so only a few megabytes of memory are used
+%   independent of the file size (unless the points are sorted). Header,
+%   VLRs, waveform data and extended VLRs are taken over. Bounding box and
+%   point counts are recomputed.
+%
+%   Input:
+%       inputFile (string)  : Full path to input LAS-File
+%       outputFile (string) : Full path to output LAS-File
+%       optional (struct)   : Optional filters and transformations
+%
+%       optional struct fields:
+%          bbox             : Keep only points inside of the box
+%                             [xmin ymin xmax ymax] or
+%                             [xmin ymin zmin xmax ymax zmax]
+%          classes          : Keep only points of these classes
+%          returnNumbers    : Keep only points with these return numbers
+%          timeWindow       : Keep only points with a GPS time inside of
+%                             [tmin tmax]
+%          polygon          : Keep only points inside of the polygon
+%                             [x y] with one vertex per row. Rings of
+%                             polygons with holes are separated by NaN
+%                             (winding number of isPointInPolygon, points
+%                             on the border are not kept)
+%          scale            : New scale factors [sx sy sz]
+%          offset           : New coordinate offsets [ox oy oz]
+%          targetPointFormat : Point data record format of the output.
+%                             Fields are converted or dropped, version is
+%                             raised if the format requires it. Class 12
+%                             (overlap) of formats 0-5 becomes unclassified
+%                             (1) with the overlap flag set in formats 6-10
+%          dropExtraBytes   : If true then the extra bytes of the records
+%                             and their description VLR are not copied
+%          spatialSort      : 'morton' or 'hilbert' to write the points in
+%                             the order of that space filling curve through
+%                             their quantized coordinates (Default: 'none').
+%                             The grid of the curve is taken from the
+%                             bounding box in the input header
+%          sortRunPoints    : Number of points that are sorted in memory at
+%                             once (Default: 4194304, about 70 bytes per
+%                             point plus the record length). Inputs with
+%                             more points are sorted in runs that are
+%                             merged via a temporary file next to the
+%                             output, so files larger than memory can be
+%                             sorted
+%
+%   Returns:
+%       pointCount          : Number of points written to the output
+%
+%   Example:
+%       opts.bbox = [1000 2000 1500 2500];
+%       opts.classes = [2 9];
+%       transcodeLASfile('C:\in.las', 'C:\ground.las', opts);
+%
+%   Source: transcodeLASfile_cpp.cpp LASTranscoder.cpp
+%   To rebuild this function run the provided script 'build_transcodeLASfile.m'
+%
+% Copyright (c) 2022, Patrick Kmmerle
+% Licence: see the included file
+
+if nargin < 2
+    error('Not enough input arguments! Needs at least inputFile and outputFile')
+end
+
+transcoderOptions = struct();
+if nargin > 2
+    transcoderOptions = GetTranscoderOptions(optional);
+end
+
+% Create output directory if doesn't exist (isdir for backwards comp)
+pathtmp = fileparts(outputFile);
+if ~isempty(pathtmp) && ~isdir(pathtmp) %#ok
+    mkdir(pathtmp);
+end
+
+pointCount = transcodeLASfile_cpp(char(inputFile), char(outputFile), transcoderOptions);
+end
+
+%% --- Subfunction Block ---
+function transcoderOptions = GetTranscoderOptions(optional)
+% transcoderOptions = GetTranscoderOptions(optional)
+%
+%   Copies the fields of the optional input struct, that are handled by
+%   the C++ transcoder, to a new struct. Numeric options are cast to double
+%
+%   Arguments:
+%       optional [struct]          : optional input struct of transcodeLASfile
+%
+%   Returns:
+%       transcoderOptions [struct] : options struct for transcodeLASfile_cpp
+optionNames = {'bbox', 'classes', 'returnNumbers', 'timeWindow', 'polygon', 'scale', ...
+    'offset', 'targetPointFormat', 'dropExtraBytes', 'spatialSort', 'sortRunPoints'};
+transcoderOptions = struct();
+
+for i = 1:numel(optionNames)
+    if isfield(optional, optionNames{i})
+        value = optional.(optionNames{i});
+        if ischar(value) || isstring(value)
+            transcoderOptions.(optionNames{i}) = lower(char(value));
+        else
+            transcoderOptions.(optionNames{i}) = double(value);
+        end
+    end
+end
+end
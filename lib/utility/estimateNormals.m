@@ -0,0 +1,98 @@
+function [normals, curvature, extrabytes] = estimateNormals(x, y, z, k, radius, numThreads, viewpoint)
+% [normals, curvature] = estimateNormals(x, y, z, k)
+% [normals, curvature, extrabytes] = estimateNormals(x, y, z, k, radius, numThreads, viewpoint)
+%
+% Estimates the normal vector and the curvature of every point of a point
+% cloud from its neighbourhood. The neighbourhood are the k nearest
+% neighbours within the radius, or all points within the radius if k is
+% Inf. The point itself is part of its neighbourhood. The neighbours are
+% found with a KD-tree and the points are processed in parallel.
+%
+% The normal is the eigenvector of the smallest eigenvalue of the
+% covariance of the neighbourhood. The curvature is the surface variation
+% smallest eigenvalue / sum of eigenvalues, which is 0 on a plane and at
+% most 1/3. Points with less than three distinct neighbours and points
+% with an undefined coordinate (NaN) get a NaN normal and curvature.
+%
+% The direction of a normal is ambiguous, so the normals are flipped
+% towards the viewpoint (e.g. the position of the scanner) or upwards
+% (positive z) if no viewpoint is given.
+%
+% The third output holds the normals and curvature as Extrabytes object
+% with the extra bytes vX, vY, vZ and curvature of data type single and
+% their min and max values, ready for encode_extrabytes.
+%
+% Input:        x [nx1 double]      :   X-Coordinates of the points
+%               y [nx1 double]      :   Y-Coordinates of the points
+%               z [nx1 double]      :   Z-Coordinates of the points
+%               k [double]          :   Number of neighbours (at least 3)
+%                                       or Inf for all within the radius
+%               radius [double]     :   Max. distance of the neighbours
+%                                       (default is Inf)
+%               numThreads [double] :   Max. number of threads used if
+%                                       above 1e4 points (default is 1)
+%               viewpoint [1x3 double] : Point the normals face (default
+%                                       is [], normals face upwards)
+%
+% Returns:      normals [nx3 double]  : Unit normal vectors [nx ny nz]
+%               curvature [nx1 double]: Surface variation of every point
+%               extrabytes (Extrabytes): Normals and curvature as extra
+%                                       bytes
+%
+% Example:
+%       [~, ~, extrabytes] = estimateNormals(las.x, las.y, las.z, 16, Inf, 0);
+%       las = encode_extrabytes(las, extrabytes, 'Point Cloud Normals');
+%       writeLASfile(las, 'normals.las', 1, 4, 6);
+%
+% The number of threads is limited to the available concurrent threads of
+% the CPU and set to all of them if it is zero. The function has to be
+% compiled with 'parallel_computing = true'.
+%
+% Source:		 pointNeighbours.cpp
+if nargin < 4
+    error('Not enough input arguments! Needs at least x, y, z and k')
+end
+if nargin < 5
+    radius = Inf;
+end
+if nargin < 6
+    numThreads = 1;
+end
+if nargin < 7
+    viewpoint = [];
+end
+
+if nargout > 1
+    [normals, curvature] = pointNeighbours_cpp('normals', double(x), double(y), double(z), ...
+        double(k), double(radius), numThreads, double(viewpoint));
+else
+    normals = pointNeighbours_cpp('normals', double(x), double(y), double(z), ...
+        double(k), double(radius), numThreads, double(viewpoint));
+end
+
+if nargout > 2
+    % Same layout as in sample_WritePointNormals, single precision is
+    % accurate enough for unit vectors
+    extraNames = {'vX', 'vY', 'vZ', 'curvature'};
+    descriptions = {'X vector component', 'Y vector component', ...
+                    'Z vector component', 'Surface variation'};
+    extraData = [normals, curvature];
+
+    extrabytes = Extrabytes(extraNames);
+    extrabytes.SetDataType(extraNames, 'single');
+
+    for i = 1:length(extraNames)
+        values = single(extraData(:, i));
+        defined = values(~isnan(values));
+
+        extrabytes.SetData(extraNames{i}, values);
+        extrabytes.SetDescription(extraNames{i}, descriptions{i});
+        extrabytes.SetNoData(extraNames{i}, 0);
+        if ~isempty(defined)
+            extrabytes.SetMin(extraNames{i}, min(defined));
+            extrabytes.SetMax(extraNames{i}, max(defined));
+        end
+    end
+    extrabytes.SetOptions(extraNames, false, true, true, false, false);
+end
+end
@@ -0,0 +1,73 @@
+function [isDuplicate, firstIndices] = findDuplicates(x, y, z, tolerance, gpsTime, timeTolerance, numThreads)
+% isDuplicate = findDuplicates(x, y, z)
+% [isDuplicate, firstIndices] = findDuplicates(x, y, z, tolerance, gpsTime, timeTolerance, numThreads)
+%
+% Finds exact and near duplicate points of a point cloud. Two points are
+% duplicates if their coordinates, quantized to floor(x / tolerance), are
+% the same. A tolerance of zero compares the coordinates exactly. With GPS
+% times the quantized times have to be the same as well, so points of
+% different pulses at the same position are no duplicates.
+%
+% Near duplicates share a cell of the tolerance grid. Points closer than
+% the tolerance that are on different sides of a cell border are no
+% duplicates, points farther apart within a cell are (up to tolerance *
+% sqrt(3)).
+%
+% The first point of every group in point order is kept, all later points
+% of the group are duplicates. firstIndices holds the index of the kept
+% point of every point, so the kept points of the duplicates are
+% firstIndices(isDuplicate). Points with an undefined value (NaN) are no
+% duplicates and have the index 0. The points are hashed in parallel and
+% the result is the same for any number of threads.
+%
+% Input:        x [nx1 double]      :   X-Coordinates of the points
+%               y [nx1 double]      :   Y-Coordinates of the points
+%               z [nx1 double]      :   Z-Coordinates of the points
+%               tolerance [double]  :   Edge length of the cells or
+%                                       [xTol yTol zTol], 0 for exact
+%                                       duplicates (default is 0)
+%               gpsTime [nx1 double]:   GPS times of the points (default
+%                                       is [], times are ignored)
+%               timeTolerance [double] : Tolerance of the GPS times
+%                                       (default is 0)
+%               numThreads [double] :   Max. number of threads used
+%                                       (default is 1)
+%
+% Returns:      isDuplicate [nx1 logical] : true for all but the first
+%                                       point of every group
+%               firstIndices [nx1 uint64] : Index of the first point of
+%                                       the group of every point
+%
+% Example:
+%       % Remove exact duplicates of points of the same pulse
+%       isDuplicate = findDuplicates(las.x, las.y, las.z, 0, las.gps_time, 0, 0);
+%       las = PCloudFun.Subset(las, ~isDuplicate);
+%
+%       % Classify points within 1 cm of another point as noise (class 7)
+%       isDuplicate = findDuplicates(las.x, las.y, las.z, 0.01, [], 0, 0);
+%       las = PCloudFun.SetClass(las, isDuplicate, 7);
+%
+% The number of threads is limited to the available concurrent threads of
+% the CPU and set to all of them if it is zero. The function has to be
+% compiled with 'parallel_computing = true'.
+%
+% Source:		 pointCleaning.cpp
+if nargin < 3
+    error('Not enough input arguments! Needs at least x, y and z')
+end
+if nargin < 4
+    tolerance = 0;
+end
+if nargin < 5
+    gpsTime = [];
+end
+if nargin < 6
+    timeTolerance = 0;
+end
+if nargin < 7
+    numThreads = 1;
+end
+
+[isDuplicate, firstIndices] = pointCleaning_cpp('duplicates', double(x), double(y), double(z), ...
+    double(tolerance), numThreads, double(gpsTime), double(timeTolerance));
+end
@@ -0,0 +1,78 @@
+function [indices, distances, counts] = findNeighbours(x, y, z, k, queryXYZ, numThreads, radius)
+% [indices, distances] = findNeighbours(x, y, z, k)
+% [indices, distances] = findNeighbours(x, y, z, k, queryXYZ, numThreads)
+% [indices, distances, counts] = findNeighbours(x, y, z, [], queryXYZ, numThreads, radius)
+%
+% Finds the k nearest neighbours or all neighbours within a radius of
+% query points in a point cloud. The points are sorted into a KD-tree once
+% per call and the query points are searched in parallel. Points with an
+% undefined coordinate (NaN) are no neighbours of any point.
+%
+% Without query points (queryXYZ = []) every point of the cloud is queried
+% and is its own first neighbour.
+%
+% k nearest neighbours: indices and distances are [m x k] matrices with
+% one row per query point, sorted by distance. If the cloud has less than
+% k points, the missing neighbours have the index 0 and the distance Inf.
+%
+% Radius search (k = [] and a radius): the neighbours of all query points
+% are returned one after another in a column vector, sorted by distance
+% for every query point. counts holds the number of neighbours of every
+% query point, so the neighbours of query point i are
+%       offsets = [0; cumsum(double(counts))];
+%       indices(offsets(i) + 1 : offsets(i + 1))
+% or as cell array: mat2cell(indices, double(counts), 1)
+%
+% Input:        x [nx1 double]      :   X-Coordinates of the points
+%               y [nx1 double]      :   Y-Coordinates of the points
+%               z [nx1 double]      :   Z-Coordinates of the points
+%               k [double]          :   Number of neighbours or [] for a
+%                                       radius search
+%               queryXYZ [mx3 double] : Query points (default is [], the
+%                                       points themselves)
+%               numThreads [double] :   Max. number of threads used if
+%                                       above 1e4 query points
+%                                       (default is 1)
+%               radius [double]     :   Radius of the radius search
+%
+% Returns:      indices [uint64]    :   Indices of the neighbours
+%               distances [double]  :   Euclidean distances of the
+%                                       neighbours to the query point
+%               counts [mx1 uint64] :   Number of neighbours of every
+%                                       query point (radius search only)
+%
+% Example:
+%       % Mean distance to the 8 nearest neighbours of every point
+%       [~, d] = findNeighbours(las.x, las.y, las.z, 9, [], 0);
+%       meanDistance = mean(d(:, 2:end), 2);
+%
+%       % Points within 0.5 units of two query points
+%       [idx, d, counts] = findNeighbours(las.x, las.y, las.z, [], [x1 y1 z1; x2 y2 z2], 0, 0.5);
+%
+% The number of threads is limited to the available concurrent threads of
+% the CPU and set to all of them if it is zero. The function has to be
+% compiled with 'parallel_computing = true'.
+%
+% Source:		 pointNeighbours.cpp
+if nargin < 4
+    error('Not enough input arguments! Needs at least x, y, z and k')
+end
+if nargin < 5
+    queryXYZ = [];
+end
+if nargin < 6
+    numThreads = 1;
+end
+
+if isempty(k)
+    if nargin < 7
+        error('A radius search needs a radius!')
+    end
+    [indices, counts, distances] = pointNeighbours_cpp('radius', double(x), double(y), double(z), ...
+        double(radius), numThreads, double(queryXYZ));
+else
+    [indices, distances] = pointNeighbours_cpp('knn', double(x), double(y), double(z), ...
+        double(k), numThreads, double(queryXYZ));
+    counts = [];
+end
+end
@@ -0,0 +1,53 @@
+function [isOutlier, meanDistances, threshold] = findOutliers(x, y, z, k, stdRatio, numThreads)
+% isOutlier = findOutliers(x, y, z, k)
+% [isOutlier, meanDistances, threshold] = findOutliers(x, y, z, k, stdRatio, numThreads)
+%
+% Finds outliers of a point cloud with statistical outlier removal. Every
+% point gets the mean distance to its k nearest neighbours, the point
+% itself excluded. A point is an outlier if its mean distance is larger
+% than the mean of the mean distances of all points plus stdRatio times
+% their standard deviation. The neighbours are found with a KD-tree and
+% the points are processed in parallel.
+%
+% Points with an undefined coordinate (NaN) have the mean distance NaN,
+% are left out of the threshold and are no outliers. Clouds with less
+% than k + 1 points use all other points as neighbours.
+%
+% Input:        x [nx1 double]      :   X-Coordinates of the points
+%               y [nx1 double]      :   Y-Coordinates of the points
+%               z [nx1 double]      :   Z-Coordinates of the points
+%               k [double]          :   Number of neighbours
+%               stdRatio [double]   :   Multiple of the standard deviation
+%                                       above the mean (default is 1)
+%               numThreads [double] :   Max. number of threads used if
+%                                       above 1e4 points (default is 1)
+%
+% Returns:      isOutlier [nx1 logical]    : true for the outliers
+%               meanDistances [nx1 double] : Mean distance of every point
+%                                       to its k nearest neighbours
+%               threshold [double]  :   Largest mean distance of points
+%                                       that are no outliers
+%
+% Example:
+%       % Classify outliers as noise (class 7)
+%       isOutlier = findOutliers(las.x, las.y, las.z, 16, 2, 0);
+%       las = PCloudFun.SetClass(las, isOutlier, 7);
+%
+% The number of threads is limited to the available concurrent threads of
+% the CPU and set to all of them if it is zero. The function has to be
+% compiled with 'parallel_computing = true'.
+%
+% Source:		 pointCleaning.cpp
+if nargin < 4
+    error('Not enough input arguments! Needs at least x, y, z and k')
+end
+if nargin < 5
+    stdRatio = 1;
+end
+if nargin < 6
+    numThreads = 1;
+end
+
+[isOutlier, meanDistances, threshold] = pointCleaning_cpp('outliers', double(x), double(y), double(z), ...
+    double(k), double(stdRatio), numThreads);
+end
@@ -1,8 +1,10 @@
-function isInside = isPointInPolygon(polyX, polyY, pointsX, pointsY, numThreads, algorithm)
+function isInside = isPointInPolygon(polyX, polyY, pointsX, pointsY, numThreads, algorithm, outputMode)
 % isInside = isPointInPolygon(polyX, polyY, pointsX, pointsY, numThreads, algorithm)
+% isInside = isPointInPolygon(polyX, polyY, pointsX, pointsY, numThreads, algorithm, outputMode)
 % 
 % Finds 2D points inside and outside of a 2D polygon. 
-% Maximum point count for query points and polygon is 2^31-1.
+% Maximum vertex count of the polygon is 2^31-1, the number of query
+% points is only limited by memory.
 %
 % Different algorithms can be chosen. Standard is the winding number
 % algorithm. Points on the border do not count as inside but there is an
@@ -10,6 +12,30 @@ function isInside = isPointInPolygon(polyX, polyY, pointsX, pointsY, numThreads,
 % is meant for cases when polygon points and a subset of points are exactly
 % equal!
 %
+% Polygons with holes and multipolygons are given as rings that are
+% separated by NaN. Every ring is closed on its own and the edges of all
+% rings are tested in the same pass. Ray casting applies the even-odd rule,
+% so the orientation of the rings doesn't matter. The winding number
+% applies the nonzero rule, so holes have to be oriented opposite to the
+% ring they are cut out of (e.g. outer ring counterclockwise, holes
+% clockwise). Option 1 also counts the edges of holes as inside.
+%
+% The polygon edges are binned into horizontal slabs before the points are
+% tested, so every point only tests the few edges that cross its scanline
+% instead of all of them. Points outside of the polygon's bounding box are
+% rejected right away. The winding number gives the same results as testing
+% all edges. Deltas and inverse slopes of the edges are computed once per
+% polygon, so ray casting multiplies instead of dividing for every point and
+% edge. Points closer to an edge than the rounding error may therefore end
+% up on the other side than with a division, like points on the border
+% already do.
+% To test many sets of points (e.g. tiles) against the same polygon,
+% prepare it once with the PreparedPolygon class. A PreparedPolygon that is
+% quantized with the scale and offset of a LAS-File tests the int32 record
+% coordinates directly, exactly in integers and without conversion.
+% For polygons with up to about a thousand edges the points are tested 4 to
+% 16 at a time with AVX2 or AVX-512, if the CPU supports it.
+%
 % Supports multithreading that kicks in if more than 1e4 points or more
 % than 150 polygon vertices are to be processed. The function has to be
 % compiled with 'parallel_computing = true'. The number of threads can
@@ -17,18 +43,36 @@ function isInside = isPointInPolygon(polyX, polyY, pointsX, pointsY, numThreads,
 % available concurrent threads of the CPU, if the number is too big.
 % Number of threads will be set to max available threads if input is zero
 %
-% Input:        polyX [nx1 float]  :	X-Coordinates of polygon vertices
-%               polyY [nx1 float]  :	Y-Coordinates of polygon vertices
+% Input:        polyX [nx1 float]  :	X-Coordinates of polygon vertices,
+%                                       rings separated by NaN
+%               polyY [nx1 float]  :	Y-Coordinates of polygon vertices,
+%                                       rings separated by NaN
 %               pointsX [nx1 float]:	X-Coordinates of query points
 %               pointsY [nx1 float]:	Y-Coordinates of query points
 %               numThreads [double] :   Max. number of threads used if
 %                                       above threshold (default is 1)
 %               algorithm [int]     :   0 == Winding Number (default)
+%                                            (nonzero rule)
 %                                       1 == WN but edges count inside
-%                                       2 == Ray Casting
+%                                       2 == Ray Casting (even-odd rule)
+%               outputMode [char]   :   'mask' (default), 'indices' or
+%                                       'bits'
 % 
 % Returns:      isInside [nx1 bool] :	true if point is inside,
 %                                       false if point is outside poylgon
+%               With outputMode 'indices':
+%               isInside [mx1 uint64] : Indices of the inside points in
+%                                       ascending order
+%               With outputMode 'bits':
+%               isInside [ceil(n/8)x1 uint8] : Mask with 8 points per
+%                                       byte, point i is bit
+%                                       mod(i-1, 8) + 1 of byte
+%                                       ceil(i/8) (see bitget)
+%
+% The index list and the bit mask need less memory than the logical mask
+% if only a small part of a large cloud is selected, e.g.
+%   idx = isPointInPolygon(polyX, polyY, x, y, 0, 0, 'indices');
+%   region = x(idx);
 %			
 % This called mex file uses the extension .mexw64.
 % Originally built in Matlab 2019b with MSVC 2019
@@ -52,6 +96,9 @@ end
 if nargin < 6
     algorithm = 0;
 end
+if nargin < 7
+    outputMode = 'mask';
+end
 
 % If input is neither fully double or single then cast to double
 isFloatingPoint = ...
@@ -67,5 +114,5 @@ if ~isFloatingPoint
     pointsY = double(pointsY);
 end
 
-isInside = isPointInPolygon_cpp(polyX, polyY, pointsX, pointsY, numThreads, algorithm);
+isInside = isPointInPolygon_cpp(polyX, polyY, pointsX, pointsY, numThreads, algorithm, lower(char(outputMode)));
 end
\ No newline at end of file
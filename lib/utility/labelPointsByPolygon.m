@@ -0,0 +1,98 @@
+function polygonIndex = labelPointsByPolygon(polyX, polyY, pointsX, pointsY, numThreads, algorithm)
+% polygonIndex = labelPointsByPolygon(polyX, polyY, pointsX, pointsY, numThreads, algorithm)
+% 
+% Finds for every 2D point the 2D polygon it is inside of. Many polygons
+% are tested in one pass over the points, which is a lot faster than
+% calling isPointInPolygon for every polygon.
+% Maximum vertex count of every polygon is 2^31-1, the number of query
+% points is only limited by memory.
+%
+% The polygons are either given as cell arrays with one polygon per cell
+% or as vectors in which the polygons are separated by NaN. Within a cell
+% NaN separates the rings of a polygon with holes or of a multipolygon,
+% as described in isPointInPolygon. A grid over the bounding boxes of the
+% polygons is used to only test the polygons whose bounding box contains
+% the point. If polygons overlap then the point gets the index of the
+% first one. Points outside of the bounding box of a polygon are never
+% inside of it.
+%
+% The algorithms and multithreading are the same as in isPointInPolygon.
+% Multithreading kicks in if more than 1e4 points are to be processed.
+%
+% Input:        polyX [cell or nx1 float] : X-Coordinates of polygon vertices
+%               polyY [cell or nx1 float] : Y-Coordinates of polygon vertices
+%               pointsX [nx1 float] :   X-Coordinates of query points
+%               pointsY [nx1 float] :   Y-Coordinates of query points
+%               numThreads [double] :   Max. number of threads used if
+%                                       above threshold (default is 1)
+%               algorithm [int]     :   0 == Winding Number (default)
+%                                       1 == WN but edges count inside
+%                                       2 == Ray Casting
+% 
+% Returns:      polygonIndex [nx1 uint32] : Index of the polygon the point
+%                                           is inside of, 0 if none
+%
+% Example:
+%       label = labelPointsByPolygon({[0 1 1 0], [2 3 3 2]}, ...
+%                                    {[0 0 1 1], [0 0 1 1]}, x, y, 0);
+%
+% Source:		 isPointInPolygon.cpp
+if nargin < 5
+    numThreads = 1;
+end
+if nargin < 6
+    algorithm = 0;
+end
+
+% NaN separated polygons are split into one cell per polygon
+if ~iscell(polyX) || ~iscell(polyY)
+    [polyX, polyY] = SplitAtNaN(polyX, polyY);
+end
+
+% If input is neither fully double or single then cast to double
+isDouble = isa(pointsX, 'double') && isa(pointsY, 'double');
+isSingle = isa(pointsX, 'single') && isa(pointsY, 'single');
+for i = 1:numel(polyX)
+    isDouble = isDouble && isa(polyX{i}, 'double') && isa(polyY{i}, 'double');
+    isSingle = isSingle && isa(polyX{i}, 'single') && isa(polyY{i}, 'single');
+end
+
+if ~isDouble && ~isSingle
+    polyX   = cellfun(@double, polyX, 'UniformOutput', false);
+    polyY   = cellfun(@double, polyY, 'UniformOutput', false);
+    pointsX = double(pointsX);
+    pointsY = double(pointsY);
+end
+
+polygonIndex = isPointInPolygon_cpp(polyX, polyY, pointsX, pointsY, numThreads, algorithm);
+end
+
+%% --- Subfunction Block ---
+function [cellX, cellY] = SplitAtNaN(polyX, polyY)
+% [cellX, cellY] = SplitAtNaN(polyX, polyY)
+%
+%   Splits vectors of NaN separated polygons into one cell per polygon.
+%   Consecutive NaN count as one separator
+%
+%   Arguments:
+%       polyX, polyY [nx1 float] : NaN separated polygon vertices
+%
+%   Returns:
+%       cellX, cellY [cell]      : Vertices of one polygon per cell
+if numel(polyX) ~= numel(polyY)
+    error('Input polygon has to be of same size!')
+end
+
+separators = [0; find(isnan(polyX(:)) | isnan(polyY(:))); numel(polyX) + 1];
+cellX = {};
+cellY = {};
+
+for i = 1:numel(separators) - 1
+    first = separators(i) + 1;
+    last  = separators(i + 1) - 1;
+    if last >= first
+        cellX{end + 1} = polyX(first:last); %#ok
+        cellY{end + 1} = polyY(first:last); %#ok
+    end
+end
+end
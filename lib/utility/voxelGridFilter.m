@@ -0,0 +1,84 @@
+function [indices, centroids, counts] = voxelGridFilter(x, y, z, voxelSize, representative, numThreads, sorted)
+% [indices, centroids, counts] = voxelGridFilter(x, y, z, voxelSize)
+% [indices, centroids, counts] = voxelGridFilter(x, y, z, voxelSize, representative, numThreads, sorted)
+%
+% Thins a point cloud to one point per voxel of a regular 3D grid. The grid
+% starts at the minimum of the points and every point is assigned to the
+% voxel floor((x - min(x)) / voxelSize) in every axis. Points with an
+% undefined coordinate (NaN) are dropped.
+%
+% The representative of a voxel is either its first point, the point
+% closest to the centroid of its points or the point closest to the center
+% of the voxel. The function returns the indices of the representatives,
+% so all other attributes of the points can be carried along by indexing
+% them, e.g. with PCloudFun.Subset for a LAS structure of readLASfile.
+%
+% The points are grouped by voxel with hash tables or by sorting the voxel
+% keys (sorted == true). The hash tables are faster if the voxels contain
+% many points and return the voxels in the order of their first points.
+% Sorting is faster if almost every point has its own voxel and returns the
+% voxels in the order of the grid (x changes fastest, then y, then z).
+% Sorting sums up the centroids in point order, so the result is the same
+% for any number of threads. With hash tables the threads sum up parts of
+% the voxels, which can change the last bits of a centroid and therefore
+% the chosen point if two points have almost the same distance to it.
+%
+% Input:        x [nx1 double]      :   X-Coordinates of the points
+%               y [nx1 double]      :   Y-Coordinates of the points
+%               z [nx1 double]      :   Z-Coordinates of the points
+%               voxelSize [double]  :   Edge length of the voxels or
+%                                       [xSize ySize zSize], Inf for a
+%                                       grid with one layer in that axis
+%               representative [char] : 'first' (default), 'centroid' or
+%                                       'center'
+%               numThreads [double] :   Max. number of threads used if
+%                                       above 1e4 points (default is 1)
+%               sorted [logical]    :   true to group by sorting
+%                                       (default is false)
+%
+% Returns:      indices [mx1 uint64]  : Index of the representative of
+%                                       every voxel
+%               centroids [mx3 double]: Centroid of the points of every
+%                                       voxel
+%               counts [mx1 uint64]   : Number of points of every voxel
+%
+% Example:
+%       idx = voxelGridFilter(las.x, las.y, las.z, 0.25, 'center', 0);
+%       thinned = PCloudFun.Subset(las, idx);
+%
+%       % Centroids as coordinates, attributes of the closest points
+%       [idx, c] = voxelGridFilter(las.x, las.y, las.z, [1 1 Inf], 'centroid', 0);
+%       thinned = PCloudFun.Subset(las, idx);
+%       thinned.x = c(:, 1); thinned.y = c(:, 2); thinned.z = c(:, 3);
+%
+% The number of threads is limited to the available concurrent threads of
+% the CPU and set to all of them if it is zero. The function has to be
+% compiled with 'parallel_computing = true'.
+%
+% Source:		 voxelGridFilter.cpp
+if nargin < 4
+    error('Not enough input arguments! Needs at least x, y, z and voxelSize')
+end
+if nargin < 5
+    representative = 'first';
+end
+if nargin < 6
+    numThreads = 1;
+end
+if nargin < 7
+    sorted = false;
+end
+
+% Centroids and counts are only created if they are requested
+outputs = cell(1, max(nargout, 1));
+[outputs{:}] = voxelGridFilter_cpp(double(x), double(y), double(z), double(voxelSize), ...
+    lower(char(representative)), numThreads, logical(sorted));
+
+indices = outputs{1};
+if nargout > 1
+    centroids = outputs{2};
+end
+if nargout > 2
+    counts = outputs{3};
+end
+end
@@ -27,6 +27,72 @@ function las = writeLASfile(las, filename, majorversion, minorversion, pointform
 %       optional struct fields:
 %          keepCreationDate : If true then the file creation info from
 %                             header is kept, if false then current date is used
+%          asyncWrite       : If true then the next chunk of points is
+%                             encoded while the previous one is written to
+%                             file by a background thread (Default: false)
+%          preallocateFile  : If true then the final file size is reserved
+%                             on disk before writing (Default: false)
+%          computeHeaderStats : If true then bounding box, point counts
+%                             and points by return are computed while
+%                             writing and the header in the file is
+%                             corrected accordingly. The bounding box is
+%                             not computed in Matlab, so offsets and scale
+%                             factors are taken as they are and points
+%                             that do not fit into int32 raise an error.
+%                             The returned struct keeps the bounding box
+%                             of the input header (Default: false)
+%          append           : If true then the points are appended to the
+%                             existing file. Version, scale factors and
+%                             offsets are taken from the file, points are
+%                             converted to its point data record format
+%                             while writing. Header, VLRs and extended
+%                             VLRs of the file are kept (Default: false)
+%          targetPointFormat : Point data record format the points are
+%                             converted to while writing. Unlike argument
+%                             pointformat no converted copies of the point
+%                             fields are created. Class 12 (overlap) of
+%                             formats 0-5 becomes unclassified (1) with the
+%                             overlap flag set in formats 6-10
+%                             (Default: format of las)
+%          targetVersionMinor : Version minor of the written file if
+%                             targetPointFormat is used (Default: lowest
+%                             version that supports the target format)
+%          spatialSort      : 'morton' or 'hilbert' to write the points in
+%                             the order of that space filling curve through
+%                             their quantized coordinates. Spatially close
+%                             points are stored close together in the file,
+%                             which speeds up bounding box and polygon
+%                             reads and compression. The returned struct
+%                             keeps the original order (Default: 'none')
+%          coordinatePrecision : Scalar or [px py pz]. Scale factors and
+%                             offsets of the header are replaced while
+%                             writing: The scale factor is the largest
+%                             power of ten not larger than the precision
+%                             (e.g. 0.001 for 0.005) and the offset lies
+%                             near the center of the real extent of the
+%                             points, so no coordinate overflows int32.
+%                             Implies computeHeaderStats. The returned
+%                             struct keeps the scale factors, offsets and
+%                             bounding box of the input header
+%          compress         : If true then a LASzip compressed file (LAZ)
+%                             is written and the extension .laz is used.
+%                             Points are compressed in independent chunks
+%                             listed in a chunk table, so readers can seek
+%                             and decompress in parallel. Requires that
+%                             writeLASfile_cpp was compiled with LASzip,
+%                             can not be combined with append and ignores
+%                             preallocateFile (Default: false)
+%          lodOctree        : If true then the points are written node by
+%                             node of a level of detail octree, coarse
+%                             nodes first. Every node keeps an even sample
+%                             of the points below it. The node hierarchy is
+%                             stored in an extended VLR, so readLASfile can
+%                             read only the nodes of a box down to a depth.
+%                             Writes LAS 1.4, can not be combined with
+%                             append or spatialSort (Default: false)
+%          lodNodePoints    : Nodes with more points keep a sample of
+%                             about this many points and hand the rest
+%                             down to their children (Default: 16384)
 %
 %   Returns:
 %       las (struct)        : Struct containing the written cloud data
@@ -38,6 +104,11 @@ LASContainsNIR         = PCloudFun.LASContainsNIR;
 LASContainsWavePackets = PCloudFun.LASContainsWavePackets;
 inputIsLegacyLasdata = false;
 keepCreationDate     = false;
+appendToFile         = false;
+useCoordinatePrecision = false;
+computeHeaderStats   = false;
+compressFile         = false;
+writerOptions        = struct();
 
 %% Input and header checks
 % Safe source PDRF for the transformation of bit fields later
@@ -56,6 +127,19 @@ if nargin == 6
     if isfield(optional, 'keepCreationDate')
         keepCreationDate = optional.keepCreationDate;
     end
+    if isfield(optional, 'append')
+        appendToFile = logical(optional.append);
+    end
+    if isfield(optional, 'coordinatePrecision')
+        useCoordinatePrecision = ~isempty(optional.coordinatePrecision);
+    end
+    if isfield(optional, 'compress')
+        compressFile = logical(optional.compress);
+    end
+    if isfield(optional, 'computeHeaderStats')
+        computeHeaderStats = logical(optional.computeHeaderStats);
+    end
+    writerOptions = GetWriterOptions(optional);
 end
 if nargin < 2
     error('Not enough input arguments! Needs at least las and filename')
@@ -66,9 +150,23 @@ end
 if ~isdir(pathtmp) %#ok
     mkdir(pathtmp);
 end
-if ~strcmp(ext,'.las')
-    warning('Extension of file changed to .las');
-    filename = fullfile(pathtmp, strcat(filenametmp, '.las'));
+expectedExt = '.las';
+if compressFile
+    expectedExt = '.laz';
+end
+if ~strcmp(ext,expectedExt)
+    warning('Extension of file changed to %s', expectedExt);
+    filename = fullfile(pathtmp, strcat(filenametmp, expectedExt));
+end
+
+% Points can only be appended if the record layout and coordinate
+% transformation match the existing file, so take them from its header
+if appendToFile
+    if exist(filename, 'file') ~= 2
+        error('File to append to does not exist: %s', filename);
+    end
+    [las.header, filePointFormat] = AdoptFileHeader(las.header, filename);
+    writerOptions.targetPointFormat = filePointFormat;
 end
 
 % Provide backwards compatibility to writeLas from lasdata
@@ -81,7 +179,7 @@ if (isfield(las.header, 'file_creation_daobj'))
 end
 
 % Check header consitency and format accordingly
-lasHeader = PrepareHeader(las, keepCreationDate);
+lasHeader = PrepareHeader(las, keepCreationDate, useCoordinatePrecision, computeHeaderStats);
 
 %% Check if data is compatible with chosen point data record format
 % No function for this task to make sure matlab doesn't copy the whole
@@ -284,7 +382,7 @@ las = checkVariableRecords(las);
 
 
 %% Now finally write the data to drive
-writeLASfile_cpp(las, char(filename));
+writeLASfile_cpp(las, char(filename), writerOptions);
 
 
 end
@@ -302,8 +400,61 @@ dateStruct.day_of_year    =  day(date_now,'dayofyear');
 dateStruct.year           =  date_now.Year;
 end
 
-function lasHeader = PrepareHeader(las, keepCreationDate)
-% lasHeader = PrepareHeader(las, keepCreationDate)
+function writerOptions = GetWriterOptions(optional)
+% writerOptions = GetWriterOptions(optional)
+%
+%   Copies the fields of the optional input struct, that are handled by
+%   the C++ writer, to a new struct. Numeric options are cast to double
+%
+%   Arguments:
+%       optional [struct]      : optional input struct of writeLASfile
+%
+%   Returns:
+%       writerOptions [struct] : options struct for writeLASfile_cpp
+writerOptionNames = {'asyncWrite', 'preallocateFile', 'computeHeaderStats', 'append', ...
+    'targetPointFormat', 'targetVersionMinor', 'spatialSort', 'coordinatePrecision', 'compress', ...
+    'lodOctree', 'lodNodePoints'};
+writerOptions     = struct();
+
+for i = 1:numel(writerOptionNames)
+    if isfield(optional, writerOptionNames{i})
+        value = optional.(writerOptionNames{i});
+        if ischar(value) || isstring(value)
+            writerOptions.(writerOptionNames{i}) = lower(char(value));
+        else
+            writerOptions.(writerOptionNames{i}) = double(value);
+        end
+    end
+end
+end
+
+function [lasHeader, filePointFormat] = AdoptFileHeader(lasHeader, filename)
+% [lasHeader, filePointFormat] = AdoptFileHeader(lasHeader, filename)
+%
+%   Copies version, scale factors and offsets from the header of an
+%   existing LAS-File to the given header. The point data record format is
+%   returned separately because the points are converted while writing
+%
+%   Arguments:
+%       lasHeader [struct]  : header of the points to append
+%       filename [char]     : path to the existing LAS-File
+%
+%   Returns:
+%       lasHeader [struct]  : header with the fields of the existing file
+%       filePointFormat     : point data record format of the existing file
+fileStruct = readLASfile(filename, 'LoadOnlyHeader');
+filePointFormat = fileStruct.header.point_data_format;
+adoptedFields = {'version_major', 'version_minor', ...
+    'scale_factor_x', 'scale_factor_y', 'scale_factor_z', ...
+    'x_offset', 'y_offset', 'z_offset'};
+
+for i = 1:numel(adoptedFields)
+    lasHeader.(adoptedFields{i}) = fileStruct.header.(adoptedFields{i});
+end
+end
+
+function lasHeader = PrepareHeader(las, keepCreationDate, useCoordinatePrecision, computeHeaderStats)
+% lasHeader = PrepareHeader(las, keepCreationDate, useCoordinatePrecision, computeHeaderStats)
 %
 %   Checks LAS header for consitency issues and resolves them. 
 %   Char array fields will be streched to correct length.
@@ -315,6 +466,12 @@ function lasHeader = PrepareHeader(las, keepCreationDate)
 %       las [struct]            : las struct
 %       keepCreationDate [bool] : Keep creation date from header or use
 %                                 current date
+%       useCoordinatePrecision [bool] : Scale factors, offsets and bounding
+%                                 box are computed by the writer, so the
+%                                 passes over the coordinates are skipped
+%       computeHeaderStats [bool] : Bounding box is computed by the
+%                                 writer, so the pass over the coordinates
+%                                 is skipped
 %
 %   Returns:
 %       lasHeader [struct]      : A consistent LAS Header
@@ -423,13 +580,35 @@ if any([lasHeader.scale_factor_x, lasHeader.scale_factor_y, lasHeader.scale_fact
     error('Scale Factor can not be zero');
 end
 
-% Recalculate point count, min, max and VLR count
-lasHeader.max_x = max(las.x);
-lasHeader.min_x = min(las.x);
-lasHeader.max_y = max(las.y);
-lasHeader.min_y = min(las.y);
-lasHeader.max_z = max(las.z);
-lasHeader.min_z = min(las.z);
+% Recalculate point count, min, max and VLR count. With a coordinate
+% precision the writer finds extent, offsets and scale factors itself in a
+% single pass and with header statistics it finds the extent while
+% writing, so only placeholders are needed
+boundsFields = {'max_x', 'min_x', 'max_y', 'min_y', 'max_z', 'min_z'};
+offsetFields = {'x_offset', 'y_offset', 'z_offset'};
+
+if useCoordinatePrecision || computeHeaderStats
+    for i = 1:numel(boundsFields)
+        if ~isfield(lasHeader, boundsFields{i}) || length(lasHeader.(boundsFields{i})) ~= 1
+            lasHeader.(boundsFields{i}) = 0;
+        end
+    end
+end
+
+if useCoordinatePrecision
+    for i = 1:numel(offsetFields)
+        if ~isfield(lasHeader, offsetFields{i}) || isempty(lasHeader.(offsetFields{i}))
+            lasHeader.(offsetFields{i}) = 0;
+        end
+    end
+elseif ~computeHeaderStats
+    lasHeader.max_x = max(las.x);
+    lasHeader.min_x = min(las.x);
+    lasHeader.max_y = max(las.y);
+    lasHeader.min_y = min(las.y);
+    lasHeader.max_z = max(las.z);
+    lasHeader.min_z = min(las.z);
+end
 
 % Coordinate Offsets
 % Should be provided by the user. Check if the offsets are there and
@@ -448,7 +627,7 @@ if length(lasHeader.z_offset) ~= 1
     lasHeader.z_offset = lasHeader.z_offset(1);
 end
 
-if ~BoundingBoxesValidInt32(lasHeader)
+if ~useCoordinatePrecision && ~computeHeaderStats && ~BoundingBoxesValidInt32(lasHeader)
     % If xyz can not be represented as int32 then recalculate offset. First
     % round to nearest integer to mean, the double precision and if
     % everything fails, then update the scale factors to fit the data
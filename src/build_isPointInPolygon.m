@@ -17,6 +17,9 @@
 %
 %       minGW_openMP_link  : Path to MinGW OpenMP lib on your PC 
 %
+% Points are tested with AVX2 or AVX-512 kernels if the CPU supports them.
+% The instruction set is detected at runtime, so no compiler flag is needed.
+%
 % Advice: According to my testing MSVC should be preferred to MinGW.
 %% ------------------------------------------------------------------------
 % User Input
@@ -33,6 +36,9 @@ minGW_openMP_link = 'C:\mingw64\lib\gcc\x86_64-w64-mingw32\12.2.0\libgomp.a';
 %% -----------------------------------------------------------------------
 fprintf('-------------------------------------------------------------\n');
 
+% include folder
+includeFolder = 'include';
+
 % Name of the output file
 outputname = 'isPointInPolygon_cpp';
 
@@ -84,6 +90,9 @@ if useAddCompilerFlags
     flags = cat(2, flags, ['CXXFLAGS=$CXXFLAGS ' add_compiler_flags]);
 end
 
+includePath = sprintf('-I"%s"', includeFolder);
+flags = cat(2, flags, includePath);
+
 % Add source files and output
 flags = cat(2, flags, 'isPointInPolygon.cpp',...
             '-outdir',  outdir, '-output', outputname);
@@ -0,0 +1,107 @@
+% This script compiles the transcodeLASfile mex file
+% Can be compiled with Microsoft Visual C++ 2017 (and likely newer)
+% and latest MinGW-w64 Compiler Collection. 
+% Tested on Windows 10 x64 platform! C++11 is minimum requirement!
+% Other compilers will probably work but have not been tested.
+% For available compilers enter the folling into the matlab command window:
+%   mex -setup cpp
+%
+% Compiling with Interleaved Complex API is recommended but is only
+% supported from Matlab 2018a onwards
+% To compile without IC API, remove the -R2018a compiler option or use the
+% provided option when using this script
+%
+% The following settings are available which the user is free to change
+%
+% Settings:
+%       outdir    : Output directory of mex file (Default is lib/mex folder)
+%       debug     : Set true if debug version should be compiled
+%       UseInterleavedComplexAPI: Set true to compile with Interleaved Complex API
+%       verbose            : Set true to show verbose compilation log
+%       parallel_computing : Set OpenMP compiler flag for multithreading
+%                            (used for sorting along space filling curves)
+%       compiler_flags     : Additional compiler flags
+%       useAddCompilerFlags : Set true to use the set compiler_flags
+%
+% Coordinates are quantized with SSE2 on x64 if scale factors or offsets
+% change. Add '-mavx' (MinGW) to the compiler_flags to use the AVX version
+% if the target machines support it
+%
+% Compilation example if all files in same folder:
+% mex -R2018a transcodeLASfile_cpp.cpp LASTranscoder.cpp -outdir ../lib/mex
+%
+%% ------------------------------------------------------------------------
+% User Input
+outdir                   = '../lib/mex';
+debug                    = false;
+UseInterleavedComplexAPI = true;
+verbose                  = false;
+parallel_computing       = true;
+useAddCompilerFlags      = false;
+compiler_flags           = '-std=c++17';
+
+%% -----------------------------------------------------------------------
+fprintf('-------------------------------------------------------------\n');
+
+% include folder without and with path separator
+includeFolder = 'include';
+relIncPath    = [includeFolder filesep];
+
+% Name of the output file
+outputname = 'transcodeLASfile_cpp';
+
+% The compiler flags
+flags = {};
+
+% Translate user settings to compiler options
+if UseInterleavedComplexAPI
+    if ~verLessThan('matlab','9.4')
+        flags = cat(2, flags, '-R2018a');
+    else
+        disp(['Compiling without Interleaved Complex API due to ',...
+              'Matlab Version being older than 9.4']);
+    end
+end
+
+if debug
+    flags = cat(2, flags, '-g');
+end
+
+if parallel_computing
+    if ispc
+        % Flag to run on Windows platform
+        flags = cat(2, flags, 'COMPFLAGS="$COMPFLAGS /openmp"');
+    elseif isunix
+        % Flag to run on Linux platform
+        flags = cat(2, flags, '''$CFLAGS -fopenmp'' -LDFLAGS=''$LDFLAGS -fopenmp''');
+    elseif ismac
+        % Flag to run on Mac platform
+        fprintf(1,'Mac platform not supported for parallel processing!');
+    else
+        fprintf(1,'Platform not supported');
+    end
+end
+
+if verbose
+    flags = cat(2, flags, '-v');
+end
+
+includePath = sprintf('-I"%s"', includeFolder);
+flags = cat(2, flags, includePath);
+
+if useAddCompilerFlags
+    flags = cat(2, flags, ['CXXFLAGS=$CXXFLAGS ' compiler_flags]);
+end
+
+flags = cat(2, flags, 'transcodeLASfile_cpp.cpp', [relIncPath, 'LASTranscoder.cpp'],  ...
+    '-outdir',  outdir, '-output', outputname);
+
+% Print chosen options (string joining was introduced with Matlab 2013b)
+fprintf(1, 'Compiler Input: ');
+fprintf('%s ', flags{:});
+fprintf('\n');
+
+% Compile File
+mex(flags{:})
+
+fprintf('-------------------------------------------------------------\n');
\ No newline at end of file
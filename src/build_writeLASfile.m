@@ -18,8 +18,18 @@
 %       debug     : Set true if debug version should be compiled
 %       UseInterleavedComplexAPI: Set true to compile with Interleaved Complex API
 %       verbose            : Set true to show verbose compilation log
+%       parallel_computing : Set OpenMP compiler flag for multithreading
+%                            (used for the header statistics)
 %       compiler_flags     : Additional compiler flags
 %       useAddCompilerFlags : Set true to use the set compiler_flags
+%       laszip_folder      : Install folder of LASzip 3 (containing include
+%                            and lib) to enable compressed output (option
+%                            compress). Leave empty to compile without LAZ
+%       laszip_library     : Name of the LASzip library to link against
+%                            (e.g. 'laszip3' on Windows)
+%
+% Coordinates are quantized with SSE2 on x64. Add '-mavx' (MinGW) to the
+% compiler_flags to use the AVX version if the target machines support it
 %
 % Compilation example if all files in same folder:
 % mex -R2018a writeLASfile_cpp.cpp LASWriter.cpp
@@ -31,8 +41,11 @@ outdir                   = '../lib/mex';
 debug                    = false;
 UseInterleavedComplexAPI = true;
 verbose                  = false;
+parallel_computing       = true;
 useAddCompilerFlags      = false;
 compiler_flags           = '-std=c++17';
+laszip_folder            = '';
+laszip_library           = 'laszip';
 
 %% -----------------------------------------------------------------------
 fprintf('-------------------------------------------------------------\n');
@@ -61,6 +74,21 @@ if debug
     flags = cat(2, flags, '-g');
 end
 
+if parallel_computing
+    if ispc
+        % Flag to run on Windows platform
+        flags = cat(2, flags, 'COMPFLAGS="$COMPFLAGS /openmp"');
+    elseif isunix
+        % Flag to run on Linux platform
+        flags = cat(2, flags, '''$CFLAGS -fopenmp'' -LDFLAGS=''$LDFLAGS -fopenmp''');
+    elseif ismac
+        % Flag to run on Mac platform
+        fprintf(1,'Mac platform not supported for parallel processing!');
+    else
+        fprintf(1,'Platform not supported');
+    end
+end
+
 if verbose
     flags = cat(2, flags, '-v');
 end
@@ -72,6 +100,16 @@ if useAddCompilerFlags
     flags = cat(2, flags, ['CXXFLAGS=$CXXFLAGS ' compiler_flags]);
 end
 
+if ~isempty(laszip_folder)
+    flags = cat(2, flags, '-DLAS_WITH_LASZIP', ...
+        sprintf('-I"%s"', fullfile(laszip_folder, 'include')), ...
+        sprintf('-L"%s"', fullfile(laszip_folder, 'lib')), ['-l' laszip_library]);
+    if ispc
+        % Import the functions from the LASzip DLL
+        flags = cat(2, flags, '-DLASZIP_DYN_LINK');
+    end
+end
+
 flags = cat(2, flags, 'writeLASfile_cpp.cpp', [relIncPath, 'LASWriter.cpp'],  ...
     [relIncPath, 'VariableLengthRecords.cpp'], '-outdir',  outdir, '-output', outputname);
 
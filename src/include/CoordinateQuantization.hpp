@@ -0,0 +1,222 @@
+#if _MSC_VER > 1400
+#pragma once
+#endif
+
+#ifndef COORDINATE_QUANTIZATION_H
+#define COORDINATE_QUANTIZATION_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+// Kernels to turn double coordinates into the int32 values stored in LAS point records and to scatter them into
+// the interleaved record buffer. The result is bit for bit identical to std::lround((coordinate - offset) / scale).
+//
+// The division is replaced by a multiplication with the reciprocal scale. This product can differ from the
+// quotient by a few ulp. That only matters if the value is close to a rounding boundary (k + 0.5), so those
+// values are recomputed with the exact division. SSE2 is used if available (always the case on x64), AVX if
+// the compiler is allowed to emit it (e.g. /arch:AVX or -mavx).
+
+#if defined(__AVX__)
+#define LAS_QUANTIZE_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LAS_QUANTIZE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Relative distance to a rounding boundary below which the reciprocal result is not trusted.
+// Covers the error of the reciprocal, of the multiplication and of adding 0.5 before truncation
+constexpr double quantizationBoundaryTolerance = 1.0 / 562949953421312.0;	// 2^-49
+
+// Exclusive bounds of the values that round into the int32 range. Rounding half away from zero turns both bounds
+// into the next integer outside of int32
+constexpr double quantizationMinValue = -2147483648.5;
+constexpr double quantizationMaxValue =  2147483647.5;
+
+// Exact quantization of a single value, used if the fast path is not sure about the rounding
+// Returns:
+//    isValid : False if the rounded value can not be represented as int32
+inline bool quantizeExact(double coordinate, double offset, double scale, int32_t& quantized)
+{
+	const double value = (coordinate - offset) / scale;
+
+	if (!(value > quantizationMinValue && value < quantizationMaxValue)) {
+		return false;
+	}
+
+	quantized = static_cast<int32_t>(std::llround(value));
+	return true;
+}
+
+// Is the product of the reciprocal close enough to k + 0.5 that the exact division has to decide?
+inline bool isNearRoundingBoundary(double value)
+{
+	const double distance = std::fabs(value - std::floor(value) - 0.5);
+	return distance <= (std::fabs(value) + 2.0) * quantizationBoundaryTolerance;
+}
+
+// Quantizes count coordinates to int32 with the same result as std::lround((coordinate - offset) / scale)
+// Returns:
+//    firstInvalid : Index of the first coordinate that does not fit into int32 or count if all are valid
+inline size_t quantizeCoordinates(const double* pCoordinates, int32_t* pQuantized, size_t count, double offset, double scale)
+{
+	const double reciprocal = 1.0 / scale;
+	size_t i = 0;
+
+#if defined(LAS_QUANTIZE_AVX)
+	const __m256d vOffset	 = _mm256_set1_pd(offset);
+	const __m256d vReciprocal = _mm256_set1_pd(reciprocal);
+	const __m256d vHalf		 = _mm256_set1_pd(0.5);
+	const __m256d vTwo		 = _mm256_set1_pd(2.0);
+	const __m256d vTolerance = _mm256_set1_pd(quantizationBoundaryTolerance);
+	const __m256d vMin		 = _mm256_set1_pd(quantizationMinValue);
+	const __m256d vMax		 = _mm256_set1_pd(quantizationMaxValue);
+	const __m256d vSignMask	 = _mm256_set1_pd(-0.0);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m256d value	= _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(pCoordinates + i), vOffset), vReciprocal);
+		const __m256d absValue = _mm256_andnot_pd(vSignMask, value);
+
+		// Round half away from zero: add 0.5 with the sign of the value and truncate
+		const __m256d halfWithSign = _mm256_or_pd(vHalf, _mm256_and_pd(vSignMask, value));
+		const __m128i rounded = _mm256_cvttpd_epi32(_mm256_add_pd(value, halfWithSign));
+
+		// Distance to next rounding boundary and range check (NaN fails the range check as well)
+		const __m256d distance = _mm256_andnot_pd(vSignMask, _mm256_sub_pd(_mm256_sub_pd(value, _mm256_floor_pd(value)), vHalf));
+		const __m256d nearBoundary = _mm256_cmp_pd(distance, _mm256_mul_pd(_mm256_add_pd(absValue, vTwo), vTolerance), _CMP_LE_OQ);
+		const __m256d inRange = _mm256_and_pd(_mm256_cmp_pd(value, vMin, _CMP_GT_OQ), _mm256_cmp_pd(value, vMax, _CMP_LT_OQ));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pQuantized + i), rounded);
+
+		if (_mm256_movemask_pd(nearBoundary) != 0 || _mm256_movemask_pd(inRange) != 0xF)
+		{
+			for (size_t k = i; k < i + 4; ++k)
+			{
+				if (!quantizeExact(pCoordinates[k], offset, scale, pQuantized[k])) { return k; }
+			}
+		}
+	}
+#elif defined(LAS_QUANTIZE_SSE2)
+	const __m128d vOffset	 = _mm_set1_pd(offset);
+	const __m128d vReciprocal = _mm_set1_pd(reciprocal);
+	const __m128d vHalf		 = _mm_set1_pd(0.5);
+	const __m128d vMin		 = _mm_set1_pd(quantizationMinValue);
+	const __m128d vMax		 = _mm_set1_pd(quantizationMaxValue);
+	const __m128d vSignMask	 = _mm_set1_pd(-0.0);
+
+	for (; i + 2 <= count; i += 2)
+	{
+		const __m128d value = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(pCoordinates + i), vOffset), vReciprocal);
+
+		// Round half away from zero: add 0.5 with the sign of the value and truncate
+		const __m128d halfWithSign = _mm_or_pd(vHalf, _mm_and_pd(vSignMask, value));
+		const __m128i rounded = _mm_cvttpd_epi32(_mm_add_pd(value, halfWithSign));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(pQuantized + i), rounded);
+
+		// SSE2 has no floor, so the boundary test is done on the scalar values (NaN fails the range check)
+		const __m128d inRange = _mm_and_pd(_mm_cmpgt_pd(value, vMin), _mm_cmplt_pd(value, vMax));
+		double values[2];
+		_mm_storeu_pd(values, value);
+
+		if (_mm_movemask_pd(inRange) != 0x3 || isNearRoundingBoundary(values[0]) || isNearRoundingBoundary(values[1]))
+		{
+			for (size_t k = i; k < i + 2; ++k)
+			{
+				if (!quantizeExact(pCoordinates[k], offset, scale, pQuantized[k])) { return k; }
+			}
+		}
+	}
+#endif
+
+	// Scalar loop for the remaining values or if no SIMD instructions are available
+	for (; i < count; ++i)
+	{
+		const double value = (pCoordinates[i] - offset) * reciprocal;
+
+		if (!(value > quantizationMinValue && value < quantizationMaxValue) || isNearRoundingBoundary(value))
+		{
+			if (!quantizeExact(pCoordinates[i], offset, scale, pQuantized[i])) { return i; }
+		}
+		else
+		{
+			pQuantized[i] = static_cast<int32_t>(value + std::copysign(0.5, value));
+		}
+	}
+
+	return count;
+}
+
+// Chooses the coarsest power of ten scale factor that is not larger than precision and an offset near the center of
+// [minimum, maximum] that is a multiple of the scale (of 1 if the scale is finer). The scale is coarsened until every
+// value of the range fits into int32.
+// Returns:
+//    isPrecisionKept : False if the scale factor had to be coarser than the precision
+inline bool decimalQuantization(double minimum, double maximum, double precision, double& scale, double& offset)
+{
+	// Power of ten as quotient for negative exponents, so 0.001 is the same double as the literal
+	auto powerOfTen = [](int exponent) { return exponent < 0 ? 1.0 / std::pow(10.0, -exponent) : std::pow(10.0, exponent); };
+
+	int exponent = static_cast<int>(std::floor(std::log10(precision)));
+	if (powerOfTen(exponent + 1) <= precision) { ++exponent; }
+	if (powerOfTen(exponent) > precision) { --exponent; }
+
+	bool isPrecisionKept = true;
+
+	while (true)
+	{
+		scale = powerOfTen(exponent);
+
+		const double step = scale < 1.0 ? 1.0 : scale;
+		offset = std::round((minimum + maximum) / 2.0 / step) * step;
+
+		if ((offset - minimum) / scale < 2147483647.0 && (maximum - offset) / scale < 2147483647.0) {
+			return isPrecisionKept;
+		}
+
+		isPrecisionKept = false;
+		++exponent;
+	}
+}
+
+// Writes X, Y and Z of count points to the start of each point record in pBuffer.
+// The SIMD version writes 16 bytes per record, so bytes 12 to 15 (intensity and bit fields) have to be written afterwards
+inline void scatterCoordinates(char* pBuffer, size_t recordLength, const int32_t* pX, const int32_t* pY, const int32_t* pZ, size_t count)
+{
+	size_t i = 0;
+
+#if defined(LAS_QUANTIZE_AVX) || defined(LAS_QUANTIZE_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pX + i));
+		const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pY + i));
+		const __m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pZ + i));
+
+		// Transpose four points from three component arrays into [x y z 0] per point
+		const __m128i xyLow  = _mm_unpacklo_epi32(x, y);
+		const __m128i xyHigh = _mm_unpackhi_epi32(x, y);
+		const __m128i zLow	 = _mm_unpacklo_epi32(z, zero);
+		const __m128i zHigh	 = _mm_unpackhi_epi32(z, zero);
+
+		char* pRecord = pBuffer + i * recordLength;
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pRecord),					 _mm_unpacklo_epi64(xyLow, zLow));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pRecord + recordLength),	 _mm_unpackhi_epi64(xyLow, zLow));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pRecord + 2 * recordLength), _mm_unpacklo_epi64(xyHigh, zHigh));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pRecord + 3 * recordLength), _mm_unpackhi_epi64(xyHigh, zHigh));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		char* pRecord = pBuffer + i * recordLength;
+		std::memcpy(pRecord,	 pX + i, 4);
+		std::memcpy(pRecord + 4, pY + i, 4);
+		std::memcpy(pRecord + 8, pZ + i, 4);
+	}
+}
+
+#endif
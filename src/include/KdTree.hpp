@@ -0,0 +1,314 @@
+#if _MSC_VER > 1400
+#pragma once
+#endif
+
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Balanced KD-tree over 3D points for k nearest neighbour and radius queries.
+// The tree is implicit: the points are copied and reordered so that every node is a contiguous range of them,
+// which is split at its median along the axis of its largest extent. All leaves are on the same level and hold
+// at most kdTreeLeafSize points, so a node only stores its split value and axis and its range follows from the
+// ranges of its parents. Neighbours of a query are found by visiting the near child first and skipping every
+// child whose cell is farther away than the current worst neighbour. The distance to a cell is updated
+// incrementally per axis, which skips more cells than the distance to the split plane alone.
+//
+// The levels of the tree are built one after another and the nodes of a level are split in parallel. A tree is
+// read only after it is built, so any number of threads can query it at once.
+
+constexpr size_t kdTreeLeafSize = 16;
+constexpr size_t kdTreeSortedLimit = 64;	// Up to this many nearest neighbours are kept in a sorted list, more in a max heap
+
+// Point of the tree with its index in the input
+template<typename Index>
+struct KdTreePoint
+{
+	double	xyz[3];
+	Index	index;
+};
+
+// Neighbour of a query point. The position refers to the points of the tree in tree order.
+// Neighbours with the same distance are ordered by their position, so results do not depend on the search order
+struct KdNeighbour
+{
+	double	squaredDistance;
+	size_t	position;
+
+	inline bool operator<(const KdNeighbour& other) const
+	{
+		return squaredDistance < other.squaredDistance || (squaredDistance == other.squaredDistance && position < other.position);
+	}
+};
+
+template<typename Index>
+class KdTree
+{
+public:
+	// Builds the tree over the points. Points with an undefined coordinate (NaN) are left out
+	void Build(const double* __restrict x, const double* __restrict y, const double* __restrict z, const size_t count);
+
+	// Gets the k nearest neighbours of a query point that are not farther away than the maximum distance.
+	// The neighbours are sorted by their distance, there are less than k if the tree has less points in that distance
+	void Nearest(const double query[3], const size_t k, const double maxSquaredDistance, std::vector<KdNeighbour>& neighbours) const;
+
+	// Calls visit(position, squaredDistance) for every point within the radius of a query point in tree order
+	template<typename Visitor>
+	void Within(const double query[3], const double squaredRadius, Visitor& visit) const;
+
+	inline size_t Size() const { return points.size(); }
+	inline const KdTreePoint<Index>& Point(const size_t position) const { return points[position]; }
+
+private:
+	void searchNearest(const size_t node, const int level, const size_t begin, const size_t end, const double query[3],
+		const double cellDistance, double offset[3], const size_t k, const double maxSquaredDistance, std::vector<KdNeighbour>& nearest) const;
+	template<typename Visitor>
+	void searchWithin(const size_t node, const int level, const size_t begin, const size_t end, const double query[3],
+		const double cellDistance, double offset[3], const double squaredRadius, Visitor& visit) const;
+
+	std::vector<KdTreePoint<Index>> points;
+	std::vector<double> splits;		// Split value of every inner node, children of node i are 2i + 1 and 2i + 2
+	std::vector<uint8_t> axes;		// Split axis of every inner node
+	int depth = 0;					// Level of the leaves
+};
+
+// Gets the worst of the nearest neighbours found so far, the last one of the sorted list or the top of the heap
+inline const KdNeighbour& worstNeighbour(const std::vector<KdNeighbour>& nearest, const size_t k)
+{
+	return k > kdTreeSortedLimit ? nearest.front() : nearest.back();
+}
+
+// Gets the squared distance between two points
+inline double squaredDistance3(const double a[3], const double b[3])
+{
+	const double dx = a[0] - b[0];
+	const double dy = a[1] - b[1];
+	const double dz = a[2] - b[2];
+	return dx * dx + dy * dy + dz * dz;
+}
+
+template<typename Index>
+void KdTree<Index>::Build(const double* __restrict x, const double* __restrict y, const double* __restrict z, const size_t count)
+{
+	points.clear();
+	points.reserve(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (x[i] != x[i] || y[i] != y[i] || z[i] != z[i])
+			continue;
+
+		const KdTreePoint<Index> point = { { x[i], y[i], z[i] }, static_cast<Index>(i) };
+		points.push_back(point);
+	}
+
+	const size_t size = points.size();
+
+	// Halving the points until a leaf is small enough gives the level of the leaves
+	depth = 0;
+	while (((size - 1) >> depth) + 1 > kdTreeLeafSize && size > 0) {
+		++depth;
+	}
+
+	splits.assign((static_cast<size_t>(1) << depth) - 1, 0);
+	axes.assign(splits.size(), 0);
+
+	// Borders of the ranges of the nodes of the current level
+	std::vector<size_t> borders(2);
+	std::vector<size_t> nextBorders;
+	borders[0] = 0;
+	borders[1] = size;
+
+	for (int level = 0; level < depth; ++level)
+	{
+		const long long levelNodes = static_cast<long long>(1) << level;
+		const size_t firstNode = (static_cast<size_t>(1) << level) - 1;
+		KdTreePoint<Index>* pPoints = points.data();
+
+		nextBorders.resize(2 * levelNodes + 1);
+		nextBorders[0] = 0;
+
+#pragma omp parallel for schedule(dynamic) if (levelNodes > 1 && size > 100000)
+		for (long long n = 0; n < levelNodes; ++n)
+		{
+			const size_t begin = borders[n];
+			const size_t end = borders[n + 1];
+			const size_t mid = begin + (end - begin) / 2;
+
+			double minimum[3] = { pPoints[begin].xyz[0], pPoints[begin].xyz[1], pPoints[begin].xyz[2] };
+			double maximum[3] = { minimum[0], minimum[1], minimum[2] };
+
+			for (size_t i = begin + 1; i < end; ++i) {
+				for (int axis = 0; axis < 3; ++axis) {
+					minimum[axis] = std::min(minimum[axis], pPoints[i].xyz[axis]);
+					maximum[axis] = std::max(maximum[axis], pPoints[i].xyz[axis]);
+				}
+			}
+
+			int axis = 0;
+			for (int a = 1; a < 3; ++a) {
+				if (maximum[a] - minimum[a] > maximum[axis] - minimum[axis]) axis = a;
+			}
+
+			// Points left of the median are not larger than the split and points right of it are not smaller
+			std::nth_element(pPoints + begin, pPoints + mid, pPoints + end,
+				[axis](const KdTreePoint<Index>& a, const KdTreePoint<Index>& b) { return a.xyz[axis] < b.xyz[axis]; });
+
+			splits[firstNode + n] = pPoints[mid].xyz[axis];
+			axes[firstNode + n] = static_cast<uint8_t>(axis);
+
+			nextBorders[2 * n + 1] = mid;
+			nextBorders[2 * n + 2] = end;
+		}
+
+		borders.swap(nextBorders);
+	}
+}
+
+template<typename Index>
+void KdTree<Index>::Nearest(const double query[3], const size_t k, const double maxSquaredDistance, std::vector<KdNeighbour>& neighbours) const
+{
+	neighbours.clear();
+
+	if (k == 0 || points.empty())
+		return;
+
+	double offset[3] = { 0, 0, 0 };
+	searchNearest(0, 0, 0, points.size(), query, 0, offset, k, maxSquaredDistance, neighbours);
+
+	if (k > kdTreeSortedLimit)
+		std::sort_heap(neighbours.begin(), neighbours.end());
+}
+
+template<typename Index>
+void KdTree<Index>::searchNearest(const size_t node, const int level, const size_t begin, const size_t end, const double query[3],
+	const double cellDistance, double offset[3], const size_t k, const double maxSquaredDistance, std::vector<KdNeighbour>& nearest) const
+{
+	if (level == depth)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const KdNeighbour candidate = { squaredDistance3(query, points[i].xyz), i };
+
+			if (nearest.size() < k) {
+				if (!(candidate.squaredDistance <= maxSquaredDistance))
+					continue;
+				nearest.push_back(candidate);
+			}
+			else if (candidate < worstNeighbour(nearest, k)) {
+				if (k > kdTreeSortedLimit)
+					std::pop_heap(nearest.begin(), nearest.end());
+				nearest.back() = candidate;
+			}
+			else {
+				continue;
+			}
+
+			// Few neighbours are shifted into place, for many the heap is cheaper
+			if (k > kdTreeSortedLimit) {
+				std::push_heap(nearest.begin(), nearest.end());
+			}
+			else {
+				size_t slot = nearest.size() - 1;
+				for (; slot > 0 && candidate < nearest[slot - 1]; --slot) {
+					nearest[slot] = nearest[slot - 1];
+				}
+				nearest[slot] = candidate;
+			}
+		}
+		return;
+	}
+
+	const int axis = axes[node];
+	const size_t mid = begin + (end - begin) / 2;
+	const double difference = query[axis] - splits[node];
+	const bool leftFirst = difference < 0;
+
+	if (leftFirst)
+		searchNearest(2 * node + 1, level + 1, begin, mid, query, cellDistance, offset, k, maxSquaredDistance, nearest);
+	else
+		searchNearest(2 * node + 2, level + 1, mid, end, query, cellDistance, offset, k, maxSquaredDistance, nearest);
+
+	// The far cell is at least as far away as the split plane in this axis and as its parent in the others
+	const double farDistance = cellDistance - offset[axis] * offset[axis] + difference * difference;
+	const double worstDistance = nearest.size() < k ? maxSquaredDistance : worstNeighbour(nearest, k).squaredDistance;
+
+	if (farDistance <= worstDistance)
+	{
+		const double parentOffset = offset[axis];
+		offset[axis] = difference;
+
+		if (leftFirst)
+			searchNearest(2 * node + 2, level + 1, mid, end, query, farDistance, offset, k, maxSquaredDistance, nearest);
+		else
+			searchNearest(2 * node + 1, level + 1, begin, mid, query, farDistance, offset, k, maxSquaredDistance, nearest);
+
+		offset[axis] = parentOffset;
+	}
+}
+
+template<typename Index>
+template<typename Visitor>
+void KdTree<Index>::Within(const double query[3], const double squaredRadius, Visitor& visit) const
+{
+	if (points.empty())
+		return;
+
+	double offset[3] = { 0, 0, 0 };
+	searchWithin(0, 0, 0, points.size(), query, 0, offset, squaredRadius, visit);
+}
+
+template<typename Index>
+template<typename Visitor>
+void KdTree<Index>::searchWithin(const size_t node, const int level, const size_t begin, const size_t end, const double query[3],
+	const double cellDistance, double offset[3], const double squaredRadius, Visitor& visit) const
+{
+	if (level == depth)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const double distance = squaredDistance3(query, points[i].xyz);
+
+			if (distance <= squaredRadius)
+				visit(i, distance);
+		}
+		return;
+	}
+
+	const int axis = axes[node];
+	const size_t mid = begin + (end - begin) / 2;
+	const double difference = query[axis] - splits[node];
+	const bool leftFirst = difference < 0;
+
+	if (leftFirst)
+		searchWithin(2 * node + 1, level + 1, begin, mid, query, cellDistance, offset, squaredRadius, visit);
+	else
+		searchWithin(2 * node + 2, level + 1, mid, end, query, cellDistance, offset, squaredRadius, visit);
+
+	const double farDistance = cellDistance - offset[axis] * offset[axis] + difference * difference;
+
+	if (farDistance <= squaredRadius)
+	{
+		const double parentOffset = offset[axis];
+		offset[axis] = difference;
+
+		if (leftFirst)
+			searchWithin(2 * node + 2, level + 1, mid, end, query, farDistance, offset, squaredRadius, visit);
+		else
+			searchWithin(2 * node + 1, level + 1, begin, mid, query, farDistance, offset, squaredRadius, visit);
+
+		offset[axis] = parentOffset;
+	}
+}
+
+#endif // !KD_TREE_H
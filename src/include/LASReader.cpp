@@ -1,7 +1,14 @@
 #include "LAS_IO.hpp"
+#include <cmath>
 #include <cstring>
 #include <memory>
 
+#if MX_HAS_INTERLEAVED_COMPLEX
+#define GetDoubles	mxGetDoubles
+#else
+#define GetDoubles	(mxDouble*)	mxGetPr
+#endif
+
 
 void LASdataReader::ReadLASheader(std::ifstream& lasBin)
 {
@@ -14,62 +21,12 @@ void LASdataReader::ReadLASheader(std::ifstream& lasBin)
 	lasBin.read(headerBuf, headerReadBytes);
 
 	/*Parse Header*/
-	std::memcpy(m_header.fileSignature, headerBuf, 4);
-
-	m_header.sourceID			= *reinterpret_cast<uint16_t*>(headerBuf + 4);
-	m_header.globalEncoding		= *reinterpret_cast<uint16_t*>(headerBuf + 6);
-	m_header.projectID_GUID_1	= *reinterpret_cast<uint32_t*>(headerBuf + 8);
-	m_header.projectID_GUID_2	= *reinterpret_cast<uint16_t*>(headerBuf + 12);
-	m_header.projectID_GUID_3	= *reinterpret_cast<uint16_t*>(headerBuf + 14);
-
-	// Copy chars into projectID_GUID_4
-	std::memcpy(m_header.projectID_GUID_4, headerBuf + 16, 8);
-
-	m_header.versionMajor = *reinterpret_cast<uint8_t*>(headerBuf + 24);
-	m_header.versionMinor = *reinterpret_cast<uint8_t*>(headerBuf + 25);
-
-	// Copy chars into System identifier and Generating Software
-	std::memcpy(m_header.systemIdentifier, headerBuf + 26, 32);
-	std::memcpy(m_header.generatingSoftware, headerBuf + 58, 32);
-
-	m_header.fileCreationDayOfYear			= *reinterpret_cast<uint16_t*>(headerBuf + 90);
-	m_header.fileCreationYear				= *reinterpret_cast<uint16_t*>(headerBuf + 92);
-	m_header.headerSize						= *reinterpret_cast<uint16_t*>(headerBuf + 94);
-	m_header.offsetToPointData				= *reinterpret_cast<uint32_t*>(headerBuf + 96);
-	m_header.numberOfVariableLengthRecords	= *reinterpret_cast<uint32_t*>(headerBuf + 100);
-	m_header.PointDataRecordFormat			= *reinterpret_cast<uint8_t*> (headerBuf + 104);
-	m_header.PointDataRecordLength			= *reinterpret_cast<uint16_t*>(headerBuf + 105);
-	m_header.LegacyNumberOfPointRecords		= *reinterpret_cast<uint32_t*>(headerBuf + 107);
-
-	std::memcpy(m_header.LegacyNumberOfPointByReturn, headerBuf + 111, 20);
-
-	m_header.xScaleFactor	= *reinterpret_cast<double*>(headerBuf + 131);
-	m_header.yScaleFactor	= *reinterpret_cast<double*>(headerBuf + 139);
-	m_header.zScaleFactor	= *reinterpret_cast<double*>(headerBuf + 147);
-	m_header.xOffset		= *reinterpret_cast<double*>(headerBuf + 155);
-	m_header.yOffset		= *reinterpret_cast<double*>(headerBuf + 163);
-	m_header.zOffset		= *reinterpret_cast<double*>(headerBuf + 171);
-	m_header.maxX			= *reinterpret_cast<double*>(headerBuf + 179);
-	m_header.minX			= *reinterpret_cast<double*>(headerBuf + 187);
-	m_header.maxY			= *reinterpret_cast<double*>(headerBuf + 195);
-	m_header.minY			= *reinterpret_cast<double*>(headerBuf + 203);
-	m_header.maxZ			= *reinterpret_cast<double*>(headerBuf + 211);
-	m_header.minZ			= *reinterpret_cast<double*>(headerBuf + 219);
+	parseLASheader(headerBuf, m_header, m_headerExt3, m_headerExt4);
 
 	// Get number of points to read later from numberOfPointRecords, but differentiate if from legacy fields or new fields starting with LAS 1.4
 	m_numberOfPointsToRead = (uint_fast64_t)m_header.LegacyNumberOfPointRecords;
 
-	if (m_header.versionMinor > 2) 
-	{
-		m_headerExt3.startOfWaveFormData = *reinterpret_cast<uint64_t*>(headerBuf + 227);
-	}
-	if (m_header.versionMinor > 3)
-	{
-		m_headerExt4.startOfFirstExtendedVariableLengthRecord	= *reinterpret_cast<uint64_t*>(headerBuf + 235);
-		m_headerExt4.numberOfExtendedVariableLengthRecords		= *reinterpret_cast<uint32_t*>(headerBuf + 243);
-		m_headerExt4.numberOfPointRecords						= *reinterpret_cast<uint64_t*>(headerBuf + 247);
-		std::memcpy(m_headerExt4.numberOfPointsByReturn, headerBuf + 255, 120);
-
+	if (m_header.versionMinor > 3) {
 		m_numberOfPointsToRead = (uint_fast64_t)m_headerExt4.numberOfPointRecords;
 	}
 
@@ -87,13 +44,8 @@ void LASdataReader::ReadLASheader(std::ifstream& lasBin)
 void LASdataReader::ReadPointData(std::ifstream& lasBin)
 {
 	const int chunksize = 4096;																		// Blocksize of points for reading -> How many Points will be read at once. Bigger buffer yields diminishing returns
-	int pointsToProcessInBuffer = chunksize;														// Used and manipulated in reading for-loop
 	const size_t bufferSize = static_cast<size_t>(m_header.PointDataRecordLength) * chunksize;		// Buffer size in bytes
 
-	// Data will be read in blocks. Determine Block count here
-	uint_fast64_t fullChunksCount = m_numberOfPointsToRead / static_cast<uint_fast64_t>(chunksize);
-	int pointsLeftToRead = (int)(m_numberOfPointsToRead - (static_cast<uint_fast64_t>(chunksize) * fullChunksCount));
-
 	/* Check for Point Data Format and start reading*/
 	// Create reading buffer
 	std::unique_ptr<char[]>  uniqueBuffer(new (std::nothrow) char[bufferSize]);
@@ -108,8 +60,34 @@ void LASdataReader::ReadPointData(std::ifstream& lasBin)
 	// Set this external buffer to be used as internal buffer of ifstream to avoid copying from internal to external buffer
 	lasBin.rdbuf()->pubsetbuf(buffer, bufferSize);
 
-	// Seek begining of point data 
-	lasBin.seekg(m_header.offsetToPointData, lasBin.beg);
+	// Selected ranges are read one after another, their points follow each other in the output struct
+	if (m_readRanges.empty())
+	{
+		readPointRange(lasBin, buffer, bufferSize, 0, m_numberOfPointsToRead);
+	}
+	else
+	{
+		for (const std::pair<uint64_t, uint64_t>& range : m_readRanges) {
+			readPointRange(lasBin, buffer, bufferSize, range.first, range.second);
+		}
+	}
+
+	// Unbuffer stream, though this is implementation defined
+	lasBin.rdbuf()->pubsetbuf(0, 0);
+}
+
+void LASdataReader::readPointRange(std::ifstream& lasBin, char* buffer, size_t bufferSize, uint_fast64_t firstPoint, uint_fast64_t pointCount)
+{
+	const int chunksize = static_cast<int>(bufferSize / m_header.PointDataRecordLength);
+	int pointsToProcessInBuffer = chunksize;														// Used and manipulated in reading for-loop
+
+	// Data will be read in blocks. Determine Block count here
+	uint_fast64_t fullChunksCount = pointCount / static_cast<uint_fast64_t>(chunksize);
+	int pointsLeftToRead = (int)(pointCount - (static_cast<uint_fast64_t>(chunksize) * fullChunksCount));
+
+	// Seek begining of the point records. A previous range may have read up to the end of the file
+	lasBin.clear();
+	lasBin.seekg(m_header.offsetToPointData + firstPoint * m_header.PointDataRecordLength, lasBin.beg);
 
 	// If unsafe Read then read coordinates and intensities and return early
 	if (m_XYZIntOnly) {
@@ -424,9 +402,6 @@ void LASdataReader::ReadPointData(std::ifstream& lasBin)
 
 	}
 	}
-
-	// Unbuffer stream, though this is implementation defined
-	lasBin.rdbuf()->pubsetbuf(0, 0);
 }
 
 
@@ -512,3 +487,86 @@ void LASdataReader::SetReadXYZIntOnly(bool m_XYZIntOnly_flag) {
 	m_XYZIntOnly = m_XYZIntOnly_flag;
 }
 
+void LASdataReader::SelectOctreeNodes(std::ifstream& lasBin, const mxArray* pOptions)
+{
+	double boxMin[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+	double boxMax[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL };
+	int maxDepth = INT32_MAX;
+
+	// Box is [xmin ymin xmax ymax] or [xmin ymin zmin xmax ymax zmax], without box the whole extent is selected
+	mxArray* pField = mxGetField(pOptions, 0, "bbox");
+	if (nullptr != pField && !mxIsEmpty(pField))
+	{
+		const size_t count = mxGetNumberOfElements(pField);
+
+		if (!mxIsDouble(pField) || (count != 4 && count != 6)) {
+			mexErrMsgIdAndTxt("MEX:SelectOctreeNodes:bbox", "Bounding box has to be [xmin ymin xmax ymax] or [xmin ymin zmin xmax ymax zmax]!");
+		}
+
+		const double* pBox = GetDoubles(pField);
+		const size_t axisCount = count / 2;
+
+		for (size_t axis = 0; axis < axisCount; ++axis)
+		{
+			boxMin[axis] = pBox[axis];
+			boxMax[axis] = pBox[axis + axisCount];
+		}
+	}
+
+	pField = mxGetField(pOptions, 0, "maxDepth");
+	if (nullptr != pField && !mxIsEmpty(pField))
+	{
+		const double depth = mxGetScalar(pField);
+
+		if (!(depth >= 0)) {
+			mexErrMsgIdAndTxt("MEX:SelectOctreeNodes:maxDepth", "Maximum depth of the octree has to be zero or positive!");
+		}
+
+		maxDepth = depth < INT32_MAX ? static_cast<int>(depth) : INT32_MAX;
+	}
+
+	// Search the hierarchy within the extended VLRs
+	OctreeHierarchy hierarchy;
+	bool hasHierarchy = false;
+
+	if (HasExtVLR())
+	{
+		setStreamToExtVLRHeader(lasBin);
+
+		for (unsigned long i = 0; i < m_headerExt4.numberOfExtendedVariableLengthRecords && lasBin.good(); ++i)
+		{
+			readExtVLRHeader(lasBin);
+
+			if (isOctreeHierarchy(m_ExtVLRHeader.userID, m_ExtVLRHeader.recordID))
+			{
+				std::vector<char> data(static_cast<size_t>(m_ExtVLRHeader.recordLengthAfterHeader));
+				lasBin.read(data.data(), data.size());
+				hasHierarchy = lasBin.good() && decodeOctreeHierarchy(data.data(), data.size(), hierarchy);
+				break;
+			}
+
+			lasBin.seekg(m_ExtVLRHeader.recordLengthAfterHeader, lasBin.cur);
+		}
+
+		lasBin.clear();
+	}
+
+	if (!hasHierarchy) {
+		mexErrMsgIdAndTxt("MEX:SelectOctreeNodes:noHierarchy", "LAS-File contains no level of detail octree!");
+	}
+
+	// Nodes have to lie within the point records of the file
+	const uint_fast64_t filePointCount = m_numberOfPointsToRead;
+	m_readRanges = selectOctreeNodes(hierarchy, boxMin, boxMax, maxDepth);
+	m_numberOfPointsToRead = 0;
+
+	for (const std::pair<uint64_t, uint64_t>& range : m_readRanges)
+	{
+		if (range.first > filePointCount || range.second > filePointCount - range.first) {
+			mexErrMsgIdAndTxt("MEX:SelectOctreeNodes:invalidHierarchy", "Level of detail octree refers to more points than the LAS-File contains!");
+		}
+
+		m_numberOfPointsToRead += range.second;
+	}
+}
+
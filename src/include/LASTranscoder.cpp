@@ -0,0 +1,1934 @@
+#include "LAS_IO.hpp"
+#include "CoordinateQuantization.hpp"
+#include "PointFormatConversion.hpp"
+#include "PointInPolygon.hpp"
+#include "Rasterizer.hpp"
+#include <cstring>
+#include <memory>
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+// Preprocessor directives to get field data
+
+#if MX_HAS_INTERLEAVED_COMPLEX
+
+#define GetDoubles	mxGetDoubles
+
+#else
+
+#define GetDoubles	(mxDouble*)	mxGetPr
+
+#endif
+
+// Returns pointer to the values of an option field or nullptr if the field does not exist or is empty.
+// Throws Matlab Error if the field is not a double array with one of the allowed element counts
+static const double* getOptionValues(const mxArray* pOptions, const char* fieldName, size_t allowedCount1, size_t allowedCount2, size_t& count)
+{
+	const mxArray* pField = mxGetField(pOptions, 0, fieldName);
+	count = 0;
+
+	if (nullptr == pField || mxIsEmpty(pField)) {
+		return nullptr;
+	}
+
+	count = mxGetNumberOfElements(pField);
+
+	if (!mxIsDouble(pField) || (allowedCount1 != 0 && count != allowedCount1 && count != allowedCount2)) {
+		mexErrMsgIdAndTxt("MEX:LASTranscoder:GetOptions", "Option %s has to be a double array with the documented number of elements!", fieldName);
+	}
+
+	return GetDoubles(pField);
+}
+
+void LASdataTranscoder::GetOptions(const mxArray* pOptions)
+{
+	if (nullptr == pOptions) {
+		return;
+	}
+
+	if (!mxIsStruct(pOptions)) {
+		mexErrMsgIdAndTxt("MEX:LASTranscoder:GetOptions", "Transcoder options have to be a struct!");
+	}
+
+	size_t count = 0;
+
+	// Bounding box as [xmin ymin xmax ymax] or [xmin ymin zmin xmax ymax zmax]
+	const double* pValues = getOptionValues(pOptions, "bbox", 4, 6, count);
+	if (nullptr != pValues)
+	{
+		m_options.useBoundingBox = true;
+
+		if (count == 4)
+		{
+			m_options.boxMin[0] = pValues[0]; m_options.boxMin[1] = pValues[1]; m_options.boxMin[2] = -HUGE_VAL;
+			m_options.boxMax[0] = pValues[2]; m_options.boxMax[1] = pValues[3]; m_options.boxMax[2] =  HUGE_VAL;
+		}
+		else
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				m_options.boxMin[axis] = pValues[axis];
+				m_options.boxMax[axis] = pValues[axis + 3];
+			}
+		}
+	}
+
+	pValues = getOptionValues(pOptions, "classes", 0, 0, count);
+	if (nullptr != pValues)
+	{
+		m_options.keepClass.assign(256, false);
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (pValues[i] >= 0 && pValues[i] < 256) { m_options.keepClass[static_cast<size_t>(pValues[i])] = true; }
+		}
+	}
+
+	pValues = getOptionValues(pOptions, "returnNumbers", 0, 0, count);
+	if (nullptr != pValues)
+	{
+		m_options.keepReturn.assign(16, false);
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (pValues[i] >= 0 && pValues[i] < 16) { m_options.keepReturn[static_cast<size_t>(pValues[i])] = true; }
+		}
+	}
+
+	pValues = getOptionValues(pOptions, "timeWindow", 2, 2, count);
+	if (nullptr != pValues)
+	{
+		m_options.useTimeWindow = true;
+		m_options.timeWindow[0] = pValues[0];
+		m_options.timeWindow[1] = pValues[1];
+	}
+
+	// Polygon as [x y] matrix with one vertex per row, rings of polygons with holes separated by NaN
+	const mxArray* pField = mxGetField(pOptions, 0, "polygon");
+	pValues = getOptionValues(pOptions, "polygon", 0, 0, count);
+	if (nullptr != pValues)
+	{
+		if (mxGetN(pField) != 2 || count / 2 > INT32_MAX) {
+			mexErrMsgIdAndTxt("MEX:LASTranscoder:GetOptions", "Option polygon has to be a double matrix with the X and Y coordinates of the vertices as columns!");
+		}
+
+		const int vertexCount = static_cast<int>(mxGetM(pField));
+		std::shared_ptr<PolygonEdgeIndex<double>> polygon = std::make_shared<PolygonEdgeIndex<double>>();
+		buildEdgeIndex(*polygon, pValues, pValues + vertexCount, vertexCount);
+		m_options.usePolygon = true;
+		m_options.polygon = polygon;
+	}
+
+	pValues = getOptionValues(pOptions, "scale", 3, 3, count);
+	if (nullptr != pValues)
+	{
+		m_options.useScale = true;
+		for (int axis = 0; axis < 3; ++axis) { m_options.scale[axis] = pValues[axis]; }
+
+		if (!(m_options.scale[0] > 0 && m_options.scale[1] > 0 && m_options.scale[2] > 0)) {
+			mexErrMsgIdAndTxt("MEX:LASTranscoder:GetOptions", "Scale factors have to be greater than zero!");
+		}
+	}
+
+	pValues = getOptionValues(pOptions, "offset", 3, 3, count);
+	if (nullptr != pValues)
+	{
+		m_options.useOffset = true;
+		for (int axis = 0; axis < 3; ++axis) { m_options.offset[axis] = pValues[axis]; }
+	}
+
+	pField = mxGetField(pOptions, 0, "targetPointFormat");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.targetPointFormat = static_cast<int>(mxGetScalar(pField));
+	}
+
+	pField = mxGetField(pOptions, 0, "dropExtraBytes");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.dropExtraBytes = mxGetScalar(pField) != 0;
+	}
+
+	pField = mxGetField(pOptions, 0, "spatialSort");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.spatialSort = getSpatialOrder(pField);
+	}
+
+	// A run holds at least one chunk and its indices stay in the int range of the OpenMP loops
+	pField = mxGetField(pOptions, 0, "sortRunPoints");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		const double runPoints = mxGetScalar(pField);
+		m_options.sortRunPoints = static_cast<size_t>(std::min(std::max(runPoints, 65536.0), 1073741824.0));
+	}
+
+	pField = mxGetField(pOptions, 0, "tileSize");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.tileSize = mxGetScalar(pField);
+	}
+
+	pValues = getOptionValues(pOptions, "tileOrigin", 2, 2, count);
+	if (nullptr != pValues)
+	{
+		m_options.tileOrigin[0] = pValues[0];
+		m_options.tileOrigin[1] = pValues[1];
+	}
+
+	pField = mxGetField(pOptions, 0, "tileOverlap");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.tileOverlap = mxGetScalar(pField);
+	}
+
+	pField = mxGetField(pOptions, 0, "tileBufferBytes");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.tileBufferBytes = static_cast<size_t>(std::max(mxGetScalar(pField), 0.0));
+	}
+
+	if (!(m_options.tileSize >= 0) || !(m_options.tileOverlap >= 0) || !(m_options.tileOverlap < m_options.tileSize || m_options.tileSize == 0)) {
+		mexErrMsgIdAndTxt("MEX:LASTranscoder:GetOptions", "Tile size has to be positive and the tile overlap smaller than the tile size!");
+	}
+}
+
+unsigned long long LASdataTranscoder::GetWrittenPointCount() const
+{
+	return m_pointCount;
+}
+
+void LASdataTranscoder::SetTemporaryPath(const std::string& temporaryPath)
+{
+	m_temporaryPath = temporaryPath;
+}
+
+void LASdataTranscoder::Transcode(std::ifstream& inBin, std::ofstream& outBin)
+{
+	if (!inBin.is_open() || !outBin.is_open()) { throw std::ios_base::failure("Input or output file is not open!"); }
+
+	const unsigned long long fileSize = readInputHeader(inBin);
+
+	// Header is written with the input statistics first and corrected after the points are written
+	writeHeader(outBin);
+	copyVLRs(inBin, outBin);
+
+	inBin.seekg(m_inputHeader.offsetToPointData, std::ios::beg);
+
+	if (m_options.spatialSort == SpatialOrder::None) {
+		streamPoints(inBin, outBin);
+	}
+	else {
+		sortPoints(inBin, outBin);
+	}
+
+	if (inBin.fail()) { throw std::ios_base::failure("Error while reading the point data of the input file!"); }
+
+	copyTrailingData(inBin, outBin, fileSize);
+	applyHeaderStatistics(m_minXYZ, m_maxXYZ, m_pointCount, m_pointsByReturn);
+
+	const auto endOfFile = outBin.tellp();
+	writeHeader(outBin);
+	outBin.seekp(endOfFile, std::ios::beg);
+
+	if (outBin.fail()) { throw std::ios_base::failure("Error during file write! Stream went bad!"); }
+}
+
+unsigned long long LASdataTranscoder::readInputHeader(std::ifstream& inBin)
+{
+	// Read and parse header of the input file. Files with a short header and no points are smaller than the buffer
+	char headerBuf[375] = {};
+	inBin.read(headerBuf, 375);
+	inBin.clear();
+	parseLASheader(headerBuf, m_inputHeader, m_inputHeaderExt3, m_inputHeaderExt4);
+
+	inBin.seekg(0, std::ios::end);
+	const unsigned long long fileSize = static_cast<unsigned long long>(inBin.tellg());
+
+	m_inputPointCount = m_inputHeader.versionMinor > 3 ? m_inputHeaderExt4.numberOfPointRecords : m_inputHeader.LegacyNumberOfPointRecords;
+
+	setOutputHeader();
+	setPolygonBounds();
+
+	const unsigned long long endOfInputPoints = m_inputHeader.offsetToPointData + m_inputPointCount * m_inputHeader.PointDataRecordLength;
+
+	if (fileSize < endOfInputPoints) {
+		mexErrMsgIdAndTxt("MEX:LASTranscoder:invalidFile", "Input file is shorter than its point data according to header!");
+	}
+
+	return fileSize;
+}
+
+void LASdataTranscoder::streamPoints(std::ifstream& inBin, std::ofstream& outBin)
+{
+	const size_t chunkPointCount = 65536;
+	std::unique_ptr<char[]> inBuffer(new char[chunkPointCount * m_in.recordLength]);
+	std::unique_ptr<char[]> outBuffer(new char[chunkPointCount * m_out.recordLength]);
+	std::fill(outBuffer.get(), outBuffer.get() + chunkPointCount * m_out.recordLength, static_cast<char>(0));
+
+	for (unsigned long long pointOffset = 0; pointOffset < m_inputPointCount; pointOffset += chunkPointCount)
+	{
+		const size_t pointsInChunk = static_cast<size_t>(std::min(static_cast<unsigned long long>(chunkPointCount), m_inputPointCount - pointOffset));
+
+		inBin.read(inBuffer.get(), static_cast<std::streamsize>(pointsInChunk) * m_in.recordLength);
+		const size_t keptPoints = transcodeChunk(inBuffer.get(), outBuffer.get(), pointsInChunk);
+		outBin.write(outBuffer.get(), static_cast<std::streamsize>(keptPoints) * m_out.recordLength);
+	}
+}
+
+// Removes the temporary file of the sorted runs when sorting ends, also if an exception is thrown
+class TemporaryFile
+{
+public:
+	explicit TemporaryFile(const std::string& path) : m_path(path) {}
+	~TemporaryFile()
+	{
+		if (m_stream.is_open()) { m_stream.close(); }
+		if (m_isCreated) { std::remove(m_path.c_str()); }
+	}
+
+	std::fstream& Open()
+	{
+		if (!m_isCreated)
+		{
+			m_stream.open(m_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!m_stream.is_open()) { throw std::ios_base::failure("Temporary file for sorting could not be created!"); }
+			m_isCreated = true;
+		}
+		return m_stream;
+	}
+
+private:
+	std::string		m_path;
+	std::fstream	m_stream;
+	bool			m_isCreated = false;
+};
+
+SpatialGrid LASdataTranscoder::getSpatialGrid() const
+{
+	const double minimum[3] = { m_inputHeader.minX, m_inputHeader.minY, m_inputHeader.minZ };
+	const double maximum[3] = { m_inputHeader.maxX, m_inputHeader.maxY, m_inputHeader.maxZ };
+	const double offsets[3] = { m_header.xOffset, m_header.yOffset, m_header.zOffset };
+	const double scales[3]	= { m_header.xScaleFactor, m_header.yScaleFactor, m_header.zScaleFactor };
+	int32_t quantizedMin[3];
+	int32_t quantizedMax[3];
+
+	// A wrong header box only makes the order less compact, points outside of it are clamped to the border cells
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const double lower = (minimum[axis] - offsets[axis]) / scales[axis];
+		const double upper = (maximum[axis] - offsets[axis]) / scales[axis];
+		quantizedMin[axis] = static_cast<int32_t>(std::min(std::max(std::round(lower), -2147483648.0), 2147483647.0));
+		quantizedMax[axis] = static_cast<int32_t>(std::min(std::max(std::round(upper), -2147483648.0), 2147483647.0));
+	}
+
+	return SpatialGrid(quantizedMin, quantizedMax);
+}
+
+void LASdataTranscoder::sortPoints(std::ifstream& inBin, std::ofstream& outBin)
+{
+	const size_t chunkPointCount = 65536;
+	const size_t runPointCount = static_cast<size_t>(std::min(static_cast<unsigned long long>(m_options.sortRunPoints), std::max<unsigned long long>(m_inputPointCount, 1)));
+	const size_t recordLength = m_out.recordLength;
+	const size_t entryLength = sizeof(uint64_t) + recordLength;
+	const SpatialGrid grid = getSpatialGrid();
+	const SpatialOrder order = m_options.spatialSort;
+
+	std::unique_ptr<char[]> inBuffer(new char[chunkPointCount * m_in.recordLength]);
+	std::vector<char> runRecords(runPointCount * recordLength, 0);
+	std::vector<char> writeBuffer(chunkPointCount * entryLength);
+	std::vector<uint64_t> keys;
+	std::vector<size_t> indices;
+	std::vector<SortedRun> runs;
+	TemporaryFile runFile(m_temporaryPath);
+
+	unsigned long long pointOffset = 0;
+	size_t runFill = 0;
+
+	while (true)
+	{
+		// Fill the run with the records that pass the filters. A chunk never produces more records than it reads
+		if (pointOffset < m_inputPointCount)
+		{
+			const size_t pointsInChunk = static_cast<size_t>(std::min(static_cast<unsigned long long>(std::min(chunkPointCount, runPointCount - runFill)), m_inputPointCount - pointOffset));
+
+			inBin.read(inBuffer.get(), static_cast<std::streamsize>(pointsInChunk) * m_in.recordLength);
+			runFill += transcodeChunk(inBuffer.get(), &runRecords[runFill * recordLength], pointsInChunk);
+			pointOffset += pointsInChunk;
+		}
+
+		const bool isInputDone = pointOffset >= m_inputPointCount;
+
+		if (runFill < runPointCount && !isInputDone) {
+			continue;
+		}
+
+		// Sort the run by the keys of the quantized output coordinates
+		const char* pRecords = runRecords.data();
+		const int count = static_cast<int>(runFill);
+		keys.resize(runFill);
+		indices.resize(runFill);
+		uint64_t* pKeys = keys.data();
+
+#pragma omp parallel for if (count > 16384)
+		for (int k = 0; k < count; ++k)
+		{
+			int32_t XYZ[3];
+			std::memcpy(XYZ, pRecords + static_cast<size_t>(k) * recordLength, 12);
+			pKeys[k] = spatialKey(order, grid.Cell(XYZ[0], 0), grid.Cell(XYZ[1], 1), grid.Cell(XYZ[2], 2));
+		}
+
+		for (size_t k = 0; k < runFill; ++k) { indices[k] = k; }
+		radixSortPairs(keys, indices);
+
+		// A single run is written directly, otherwise keys and records are stored in the temporary file for merging
+		const bool isOnlyRun = isInputDone && runs.empty();
+
+		if (!isOnlyRun && runFill > 0)
+		{
+			std::fstream& runStream = runFile.Open();
+			SortedRun run;
+			run.filePosition = static_cast<unsigned long long>(runStream.tellp());
+			run.pointCount = runFill;
+			runs.push_back(run);
+		}
+
+		for (size_t first = 0; first < runFill; first += chunkPointCount)
+		{
+			const size_t entries = std::min(chunkPointCount, runFill - first);
+			char* pEntry = writeBuffer.data();
+
+			for (size_t k = first; k < first + entries; ++k)
+			{
+				if (!isOnlyRun)
+				{
+					std::memcpy(pEntry, &keys[k], sizeof(uint64_t));
+					pEntry += sizeof(uint64_t);
+				}
+
+				std::memcpy(pEntry, pRecords + indices[k] * recordLength, recordLength);
+				pEntry += recordLength;
+			}
+
+			if (isOnlyRun) {
+				outBin.write(writeBuffer.data(), static_cast<std::streamsize>(entries * recordLength));
+			}
+			else {
+				runFile.Open().write(writeBuffer.data(), static_cast<std::streamsize>(entries * entryLength));
+			}
+		}
+
+		runFill = 0;
+
+		if (isInputDone) {
+			break;
+		}
+	}
+
+	// Release the run before the merge buffers are allocated
+	runRecords = std::vector<char>();
+	keys = std::vector<uint64_t>();
+	indices = std::vector<size_t>();
+
+	if (!runs.empty())
+	{
+		std::fstream& runStream = runFile.Open();
+		if (runStream.fail()) { throw std::ios_base::failure("Error while writing the temporary file for sorting!"); }
+
+		mergeRuns(runStream, runs, outBin);
+	}
+}
+
+void LASdataTranscoder::mergeRuns(std::fstream& runFile, const std::vector<SortedRun>& runs, std::ofstream& outBin) const
+{
+	const size_t chunkPointCount = 65536;
+	const size_t recordLength = m_out.recordLength;
+	const size_t entryLength = sizeof(uint64_t) + recordLength;
+
+	// The read buffers of all runs together use about as much memory as one run in memory
+	const size_t bufferEntries = std::max(static_cast<size_t>(1024), m_options.sortRunPoints / runs.size());
+
+	struct RunCursor
+	{
+		unsigned long long	filePosition	= 0;	// Position of the next entry that is not buffered yet
+		unsigned long long	remaining		= 0;	// Entries that are not buffered yet
+		std::vector<char>	buffer;
+		size_t				bufferFill		= 0;
+		size_t				position		= 0;
+	};
+
+	std::vector<RunCursor> cursors(runs.size());
+
+	// Read the next entries of a run. Returns false if the run is exhausted
+	auto refill = [&](RunCursor& cursor) -> bool
+	{
+		if (cursor.remaining == 0) {
+			return false;
+		}
+
+		const size_t entries = static_cast<size_t>(std::min(static_cast<unsigned long long>(bufferEntries), cursor.remaining));
+		runFile.seekg(static_cast<std::streamoff>(cursor.filePosition), std::ios::beg);
+		runFile.read(cursor.buffer.data(), static_cast<std::streamsize>(entries * entryLength));
+
+		if (runFile.fail()) { throw std::ios_base::failure("Error while reading the temporary file for sorting!"); }
+
+		cursor.filePosition += entries * entryLength;
+		cursor.remaining -= entries;
+		cursor.bufferFill = entries;
+		cursor.position = 0;
+		return true;
+	};
+
+	// Min heap of the current key of every run, equal keys are taken from the earlier run
+	typedef std::pair<uint64_t, size_t> HeapEntry;
+	std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+
+	for (size_t i = 0; i < runs.size(); ++i)
+	{
+		cursors[i].filePosition = runs[i].filePosition;
+		cursors[i].remaining = runs[i].pointCount;
+		cursors[i].buffer.resize(std::min(static_cast<unsigned long long>(bufferEntries), runs[i].pointCount) * entryLength);
+
+		if (refill(cursors[i]))
+		{
+			uint64_t key;
+			std::memcpy(&key, cursors[i].buffer.data(), sizeof(uint64_t));
+			heap.push(HeapEntry(key, i));
+		}
+	}
+
+	std::vector<char> writeBuffer(chunkPointCount * recordLength);
+	size_t writeFill = 0;
+
+	while (!heap.empty())
+	{
+		const size_t runIndex = heap.top().second;
+		heap.pop();
+
+		RunCursor& cursor = cursors[runIndex];
+		std::memcpy(&writeBuffer[writeFill * recordLength], &cursor.buffer[cursor.position * entryLength + sizeof(uint64_t)], recordLength);
+
+		if (++writeFill == chunkPointCount)
+		{
+			outBin.write(writeBuffer.data(), static_cast<std::streamsize>(writeFill * recordLength));
+			writeFill = 0;
+		}
+
+		if (++cursor.position < cursor.bufferFill || refill(cursor))
+		{
+			uint64_t key;
+			std::memcpy(&key, &cursor.buffer[cursor.position * entryLength], sizeof(uint64_t));
+			heap.push(HeapEntry(key, runIndex));
+		}
+	}
+
+	outBin.write(writeBuffer.data(), static_cast<std::streamsize>(writeFill * recordLength));
+}
+
+void LASdataTranscoder::setRecordOffsets(RecordOffsets& offsets, unsigned char pointDataRecordFormat, int extraBytesCount) const
+{
+	const size_t id = pointDataRecordFormat;
+
+	offsets.recordLength		= m_record_lengths[id] + extraBytesCount;
+	offsets.extraBytesCount		= extraBytesCount;
+	offsets.extradata_Byte		= m_record_lengths[id];
+	offsets.bits2_Byte			= m_bits2_Byte[id];
+	offsets.classification_Byte = m_classification_Byte[id];
+	offsets.scanAngle_Byte		= m_scanAngle_Byte[id];
+	offsets.userData_Byte		= m_userData_Byte[id];
+	offsets.pointSourceID_Byte	= m_pointSourceID_Byte[id];
+	offsets.time_Byte			= m_time_Byte[id];
+	offsets.color_Byte			= m_color_Byte[id];
+	offsets.NIR_Byte			= m_NIR_Byte[id];
+	offsets.wavePackets_Byte	= m_wavePackets_Byte[id];
+	offsets.isExtended			= pointDataRecordFormat > 5;
+}
+
+void LASdataTranscoder::setOutputHeader()
+{
+	const LASheader& in = m_inputHeader;
+
+	// Check the input file before anything is written
+	const char* errorMessage = nullptr;
+
+	if (std::strncmp(in.fileSignature, "LASF", 4) != 0 || in.versionMajor != 1 || in.versionMinor > 4) {
+		errorMessage = "Input file is not a valid LAS-File of version 1.0 to 1.4!";
+	}
+	else if (in.PointDataRecordFormat >= RecordFormatCount || in.PointDataRecordLength < m_record_lengths[in.PointDataRecordFormat]) {
+		errorMessage = "Point data record format or record length of the input file is not supported!";
+	}
+	else if (in.offsetToPointData < in.headerSize) {
+		errorMessage = "Offset to point data of the input file is smaller than its header size!";
+	}
+
+	if (nullptr != errorMessage) {
+		mexErrMsgIdAndTxt("MEX:LASTranscoder:invalidFile", errorMessage);
+	}
+
+	const int targetFormat = m_options.targetPointFormat < 0 ? in.PointDataRecordFormat : m_options.targetPointFormat;
+
+	if (targetFormat >= static_cast<int>(RecordFormatCount)) {
+		mexErrMsgIdAndTxt("MEX:LASTranscoder:invalidTarget", "Target point data record format has to be 0 to 10!");
+	}
+
+	const int inputExtraBytes = in.PointDataRecordLength - m_record_lengths[in.PointDataRecordFormat];
+	setRecordOffsets(m_in, in.PointDataRecordFormat, inputExtraBytes);
+	setRecordOffsets(m_out, static_cast<unsigned char>(targetFormat), m_options.dropExtraBytes ? 0 : inputExtraBytes);
+
+	if (m_options.useTimeWindow && m_in.time_Byte == 0) {
+		mexErrMsgIdAndTxt("MEX:LASTranscoder:noTime", "Time window can not be applied because the input points have no GPS time!");
+	}
+
+	m_header	 = in;
+	m_headerExt3 = m_inputHeaderExt3;
+	m_headerExt4 = m_inputHeaderExt4;
+
+	// Version is only raised if the target format requires it. Extended VLRs and waveform data are kept that way
+	if (targetFormat > 5) { m_header.versionMinor = 4; }
+	else if ((targetFormat == 4 || targetFormat == 5) && m_header.versionMinor < 3) { m_header.versionMinor = 3; }
+
+	if (in.versionMinor < 3) {
+		m_headerExt3 = LASheaderExt3();
+	}
+	if (in.versionMinor < 4) {
+		m_headerExt4 = LASheaderExt4();
+	}
+
+	m_header.headerSize				= m_header.versionMinor < 3 ? 227 : (m_header.versionMinor < 4 ? 235 : 375);
+	m_header.PointDataRecordFormat	= static_cast<unsigned char>(targetFormat);
+	m_header.PointDataRecordLength	= static_cast<unsigned short>(m_out.recordLength);
+
+	if (m_options.useScale)
+	{
+		m_header.xScaleFactor = m_options.scale[0];
+		m_header.yScaleFactor = m_options.scale[1];
+		m_header.zScaleFactor = m_options.scale[2];
+	}
+
+	if (m_options.useOffset)
+	{
+		m_header.xOffset = m_options.offset[0];
+		m_header.yOffset = m_options.offset[1];
+		m_header.zOffset = m_options.offset[2];
+	}
+
+	setRequantization();
+}
+
+void LASdataTranscoder::setRequantization()
+{
+	const LASheader& in = m_inputHeader;
+
+	m_doRequantize = m_header.xScaleFactor != in.xScaleFactor || m_header.yScaleFactor != in.yScaleFactor || m_header.zScaleFactor != in.zScaleFactor ||
+					 m_header.xOffset != in.xOffset || m_header.yOffset != in.yOffset || m_header.zOffset != in.zOffset;
+
+	// Integers are exact if the input scale is a multiple of the output scale and the offsets differ by a multiple of it
+	const double inScales[3]	= { in.xScaleFactor, in.yScaleFactor, in.zScaleFactor };
+	const double inOffsets[3]	= { in.xOffset, in.yOffset, in.zOffset };
+	const double outScales[3]	= { m_header.xScaleFactor, m_header.yScaleFactor, m_header.zScaleFactor };
+	const double outOffsets[3]	= { m_header.xOffset, m_header.yOffset, m_header.zOffset };
+
+	m_isIntegerRequantize = m_doRequantize;
+
+	for (int axis = 0; axis < 3 && m_isIntegerRequantize; ++axis)
+	{
+		const double ratio = inScales[axis] / outScales[axis];
+		const double factor = std::round(ratio);
+		const double shift = (inOffsets[axis] - outOffsets[axis]) / outScales[axis];
+		const double roundedShift = std::round(shift);
+
+		m_isIntegerRequantize = factor >= 1 && factor < 2147483648.0 && std::fabs(ratio - factor) <= 1e-9 * factor &&
+								std::fabs(shift - roundedShift) <= 1e-6 && std::fabs(roundedShift) < 9007199254740992.0;
+
+		m_requantizeFactor[axis] = static_cast<long long>(factor);
+		m_requantizeShift[axis] = static_cast<long long>(roundedShift);
+	}
+}
+
+void LASdataTranscoder::setPolygonBounds()
+{
+	if (!m_options.usePolygon) {
+		return;
+	}
+
+	// Floor and ceil keep every quantized coordinate whose dequantized value can be inside of the box.
+	// A polygon without finite vertices gives an empty range
+	const double scales[2] = { m_inputHeader.xScaleFactor, m_inputHeader.yScaleFactor };
+	const double offsets[2] = { m_inputHeader.xOffset, m_inputHeader.yOffset };
+	const double minimum[2] = { m_options.polygon->minX, m_options.polygon->minY };
+	const double maximum[2] = { m_options.polygon->maxX, m_options.polygon->maxY };
+
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		if (!(minimum[axis] <= maximum[axis]))
+		{
+			m_polygonMinXY[axis] = INT32_MAX;
+			m_polygonMaxXY[axis] = INT32_MIN;
+			continue;
+		}
+
+		const double raw1 = (minimum[axis] - offsets[axis]) / scales[axis];
+		const double raw2 = (maximum[axis] - offsets[axis]) / scales[axis];
+		const double rawMin = std::floor(std::min(raw1, raw2)) - 1;
+		const double rawMax = std::ceil(std::max(raw1, raw2)) + 1;
+
+		m_polygonMinXY[axis] = static_cast<int32_t>(std::min(std::max(rawMin, static_cast<double>(INT32_MIN)), static_cast<double>(INT32_MAX)));
+		m_polygonMaxXY[axis] = static_cast<int32_t>(std::min(std::max(rawMax, static_cast<double>(INT32_MIN)), static_cast<double>(INT32_MAX)));
+	}
+}
+
+inline bool LASdataTranscoder::isRecordKept(const char* pRecord) const
+{
+	if (m_options.useBoundingBox)
+	{
+		int32_t XYZ[3];
+		std::memcpy(XYZ, pRecord, 12);
+
+		const double x = (static_cast<double>(XYZ[0]) * m_inputHeader.xScaleFactor) + m_inputHeader.xOffset;
+		const double y = (static_cast<double>(XYZ[1]) * m_inputHeader.yScaleFactor) + m_inputHeader.yOffset;
+		const double z = (static_cast<double>(XYZ[2]) * m_inputHeader.zScaleFactor) + m_inputHeader.zOffset;
+
+		if (x < m_options.boxMin[0] || x > m_options.boxMax[0] ||
+			y < m_options.boxMin[1] || y > m_options.boxMax[1] ||
+			z < m_options.boxMin[2] || z > m_options.boxMax[2]) {
+			return false;
+		}
+	}
+
+	// Reject on the raw coordinates first, only points in the box of the polygon are dequantized and tested
+	if (m_options.usePolygon)
+	{
+		int32_t XY[2];
+		std::memcpy(XY, pRecord, 8);
+
+		if (XY[0] < m_polygonMinXY[0] || XY[0] > m_polygonMaxXY[0] || XY[1] < m_polygonMinXY[1] || XY[1] > m_polygonMaxXY[1]) {
+			return false;
+		}
+
+		const double x = (static_cast<double>(XY[0]) * m_inputHeader.xScaleFactor) + m_inputHeader.xOffset;
+		const double y = (static_cast<double>(XY[1]) * m_inputHeader.yScaleFactor) + m_inputHeader.yOffset;
+
+		if (!isInPolygon(*m_options.polygon, WindingNumber, x, y)) {
+			return false;
+		}
+	}
+
+	// Legacy classification byte holds the class in bits 0-4 and flags in bits 5-7
+	if (!m_options.keepClass.empty())
+	{
+		const uint8_t classification = static_cast<uint8_t>(pRecord[m_in.classification_Byte]) & (m_in.isExtended ? 0xFF : 0x1F);
+		if (!m_options.keepClass[classification]) { return false; }
+	}
+
+	if (!m_options.keepReturn.empty())
+	{
+		const uint8_t returnNumber = static_cast<uint8_t>(pRecord[14]) & (m_in.isExtended ? 0x0F : 0x07);
+		if (!m_options.keepReturn[returnNumber]) { return false; }
+	}
+
+	if (m_options.useTimeWindow)
+	{
+		double time;
+		std::memcpy(&time, pRecord + m_in.time_Byte, sizeof(double));
+		if (!(time >= m_options.timeWindow[0] && time <= m_options.timeWindow[1])) { return false; }
+	}
+
+	return true;
+}
+
+inline void LASdataTranscoder::transcodeRecord(const char* pIn, char* pOut) const
+{
+	// Same format: Only the extra bytes can be dropped at the end of the record
+	if (m_header.PointDataRecordFormat == m_inputHeader.PointDataRecordFormat)
+	{
+		std::memcpy(pOut, pIn, m_out.recordLength);
+		return;
+	}
+
+	// Coordinates and intensity are at the same position for every format
+	std::memcpy(pOut, pIn, 14);
+
+	if (m_in.isExtended == m_out.isExtended)
+	{
+		pOut[14] = pIn[14];
+		pOut[m_out.classification_Byte] = pIn[m_in.classification_Byte];
+
+		if (m_out.isExtended)
+		{
+			pOut[m_out.bits2_Byte] = pIn[m_in.bits2_Byte];
+			std::memcpy(pOut + m_out.scanAngle_Byte, pIn + m_in.scanAngle_Byte, sizeof(int16_t));
+		}
+		else
+		{
+			pOut[m_out.scanAngle_Byte] = pIn[m_in.scanAngle_Byte];
+		}
+	}
+	else if (m_out.isExtended)
+	{
+		uint8_t bits, bits2, classification;
+		int16_t scanAngle;
+		legacyToExtendedFields(static_cast<uint8_t>(pIn[14]), static_cast<uint8_t>(pIn[m_in.classification_Byte]), static_cast<int8_t>(pIn[m_in.scanAngle_Byte]),
+			bits, bits2, classification, scanAngle);
+
+		pOut[14] = static_cast<char>(bits);
+		pOut[m_out.bits2_Byte] = static_cast<char>(bits2);
+		pOut[m_out.classification_Byte] = static_cast<char>(classification);
+		std::memcpy(pOut + m_out.scanAngle_Byte, &scanAngle, sizeof(int16_t));
+	}
+	else
+	{
+		uint8_t bits, classification;
+		int8_t scanAngle;
+		int16_t extScanAngle;
+		std::memcpy(&extScanAngle, pIn + m_in.scanAngle_Byte, sizeof(int16_t));
+		extendedToLegacyFields(static_cast<uint8_t>(pIn[14]), static_cast<uint8_t>(pIn[m_in.bits2_Byte]), static_cast<uint8_t>(pIn[m_in.classification_Byte]), extScanAngle,
+			bits, classification, scanAngle);
+
+		pOut[14] = static_cast<char>(bits);
+		pOut[m_out.classification_Byte] = static_cast<char>(classification);
+		pOut[m_out.scanAngle_Byte] = static_cast<char>(scanAngle);
+	}
+
+	pOut[m_out.userData_Byte] = pIn[m_in.userData_Byte];
+	std::memcpy(pOut + m_out.pointSourceID_Byte, pIn + m_in.pointSourceID_Byte, sizeof(uint16_t));
+
+	// Fields that the input format lacks stay zero
+	if (m_out.time_Byte != 0 && m_in.time_Byte != 0) {
+		std::memcpy(pOut + m_out.time_Byte, pIn + m_in.time_Byte, sizeof(double));
+	}
+	if (m_out.color_Byte != 0 && m_in.color_Byte != 0) {
+		std::memcpy(pOut + m_out.color_Byte, pIn + m_in.color_Byte, 3 * sizeof(uint16_t));
+	}
+	if (m_out.NIR_Byte != 0 && m_in.NIR_Byte != 0) {
+		std::memcpy(pOut + m_out.NIR_Byte, pIn + m_in.NIR_Byte, sizeof(uint16_t));
+	}
+	if (m_out.wavePackets_Byte != 0 && m_in.wavePackets_Byte != 0) {
+		std::memcpy(pOut + m_out.wavePackets_Byte, pIn + m_in.wavePackets_Byte, 29);
+	}
+	if (m_out.extraBytesCount > 0) {
+		std::memcpy(pOut + m_out.extradata_Byte, pIn + m_in.extradata_Byte, m_out.extraBytesCount);
+	}
+}
+
+size_t LASdataTranscoder::transcodeChunk(const char* pIn, char* pOut, size_t count)
+{
+	size_t keptCount = 0;
+	const bool doFloatRequantize = m_doRequantize && !m_isIntegerRequantize;
+
+	if (doFloatRequantize && m_coordinates.size() < 3 * count)
+	{
+		m_coordinates.resize(3 * count);
+		m_quantized.resize(3 * count);
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const char* pRecord = pIn + i * m_in.recordLength;
+
+		if (!isRecordKept(pRecord)) {
+			continue;
+		}
+
+		transcodeRecord(pRecord, pOut + keptCount * m_out.recordLength);
+
+		if (m_isIntegerRequantize)
+		{
+			int32_t XYZ[3];
+			std::memcpy(XYZ, pRecord, 12);
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const long long value = XYZ[axis] * m_requantizeFactor[axis] + m_requantizeShift[axis];
+
+				if (value < INT32_MIN || value > INT32_MAX)
+				{
+					const char axisName[3] = { 'X', 'Y', 'Z' };
+					throw std::range_error(std::string(1, axisName[axis]) + " coordinate of a point does not fit into int32 with the given scale factor and offset!");
+				}
+
+				XYZ[axis] = static_cast<int32_t>(value);
+			}
+
+			std::memcpy(pOut + keptCount * m_out.recordLength, XYZ, 12);
+		}
+		else if (doFloatRequantize)
+		{
+			int32_t XYZ[3];
+			std::memcpy(XYZ, pRecord, 12);
+			m_coordinates[keptCount]			 = (static_cast<double>(XYZ[0]) * m_inputHeader.xScaleFactor) + m_inputHeader.xOffset;
+			m_coordinates[count + keptCount]	 = (static_cast<double>(XYZ[1]) * m_inputHeader.yScaleFactor) + m_inputHeader.yOffset;
+			m_coordinates[2 * count + keptCount] = (static_cast<double>(XYZ[2]) * m_inputHeader.zScaleFactor) + m_inputHeader.zOffset;
+		}
+
+		++keptCount;
+	}
+
+	// Quantize the coordinates of the kept points with the output scale factors and offsets
+	if (doFloatRequantize)
+	{
+		const double offsets[3] = { m_header.xOffset, m_header.yOffset, m_header.zOffset };
+		const double scales[3]	= { m_header.xScaleFactor, m_header.yScaleFactor, m_header.zScaleFactor };
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const size_t firstInvalid = quantizeCoordinates(&m_coordinates[axis * count], &m_quantized[axis * count], keptCount, offsets[axis], scales[axis]);
+
+			if (firstInvalid != keptCount)
+			{
+				const char axisName[3] = { 'X', 'Y', 'Z' };
+				throw std::range_error(std::string(1, axisName[axis]) + " coordinate of a point does not fit into int32 with the given scale factor and offset!");
+			}
+		}
+
+		for (size_t k = 0; k < keptCount; ++k)
+		{
+			char* pRecord = pOut + k * m_out.recordLength;
+			std::memcpy(pRecord,	 &m_quantized[k], sizeof(int32_t));
+			std::memcpy(pRecord + 4, &m_quantized[count + k], sizeof(int32_t));
+			std::memcpy(pRecord + 8, &m_quantized[2 * count + k], sizeof(int32_t));
+		}
+	}
+
+	// Statistics of the output records
+	const uint8_t returnNumberMask = m_out.isExtended ? 0x0F : 0x07;
+
+	for (size_t k = 0; k < keptCount; ++k)
+	{
+		const char* pRecord = pOut + k * m_out.recordLength;
+		int32_t XYZ[3];
+		std::memcpy(XYZ, pRecord, 12);
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (XYZ[axis] < m_minXYZ[axis]) { m_minXYZ[axis] = XYZ[axis]; }
+			if (XYZ[axis] > m_maxXYZ[axis]) { m_maxXYZ[axis] = XYZ[axis]; }
+		}
+
+		// Return number 0 is invalid and not counted
+		const int returnNumber = static_cast<uint8_t>(pRecord[14]) & returnNumberMask;
+		if (returnNumber > 0) { ++m_pointsByReturn[returnNumber - 1]; }
+	}
+
+	m_pointCount += keptCount;
+	return keptCount;
+}
+
+void LASdataTranscoder::copyVLRs(std::ifstream& inBin, std::ostream& outBin)
+{
+	const bool dropExtraBytesVLR = m_in.extraBytesCount > 0 && m_out.extraBytesCount == 0;
+	const unsigned long long endOfVLRs = m_inputHeader.offsetToPointData;
+	unsigned long long position = m_inputHeader.headerSize;
+	std::vector<char> buffer;
+	char vlrHeader[54];
+
+	inBin.seekg(m_inputHeader.headerSize, std::ios::beg);
+	outBin.seekp(m_header.headerSize, std::ios::beg);
+	m_header.numberOfVariableLengthRecords = 0;
+
+	for (unsigned long i = 0; i < m_inputHeader.numberOfVariableLengthRecords; ++i)
+	{
+		if (position + 54 > endOfVLRs) {
+			mexErrMsgIdAndTxt("MEX:LASTranscoder:invalidFile", "Variable length records of the input file exceed the offset to point data!");
+		}
+
+		inBin.read(vlrHeader, 54);
+		const unsigned short recordID = *reinterpret_cast<const uint16_t*>(vlrHeader + 18);
+		const unsigned short recordLength = *reinterpret_cast<const uint16_t*>(vlrHeader + 20);
+		position += 54 + recordLength;
+
+		if (position > endOfVLRs) {
+			mexErrMsgIdAndTxt("MEX:LASTranscoder:invalidFile", "Variable length records of the input file exceed the offset to point data!");
+		}
+
+		// Extra bytes description has to be removed if the extra bytes are not written
+		if (dropExtraBytesVLR && recordID == 4 && std::strncmp(vlrHeader + 2, "LASF_Spec", 16) == 0)
+		{
+			inBin.seekg(recordLength, std::ios::cur);
+			continue;
+		}
+
+		buffer.resize(recordLength);
+		inBin.read(buffer.data(), recordLength);
+		outBin.write(vlrHeader, 54);
+		outBin.write(buffer.data(), recordLength);
+		++m_header.numberOfVariableLengthRecords;
+	}
+
+	// Bytes between the last VLR and the point data are kept as well
+	if (position < endOfVLRs)
+	{
+		buffer.resize(static_cast<size_t>(endOfVLRs - position));
+		inBin.read(buffer.data(), buffer.size());
+		outBin.write(buffer.data(), buffer.size());
+	}
+
+	if (inBin.fail()) { throw std::ios_base::failure("Error while reading the variable length records of the input file!"); }
+
+	m_header.offsetToPointData = static_cast<unsigned long>(outBin.tellp());
+}
+
+void LASdataTranscoder::copyTrailingData(std::ifstream& inBin, std::ofstream& outBin, unsigned long long fileSize)
+{
+	const unsigned long long endOfInputPoints = m_inputHeader.offsetToPointData + m_inputPointCount * m_inputHeader.PointDataRecordLength;
+	const unsigned long long endOfOutputPoints = static_cast<unsigned long long>(outBin.tellp());
+
+	// Waveform data and extended VLRs only exist from LAS 1.3 onwards
+	if (m_inputHeader.versionMinor < 3 || fileSize <= endOfInputPoints) {
+		return;
+	}
+
+	const size_t copyBufferSize = 1 << 20;
+	std::unique_ptr<char[]> copyBuffer(new char[copyBufferSize]);
+	inBin.seekg(endOfInputPoints, std::ios::beg);
+
+	for (unsigned long long position = endOfInputPoints; position < fileSize; position += copyBufferSize)
+	{
+		const size_t chunkSize = static_cast<size_t>(std::min(static_cast<unsigned long long>(copyBufferSize), fileSize - position));
+		inBin.read(copyBuffer.get(), chunkSize);
+		outBin.write(copyBuffer.get(), chunkSize);
+	}
+
+	if (inBin.fail()) { throw std::ios_base::failure("Error while reading the data after the point records of the input file!"); }
+
+	// Data after the point records moves by the size difference of the point data
+	if (m_headerExt3.startOfWaveFormData >= endOfInputPoints) {
+		m_headerExt3.startOfWaveFormData = m_headerExt3.startOfWaveFormData - endOfInputPoints + endOfOutputPoints;
+	}
+
+	if (m_headerExt4.numberOfExtendedVariableLengthRecords > 0 && m_headerExt4.startOfFirstExtendedVariableLengthRecord >= endOfInputPoints) {
+		m_headerExt4.startOfFirstExtendedVariableLengthRecord = m_headerExt4.startOfFirstExtendedVariableLengthRecord - endOfInputPoints + endOfOutputPoints;
+	}
+}
+
+void LASdataTranscoder::writeHeader(std::ostream& outBin)
+{
+	outBin.seekp(0, std::ios::beg);
+
+	// Write every single header entry, sizes are fixed and guaranteed during compilation
+	outBin.write("LASF", 4);
+	outBin.write(reinterpret_cast<char*>(&m_header.sourceID), 2);
+	outBin.write(reinterpret_cast<char*>(&m_header.globalEncoding), 2);
+	outBin.write(reinterpret_cast<char*>(&m_header.projectID_GUID_1), 4);
+	outBin.write(reinterpret_cast<char*>(&m_header.projectID_GUID_2), 2);
+	outBin.write(reinterpret_cast<char*>(&m_header.projectID_GUID_3), 2);
+	outBin.write(reinterpret_cast<char*>(&m_header.projectID_GUID_4), 8);
+	outBin.write(reinterpret_cast<char*>(&m_header.versionMajor), 1);
+	outBin.write(reinterpret_cast<char*>(&m_header.versionMinor), 1);
+	outBin.write(reinterpret_cast<char*>(&m_header.systemIdentifier), 32);
+	outBin.write(reinterpret_cast<char*>(&m_header.generatingSoftware), 32);
+	outBin.write(reinterpret_cast<char*>(&m_header.fileCreationDayOfYear), 2);
+	outBin.write(reinterpret_cast<char*>(&m_header.fileCreationYear), 2);
+	outBin.write(reinterpret_cast<char*>(&m_header.headerSize), 2);
+	outBin.write(reinterpret_cast<char*>(&m_header.offsetToPointData), 4);
+	outBin.write(reinterpret_cast<char*>(&m_header.numberOfVariableLengthRecords), 4);
+	outBin.write(reinterpret_cast<char*>(&m_header.PointDataRecordFormat), 1);
+	outBin.write(reinterpret_cast<char*>(&m_header.PointDataRecordLength), 2);
+	outBin.write(reinterpret_cast<char*>(&m_header.LegacyNumberOfPointRecords), 4);
+	outBin.write(reinterpret_cast<char*>(&m_header.LegacyNumberOfPointByReturn), 20);
+	outBin.write(reinterpret_cast<char*>(&m_header.xScaleFactor), 8);
+	outBin.write(reinterpret_cast<char*>(&m_header.yScaleFactor), 8);
+	outBin.write(reinterpret_cast<char*>(&m_header.zScaleFactor), 8);
+	outBin.write(reinterpret_cast<char*>(&m_header.xOffset), 8);
+	outBin.write(reinterpret_cast<char*>(&m_header.yOffset), 8);
+	outBin.write(reinterpret_cast<char*>(&m_header.zOffset), 8);
+	outBin.write(reinterpret_cast<char*>(&m_header.maxX), 8);
+	outBin.write(reinterpret_cast<char*>(&m_header.minX), 8);
+	outBin.write(reinterpret_cast<char*>(&m_header.maxY), 8);
+	outBin.write(reinterpret_cast<char*>(&m_header.minY), 8);
+	outBin.write(reinterpret_cast<char*>(&m_header.maxZ), 8);
+	outBin.write(reinterpret_cast<char*>(&m_header.minZ), 8);
+
+	if (m_header.versionMinor > 2)
+	{
+		outBin.write(reinterpret_cast<char*>(&m_headerExt3.startOfWaveFormData), 8);
+	}
+
+	if (m_header.versionMinor > 3)
+	{
+		outBin.write(reinterpret_cast<char*>(&m_headerExt4.startOfFirstExtendedVariableLengthRecord), 8);
+		outBin.write(reinterpret_cast<char*>(&m_headerExt4.numberOfExtendedVariableLengthRecords), 4);
+		outBin.write(reinterpret_cast<char*>(&m_headerExt4.numberOfPointRecords), 8);
+		outBin.write(reinterpret_cast<char*>(&m_headerExt4.numberOfPointsByReturn), 120);
+	}
+}
+
+void LASdataTranscoder::GetTiles(std::vector<std::string>& paths, std::vector<unsigned long long>& pointCounts) const
+{
+	paths.clear();
+	pointCounts.clear();
+
+	for (const TileFile& tile : m_tiles)
+	{
+		paths.push_back(tile.path);
+		pointCounts.push_back(tile.pointCount);
+	}
+}
+
+void LASdataTranscoder::Tile(std::ifstream& inBin, const std::string& outputPrefix)
+{
+	if (!inBin.is_open()) { throw std::ios_base::failure("Input file is not open!"); }
+
+	if (!(m_options.tileSize > 0)) {
+		mexErrMsgIdAndTxt("MEX:LASTranscoder:GetOptions", "Tile size has to be greater than zero!");
+	}
+
+	const unsigned long long fileSize = readInputHeader(inBin);
+
+	// Every tile starts with the same header and VLRs, the header is corrected when the tile is closed
+	std::ostringstream prefix(std::ios::out | std::ios::binary);
+	writeHeader(prefix);
+	copyVLRs(inBin, prefix);
+	m_tilePrefix = prefix.str();
+
+	unsigned long extendedVLRCount = 0;
+	const std::vector<char> extendedVLRs = readExtendedVLRs(inBin, fileSize, extendedVLRCount);
+
+	// Waveform data inside of the file can not be split into the tiles
+	if (m_header.versionMinor > 2 && (m_header.globalEncoding & 2) != 0)
+	{
+		mexWarnMsgIdAndTxt("MEX:LASTranscoder:waveformData", "Waveform data stored in the input file is not copied into the tiles!");
+		m_header.globalEncoding &= ~2;
+	}
+	m_headerExt3.startOfWaveFormData = 0;
+
+	const size_t chunkPointCount = 65536;
+	const size_t recordLength = m_out.recordLength;
+	std::unique_ptr<char[]> inBuffer(new char[chunkPointCount * m_in.recordLength]);
+	std::vector<char> outBuffer(chunkPointCount * recordLength, 0);
+
+	const double tileSize = m_options.tileSize;
+	const double overlap = m_options.tileOverlap;
+	const uint8_t returnNumberMask = m_out.isExtended ? 0x0F : 0x07;
+	size_t bufferedBytes = 0;
+
+	m_tiles.clear();
+	m_tileIndices.clear();
+	m_openTileCount = 0;
+	inBin.seekg(m_inputHeader.offsetToPointData, std::ios::beg);
+
+	for (unsigned long long pointOffset = 0; pointOffset < m_inputPointCount; pointOffset += chunkPointCount)
+	{
+		const size_t pointsInChunk = static_cast<size_t>(std::min(static_cast<unsigned long long>(chunkPointCount), m_inputPointCount - pointOffset));
+
+		inBin.read(inBuffer.get(), static_cast<std::streamsize>(pointsInChunk) * m_in.recordLength);
+		const size_t keptPoints = transcodeChunk(inBuffer.get(), outBuffer.data(), pointsInChunk);
+
+		// Points within the overlap of a tile border are routed into the neighbouring tiles as well
+		for (size_t k = 0; k < keptPoints; ++k)
+		{
+			const char* pRecord = &outBuffer[k * recordLength];
+			int32_t XYZ[3];
+			std::memcpy(XYZ, pRecord, 12);
+
+			const double x = (static_cast<double>(XYZ[0]) * m_header.xScaleFactor) + m_header.xOffset - m_options.tileOrigin[0];
+			const double y = (static_cast<double>(XYZ[1]) * m_header.yScaleFactor) + m_header.yOffset - m_options.tileOrigin[1];
+			const long long firstColumn = static_cast<long long>(std::floor((x - overlap) / tileSize));
+			const long long lastColumn	= static_cast<long long>(std::floor((x + overlap) / tileSize));
+			const long long firstRow	= static_cast<long long>(std::floor((y - overlap) / tileSize));
+			const long long lastRow		= static_cast<long long>(std::floor((y + overlap) / tileSize));
+			const int returnNumber = static_cast<uint8_t>(pRecord[14]) & returnNumberMask;
+
+			for (long long column = firstColumn; column <= lastColumn; ++column)
+			{
+				for (long long row = firstRow; row <= lastRow; ++row)
+				{
+					TileFile& tile = m_tiles[getTileIndex(column, row, outputPrefix)];
+					tile.buffer.insert(tile.buffer.end(), pRecord, pRecord + recordLength);
+
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						if (XYZ[axis] < tile.minXYZ[axis]) { tile.minXYZ[axis] = XYZ[axis]; }
+						if (XYZ[axis] > tile.maxXYZ[axis]) { tile.maxXYZ[axis] = XYZ[axis]; }
+					}
+
+					// Return number 0 is invalid and not counted
+					if (returnNumber > 0) { ++tile.pointsByReturn[returnNumber - 1]; }
+					++tile.pointCount;
+					bufferedBytes += recordLength;
+				}
+			}
+		}
+
+		// Write the largest buffers until all buffers together fit into the budget again
+		while (bufferedBytes > m_options.tileBufferBytes)
+		{
+			auto largest = std::max_element(m_tiles.begin(), m_tiles.end(),
+				[](const TileFile& a, const TileFile& b) { return a.buffer.size() < b.buffer.size(); });
+
+			bufferedBytes -= largest->buffer.size();
+			flushTile(*largest);
+		}
+	}
+
+	if (inBin.fail()) { throw std::ios_base::failure("Error while reading the point data of the input file!"); }
+
+	for (TileFile& tile : m_tiles)
+	{
+		flushTile(tile);
+
+		if (tile.stream)
+		{
+			tile.stream.reset();
+			--m_openTileCount;
+		}
+
+		closeTile(tile, extendedVLRs, extendedVLRCount);
+	}
+}
+
+size_t LASdataTranscoder::getTileIndex(long long column, long long row, const std::string& outputPrefix)
+{
+	const std::pair<long long, long long> key(column, row);
+
+	// Consecutive points usually fall into the same tile
+	if (m_lastTileIndex < m_tiles.size() && m_tiles[m_lastTileIndex].column == column && m_tiles[m_lastTileIndex].row == row) {
+		return m_lastTileIndex;
+	}
+
+	auto it = m_tileIndices.find(key);
+	if (it != m_tileIndices.end())
+	{
+		m_lastTileIndex = it->second;
+		return m_lastTileIndex;
+	}
+
+	// File name holds the lower left corner of the tile
+	std::ostringstream path;
+	path.precision(15);
+	path << outputPrefix << '_' << m_options.tileOrigin[0] + column * m_options.tileSize << '_' << m_options.tileOrigin[1] + row * m_options.tileSize << ".las";
+
+	TileFile tile;
+	tile.column = column;
+	tile.row = row;
+	tile.path = path.str();
+
+	m_tiles.push_back(std::move(tile));
+	m_lastTileIndex = m_tiles.size() - 1;
+	m_tileIndices[key] = m_lastTileIndex;
+	return m_lastTileIndex;
+}
+
+void LASdataTranscoder::flushTile(TileFile& tile)
+{
+	tile.lastFlush = ++m_tileFlushCount;
+
+	if (tile.isCreated && tile.buffer.empty()) {
+		return;
+	}
+
+	if (!tile.stream)
+	{
+		// Make room for the file of this tile by closing the least recently flushed one
+		if (m_openTileCount >= maxOpenTiles)
+		{
+			TileFile* oldest = nullptr;
+
+			for (TileFile& other : m_tiles) {
+				if (other.stream && (nullptr == oldest || other.lastFlush < oldest->lastFlush)) { oldest = &other; }
+			}
+
+			oldest->stream.reset();
+			--m_openTileCount;
+		}
+
+		tile.stream.reset(new std::ofstream(tile.path, std::ios::out | std::ios::binary | (tile.isCreated ? std::ios::app : std::ios::trunc)));
+
+		if (!tile.stream->is_open()) {
+			tile.stream.reset();
+			throw std::ios_base::failure("Tile file " + tile.path + " could not be opened for writing!");
+		}
+
+		++m_openTileCount;
+	}
+
+	std::ofstream& tileBin = *tile.stream;
+
+	if (!tile.isCreated)
+	{
+		tileBin.write(m_tilePrefix.data(), static_cast<std::streamsize>(m_tilePrefix.size()));
+		tile.isCreated = true;
+	}
+
+	tileBin.write(tile.buffer.data(), static_cast<std::streamsize>(tile.buffer.size()));
+
+	if (tileBin.fail()) {
+		throw std::ios_base::failure("Error while writing tile file " + tile.path + "!");
+	}
+
+	// Release the memory instead of keeping the capacity, so the budget of all buffers holds
+	tile.buffer = std::vector<char>();
+}
+
+void LASdataTranscoder::closeTile(const TileFile& tile, const std::vector<char>& extendedVLRs, unsigned long extendedVLRCount)
+{
+	std::fstream tileBin(tile.path, std::ios::in | std::ios::out | std::ios::binary);
+
+	if (!tileBin.is_open()) {
+		throw std::ios_base::failure("Tile file " + tile.path + " could not be opened for writing!");
+	}
+
+	tileBin.seekp(0, std::ios::end);
+	const unsigned long long endOfPoints = static_cast<unsigned long long>(tileBin.tellp());
+
+	if (extendedVLRCount > 0) {
+		tileBin.write(extendedVLRs.data(), static_cast<std::streamsize>(extendedVLRs.size()));
+	}
+
+	m_headerExt4.startOfFirstExtendedVariableLengthRecord = extendedVLRCount > 0 ? endOfPoints : 0;
+	m_headerExt4.numberOfExtendedVariableLengthRecords = extendedVLRCount;
+
+	applyHeaderStatistics(tile.minXYZ, tile.maxXYZ, tile.pointCount, tile.pointsByReturn);
+	writeHeader(tileBin);
+
+	if (tileBin.fail()) {
+		throw std::ios_base::failure("Error while writing tile file " + tile.path + "!");
+	}
+}
+
+std::vector<char> LASdataTranscoder::readExtendedVLRs(std::ifstream& inBin, unsigned long long fileSize, unsigned long& count) const
+{
+	std::vector<char> records;
+	count = 0;
+
+	if (m_inputHeader.versionMinor < 4 || m_header.versionMinor < 4) {
+		return records;
+	}
+
+	const bool dropExtraBytesVLR = m_in.extraBytesCount > 0 && m_out.extraBytesCount == 0;
+	unsigned long long position = m_inputHeaderExt4.startOfFirstExtendedVariableLengthRecord;
+	char evlrHeader[60];
+
+	for (unsigned long i = 0; i < m_inputHeaderExt4.numberOfExtendedVariableLengthRecords; ++i)
+	{
+		if (position + 60 > fileSize) {
+			mexErrMsgIdAndTxt("MEX:LASTranscoder:invalidFile", "Extended variable length records of the input file exceed the file size!");
+		}
+
+		inBin.seekg(position, std::ios::beg);
+		inBin.read(evlrHeader, 60);
+
+		const unsigned short recordID = *reinterpret_cast<const uint16_t*>(evlrHeader + 18);
+		const unsigned long long recordLength = *reinterpret_cast<const uint64_t*>(evlrHeader + 20);
+
+		if (recordLength > fileSize - position - 60) {
+			mexErrMsgIdAndTxt("MEX:LASTranscoder:invalidFile", "Extended variable length records of the input file exceed the file size!");
+		}
+
+		position += 60 + recordLength;
+
+		// Waveform data packets and the extra bytes description of dropped extra bytes are not taken over
+		const bool isSpec = std::strncmp(evlrHeader + 2, "LASF_Spec", 16) == 0;
+		if (isSpec && (recordID == 65535 || (dropExtraBytesVLR && recordID == 4))) {
+			continue;
+		}
+
+		const size_t start = records.size();
+		records.resize(start + 60 + static_cast<size_t>(recordLength));
+		std::memcpy(&records[start], evlrHeader, 60);
+		inBin.read(&records[start + 60], static_cast<std::streamsize>(recordLength));
+		++count;
+	}
+
+	if (inBin.fail()) { throw std::ios_base::failure("Error while reading the extended variable length records of the input file!"); }
+
+	return records;
+}
+
+void LASdataTranscoder::Merge(const std::vector<std::string>& inputPaths, std::ofstream& outBin)
+{
+	if (!outBin.is_open()) { throw std::ios_base::failure("Output file is not open!"); }
+
+	if (inputPaths.empty()) {
+		mexErrMsgIdAndTxt("MEX:LASTranscoder:noInput", "At least one input file is required!");
+	}
+
+	std::vector<std::unique_ptr<LASdataTranscoder>> inputs;
+	std::vector<std::vector<VariableRecord>> inputVLRs;
+	std::vector<std::vector<VariableRecord>> inputExtendedVLRs;
+	bool hasWaveformData = false;
+
+	// Every input checks its header with the filters of the merge and keeps its own format for now.
+	// Files are only open while their header and VLRs are read, so the number of inputs is not limited by file handles
+	for (const std::string& path : inputPaths)
+	{
+		std::ifstream inBin(path, std::ios::in | std::ios::binary);
+
+		if (!inBin.is_open()) {
+			mexErrMsgIdAndTxt("MEX:LASTranscoder:invalidFile", "Input file %s could not be opened!", path.c_str());
+		}
+
+		std::unique_ptr<LASdataTranscoder> input(new LASdataTranscoder());
+		input->m_options = m_options;
+		input->m_options.targetPointFormat = -1;
+		input->m_options.useScale = false;
+		input->m_options.useOffset = false;
+		input->m_options.dropExtraBytes = false;
+
+		const unsigned long long fileSize = input->readInputHeader(inBin);
+		unsigned long extendedVLRCount = 0;
+
+		inputVLRs.push_back(input->readVLRs(inBin));
+		inputExtendedVLRs.push_back(splitExtendedVLRs(input->readExtendedVLRs(inBin, fileSize, extendedVLRCount)));
+		hasWaveformData = hasWaveformData || (input->m_inputHeader.versionMinor > 2 && (input->m_inputHeader.globalEncoding & 2) != 0);
+
+		inputs.push_back(std::move(input));
+	}
+
+	if (hasWaveformData) {
+		mexWarnMsgIdAndTxt("MEX:LASTranscoder:waveformData", "Waveform data stored in the input files is not merged!");
+	}
+
+	// Extra bytes are only merged if all inputs have the same number and the same description of them
+	int extraBytesCount = m_options.dropExtraBytes ? 0 : inputs[0]->m_in.extraBytesCount;
+
+	for (size_t i = 1; i < inputs.size() && !m_options.dropExtraBytes; ++i)
+	{
+		auto findDescription = [](const std::vector<VariableRecord>& records) -> const VariableRecord*
+		{
+			for (const VariableRecord& record : records)
+			{
+				if (*reinterpret_cast<const uint16_t*>(&record.header[18]) == 4 && std::strncmp(&record.header[2], "LASF_Spec", 16) == 0) {
+					return &record;
+				}
+			}
+			return nullptr;
+		};
+
+		const VariableRecord* pFirst = findDescription(inputVLRs[0]);
+		const VariableRecord* pOther = findDescription(inputVLRs[i]);
+		const bool isSameDescription = (nullptr == pFirst && nullptr == pOther) || (nullptr != pFirst && nullptr != pOther && pFirst->data == pOther->data);
+
+		if (inputs[i]->m_in.extraBytesCount != extraBytesCount || !isSameDescription)
+		{
+			mexWarnMsgIdAndTxt("MEX:LASTranscoder:differentExtraBytes", "Input files have different extra bytes, they are not merged!");
+			extraBytesCount = 0;
+			break;
+		}
+	}
+
+	setMergeHeader(inputs, extraBytesCount);
+
+	for (auto& input : inputs) {
+		input->prepareMergeInput(*this);
+	}
+
+	// First occurrence of every VLR is kept, the extra bytes description only if the extra bytes are merged
+	std::vector<VariableRecord> mergedVLRs;
+	std::vector<VariableRecord> mergedExtendedVLRs;
+
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		mergeVariableRecords(mergedVLRs, inputVLRs[i], extraBytesCount == 0);
+		mergeVariableRecords(mergedExtendedVLRs, inputExtendedVLRs[i], extraBytesCount == 0);
+	}
+
+	if (m_header.versionMinor < 4) {
+		mergedExtendedVLRs.clear();
+	}
+
+	unsigned long long offsetToPointData = m_header.headerSize;
+	for (const VariableRecord& record : mergedVLRs) {
+		offsetToPointData += record.header.size() + record.data.size();
+	}
+
+	if (offsetToPointData > ULONG_MAX) {
+		mexErrMsgIdAndTxt("MEX:LASTranscoder:invalidFile", "Merged variable length records are too large for the offset to point data!");
+	}
+
+	m_header.numberOfVariableLengthRecords = static_cast<unsigned long>(mergedVLRs.size());
+	m_header.offsetToPointData = static_cast<unsigned long>(offsetToPointData);
+
+	// Header is written with the statistics of the first input and corrected after the points are written
+	writeHeader(outBin);
+
+	for (const VariableRecord& record : mergedVLRs)
+	{
+		outBin.write(record.header.data(), static_cast<std::streamsize>(record.header.size()));
+		outBin.write(record.data.data(), static_cast<std::streamsize>(record.data.size()));
+	}
+
+	mergePoints(inputs, inputPaths, outBin);
+
+	const unsigned long long endOfPoints = static_cast<unsigned long long>(outBin.tellp());
+
+	for (const VariableRecord& record : mergedExtendedVLRs)
+	{
+		outBin.write(record.header.data(), static_cast<std::streamsize>(record.header.size()));
+		outBin.write(record.data.data(), static_cast<std::streamsize>(record.data.size()));
+	}
+
+	m_headerExt4.startOfFirstExtendedVariableLengthRecord = mergedExtendedVLRs.empty() ? 0 : endOfPoints;
+	m_headerExt4.numberOfExtendedVariableLengthRecords = static_cast<unsigned long>(mergedExtendedVLRs.size());
+
+	// Statistics of all inputs
+	for (const auto& input : inputs)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			m_minXYZ[axis] = std::min(m_minXYZ[axis], input->m_minXYZ[axis]);
+			m_maxXYZ[axis] = std::max(m_maxXYZ[axis], input->m_maxXYZ[axis]);
+		}
+
+		m_pointCount += input->m_pointCount;
+		for (int i = 0; i < 15; ++i) { m_pointsByReturn[i] += input->m_pointsByReturn[i]; }
+	}
+
+	applyHeaderStatistics(m_minXYZ, m_maxXYZ, m_pointCount, m_pointsByReturn);
+
+	const auto endOfFile = outBin.tellp();
+	writeHeader(outBin);
+	outBin.seekp(endOfFile, std::ios::beg);
+
+	if (outBin.fail()) { throw std::ios_base::failure("Error during file write! Stream went bad!"); }
+}
+
+void LASdataTranscoder::Rasterize(const std::vector<std::string>& inputPaths, PointRaster& raster, bool useHeaderExtent)
+{
+	if (inputPaths.empty()) {
+		mexErrMsgIdAndTxt("MEX:LASTranscoder:noInput", "At least one input file is required!");
+	}
+
+	std::vector<std::unique_ptr<LASdataTranscoder>> inputs;
+	double minXY[2] = { HUGE_VAL, HUGE_VAL };
+	double maxXY[2] = { -HUGE_VAL, -HUGE_VAL };
+
+	// Every input checks its header with the filters of the raster and keeps its own format, the records are only read
+	for (const std::string& path : inputPaths)
+	{
+		std::ifstream inBin(path, std::ios::in | std::ios::binary);
+
+		if (!inBin.is_open()) {
+			mexErrMsgIdAndTxt("MEX:LASTranscoder:invalidFile", "Input file %s could not be opened!", path.c_str());
+		}
+
+		std::unique_ptr<LASdataTranscoder> input(new LASdataTranscoder());
+		input->m_options = m_options;
+		input->m_options.targetPointFormat = -1;
+		input->m_options.useScale = false;
+		input->m_options.useOffset = false;
+		input->readInputHeader(inBin);
+
+		if (input->m_inputPointCount > 0)
+		{
+			minXY[0] = std::min(minXY[0], input->m_inputHeader.minX);
+			minXY[1] = std::min(minXY[1], input->m_inputHeader.minY);
+			maxXY[0] = std::max(maxXY[0], input->m_inputHeader.maxX);
+			maxXY[1] = std::max(maxXY[1], input->m_inputHeader.maxY);
+		}
+
+		inputs.push_back(std::move(input));
+	}
+
+	if (useHeaderExtent)
+	{
+		// Only the part of the inputs inside of the bounding box option can have points
+		if (m_options.useBoundingBox)
+		{
+			for (int axis = 0; axis < 2; ++axis)
+			{
+				minXY[axis] = std::max(minXY[axis], m_options.boxMin[axis]);
+				maxXY[axis] = std::min(maxXY[axis], m_options.boxMax[axis]);
+			}
+		}
+
+		if (!(minXY[0] <= maxXY[0] && minXY[1] <= maxXY[1])) {
+			mexErrMsgIdAndTxt("MEX:LASTranscoder:emptyExtent", "Input files have no points inside of the filters, an extent of the raster is required!");
+		}
+
+		raster.SnapExtent(minXY[0], minXY[1], maxXY[0], maxXY[1]);
+	}
+
+	raster.BeginAccumulation();
+
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		inputs[i]->rasterizePoints(inputPaths[i], raster);
+	}
+
+	raster.EndAccumulation();
+
+	// Percentiles collect the values of a band of rows at a time
+	while (raster.NextBand())
+	{
+		for (size_t i = 0; i < inputs.size(); ++i) {
+			inputs[i]->rasterizePoints(inputPaths[i], raster);
+		}
+
+		raster.ReduceBand();
+	}
+}
+
+void LASdataTranscoder::rasterizePoints(const std::string& inputPath, PointRaster& raster) const
+{
+	std::ifstream inBin(inputPath, std::ios::in | std::ios::binary);
+
+	if (!inBin.is_open()) {
+		mexErrMsgIdAndTxt("MEX:LASTranscoder:invalidFile", "Input file %s could not be opened!", inputPath.c_str());
+	}
+
+	const size_t chunkPointCount = 65536;
+	std::unique_ptr<char[]> inBuffer(new char[chunkPointCount * m_in.recordLength]);
+
+	inBin.seekg(m_inputHeader.offsetToPointData, std::ios::beg);
+
+	for (unsigned long long pointOffset = 0; pointOffset < m_inputPointCount; pointOffset += chunkPointCount)
+	{
+		const size_t pointsInChunk = static_cast<size_t>(std::min(static_cast<unsigned long long>(chunkPointCount), m_inputPointCount - pointOffset));
+
+		inBin.read(inBuffer.get(), static_cast<std::streamsize>(pointsInChunk) * m_in.recordLength);
+
+		for (size_t i = 0; i < pointsInChunk; ++i)
+		{
+			const char* pRecord = inBuffer.get() + i * m_in.recordLength;
+
+			if (!isRecordKept(pRecord)) {
+				continue;
+			}
+
+			int32_t XYZ[3];
+			uint16_t intensity;
+			std::memcpy(XYZ, pRecord, 12);
+			std::memcpy(&intensity, pRecord + 12, sizeof(uint16_t));
+
+			raster.Add((static_cast<double>(XYZ[0]) * m_inputHeader.xScaleFactor) + m_inputHeader.xOffset,
+				(static_cast<double>(XYZ[1]) * m_inputHeader.yScaleFactor) + m_inputHeader.yOffset,
+				(static_cast<double>(XYZ[2]) * m_inputHeader.zScaleFactor) + m_inputHeader.zOffset,
+				static_cast<double>(intensity));
+		}
+	}
+
+	if (inBin.fail()) { throw std::ios_base::failure("Error while reading the point data of the input file!"); }
+}
+
+void LASdataTranscoder::setMergeHeader(const std::vector<std::unique_ptr<LASdataTranscoder>>& inputs, int extraBytesCount)
+{
+	const LASdataTranscoder& first = *inputs[0];
+
+	bool isExtended = false, hasTime = false, hasColor = false, hasNIR = false, hasWavePackets = false;
+	bool isSameOffset = true;
+	unsigned char versionMinor = 0;
+	double minScale[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL };
+	double minimum[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL };
+	double maximum[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+
+	for (const auto& input : inputs)
+	{
+		const LASheader& header = input->m_inputHeader;
+		const double scales[3]	= { header.xScaleFactor, header.yScaleFactor, header.zScaleFactor };
+		const double mins[3]	= { header.minX, header.minY, header.minZ };
+		const double maxs[3]	= { header.maxX, header.maxY, header.maxZ };
+
+		isExtended		= isExtended || input->m_in.isExtended;
+		hasTime			= hasTime || input->m_in.time_Byte != 0;
+		hasColor		= hasColor || input->m_in.color_Byte != 0;
+		hasNIR			= hasNIR || input->m_in.NIR_Byte != 0;
+		hasWavePackets	= hasWavePackets || input->m_in.wavePackets_Byte != 0;
+		versionMinor	= std::max(versionMinor, header.versionMinor);
+		isSameOffset	= isSameOffset && header.xOffset == first.m_inputHeader.xOffset && header.yOffset == first.m_inputHeader.yOffset &&
+						  header.zOffset == first.m_inputHeader.zOffset;
+
+		// Header boxes of inputs without points are not taken into account
+		const unsigned long long pointCount = input->m_inputPointCount;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			minScale[axis] = std::min(minScale[axis], scales[axis]);
+
+			if (pointCount > 0)
+			{
+				minimum[axis] = std::min(minimum[axis], mins[axis]);
+				maximum[axis] = std::max(maximum[axis], maxs[axis]);
+			}
+		}
+	}
+
+	// Smallest point data record format that holds the fields of all inputs. Near infrared requires format 8 or 10
+	int pointFormat = m_options.targetPointFormat;
+
+	if (pointFormat < 0)
+	{
+		if (isExtended || hasNIR) {
+			pointFormat = hasWavePackets ? (hasColor || hasNIR ? 10 : 9) : (hasNIR ? 8 : (hasColor ? 7 : 6));
+		}
+		else {
+			pointFormat = hasWavePackets ? (hasColor ? 5 : 4) : (hasColor ? (hasTime ? 3 : 2) : (hasTime ? 1 : 0));
+		}
+	}
+
+	// Finest scale factors of the inputs keep the precision of all points. Offsets are kept if they are the same
+	// and the merged extent fits into int32, otherwise they are moved to the center of the merged extent
+	if (!m_options.useScale)
+	{
+		for (int axis = 0; axis < 3; ++axis) { m_options.scale[axis] = minScale[axis]; }
+		m_options.useScale = true;
+	}
+
+	if (!m_options.useOffset)
+	{
+		const double firstOffsets[3] = { first.m_inputHeader.xOffset, first.m_inputHeader.yOffset, first.m_inputHeader.zOffset };
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const double scale = m_options.scale[axis];
+			const bool isInRange = minimum[axis] > maximum[axis] ||
+				((minimum[axis] - firstOffsets[axis]) / scale > -2147483648.0 && (maximum[axis] - firstOffsets[axis]) / scale < 2147483647.0);
+
+			if (isSameOffset && isInRange) {
+				m_options.offset[axis] = firstOffsets[axis];
+			}
+			else {
+				m_options.offset[axis] = std::round((minimum[axis] + maximum[axis]) / 2.0 / scale) * scale;
+			}
+		}
+
+		m_options.useOffset = true;
+	}
+
+	m_options.targetPointFormat = pointFormat;
+	m_options.dropExtraBytes = extraBytesCount == 0;
+
+	// Output header is derived from the first input
+	m_inputHeader		= first.m_inputHeader;
+	m_inputHeaderExt3	= first.m_inputHeaderExt3;
+	m_inputHeaderExt4	= first.m_inputHeaderExt4;
+	m_inputPointCount	= first.m_inputPointCount;
+	setOutputHeader();
+
+	// Highest version of the inputs, waveform data is not merged
+	m_header.versionMinor	= std::max(m_header.versionMinor, versionMinor);
+	m_header.headerSize		= m_header.versionMinor < 3 ? 227 : (m_header.versionMinor < 4 ? 235 : 375);
+	m_header.globalEncoding	&= ~2;
+	m_headerExt3 = LASheaderExt3();
+	m_headerExt4 = LASheaderExt4();
+}
+
+void LASdataTranscoder::prepareMergeInput(const LASdataTranscoder& merger)
+{
+	const int inputExtraBytes = m_inputHeader.PointDataRecordLength - m_record_lengths[m_inputHeader.PointDataRecordFormat];
+
+	m_header	 = merger.m_header;
+	m_headerExt3 = merger.m_headerExt3;
+	m_headerExt4 = merger.m_headerExt4;
+
+	setRecordOffsets(m_in, m_inputHeader.PointDataRecordFormat, inputExtraBytes);
+	m_out = merger.m_out;
+
+	setRequantization();
+}
+
+void LASdataTranscoder::mergePoints(const std::vector<std::unique_ptr<LASdataTranscoder>>& inputs, const std::vector<std::string>& inputPaths, std::ofstream& outBin)
+{
+	// Chunks of converted records of one input, filled by a reader thread and emptied by the writing main thread
+	struct ChunkQueue
+	{
+		std::mutex				mutex;
+		std::condition_variable	condition;
+		std::deque<std::vector<char>> chunks;
+		bool					isDone = false;
+		std::exception_ptr		error;
+	};
+
+	const size_t inputCount = inputs.size();
+	const size_t chunkPointCount = 65536;
+	const size_t queueDepth = 2;
+	const size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	const size_t threadCount = std::min(inputCount, std::min(hardwareThreads, static_cast<size_t>(4)));
+
+	std::vector<ChunkQueue> queues(inputCount);
+	std::atomic<bool> isStopped(false);
+
+	// Reader thread t converts the inputs t, t + threadCount, ... one after the other. No Matlab API is used here,
+	// errors are passed to the main thread
+	auto readInputs = [&](size_t firstInput)
+	{
+		for (size_t i = firstInput; i < inputCount && !isStopped; i += threadCount)
+		{
+			ChunkQueue& queue = queues[i];
+
+			try
+			{
+				LASdataTranscoder& input = *inputs[i];
+				std::ifstream inBin(inputPaths[i], std::ios::in | std::ios::binary);
+
+				if (!inBin.is_open()) {
+					throw std::ios_base::failure("Input file " + inputPaths[i] + " could not be opened!");
+				}
+
+				std::vector<char> inBuffer(chunkPointCount * input.m_in.recordLength);
+				inBin.seekg(input.m_inputHeader.offsetToPointData, std::ios::beg);
+
+				for (unsigned long long pointOffset = 0; pointOffset < input.m_inputPointCount && !isStopped; pointOffset += chunkPointCount)
+				{
+					const size_t pointsInChunk = static_cast<size_t>(std::min(static_cast<unsigned long long>(chunkPointCount), input.m_inputPointCount - pointOffset));
+
+					inBin.read(inBuffer.data(), static_cast<std::streamsize>(pointsInChunk) * input.m_in.recordLength);
+
+					if (inBin.fail()) {
+						throw std::ios_base::failure("Error while reading the point data of input file " + inputPaths[i] + "!");
+					}
+
+					std::vector<char> records(pointsInChunk * input.m_out.recordLength, 0);
+					records.resize(input.transcodeChunk(inBuffer.data(), records.data(), pointsInChunk) * input.m_out.recordLength);
+
+					std::unique_lock<std::mutex> lock(queue.mutex);
+					queue.condition.wait(lock, [&] { return queue.chunks.size() < queueDepth || isStopped; });
+					queue.chunks.push_back(std::move(records));
+					queue.condition.notify_all();
+				}
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				queue.error = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.isDone = true;
+			queue.condition.notify_all();
+		}
+	};
+
+	std::vector<std::thread> readers;
+	for (size_t t = 0; t < threadCount; ++t) {
+		readers.push_back(std::thread(readInputs, t));
+	}
+
+	auto stopReaders = [&]()
+	{
+		isStopped = true;
+
+		for (ChunkQueue& queue : queues)
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.condition.notify_all();
+		}
+
+		for (std::thread& reader : readers) {
+			reader.join();
+		}
+	};
+
+	try
+	{
+		for (size_t i = 0; i < inputCount; ++i)
+		{
+			ChunkQueue& queue = queues[i];
+
+			while (true)
+			{
+				std::vector<char> records;
+				{
+					std::unique_lock<std::mutex> lock(queue.mutex);
+					queue.condition.wait(lock, [&] { return !queue.chunks.empty() || queue.isDone; });
+
+					if (queue.chunks.empty())
+					{
+						if (queue.error) { std::rethrow_exception(queue.error); }
+						break;
+					}
+
+					records = std::move(queue.chunks.front());
+					queue.chunks.pop_front();
+					queue.condition.notify_all();
+				}
+
+				outBin.write(records.data(), static_cast<std::streamsize>(records.size()));
+
+				if (outBin.fail()) { throw std::ios_base::failure("Error during file write! Stream went bad!"); }
+			}
+		}
+	}
+	catch (...)
+	{
+		stopReaders();
+		throw;
+	}
+
+	stopReaders();
+}
+
+std::vector<LASdataTranscoder::VariableRecord> LASdataTranscoder::readVLRs(std::ifstream& inBin) const
+{
+	std::vector<VariableRecord> records;
+	unsigned long long position = m_inputHeader.headerSize;
+
+	inBin.seekg(m_inputHeader.headerSize, std::ios::beg);
+
+	for (unsigned long i = 0; i < m_inputHeader.numberOfVariableLengthRecords; ++i)
+	{
+		VariableRecord record;
+		record.header.resize(54);
+		inBin.read(record.header.data(), 54);
+
+		const unsigned short recordLength = *reinterpret_cast<const uint16_t*>(&record.header[20]);
+		position += 54 + recordLength;
+
+		if (position > m_inputHeader.offsetToPointData) {
+			mexErrMsgIdAndTxt("MEX:LASTranscoder:invalidFile", "Variable length records of the input file exceed the offset to point data!");
+		}
+
+		record.data.resize(recordLength);
+		inBin.read(record.data.data(), recordLength);
+		records.push_back(std::move(record));
+	}
+
+	if (inBin.fail()) { throw std::ios_base::failure("Error while reading the variable length records of the input file!"); }
+
+	return records;
+}
+
+std::vector<LASdataTranscoder::VariableRecord> LASdataTranscoder::splitExtendedVLRs(const std::vector<char>& records)
+{
+	std::vector<VariableRecord> split;
+
+	for (size_t position = 0; position + 60 <= records.size();)
+	{
+		const unsigned long long recordLength = *reinterpret_cast<const uint64_t*>(&records[position + 20]);
+
+		VariableRecord record;
+		record.header.assign(records.begin() + position, records.begin() + position + 60);
+		record.data.assign(records.begin() + position + 60, records.begin() + position + 60 + static_cast<size_t>(recordLength));
+		split.push_back(std::move(record));
+
+		position += 60 + static_cast<size_t>(recordLength);
+	}
+
+	return split;
+}
+
+void LASdataTranscoder::mergeVariableRecords(std::vector<VariableRecord>& merged, const std::vector<VariableRecord>& records, bool dropExtraBytesDescription)
+{
+	for (const VariableRecord& record : records)
+	{
+		const char* pUserID = &record.header[2];
+		const unsigned short recordID = *reinterpret_cast<const uint16_t*>(&record.header[18]);
+
+		if (dropExtraBytesDescription && recordID == 4 && std::strncmp(pUserID, "LASF_Spec", 16) == 0) {
+			continue;
+		}
+
+		bool isMerged = false;
+
+		for (const VariableRecord& existing : merged)
+		{
+			if (std::strncmp(&existing.header[2], pUserID, 16) != 0 || *reinterpret_cast<const uint16_t*>(&existing.header[18]) != recordID) {
+				continue;
+			}
+
+			isMerged = true;
+
+			if (std::strncmp(pUserID, "LASF_Projection", 16) == 0 && existing.data != record.data) {
+				mexWarnMsgIdAndTxt("MEX:LASTranscoder:differentCRS", "Input files have different coordinate reference systems, the one of the first file is kept!");
+			}
+			break;
+		}
+
+		if (!isMerged) {
+			merged.push_back(record);
+		}
+	}
+}
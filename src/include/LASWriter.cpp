@@ -1,7 +1,33 @@
 #include "LAS_IO.hpp"
+#include "CoordinateQuantization.hpp"
+#include "PointFormatConversion.hpp"
 #include <cstring>
 #include <memory>
 #include <cmath>
+#include <climits>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <string>
+#ifdef LAS_WITH_LASZIP
+#include <exception>
+#include <laszip/laszip_api.h>
+#endif
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 // Preprocessor directives to get field data
 
@@ -129,247 +155,1527 @@ void LASdataWriter::WriteLASheader(std::ofstream& lasBin)
 }
 
 
-void LASdataWriter::WriteLASdata(std::ofstream& lasBin)
+// Writes buffers handed over by the encoding thread to file in a background thread.
+// Only one buffer is in flight at a time, so the caller can fill a second buffer meanwhile (double buffering)
+class AsyncChunkWriter
 {
-	// Initialilzations
-	int writeBufferPointSize = 4096;	// How many Points are written per write call
-	size_t pointOffset = 0;				// pointOffset is offset to the current cloud point to process
-	size_t bufOffPointStart = 0;		// Offset to current position in write Buffer
+public:
+	explicit AsyncChunkWriter(std::ofstream& lasBin) : m_lasBin(lasBin)
+	{
+		m_thread = std::thread(&AsyncChunkWriter::run, this);
+	}
+
+	~AsyncChunkWriter()
+	{
+		Finish();
+	}
+
+	// Hands buffer over to the background thread. Blocks until the previously submitted buffer has been written
+	void Submit(const char* pBuffer, std::streamsize byteCount)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_condition.wait(lock, [this] { return nullptr == m_pPending; });
+		m_pPending = pBuffer;
+		m_pendingBytes = byteCount;
+		m_condition.notify_all();
+	}
 
+	// Waits until every submitted buffer has been written and stops the background thread
+	void Finish()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return nullptr == m_pPending; });
+			m_stop = true;
+			m_condition.notify_all();
+		}
+		if (m_thread.joinable()) { m_thread.join(); }
+	}
+
+private:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true)
+		{
+			m_condition.wait(lock, [this] { return nullptr != m_pPending || m_stop; });
+			if (nullptr == m_pPending) { return; }
+
+			// Write without holding the lock so the encoder is only blocked if it needs the slot
+			lock.unlock();
+			m_lasBin.write(m_pPending, m_pendingBytes);
+			lock.lock();
+
+			m_pPending = nullptr;
+			m_condition.notify_all();
+		}
+	}
+
+	std::ofstream&			m_lasBin;
+	std::thread				m_thread;
+	std::mutex				m_mutex;
+	std::condition_variable	m_condition;
+	const char*				m_pPending		= nullptr;
+	std::streamsize			m_pendingBytes	= 0;
+	bool					m_stop			= false;
+};
+
+void LASdataWriter::WriteLASdata(std::ofstream& lasBin)
+{
 	// Check if necessary Pointers are valid (Creates Matlab Error if not)
 	isDataValid();
 
+	if (!BeginPointData(lasBin)) {
+		return;
+	}
+
+	if (m_options.useCoordinatePrecision) {
+		optimizeQuantization();
+	}
+
+	if (m_options.lodOctree) {
+		computeOctreeOrder();
+	}
+	else if (m_options.spatialSort != SpatialOrder::None) {
+		computePointOrder();
+	}
+
+	writePoints(lasBin);
+
+	m_pointOrder = std::vector<size_t>();
+	EndPointData(lasBin);
+}
+
+bool LASdataWriter::BeginPointData(std::ofstream& lasBin)
+{
 	// Get Interal record format and get all the byte offsets to LAS Fields
 	setInternalRecordFormatID();
 
 	if (m_internalPointDataRecordID == -1) 
 	{
 		mexWarnMsgIdAndTxt("MEX:WriteLASdata:invalidPointDataRecordFormat", "Critical Error: Point Data Record Format not supported!\n");
-		return;
+		return false;
 	}
 
-	const int record_length         = m_header.PointDataRecordLength;
-	const int extradata_Byte		= m_record_lengths[m_internalPointDataRecordID];
-
-	const int bits2_Byte			= m_bits2_Byte			[m_internalPointDataRecordID];
-	const int classification_Byte	= m_classification_Byte	[m_internalPointDataRecordID];
-	const int scanAngle_Byte		= m_scanAngle_Byte		[m_internalPointDataRecordID];
-	const int userData_Byte			= m_userData_Byte		[m_internalPointDataRecordID];
-	const int pointSourceID_Byte	= m_pointSourceID_Byte	[m_internalPointDataRecordID];
-	const int time_Byte				= m_time_Byte			[m_internalPointDataRecordID];
-	const int color_Byte			= m_color_Byte			[m_internalPointDataRecordID];
-	const int NIR_Byte				= m_NIR_Byte			[m_internalPointDataRecordID];
-	const int wavePackets_Byte		= m_wavePackets_Byte	[m_internalPointDataRecordID];
-
-	const bool doWriteBits2			= bits2_Byte != 0;			// Is Bits2 field to be written
-	const bool doWriteTime			= time_Byte  != 0;			// Is Time field to be written
-	const bool doWriteColor			= color_Byte != 0;			// Is Color field to be written
-	const bool doWriteNIR			= NIR_Byte   != 0;			// Is NIR field to be written
-	const bool doWriteWavePackets	= wavePackets_Byte != 0;	// Is Wave Packets field to be written
-	const bool isScanAngle16Bit		= scanAngle_Byte == 18;		// Is Scan Angle field a 16 bit / 2 byte value
-
-	// Const copies of frequently accessed struct values
-	const double xScale = m_header.xScaleFactor;
-	const double yScale = m_header.yScaleFactor;
-	const double zScale = m_header.zScaleFactor;
-	const double xOff	= m_header.xOffset;
-	const double yOff	= m_header.yOffset;
-	const double zOff	= m_header.zOffset;
-
-	// Set stream position before write as offset to point data
-	setStreamPosAsDataOffset(lasBin);
-
-	// Seek start of point data in file
+	setRecordLayout();
+	m_statistics = m_existingStatistics;
+
 	if (!lasBin.is_open()) { throw std::ofstream::failure("File is not open or not writable!"); }
-	lasBin.seekp(m_header.offsetToPointData, lasBin.beg);
 
-	// Arrays for three components fields
-	int32_t XYZ_Coordinates[3] = { 0 };
-	uint16_t colors[3] = { 0 };
+	if (m_appendOffset == 0)
+	{
+		// Set stream position before write as offset to point data
+		setStreamPosAsDataOffset(lasBin);
+
+		// Seek start of point data in file
+		lasBin.seekp(m_header.offsetToPointData, lasBin.beg);
+	}
+	else
+	{
+		// Seek end of the existing point records
+		lasBin.seekp(m_appendOffset, lasBin.beg);
+	}
 
-	// Calculate number of full write blocks and the remaining points inside the last block
-	const int fullChunksCount = static_cast<int>(m_numberOfPointsToWrite / writeBufferPointSize);
-	const int pointsToWriteAtEnd = static_cast<int>(m_numberOfPointsToWrite - (static_cast<unsigned long long>(writeBufferPointSize) * fullChunksCount));
+	return true;
+}
 
-	// Create Write Buffer
-	const int bufferLength = static_cast<int>(m_header.PointDataRecordLength) * writeBufferPointSize;
-	std::unique_ptr<char[]>  uniqueBuffer(new char[bufferLength]);
-	char* pBuffer = uniqueBuffer.get();
+void LASdataWriter::WritePointChunk(std::ofstream& lasBin, const mxArray* lasChunk)
+{
+	// Point count of the chunk is given by its coordinates, all other fields need at least as many elements
+	const mxArray* pX = mxIsStruct(lasChunk) ? mxGetField(lasChunk, 0, "x") : nullptr;
 
-	// Set Buffer to Zero
-	std::fill(pBuffer, pBuffer + bufferLength, static_cast<char>(0));
+	if (nullptr == pX) {
+		mexErrMsgIdAndTxt("MEX:WritePointChunk:typeargin", "Point chunk has to be a LAS structure with field x!");
+	}
 
-	// Don't check for file still good for every chunk
-	const unsigned int fileCheckInterval = 30;
+	m_numberOfPointsToWrite = mxGetNumberOfElements(pX);
 
-	/* Data write loop */
-	for (size_t i = 0; i < (fullChunksCount + 1); ++i)
+	if (m_numberOfPointsToWrite == 0) {
+		return;
+	}
+
+	if (m_header.versionMinor < 4 && m_statistics.pointCount + m_numberOfPointsToWrite > ULONG_MAX) {
+		mexErrMsgIdAndTxt("MEX:WritePointChunk:pointCount", "Point count exceeds the maximum of LAS versions before 1.4!");
+	}
+
+	// Quantization has to be fixed before the first chunk, so the extent of all points is unknown
+	if (m_options.useCoordinatePrecision) {
+		mexErrMsgIdAndTxt("MEX:WritePointChunk:coordinatePrecision", "Coordinate precision is not supported when writing chunks, set scale factors and offsets in the header!");
+	}
+
+	// The octree needs all points at once
+	if (m_options.lodOctree) {
+		mexErrMsgIdAndTxt("MEX:WritePointChunk:lodOctree", "Level of detail octree is not supported when writing chunks!");
+	}
+
+	// Fields are checked before their data pointers are taken
+	setContentFlags();
+	isChunkSizeValid(lasChunk);
+
+	GetData(lasChunk);
+	isDataValid();
+
+	writePoints(lasBin);
+}
+
+void LASdataWriter::EndPointData(std::ofstream& lasBin)
+{
+	if (lasBin.fail()) { throw std::ofstream::failure("Error during file write! Stream went bad!"); }
+
+	// Patch header with the statistics gathered during encoding and return to the end of the point data
+	if (m_options.computeHeaderStats)
 	{
-		// Current Position in point array
-		pointOffset = static_cast<size_t>(i) * writeBufferPointSize;
+		applyHeaderStatistics(m_statistics.minXYZ, m_statistics.maxXYZ, m_statistics.pointCount, m_statistics.pointsByReturn);
 
-		// If last Iteration then we have to reduce buffer size
-		if (i == fullChunksCount) { writeBufferPointSize = pointsToWriteAtEnd; }
+		const auto endOfPointData = lasBin.tellp();
 
-		// Fill write buffer with all the fields which are supposed to be written
-		for (size_t k = 0; k < writeBufferPointSize; ++k)
+		// Extended VLRs follow directly after the point data. Waveform data inside of them moves along
+		if (m_appendOffset == 0 && m_header.versionMajor == 1 && m_header.versionMinor > 3 && m_headerExt4.numberOfExtendedVariableLengthRecords > 0)
 		{
-			bufOffPointStart = k * m_header.PointDataRecordLength;
+			const unsigned long long declaredStart = m_headerExt4.startOfFirstExtendedVariableLengthRecord;
+			const unsigned long long actualStart = static_cast<unsigned long long>(endOfPointData);
 
-			// Create final values of static LAS fields which have to be written to file
-			XYZ_Coordinates[0]	= std::lround((m_mxStructPointer.pX[pointOffset + k] - xOff) / xScale);
-			XYZ_Coordinates[1]	= std::lround((m_mxStructPointer.pY[pointOffset + k] - yOff) / yScale);
-			XYZ_Coordinates[2]	= std::lround((m_mxStructPointer.pZ[pointOffset + k] - zOff) / zScale);
+			if (declaredStart > 0 && m_headerExt3.startOfWaveFormData >= declaredStart) {
+				m_headerExt3.startOfWaveFormData = m_headerExt3.startOfWaveFormData - declaredStart + actualStart;
+			}
 
-			// Copy values to write buffer
-			std::memcpy(pBuffer + bufOffPointStart,		 &XYZ_Coordinates[0], size_3_int32);
-			std::memcpy(pBuffer + bufOffPointStart + 12, &m_mxStructPointer.pIntensity[pointOffset + k], size_uint16);
-			std::memcpy(pBuffer + bufOffPointStart + 14, &m_mxStructPointer.pBits[pointOffset + k], size_uint16);
+			m_headerExt4.startOfFirstExtendedVariableLengthRecord = actualStart;
+		}
 
-			// Write other fields according to point data record format
-			if (doWriteBits2){	
-				std::memcpy(pBuffer + bufOffPointStart + bits2_Byte, &m_mxStructPointer.pBits2[pointOffset + k], size_uint8); 
-			}
+		WriteLASheader(lasBin);
+		lasBin.seekp(endOfPointData, lasBin.beg);
+	}
+}
 
-			std::memcpy(pBuffer + bufOffPointStart + classification_Byte, &m_mxStructPointer.pClassicfication[pointOffset + k],	size_uint8);
-			std::memcpy(pBuffer + bufOffPointStart + userData_Byte, &m_mxStructPointer.pUserData[pointOffset + k], size_uint8);
+void LASdataWriter::SetComputeHeaderStats(bool computeHeaderStats)
+{
+	m_options.computeHeaderStats = computeHeaderStats;
+}
 
-			if (isScanAngle16Bit) 
-			{
-				std::memcpy(pBuffer + bufOffPointStart + scanAngle_Byte, &m_mxStructPointer.pScanAngle_16Bit[pointOffset + k], size_int16);
-			}
-			else 
-			{
-				std::memcpy(pBuffer + bufOffPointStart + scanAngle_Byte, &m_mxStructPointer.pScanAngle[pointOffset + k], size_int8);
-			}
+#ifdef LAS_WITH_LASZIP
+
+// Owns a LASzip writer handle and turns its error codes into exceptions, so the handle is released on every path
+class LASzipWriter
+{
+public:
+	LASzipWriter()
+	{
+		if (laszip_create(&m_pointer) != 0) { throw std::ofstream::failure("LASzip writer could not be created!"); }
+	}
+
+	~LASzipWriter()
+	{
+		if (m_isOpen) { laszip_close_writer(m_pointer); }
+		laszip_destroy(m_pointer);
+	}
+
+	// Throws the error message of LASzip if result signals an error
+	void Check(laszip_I32 result) const
+	{
+		if (result == 0) {
+			return;
+		}
+
+		laszip_CHAR* pError = nullptr;
+		laszip_get_error(m_pointer, &pError);
+		throw std::ofstream::failure(std::string("LASzip: ") + (nullptr != pError ? pError : "unknown error"));
+	}
+
+	void Open(const char* filePath)
+	{
+		Check(laszip_open_writer(m_pointer, filePath, 1));
+		m_isOpen = true;
+	}
+
+	// Writes the chunk table and the header with the inventory of the written points
+	void Close()
+	{
+		m_isOpen = false;
+		Check(laszip_close_writer(m_pointer));
+	}
+
+	laszip_POINTER Get() const { return m_pointer; }
+
+private:
+	laszip_POINTER	m_pointer	= nullptr;
+	bool			m_isOpen	= false;
+};
+
+void LASdataWriter::WriteCompressed(const char* filePath, const mxArray* lasStructure)
+{
+	// Check if necessary Pointers are valid (Creates Matlab Error if not)
+	isDataValid();
+	setInternalRecordFormatID();
 
-			std::memcpy(pBuffer + bufOffPointStart + pointSourceID_Byte, &m_mxStructPointer.pPointSourceID[pointOffset + k], size_uint16);
+	if (m_internalPointDataRecordID == -1) {
+		mexErrMsgIdAndTxt("MEX:WriteCompressed:invalidPointDataRecordFormat", "Point Data Record Format not supported!");
+	}
+
+	setRecordLayout();
+
+	if (m_options.useCoordinatePrecision) {
+		optimizeQuantization();
+	}
+
+	if (m_options.lodOctree) {
+		computeOctreeOrder();
+	}
+	else if (m_options.spatialSort != SpatialOrder::None) {
+		computePointOrder();
+	}
+
+	LASzipWriter laszip;
+	laszip_header_struct* pHeader = nullptr;
+	laszip.Check(laszip_get_header_pointer(laszip.Get(), &pHeader));
+
+	// Point counts and bounding box are taken from the inventory of the written points when the writer is closed
+	pHeader->file_source_ID				= m_header.sourceID;
+	pHeader->global_encoding			= m_header.globalEncoding;
+	pHeader->project_ID_GUID_data_1		= static_cast<laszip_U32>(m_header.projectID_GUID_1);
+	pHeader->project_ID_GUID_data_2		= m_header.projectID_GUID_2;
+	pHeader->project_ID_GUID_data_3		= m_header.projectID_GUID_3;
+	std::memcpy(pHeader->project_ID_GUID_data_4, m_header.projectID_GUID_4, 8);
+	pHeader->version_major				= m_header.versionMajor;
+	pHeader->version_minor				= m_header.versionMinor;
+	std::memcpy(pHeader->system_identifier, m_header.systemIdentifier, 32);
+	std::memcpy(pHeader->generating_software, m_header.generatingSoftware, 32);
+	pHeader->file_creation_day			= m_header.fileCreationDayOfYear;
+	pHeader->file_creation_year			= m_header.fileCreationYear;
+	pHeader->header_size				= m_header.headerSize;
+	pHeader->offset_to_point_data		= m_header.headerSize;
+	pHeader->number_of_variable_length_records = 0;
+	pHeader->point_data_format			= m_header.PointDataRecordFormat;
+	pHeader->point_data_record_length	= m_header.PointDataRecordLength;
+	pHeader->x_scale_factor				= m_header.xScaleFactor;
+	pHeader->y_scale_factor				= m_header.yScaleFactor;
+	pHeader->z_scale_factor				= m_header.zScaleFactor;
+	pHeader->x_offset					= m_header.xOffset;
+	pHeader->y_offset					= m_header.yOffset;
+	pHeader->z_offset					= m_header.zOffset;
+	pHeader->start_of_waveform_data_packet_record = m_headerExt3.startOfWaveFormData;
+
+	// Extended VLRs are appended after the chunk table once LASzip is done
+	pHeader->start_of_first_extended_variable_length_record = 0;
+	pHeader->number_of_extended_variable_length_records = 0;
+
+	// LASzip adds its own VLR and keeps the VLR count and the offset to point data up to date
+	if (HasVLR())
+	{
+		mxArray* pVLRfield = mxGetField(lasStructure, 0, "variablerecords");
+
+		for (size_t i = 0; i < m_header.numberOfVariableLengthRecords; ++i)
+		{
+			getVLRHeader(pVLRfield, i);
 
-			if (doWriteTime){	
-				std::memcpy(pBuffer + bufOffPointStart + time_Byte,  &m_mxStructPointer.pGPS_Time[pointOffset + k], size_double); 
+			// The compression VLR of a previously read LAZ-File does not describe the new file
+			if (m_VLRHeader.recordID == 22204 && std::strcmp(m_VLRHeader.userID, "laszip encoded") == 0) {
+				continue;
 			}
-			
-			if (doWriteColor)
-			{
-				colors[0] = m_mxStructPointer.pRed[pointOffset + k];
-				colors[1] = m_mxStructPointer.pGreen[pointOffset + k];
-				colors[2] = m_mxStructPointer.pBlue[pointOffset + k];
-				memcpy(pBuffer + bufOffPointStart + color_Byte, &colors[0], size_3_uint16);
 
+			const laszip_U8* pData = nullptr;
+			if (m_VLRHeader.recordLengthAfterHeader > 0) {
+				pData = GetUint8(mxGetField(pVLRfield, i, "data"));
 			}
 
-			if (doWriteNIR) 
+			laszip.Check(laszip_add_vlr(laszip.Get(), m_VLRHeader.userID, m_VLRHeader.recordID, m_VLRHeader.recordLengthAfterHeader, m_VLRHeader.description, pData));
+		}
+	}
+
+	// Point data record formats 6-10 are compressed with the layered LAS 1.4 scheme. Every chunk of 50000 points
+	// is compressed independently and listed in the chunk table, so readers can seek and decode chunks in parallel
+	laszip.Check(laszip_preserve_generating_software(laszip.Get(), 1));
+	laszip.Check(laszip_request_native_extension(laszip.Get(), 1));
+	laszip.Check(laszip_set_chunk_size(laszip.Get(), 50000));
+	laszip.Open(filePath);
+
+	laszip_point_struct* pPoint = nullptr;
+	laszip.Check(laszip_get_point_pointer(laszip.Get(), &pPoint));
+
+	const RecordLayout layout = m_layout;
+	const bool isExtended = m_header.PointDataRecordFormat > 5;
+	const int extraByteCount = layout.recordLength - layout.extradata_Byte;
+
+	// Copy the fields of pointCount encoded point records into the point of LASzip and compress them
+	auto compressRecords = [&](const char* pRecords, size_t pointCount)
+	{
+		for (size_t i = 0; i < pointCount; ++i)
+		{
+			const char* pRecord = pRecords + i * layout.recordLength;
+			const uint8_t bits = static_cast<uint8_t>(pRecord[14]);
+			const uint8_t classification = static_cast<uint8_t>(pRecord[layout.classification_Byte]);
+			uint8_t legacyBits = 0;
+			uint8_t legacyClassification = 0;
+			int8_t legacyScanAngle = 0;
+
+			std::memcpy(&pPoint->X, pRecord, 4);
+			std::memcpy(&pPoint->Y, pRecord + 4, 4);
+			std::memcpy(&pPoint->Z, pRecord + 8, 4);
+			std::memcpy(&pPoint->intensity, pRecord + 12, 2);
+			pPoint->user_data = static_cast<laszip_U8>(pRecord[layout.userData_Byte]);
+			std::memcpy(&pPoint->point_source_ID, pRecord + layout.pointSourceID_Byte, 2);
+
+			if (isExtended)
 			{
-				std::memcpy(pBuffer + bufOffPointStart + NIR_Byte, &m_mxStructPointer.pNIR[pointOffset + k], size_uint16);
+				const uint8_t bits2 = static_cast<uint8_t>(pRecord[layout.bits2_Byte]);
+				int16_t scanAngle = 0;
+				std::memcpy(&scanAngle, pRecord + layout.scanAngle_Byte, 2);
+
+				pPoint->extended_point_type				= 1;
+				pPoint->extended_return_number			= bits & 15;
+				pPoint->extended_number_of_returns		= bits >> 4;
+				pPoint->extended_classification_flags	= bits2 & 15;
+				pPoint->extended_scanner_channel		= (bits2 >> 4) & 3;
+				pPoint->extended_classification			= classification;
+				pPoint->extended_scan_angle				= scanAngle;
+
+				// Legacy fields have to be consistent with the extended ones, they are mapped like in the conversion
+				// of record formats 6-10 to 0-5
+				extendedToLegacyFields(bits, bits2, classification, scanAngle, legacyBits, legacyClassification, legacyScanAngle);
 			}
-
-			if (doWriteWavePackets)
+			else
 			{
-				std::memcpy(pBuffer + bufOffPointStart + wavePackets_Byte,		&m_mxStructPointer.pWavePacketDescriptor[pointOffset + k], size_uint8);
-				std::memcpy(pBuffer + bufOffPointStart + wavePackets_Byte + 1,	&m_mxStructPointer.pWaveByteOffset[pointOffset + k], size_uint64);
-				std::memcpy(pBuffer + bufOffPointStart + wavePackets_Byte + 9,	&m_mxStructPointer.pWavePacketSize[pointOffset + k], size_uint32);
-				std::memcpy(pBuffer + bufOffPointStart + wavePackets_Byte + 13, &m_mxStructPointer.pWaveReturnPoint[pointOffset + k], size_float);
-				std::memcpy(pBuffer + bufOffPointStart + wavePackets_Byte + 17, &m_mxStructPointer.pWaveXt[pointOffset + k], size_float);
-				std::memcpy(pBuffer + bufOffPointStart + wavePackets_Byte + 21, &m_mxStructPointer.pWaveYt[pointOffset + k], size_float);
-				std::memcpy(pBuffer + bufOffPointStart + wavePackets_Byte + 25, &m_mxStructPointer.pWaveZt[pointOffset + k], size_float);
+				legacyBits				= bits;
+				legacyClassification	= classification;
+				legacyScanAngle			= static_cast<int8_t>(pRecord[layout.scanAngle_Byte]);
 			}
 
-			if (m_containsExtraBytes)
-			{
-				std::memcpy(pBuffer + bufOffPointStart + extradata_Byte, &m_mxStructPointer.pExtraBytes[(pointOffset + k)*m_extraByteCount], m_extraByteCount*size_uint8);
+			pPoint->return_number		= legacyBits & 7;
+			pPoint->number_of_returns	= (legacyBits >> 3) & 7;
+			pPoint->scan_direction_flag	= (legacyBits >> 6) & 1;
+			pPoint->edge_of_flight_line	= legacyBits >> 7;
+			pPoint->classification		= legacyClassification & 31;
+			pPoint->synthetic_flag		= (legacyClassification >> 5) & 1;
+			pPoint->keypoint_flag		= (legacyClassification >> 6) & 1;
+			pPoint->withheld_flag		= legacyClassification >> 7;
+			pPoint->scan_angle_rank		= static_cast<laszip_I8>(legacyScanAngle);
+
+			if (layout.time_Byte != 0) {
+				std::memcpy(&pPoint->gps_time, pRecord + layout.time_Byte, 8);
+			}
+			if (layout.color_Byte != 0) {
+				std::memcpy(pPoint->rgb, pRecord + layout.color_Byte, 6);
+			}
+			if (layout.NIR_Byte != 0) {
+				std::memcpy(&pPoint->rgb[3], pRecord + layout.NIR_Byte, 2);
 			}
+			if (layout.wavePackets_Byte != 0) {
+				std::memcpy(pPoint->wave_packet, pRecord + layout.wavePackets_Byte, 29);
+			}
+			if (extraByteCount > 0 && nullptr != pPoint->extra_bytes) {
+				std::memcpy(pPoint->extra_bytes, pRecord + layout.extradata_Byte, std::min(extraByteCount, static_cast<int>(pPoint->num_extra_bytes)));
+			}
+
+			laszip.Check(laszip_write_point(laszip.Get()));
+			laszip.Check(laszip_update_inventory(laszip.Get()));
+		}
+	};
+
+	// Encode the next chunk of records while a background thread compresses the previous one (double buffering)
+	const size_t chunkPointSize = 65536;
+	const size_t bufferLength = static_cast<size_t>(layout.recordLength) * chunkPointSize;
+	std::unique_ptr<char[]> uniqueBuffers[2];
+
+	for (int i = 0; i < 2; ++i)
+	{
+		uniqueBuffers[i].reset(new char[bufferLength]);
+		std::fill(uniqueBuffers[i].get(), uniqueBuffers[i].get() + bufferLength, static_cast<char>(0));
+	}
+
+	std::thread compressor;
+	std::exception_ptr compressorError;
+	int currentBuffer = 0;
+
+	try
+	{
+		for (size_t pointOffset = 0; pointOffset < m_numberOfPointsToWrite; pointOffset += chunkPointSize)
+		{
+			const size_t pointsInChunk = std::min(chunkPointSize, static_cast<size_t>(m_numberOfPointsToWrite - pointOffset));
+			char* pBuffer = uniqueBuffers[currentBuffer].get();
+
+			encodePointChunk(pBuffer, pointOffset, pointsInChunk);
+
+			if (compressor.joinable()) { compressor.join(); }
+			if (compressorError) { std::rethrow_exception(compressorError); }
+
+			compressor = std::thread([&compressRecords, &compressorError, pBuffer, pointsInChunk]
+			{
+				try { compressRecords(pBuffer, pointsInChunk); }
+				catch (...) { compressorError = std::current_exception(); }
+			});
+
+			currentBuffer ^= 1;
 		}
+	}
+	catch (...)
+	{
+		if (compressor.joinable()) { compressor.join(); }
+		throw;
+	}
+
+	if (compressor.joinable()) { compressor.join(); }
+	if (compressorError) { std::rethrow_exception(compressorError); }
+
+	m_pointOrder = std::vector<size_t>();
+	laszip.Close();
+
+	if (!HasExtVLR()) {
+		return;
+	}
+
+	// Extended VLRs follow the chunk table. Waveform data inside of them moves along
+	std::ofstream lasBin(filePath, std::ios::in | std::ios::out | std::ios::binary);
+	if (!lasBin.is_open()) { throw std::ofstream::failure("Compressed file could not be reopened to write the extended VLRs!"); }
 
-		// Finally write buffer to file
-		lasBin.write(pBuffer, static_cast<std::streamsize>(writeBufferPointSize) * m_header.PointDataRecordLength);
+	lasBin.seekp(0, lasBin.end);
+	const unsigned long long actualStart = static_cast<unsigned long long>(lasBin.tellp());
+	const unsigned long long declaredStart = m_headerExt4.startOfFirstExtendedVariableLengthRecord;
+
+	if (declaredStart > 0 && m_headerExt3.startOfWaveFormData >= declaredStart) {
+		m_headerExt3.startOfWaveFormData = m_headerExt3.startOfWaveFormData - declaredStart + actualStart;
 	}
+	m_headerExt4.startOfFirstExtendedVariableLengthRecord = actualStart;
+
+	WriteExtVLR(lasBin, lasStructure);
+
+	lasBin.seekp(227, lasBin.beg);
+	lasBin.write(reinterpret_cast<char*>(&m_headerExt3.startOfWaveFormData), 8);
+	lasBin.write(reinterpret_cast<char*>(&m_headerExt4.startOfFirstExtendedVariableLengthRecord), 8);
+	lasBin.write(reinterpret_cast<char*>(&m_headerExt4.numberOfExtendedVariableLengthRecords), 4);
 
 	if (lasBin.fail()) { throw std::ofstream::failure("Error during file write! Stream went bad!"); }
 }
 
-void LASdataWriter::GetHeader(const mxArray* prhs)
+#else
+
+void LASdataWriter::WriteCompressed(const char* /*filePath*/, const mxArray* /*lasStructure*/)
 {
-	mxDouble* pMXDouble;
-	mxChar* pMXChar;
+	mexErrMsgIdAndTxt("MEX:WriteCompressed:compress", "Compressed output requires writeLASfile_cpp to be compiled with LASzip (see build_writeLASfile.m)!");
+}
 
-	mxArray* pMxHeader = mxGetField(prhs, 0, "header");
-	m_mxStructPointer.pMXheader = pMxHeader;
+#endif
 
-	if (nullptr == pMxHeader) {
-		mexErrMsgIdAndTxt("MEX:GetHeader:nullptr", "Could not access header field of LAS structure!");
+void LASdataWriter::isChunkSizeValid(const mxArray* lasChunk) const
+{
+	// Fields that are written for every point data record format and the format dependent ones
+	std::vector<const char*> fieldNames = { "y", "z", "intensity", "bits", "classification", "user_data", "scan_angle", "point_source_id" };
+
+	if (m_source.isExtended) { fieldNames.push_back("bits2"); }
+	if (m_source.hasTime) { fieldNames.push_back("gps_time"); }
+	if (m_source.hasColors) { fieldNames.insert(fieldNames.end(), { "red", "green", "blue" }); }
+	if (m_source.hasNIR) { fieldNames.push_back("nir"); }
+	if (m_source.hasWavePackets) {
+		fieldNames.insert(fieldNames.end(), { "wave_packet_descriptor", "wave_byte_offset", "wave_packet_size", "wave_return_point", "Xt", "Yt", "Zt" });
 	}
 
-	m_header.sourceID		  = static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "source_id")));
-	m_header.globalEncoding   = static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "global_encoding")));
-	m_header.projectID_GUID_1 = static_cast<unsigned long>(*GetDoubles(mxGetField(pMxHeader, 0, "project_id_guid1")));
-	m_header.projectID_GUID_2 = static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "project_id_guid2")));
-	m_header.projectID_GUID_3 = static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "project_id_guid3")));
+	for (const char* fieldName : fieldNames)
+	{
+		const mxArray* pField = mxGetField(lasChunk, 0, fieldName);
 
-	pMXDouble = GetDoubles(mxGetField(pMxHeader, 0, "project_id_guid4"));
-	for (int i = 0; i < 8; ++i) { m_header.projectID_GUID_4[i] = static_cast<uint8_t>(pMXDouble[i]); }
+		if (nullptr == pField || mxGetNumberOfElements(pField) < m_numberOfPointsToWrite) {
+			mexErrMsgIdAndTxt("MEX:LASWriter:isChunkSizeValid", "Field %s of the point chunk has less elements than x!", fieldName);
+		}
+	}
 
-	m_header.versionMajor = static_cast<unsigned char>(*GetDoubles(mxGetField(pMxHeader, 0, "version_major")));
-	m_header.versionMinor = static_cast<unsigned char>(*GetDoubles(mxGetField(pMxHeader, 0, "version_minor")));
+	const mxArray* pExtraBytes = mxGetField(lasChunk, 0, "extradata");
 
-	m_header.fileCreationDayOfYear			= static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "file_creation_day_of_year")));
-	m_header.fileCreationYear				= static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "file_creation_year")));
-	m_header.headerSize						= static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "header_size")));
-	m_header.offsetToPointData				= static_cast<unsigned long>(*GetDoubles(mxGetField(pMxHeader, 0, "offset_to_point_data")));
-	m_header.numberOfVariableLengthRecords	= static_cast<unsigned long>(*GetDoubles(mxGetField(pMxHeader, 0, "number_of_variable_records")));
-	m_header.LegacyNumberOfPointRecords		= 0;
+	if (m_containsExtraBytes && (nullptr == pExtraBytes || mxGetNumberOfElements(pExtraBytes) < m_numberOfPointsToWrite * m_extraByteCount)) {
+		mexErrMsgIdAndTxt("MEX:LASWriter:isChunkSizeValid", "Field extradata of the point chunk has less elements than needed for x!");
+	}
+}
 
-	m_header.PointDataRecordFormat = static_cast<unsigned char>(*GetDoubles(mxGetField(pMxHeader, 0, "point_data_format")));
-	m_header.PointDataRecordLength = static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "point_data_record_length")));
-	m_header.xScaleFactor = *GetDoubles(mxGetField(pMxHeader, 0, "scale_factor_x"));
-	m_header.yScaleFactor = *GetDoubles(mxGetField(pMxHeader, 0, "scale_factor_y"));
-	m_header.zScaleFactor = *GetDoubles(mxGetField(pMxHeader, 0, "scale_factor_z"));
-	m_header.xOffset = *GetDoubles(mxGetField(pMxHeader, 0, "x_offset"));
-	m_header.yOffset = *GetDoubles(mxGetField(pMxHeader, 0, "y_offset"));
-	m_header.zOffset = *GetDoubles(mxGetField(pMxHeader, 0, "z_offset"));
-	m_header.maxX = *GetDoubles(mxGetField(pMxHeader, 0, "max_x"));
-	m_header.minX = *GetDoubles(mxGetField(pMxHeader, 0, "min_x"));
-	m_header.maxY = *GetDoubles(mxGetField(pMxHeader, 0, "max_y"));
-	m_header.minY = *GetDoubles(mxGetField(pMxHeader, 0, "min_y"));
-	m_header.maxZ = *GetDoubles(mxGetField(pMxHeader, 0, "max_z"));
-	m_header.minZ = *GetDoubles(mxGetField(pMxHeader, 0, "min_z"));
+void LASdataWriter::writePoints(std::ofstream& lasBin)
+{
+	const size_t writeBufferPointSize = m_options.asyncWrite ? 65536 : 4096;	// How many Points are written per write call
+	size_t pointOffset = 0;													// pointOffset is offset to the current cloud point to process
 
-	// Get number of point records
-	m_numberOfPointsToWrite = static_cast<unsigned long long>(*GetDoubles(mxGetField(pMxHeader, 0, "number_of_point_records")));
+	// Create Write Buffers. The second one is only used for asynchronous writing
+	const size_t bufferLength = static_cast<size_t>(m_header.PointDataRecordLength) * writeBufferPointSize;
+	const int bufferCount = m_options.asyncWrite ? 2 : 1;
+	std::unique_ptr<char[]> uniqueBuffers[2];
 
-	if (m_numberOfPointsToWrite < ULONG_MAX) // max is 4294967296
+	for (int i = 0; i < bufferCount; ++i)
 	{
-		m_header.LegacyNumberOfPointRecords = static_cast<unsigned long>(m_numberOfPointsToWrite);
+		uniqueBuffers[i].reset(new char[bufferLength]);
+		std::fill(uniqueBuffers[i].get(), uniqueBuffers[i].get() + bufferLength, static_cast<char>(0));
 	}
 
-	// Get version exclusive features
-	if (m_header.versionMajor == 1 && m_header.versionMinor < 4)
+	/* Data write loop */
+	if (!m_options.asyncWrite)
 	{
-		pMXDouble = GetDoubles(mxGetField(pMxHeader, 0, "number_of_points_by_return"));
-		for (int i = 0; i < 5; ++i) { m_header.LegacyNumberOfPointByReturn[i] = static_cast<unsigned long>(pMXDouble[i]); }
-	}
+		char* pBuffer = uniqueBuffers[0].get();
 
-	if (m_header.versionMajor == 1 && m_header.versionMinor > 2)
+		for (pointOffset = 0; pointOffset < m_numberOfPointsToWrite; pointOffset += writeBufferPointSize)
+		{
+			// Last chunk is probably not full
+			const size_t pointsInChunk = std::min(writeBufferPointSize, static_cast<size_t>(m_numberOfPointsToWrite - pointOffset));
+
+			// Fill write buffer with all the fields which are supposed to be written, then write buffer to file
+			encodePointChunk(pBuffer, pointOffset, pointsInChunk);
+			lasBin.write(pBuffer, static_cast<std::streamsize>(pointsInChunk) * m_header.PointDataRecordLength);
+		}
+	}
+	else
 	{
-		m_headerExt3.startOfWaveFormData = static_cast<unsigned long long>(*GetDoubles(mxGetField(pMxHeader, 0, "start_of_waveform_data")));
+		// Encode into one buffer while the other one is written by the background thread
+		AsyncChunkWriter chunkWriter(lasBin);
+		int currentBuffer = 0;
+
+		for (pointOffset = 0; pointOffset < m_numberOfPointsToWrite; pointOffset += writeBufferPointSize)
+		{
+			const size_t pointsInChunk = std::min(writeBufferPointSize, static_cast<size_t>(m_numberOfPointsToWrite - pointOffset));
+			char* pBuffer = uniqueBuffers[currentBuffer].get();
+
+			encodePointChunk(pBuffer, pointOffset, pointsInChunk);
+			chunkWriter.Submit(pBuffer, static_cast<std::streamsize>(pointsInChunk) * m_header.PointDataRecordLength);
+
+			currentBuffer ^= 1;
+		}
+
+		chunkWriter.Finish();
 	}
+}
 
-	if (m_header.versionMajor == 1 && m_header.versionMinor > 3)
-	{
-		m_headerExt4.numberOfPointRecords = m_numberOfPointsToWrite;
-		m_headerExt4.startOfFirstExtendedVariableLengthRecord	= static_cast<unsigned long long>(*GetDoubles(mxGetField(pMxHeader, 0, "start_of_extended_variable_length_record")));
-		m_headerExt4.numberOfExtendedVariableLengthRecords		= static_cast<unsigned long>(*GetDoubles(mxGetField(pMxHeader, 0, "number_of_extended_variable_length_record")));
+void LASdataWriter::setRecordLayout()
+{
+	m_layout.recordLength			= m_header.PointDataRecordLength;
+	m_layout.extradata_Byte			= m_record_lengths		[m_internalPointDataRecordID];
+	m_layout.bits2_Byte				= m_bits2_Byte			[m_internalPointDataRecordID];
+	m_layout.classification_Byte	= m_classification_Byte	[m_internalPointDataRecordID];
+	m_layout.scanAngle_Byte			= m_scanAngle_Byte		[m_internalPointDataRecordID];
+	m_layout.userData_Byte			= m_userData_Byte		[m_internalPointDataRecordID];
+	m_layout.pointSourceID_Byte		= m_pointSourceID_Byte	[m_internalPointDataRecordID];
+	m_layout.time_Byte				= m_time_Byte			[m_internalPointDataRecordID];
+	m_layout.color_Byte				= m_color_Byte			[m_internalPointDataRecordID];
+	m_layout.NIR_Byte				= m_NIR_Byte			[m_internalPointDataRecordID];
+	m_layout.wavePackets_Byte		= m_wavePackets_Byte	[m_internalPointDataRecordID];
+
+	m_layout.doWriteBits2			= m_layout.bits2_Byte != 0;			// Is Bits2 field to be written
+	m_layout.doWriteTime			= m_layout.time_Byte  != 0 && m_source.hasTime;				// Is Time field to be written
+	m_layout.doWriteColor			= m_layout.color_Byte != 0 && m_source.hasColors;			// Is Color field to be written
+	m_layout.doWriteNIR				= m_layout.NIR_Byte   != 0 && m_source.hasNIR;				// Is NIR field to be written
+	m_layout.doWriteWavePackets		= m_layout.wavePackets_Byte != 0 && m_source.hasWavePackets;	// Is Wave Packets field to be written
+	m_layout.isScanAngle16Bit		= m_layout.scanAngle_Byte == 18;	// Is Scan Angle field a 16 bit / 2 byte value
+	m_layout.isSourceExtended		= m_source.isExtended;				// Have bit fields and scan angle to be converted
+}
 
-		pMXDouble = GetDoubles(mxGetField(pMxHeader, 0, "number_of_points_by_return"));
-		for (int i = 0; i < 15; ++i) { m_headerExt4.numberOfPointsByReturn[i] = static_cast<unsigned long long>(pMXDouble[i]); }
+void LASdataWriter::setSourceFields()
+{
+	m_source = SourceFields();
+
+	auto it = std::find(m_supported_record_formats.begin(), m_supported_record_formats.end(), m_sourcePointDataRecordFormat);
+	if (it == m_supported_record_formats.end()) {
+		return;
 	}
 
-	// Copy system identifier and generating software char by char until null character or end of array is reached
-	pMXChar = GetChars(mxGetField(pMxHeader, 0, "system_identifier"));
-	copyMXCharToArray(&m_header.systemIdentifier[0], pMXChar, 32);
+	const size_t sourceID = static_cast<size_t>(std::distance(m_supported_record_formats.begin(), it));
 
-	pMXChar = GetChars(mxGetField(pMxHeader, 0, "generating_software"));
-	copyMXCharToArray(&m_header.generatingSoftware[0], pMXChar, 32);
+	m_source.hasTime		= m_time_Byte[sourceID] != 0;
+	m_source.hasColors		= m_color_Byte[sourceID] != 0;
+	m_source.hasNIR			= m_NIR_Byte[sourceID] != 0;
+	m_source.hasWavePackets = m_wavePackets_Byte[sourceID] != 0;
+	m_source.isExtended		= m_sourcePointDataRecordFormat > 5;
+}
 
+void LASdataWriter::convertHeaderToTarget()
+{
+	if (m_options.targetPointFormat < 0 && m_options.targetVersionMinor < 0) {
+		return;
+	}
+
+	const int sourceFormat	= m_header.PointDataRecordFormat;
+	const int sourceMinor	= m_header.versionMinor;
+	const int targetFormat	= m_options.targetPointFormat < 0 ? sourceFormat : m_options.targetPointFormat;
+
+	// Without a given version the lowest version that supports the target format is used if the current one does not
+	int targetMinor = m_options.targetVersionMinor;
+	if (targetMinor < 0)
+	{
+		targetMinor = sourceMinor;
+		if (targetFormat > 5) { targetMinor = 4; }
+		else if ((targetFormat == 4 || targetFormat == 5) && targetMinor < 3) { targetMinor = 3; }
+	}
+
+	if (targetFormat == sourceFormat && targetMinor == sourceMinor) {
+		return;
+	}
+
+	if (m_header.versionMajor != 1 || sourceFormat > 10 || m_header.PointDataRecordLength < m_record_lengths[sourceFormat]) {
+		mexErrMsgIdAndTxt("MEX:convertHeaderToTarget:invalidSource", "Version or point data record format of the LAS structure can not be converted!");
+	}
+	if (targetFormat > 10 || targetMinor < 1 || targetMinor > 4) {
+		mexErrMsgIdAndTxt("MEX:convertHeaderToTarget:invalidTarget", "Target point data record format has to be 0 to 10 and target version minor 1 to 4!");
+	}
+	if ((targetFormat > 5 && targetMinor < 4) || ((targetFormat == 4 || targetFormat == 5) && targetMinor < 3)) {
+		mexErrMsgIdAndTxt("MEX:convertHeaderToTarget:invalidTarget", "Target point data record format %d is not supported by LAS 1.%d!", targetFormat, targetMinor);
+	}
+	if (targetMinor < 4 && m_numberOfPointsToWrite > ULONG_MAX) {
+		mexErrMsgIdAndTxt("MEX:convertHeaderToTarget:pointCount", "Point count exceeds the maximum of LAS versions before 1.4!");
+	}
+
+	// Extra bytes are kept behind the standard fields of the target format
+	const int extraByteCount = m_header.PointDataRecordLength - m_record_lengths[sourceFormat];
+	m_header.PointDataRecordFormat = static_cast<unsigned char>(targetFormat);
+	m_header.PointDataRecordLength = static_cast<unsigned short>(m_record_lengths[targetFormat] + extraByteCount);
+
+	// Header size depends on the version. VLRs directly follow the header
+	const unsigned short targetHeaderSize = targetMinor < 3 ? 227 : (targetMinor < 4 ? 235 : 375);
+	m_header.offsetToPointData = m_header.offsetToPointData - m_header.headerSize + targetHeaderSize;
+	m_header.headerSize = targetHeaderSize;
+	m_header.versionMinor = static_cast<unsigned char>(targetMinor);
+
+	if (sourceMinor < 3) {
+		m_headerExt3.startOfWaveFormData = 0;
+	}
+
+	if (sourceMinor < 4 && targetMinor > 3)
+	{
+		m_headerExt4 = LASheaderExt4();
+		m_headerExt4.numberOfPointRecords = m_numberOfPointsToWrite;
+		for (int i = 0; i < 5; ++i) { m_headerExt4.numberOfPointsByReturn[i] = m_header.LegacyNumberOfPointByReturn[i]; }
+	}
+	else if (sourceMinor > 3 && targetMinor < 4)
+	{
+		if (m_headerExt4.numberOfExtendedVariableLengthRecords > 0) {
+			mexWarnMsgIdAndTxt("MEX:convertHeaderToTarget:droppedExtVLR", "Extended VLRs are not supported by LAS 1.%d and will not be written!", targetMinor);
+		}
+
+		m_headerExt4.numberOfExtendedVariableLengthRecords = 0;
+		for (int i = 0; i < 5; ++i) { m_header.LegacyNumberOfPointByReturn[i] = static_cast<unsigned long>(m_headerExt4.numberOfPointsByReturn[i]); }
+	}
+
+	// Return numbers may change during conversion, so the counts are determined from the written points
+	m_options.computeHeaderStats = true;
+}
+
+void LASdataWriter::encodePointChunk(char* pBuffer, size_t pointOffset, size_t pointCount)
+{
+	const RecordLayout layout = m_layout;
+	size_t bufOffPointStart = 0;		// Offset to current position in write Buffer
+
+	// Indices of the chunk's points if they are written in spatial order
+	const size_t* pOrder = m_pointOrder.empty() ? nullptr : m_pointOrder.data() + pointOffset;
+
+	// Quantize the coordinates of the whole chunk and scatter them into the point records
+	if (m_quantizedXYZ.size() < 3 * pointCount) { m_quantizedXYZ.resize(3 * pointCount); }
+
+	int32_t* pQuantized[3] = { m_quantizedXYZ.data(), m_quantizedXYZ.data() + pointCount, m_quantizedXYZ.data() + 2 * pointCount };
+	const double* pCoordinates[3] = { m_mxStructPointer.pX + pointOffset, m_mxStructPointer.pY + pointOffset, m_mxStructPointer.pZ + pointOffset };
+	const uint8_t* pBits = m_mxStructPointer.pBits + pointOffset;
+
+	if (nullptr != pOrder)
+	{
+		// Gather the fields the chunk kernels need into contiguous arrays
+		if (m_orderedXYZ.size() < 3 * pointCount) { m_orderedXYZ.resize(3 * pointCount); }
+		if (m_orderedBits.size() < pointCount) { m_orderedBits.resize(pointCount); }
+
+		const double* pSource[3] = { m_mxStructPointer.pX, m_mxStructPointer.pY, m_mxStructPointer.pZ };
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			double* pOrdered = m_orderedXYZ.data() + axis * pointCount;
+			for (size_t k = 0; k < pointCount; ++k) { pOrdered[k] = pSource[axis][pOrder[k]]; }
+			pCoordinates[axis] = pOrdered;
+		}
+
+		for (size_t k = 0; k < pointCount; ++k) { m_orderedBits[k] = m_mxStructPointer.pBits[pOrder[k]]; }
+		pBits = m_orderedBits.data();
+	}
+
+	quantizePoints(pCoordinates, pQuantized, pointCount, pointOffset, pOrder);
+
+	scatterCoordinates(pBuffer, layout.recordLength, pQuantized[0], pQuantized[1], pQuantized[2], pointCount);
+
+	if (m_options.computeHeaderStats) {
+		accumulateStatistics(pQuantized, pBits, pointCount);
+	}
+
+	// Array for three components fields
+	uint16_t colors[3] = { 0 };
+
+	for (size_t k = 0; k < pointCount; ++k)
+	{
+		bufOffPointStart = k * layout.recordLength;
+		const size_t pointIndex = nullptr != pOrder ? pOrder[k] : pointOffset + k;
+
+		// Copy values to write buffer
+		std::memcpy(pBuffer + bufOffPointStart + 12, &m_mxStructPointer.pIntensity[pointIndex], size_uint16);
+
+		// Bit fields, classification and scan angle are remapped if the source points are of the other format family
+		if (layout.isSourceExtended == layout.isScanAngle16Bit)
+		{
+			std::memcpy(pBuffer + bufOffPointStart + 14, &m_mxStructPointer.pBits[pointIndex], size_uint8);
+
+			// Write other fields according to point data record format
+			if (layout.doWriteBits2){	
+				std::memcpy(pBuffer + bufOffPointStart + layout.bits2_Byte, &m_mxStructPointer.pBits2[pointIndex], size_uint8); 
+			}
+
+			std::memcpy(pBuffer + bufOffPointStart + layout.classification_Byte, &m_mxStructPointer.pClassicfication[pointIndex], size_uint8);
+
+			if (layout.isScanAngle16Bit) 
+			{
+				std::memcpy(pBuffer + bufOffPointStart + layout.scanAngle_Byte, &m_mxStructPointer.pScanAngle_16Bit[pointIndex], size_int16);
+			}
+			else 
+			{
+				std::memcpy(pBuffer + bufOffPointStart + layout.scanAngle_Byte, &m_mxStructPointer.pScanAngle[pointIndex], size_int8);
+			}
+		}
+		else if (layout.isScanAngle16Bit)
+		{
+			uint8_t bits, bits2, classification;
+			int16_t scanAngle;
+			legacyToExtendedFields(m_mxStructPointer.pBits[pointIndex], m_mxStructPointer.pClassicfication[pointIndex], m_mxStructPointer.pScanAngle[pointIndex],
+				bits, bits2, classification, scanAngle);
+
+			std::memcpy(pBuffer + bufOffPointStart + 14, &bits, size_uint8);
+			std::memcpy(pBuffer + bufOffPointStart + layout.bits2_Byte, &bits2, size_uint8);
+			std::memcpy(pBuffer + bufOffPointStart + layout.classification_Byte, &classification, size_uint8);
+			std::memcpy(pBuffer + bufOffPointStart + layout.scanAngle_Byte, &scanAngle, size_int16);
+		}
+		else
+		{
+			uint8_t bits, classification;
+			int8_t scanAngle;
+			extendedToLegacyFields(m_mxStructPointer.pBits[pointIndex], m_mxStructPointer.pBits2[pointIndex], m_mxStructPointer.pClassicfication[pointIndex],
+				m_mxStructPointer.pScanAngle_16Bit[pointIndex], bits, classification, scanAngle);
+
+			std::memcpy(pBuffer + bufOffPointStart + 14, &bits, size_uint8);
+			std::memcpy(pBuffer + bufOffPointStart + layout.classification_Byte, &classification, size_uint8);
+			std::memcpy(pBuffer + bufOffPointStart + layout.scanAngle_Byte, &scanAngle, size_int8);
+		}
+
+		std::memcpy(pBuffer + bufOffPointStart + layout.userData_Byte, &m_mxStructPointer.pUserData[pointIndex], size_uint8);
+
+		std::memcpy(pBuffer + bufOffPointStart + layout.pointSourceID_Byte, &m_mxStructPointer.pPointSourceID[pointIndex], size_uint16);
+
+		if (layout.doWriteTime){	
+			std::memcpy(pBuffer + bufOffPointStart + layout.time_Byte,  &m_mxStructPointer.pGPS_Time[pointIndex], size_double); 
+		}
+		
+		if (layout.doWriteColor)
+		{
+			colors[0] = m_mxStructPointer.pRed[pointIndex];
+			colors[1] = m_mxStructPointer.pGreen[pointIndex];
+			colors[2] = m_mxStructPointer.pBlue[pointIndex];
+			memcpy(pBuffer + bufOffPointStart + layout.color_Byte, &colors[0], size_3_uint16);
+		}
+
+		if (layout.doWriteNIR) 
+		{
+			std::memcpy(pBuffer + bufOffPointStart + layout.NIR_Byte, &m_mxStructPointer.pNIR[pointIndex], size_uint16);
+		}
+
+		if (layout.doWriteWavePackets)
+		{
+			std::memcpy(pBuffer + bufOffPointStart + layout.wavePackets_Byte,		&m_mxStructPointer.pWavePacketDescriptor[pointIndex], size_uint8);
+			std::memcpy(pBuffer + bufOffPointStart + layout.wavePackets_Byte + 1,	&m_mxStructPointer.pWaveByteOffset[pointIndex], size_uint64);
+			std::memcpy(pBuffer + bufOffPointStart + layout.wavePackets_Byte + 9,	&m_mxStructPointer.pWavePacketSize[pointIndex], size_uint32);
+			std::memcpy(pBuffer + bufOffPointStart + layout.wavePackets_Byte + 13, &m_mxStructPointer.pWaveReturnPoint[pointIndex], size_float);
+			std::memcpy(pBuffer + bufOffPointStart + layout.wavePackets_Byte + 17, &m_mxStructPointer.pWaveXt[pointIndex], size_float);
+			std::memcpy(pBuffer + bufOffPointStart + layout.wavePackets_Byte + 21, &m_mxStructPointer.pWaveYt[pointIndex], size_float);
+			std::memcpy(pBuffer + bufOffPointStart + layout.wavePackets_Byte + 25, &m_mxStructPointer.pWaveZt[pointIndex], size_float);
+		}
+
+		if (m_containsExtraBytes)
+		{
+			std::memcpy(pBuffer + bufOffPointStart + layout.extradata_Byte, &m_mxStructPointer.pExtraBytes[pointIndex * m_extraByteCount], m_extraByteCount * size_uint8);
+		}
+	}
+}
+
+void LASdataWriter::HeaderStatistics::Merge(const HeaderStatistics& other)
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		minXYZ[axis] = std::min(minXYZ[axis], other.minXYZ[axis]);
+		maxXYZ[axis] = std::max(maxXYZ[axis], other.maxXYZ[axis]);
+	}
+
+	pointCount += other.pointCount;
+	for (int i = 0; i < 15; ++i) { pointsByReturn[i] += other.pointsByReturn[i]; }
+}
+
+void LASdataWriter::quantizePoints(const double* const pCoordinates[3], int32_t* const pQuantized[3], size_t pointCount, size_t pointOffset, const size_t* pPointNumbers) const
+{
+	const double offsets[3] = { m_header.xOffset, m_header.yOffset, m_header.zOffset };
+	const double scales[3]	= { m_header.xScaleFactor, m_header.yScaleFactor, m_header.zScaleFactor };
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const size_t firstInvalid = quantizeCoordinates(pCoordinates[axis], pQuantized[axis], pointCount, offsets[axis], scales[axis]);
+
+		if (firstInvalid != pointCount)
+		{
+			const char axisName[3] = { 'X', 'Y', 'Z' };
+			const size_t pointIndex = nullptr != pPointNumbers ? pPointNumbers[firstInvalid] : pointOffset + firstInvalid;
+			throw std::range_error(std::string(1, axisName[axis]) + " coordinate of point " + std::to_string(pointIndex + 1) +
+				" does not fit into int32 with the given scale factor and offset!");
+		}
+	}
+}
+
+void LASdataWriter::validateQuantization() const
+{
+	const size_t pointCount = static_cast<size_t>(m_numberOfPointsToWrite);
+	const size_t chunkSize = 65536;
+	std::vector<int32_t> quantized(3 * std::min(chunkSize, pointCount));
+
+	for (size_t pointOffset = 0; pointOffset < pointCount; pointOffset += chunkSize)
+	{
+		const size_t pointsInChunk = std::min(chunkSize, pointCount - pointOffset);
+		int32_t* pQuantized[3] = { quantized.data(), quantized.data() + pointsInChunk, quantized.data() + 2 * pointsInChunk };
+		const double* pCoordinates[3] = { m_mxStructPointer.pX + pointOffset, m_mxStructPointer.pY + pointOffset, m_mxStructPointer.pZ + pointOffset };
+
+		quantizePoints(pCoordinates, pQuantized, pointsInChunk, pointOffset, nullptr);
+	}
+}
+
+void LASdataWriter::optimizeQuantization()
+{
+	const double* const pCoordinates[3] = { m_mxStructPointer.pX, m_mxStructPointer.pY, m_mxStructPointer.pZ };
+	const long long count = static_cast<long long>(m_numberOfPointsToWrite);
+	double minimum[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL };
+	double maximum[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+
+	// One pass over the coordinates for the real extent. OpenMP 2.0 (MSVC) has no min/max reductions
+#pragma omp parallel if (count > 16384)
+	{
+		double partialMin[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL };
+		double partialMax[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+
+#pragma omp for schedule(static) nowait
+		for (long long k = 0; k < count; ++k)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const double value = pCoordinates[axis][k];
+				if (value < partialMin[axis]) { partialMin[axis] = value; }
+				if (value > partialMax[axis]) { partialMax[axis] = value; }
+			}
+		}
+
+#pragma omp critical (mergeCoordinateRange)
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			minimum[axis] = std::min(minimum[axis], partialMin[axis]);
+			maximum[axis] = std::max(maximum[axis], partialMax[axis]);
+		}
+	}
+
+	// Without points or with infinite coordinates the header values are kept, the latter fail during quantization
+	double* const pScales[3]  = { &m_header.xScaleFactor, &m_header.yScaleFactor, &m_header.zScaleFactor };
+	double* const pOffsets[3] = { &m_header.xOffset, &m_header.yOffset, &m_header.zOffset };
+	bool isPrecisionKept = true;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (std::isfinite(minimum[axis]) && std::isfinite(maximum[axis])) {
+			isPrecisionKept = decimalQuantization(minimum[axis], maximum[axis], m_options.coordinatePrecision[axis], *pScales[axis], *pOffsets[axis]) && isPrecisionKept;
+		}
+	}
+
+	if (!isPrecisionKept) {
+		mexWarnMsgIdAndTxt("MEX:optimizeQuantization:precision", "Extent of the points is too large for the coordinate precision, coarser scale factors are used!");
+	}
+}
+
+void LASdataWriter::computePointOrder()
+{
+	std::vector<uint64_t> keys;
+	SpatialGrid grid;
+	computeSpatialKeys(m_options.spatialSort, keys, grid);
+
+	std::vector<size_t> indices(keys.size());
+	for (size_t i = 0; i < indices.size(); ++i) { indices[i] = i; }
+
+	radixSortPairs(keys, indices);
+	m_pointOrder.swap(indices);
+}
+
+void LASdataWriter::computeOctreeOrder()
+{
+	std::vector<uint64_t> keys;
+	SpatialGrid grid;
+	computeSpatialKeys(SpatialOrder::Morton, keys, grid);
+
+	std::vector<size_t> indices(keys.size());
+	for (size_t i = 0; i < indices.size(); ++i) { indices[i] = i; }
+
+	radixSortPairs(keys, indices);
+	buildOctree(keys, indices, m_options.lodNodePoints, m_pointOrder, m_octree.nodes);
+
+	// Root cube covers the whole grid. Its cells have the same size along all axes in quantized units
+	const double scale[3]	= { m_header.xScaleFactor, m_header.yScaleFactor, m_header.zScaleFactor };
+	const double offset[3]	= { m_header.xOffset, m_header.yOffset, m_header.zOffset };
+	const double rootEdge	= grid.cellsPerUnit > 0 ? (spatialGridMaxCell + 1.0) / grid.cellsPerUnit : 0;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		m_octree.rootMin[axis]	= grid.minXYZ[axis] * scale[axis] + offset[axis];
+		m_octree.rootSize[axis]	= rootEdge * scale[axis];
+	}
+}
+
+void LASdataWriter::computeSpatialKeys(SpatialOrder order, std::vector<uint64_t>& keys, SpatialGrid& grid)
+{
+	const size_t pointCount = static_cast<size_t>(m_numberOfPointsToWrite);
+	const size_t chunkSize = 65536;
+
+	std::vector<int32_t> quantized(3 * std::min(chunkSize, pointCount));
+	int32_t minXYZ[3] = { INT32_MAX, INT32_MAX, INT32_MAX };
+	int32_t maxXYZ[3] = { INT32_MIN, INT32_MIN, INT32_MIN };
+	keys.resize(pointCount);
+
+	// The first pass finds the bounding box of the quantized coordinates, the second maps them onto the grid of the box
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		if (pass == 1) { grid = SpatialGrid(minXYZ, maxXYZ); }
+
+		for (size_t pointOffset = 0; pointOffset < pointCount; pointOffset += chunkSize)
+		{
+			const size_t pointsInChunk = std::min(chunkSize, pointCount - pointOffset);
+			int32_t* pQuantized[3] = { quantized.data(), quantized.data() + pointsInChunk, quantized.data() + 2 * pointsInChunk };
+			const double* pCoordinates[3] = { m_mxStructPointer.pX + pointOffset, m_mxStructPointer.pY + pointOffset, m_mxStructPointer.pZ + pointOffset };
+
+			quantizePoints(pCoordinates, pQuantized, pointsInChunk, pointOffset, nullptr);
+
+			if (pass == 0)
+			{
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					const std::pair<const int32_t*, const int32_t*> range = std::minmax_element(pQuantized[axis], pQuantized[axis] + pointsInChunk);
+					minXYZ[axis] = std::min(minXYZ[axis], *range.first);
+					maxXYZ[axis] = std::max(maxXYZ[axis], *range.second);
+				}
+				continue;
+			}
+
+			uint64_t* pKeys = keys.data() + pointOffset;
+			const int count = static_cast<int>(pointsInChunk);
+
+#pragma omp parallel for if (count > 16384)
+			for (int k = 0; k < count; ++k)
+			{
+				pKeys[k] = spatialKey(order, grid.Cell(pQuantized[0][k], 0), grid.Cell(pQuantized[1][k], 1), grid.Cell(pQuantized[2][k], 2));
+			}
+		}
+	}
+}
+
+void LASdataWriter::accumulateStatistics(const int32_t* const pQuantized[3], const uint8_t* pBits, size_t pointCount)
+{
+	// Return number is stored in bits 0-2 for point data record format 0-5 and in bits 0-3 for 6-10 (of the source points)
+	const uint8_t returnNumberMask = m_source.isExtended ? 0x0F : 0x07;
+	const long long count = static_cast<long long>(pointCount);
+
+	// Every thread reduces its part of the chunk, then the partial results are merged. Only chunks of asynchronous
+	// and compressed writing (65536 points) are large enough to pay for a parallel region, the 4096 points of a
+	// synchronous chunk are reduced by the encoding thread. OpenMP 2.0 (MSVC) has no min/max reductions
+#pragma omp parallel if (count >= 65536)
+	{
+		HeaderStatistics partial;
+
+#pragma omp for schedule(static) nowait
+		for (long long k = 0; k < count; ++k)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const int32_t value = pQuantized[axis][k];
+				if (value < partial.minXYZ[axis]) { partial.minXYZ[axis] = value; }
+				if (value > partial.maxXYZ[axis]) { partial.maxXYZ[axis] = value; }
+			}
+
+			// Return number 0 is invalid and not counted
+			const int returnNumber = pBits[k] & returnNumberMask;
+			if (returnNumber > 0) { ++partial.pointsByReturn[returnNumber - 1]; }
+		}
+
+#pragma omp critical (mergeHeaderStatistics)
+		m_statistics.Merge(partial);
+	}
+
+	m_statistics.pointCount += pointCount;
+}
+
+void LASdataWriter::GetOptions(const mxArray* pOptions)
+{
+	if (nullptr == pOptions) {
+		return;
+	}
+
+	if (!mxIsStruct(pOptions)) {
+		mexErrMsgIdAndTxt("MEX:GetOptions:typeargin", "Writer options have to be a struct!");
+	}
+
+	mxArray* pField = mxGetField(pOptions, 0, "asyncWrite");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.asyncWrite = mxGetScalar(pField) != 0;
+	}
+
+	pField = mxGetField(pOptions, 0, "preallocateFile");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.preallocateFile = mxGetScalar(pField) != 0;
+	}
+
+	pField = mxGetField(pOptions, 0, "computeHeaderStats");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.computeHeaderStats = mxGetScalar(pField) != 0;
+	}
+
+	pField = mxGetField(pOptions, 0, "append");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.append = mxGetScalar(pField) != 0;
+	}
+
+	pField = mxGetField(pOptions, 0, "targetPointFormat");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.targetPointFormat = static_cast<int>(mxGetScalar(pField));
+	}
+
+	pField = mxGetField(pOptions, 0, "targetVersionMinor");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.targetVersionMinor = static_cast<int>(mxGetScalar(pField));
+	}
+
+	pField = mxGetField(pOptions, 0, "spatialSort");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.spatialSort = getSpatialOrder(pField);
+	}
+
+	// One precision for all axes or one per axis. The header is rewritten with the new quantization and the real extent
+	pField = mxGetField(pOptions, 0, "coordinatePrecision");
+	if (nullptr != pField && !mxIsEmpty(pField))
+	{
+		const size_t count = mxGetNumberOfElements(pField);
+
+		if (!mxIsDouble(pField) || (count != 1 && count != 3)) {
+			mexErrMsgIdAndTxt("MEX:GetOptions:coordinatePrecision", "Coordinate precision has to be a double scalar or a vector of three values!");
+		}
+
+		const double* pPrecision = GetDoubles(pField);
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			m_options.coordinatePrecision[axis] = pPrecision[count == 3 ? axis : 0];
+
+			if (!(m_options.coordinatePrecision[axis] > 0) || !std::isfinite(m_options.coordinatePrecision[axis])) {
+				mexErrMsgIdAndTxt("MEX:GetOptions:coordinatePrecision", "Coordinate precision has to be positive and finite!");
+			}
+		}
+
+		m_options.useCoordinatePrecision = true;
+		m_options.computeHeaderStats = true;
+	}
+
+	if (m_options.useCoordinatePrecision && m_options.append) {
+		mexErrMsgIdAndTxt("MEX:GetOptions:coordinatePrecision", "Coordinate precision can not be used when appending, scale factors and offsets of the file are kept!");
+	}
+
+	pField = mxGetField(pOptions, 0, "lodOctree");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.lodOctree = mxGetScalar(pField) != 0;
+	}
+
+	pField = mxGetField(pOptions, 0, "lodNodePoints");
+	if (nullptr != pField && !mxIsEmpty(pField))
+	{
+		const double nodePoints = mxGetScalar(pField);
+
+		if (!(nodePoints >= 1) || !std::isfinite(nodePoints)) {
+			mexErrMsgIdAndTxt("MEX:GetOptions:lodNodePoints", "Points per octree node have to be a positive number!");
+		}
+
+		m_options.lodNodePoints = static_cast<size_t>(nodePoints);
+	}
+
+	// The octree defines the point order and its hierarchy is an extended VLR, which needs LAS 1.4
+	if (m_options.lodOctree)
+	{
+		if (m_options.append || m_options.spatialSort != SpatialOrder::None) {
+			mexErrMsgIdAndTxt("MEX:GetOptions:lodOctree", "Level of detail octree can not be combined with append or spatialSort!");
+		}
+		if (m_options.targetVersionMinor >= 0 && m_options.targetVersionMinor < 4) {
+			mexErrMsgIdAndTxt("MEX:GetOptions:lodOctree", "Level of detail octree needs LAS 1.4 for its extended VLR!");
+		}
+
+		m_options.targetVersionMinor = 4;
+		m_options.computeHeaderStats = true;
+	}
+
+	pField = mxGetField(pOptions, 0, "compress");
+	if (nullptr != pField && !mxIsEmpty(pField)) {
+		m_options.compress = mxGetScalar(pField) != 0;
+	}
+
+	if (m_options.compress)
+	{
+#ifndef LAS_WITH_LASZIP
+		mexErrMsgIdAndTxt("MEX:GetOptions:compress", "Compressed output requires writeLASfile_cpp to be compiled with LASzip (see build_writeLASfile.m)!");
+#endif
+		if (m_options.append) {
+			mexErrMsgIdAndTxt("MEX:GetOptions:compress", "Points can not be appended to a compressed file!");
+		}
+	}
+}
+
+bool LASdataWriter::DoAppend() const
+{
+	return m_options.append;
+}
+
+bool LASdataWriter::DoCompress() const
+{
+	return m_options.compress;
+}
+
+bool LASdataWriter::DoSpatialSort() const
+{
+	return m_options.spatialSort != SpatialOrder::None;
+}
+
+bool LASdataWriter::DoCoordinatePrecision() const
+{
+	return m_options.useCoordinatePrecision;
+}
+
+bool LASdataWriter::DoLODOctree() const
+{
+	return m_options.lodOctree;
+}
+
+void LASdataWriter::PrepareAppend(const char* filePath, const mxArray* lasStructure)
+{
+	// The points to write are counted by their coordinates, the header of the structure may be outdated
+	const mxArray* pX = mxGetField(lasStructure, 0, "x");
+
+	if (nullptr == pX) {
+		mexErrMsgIdAndTxt("MEX:PrepareAppend:typeargin", "LAS structure to append has no field x!");
+	}
+
+	m_numberOfPointsToWrite = mxGetNumberOfElements(pX);
+
+	std::fstream lasFile(filePath, std::ios::in | std::ios::out | std::ios::binary);
+
+	if (!lasFile.is_open()) {
+		mexErrMsgIdAndTxt("MEX:PrepareAppend:fileNotFound", "LAS-File to append to could not be opened!");
+	}
+
+	// Read and parse header of the existing file. Files with a short header and no points are smaller than the buffer
+	char headerBuf[375] = {};
+	lasFile.read(headerBuf, 375);
+	lasFile.clear();
+
+	LASheader fileHeader;
+	LASheaderExt3 fileHeaderExt3;
+	LASheaderExt4 fileHeaderExt4;
+	parseLASheader(headerBuf, fileHeader, fileHeaderExt3, fileHeaderExt4);
+
+	lasFile.seekg(0, std::ios::end);
+	const unsigned long long fileSize = static_cast<unsigned long long>(lasFile.tellg());
+
+	const unsigned short standardHeaderSize = fileHeader.versionMinor < 3 ? 227 : (fileHeader.versionMinor < 4 ? 235 : 375);
+	const unsigned long long existingPointCount = fileHeader.versionMinor > 3 ? fileHeaderExt4.numberOfPointRecords : fileHeader.LegacyNumberOfPointRecords;
+	const unsigned long long endOfPointData = fileHeader.offsetToPointData + existingPointCount * fileHeader.PointDataRecordLength;
+
+	// Check compatibility before anything in the file is changed
+	const char* errorMessage = nullptr;
+
+	if (std::strncmp(fileHeader.fileSignature, "LASF", 4) != 0 || fileHeader.versionMajor != 1) {
+		errorMessage = "File to append to is not a valid LAS-File!";
+	}
+	else if (fileHeader.headerSize != standardHeaderSize) {
+		errorMessage = "Appending to files with user defined bytes after the header is not supported!";
+	}
+	else if (fileHeader.PointDataRecordFormat != m_header.PointDataRecordFormat || fileHeader.PointDataRecordLength != m_header.PointDataRecordLength) {
+		errorMessage = "Point data record format and record length have to match the file to append to!";
+	}
+	else if (fileHeader.xScaleFactor != m_header.xScaleFactor || fileHeader.yScaleFactor != m_header.yScaleFactor || fileHeader.zScaleFactor != m_header.zScaleFactor ||
+			 fileHeader.xOffset != m_header.xOffset || fileHeader.yOffset != m_header.yOffset || fileHeader.zOffset != m_header.zOffset) {
+		errorMessage = "Scale factors and offsets have to match the file to append to!";
+	}
+	else if (fileHeader.versionMinor < 4 && existingPointCount + m_numberOfPointsToWrite > ULONG_MAX) {
+		errorMessage = "Point count after appending exceeds the maximum of LAS versions before 1.4!";
+	}
+	else if (fileSize < endOfPointData) {
+		errorMessage = "File to append to is shorter than its point data according to header!";
+	}
+
+	if (nullptr != errorMessage)
+	{
+		lasFile.close();
+		mexErrMsgIdAndTxt("MEX:PrepareAppend:incompatibleFile", errorMessage);
+	}
+
+	// Fields and coordinates are checked before anything in the file is changed. Quantization uses the scale
+	// factors and offsets of the structure, which are the same as those of the file
+	setContentFlags();
+	isChunkSizeValid(lasStructure);
+	GetData(lasStructure);
+	isDataValid();
+
+	try {
+		validateQuantization();
+	}
+	catch (...) {
+		lasFile.close();
+		throw;
+	}
+
+	// Move everything after the point records (waveform data, extended VLRs) back by the size of the new points.
+	// Chunks are copied starting at the end of the file so that nothing is overwritten before it was moved
+	const unsigned long long shift = m_numberOfPointsToWrite * fileHeader.PointDataRecordLength;
+	const size_t moveBufferSize = 1 << 20;
+
+	if (fileSize > endOfPointData && shift > 0)
+	{
+		std::unique_ptr<char[]> moveBuffer(new char[moveBufferSize]);
+		unsigned long long chunkEnd = fileSize;
+
+		while (chunkEnd > endOfPointData)
+		{
+			const size_t chunkSize = static_cast<size_t>(std::min(static_cast<unsigned long long>(moveBufferSize), chunkEnd - endOfPointData));
+			const unsigned long long chunkStart = chunkEnd - chunkSize;
+
+			lasFile.seekg(chunkStart, std::ios::beg);
+			lasFile.read(moveBuffer.get(), chunkSize);
+			lasFile.seekp(chunkStart + shift, std::ios::beg);
+			lasFile.write(moveBuffer.get(), chunkSize);
+
+			chunkEnd = chunkStart;
+		}
+
+		if (fileHeader.versionMinor > 2 && fileHeaderExt3.startOfWaveFormData >= endOfPointData) {
+			fileHeaderExt3.startOfWaveFormData += shift;
+		}
+
+		if (fileHeader.versionMinor > 3 && fileHeaderExt4.numberOfExtendedVariableLengthRecords > 0 && fileHeaderExt4.startOfFirstExtendedVariableLengthRecord >= endOfPointData) {
+			fileHeaderExt4.startOfFirstExtendedVariableLengthRecord += shift;
+		}
+	}
+
+	const bool moveFailed = lasFile.fail();
+	lasFile.close();
+
+	if (moveFailed) {
+		mexErrMsgIdAndTxt("MEX:PrepareAppend:ioError", "Data after the point records could not be moved!");
+	}
+
+	// Statistics of the existing points. Bounding box is converted back to the quantized coordinates
+	m_existingStatistics = HeaderStatistics();
+	m_existingStatistics.pointCount = existingPointCount;
+
+	if (existingPointCount > 0)
+	{
+		const double minimums[3] = { fileHeader.minX, fileHeader.minY, fileHeader.minZ };
+		const double maximums[3] = { fileHeader.maxX, fileHeader.maxY, fileHeader.maxZ };
+		const double offsets[3]  = { fileHeader.xOffset, fileHeader.yOffset, fileHeader.zOffset };
+		const double scales[3]	 = { fileHeader.xScaleFactor, fileHeader.yScaleFactor, fileHeader.zScaleFactor };
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			m_existingStatistics.minXYZ[axis] = static_cast<int32_t>(std::max(static_cast<double>(INT32_MIN), std::round((minimums[axis] - offsets[axis]) / scales[axis])));
+			m_existingStatistics.maxXYZ[axis] = static_cast<int32_t>(std::min(static_cast<double>(INT32_MAX), std::round((maximums[axis] - offsets[axis]) / scales[axis])));
+		}
+	}
+
+	if (fileHeader.versionMinor > 3) {
+		for (int i = 0; i < 15; ++i) { m_existingStatistics.pointsByReturn[i] = fileHeaderExt4.numberOfPointsByReturn[i]; }
+	}
+	else {
+		for (int i = 0; i < 5; ++i) { m_existingStatistics.pointsByReturn[i] = fileHeader.LegacyNumberOfPointByReturn[i]; }
+	}
+
+	// The header of the existing file is kept and only its counts, bounding box and offsets are updated after writing
+	m_header		= fileHeader;
+	m_headerExt3	= fileHeaderExt3;
+	m_headerExt4	= fileHeaderExt4;
+	m_appendOffset	= endOfPointData;
+	m_options.computeHeaderStats = true;
+}
+
+bool LASdataWriter::DoPreallocateFile() const
+{
+	return m_options.preallocateFile;
+}
+
+unsigned long long LASdataWriter::GetExpectedFileSize(const mxArray* lasStructure) const
+{
+	unsigned long long fileSize = static_cast<unsigned long long>(m_header.offsetToPointData)
+		+ m_numberOfPointsToWrite * static_cast<unsigned long long>(m_header.PointDataRecordLength);
+
+	// Extended VLRs are appended after the point data
+	mxArray* pExtVLRfield = mxGetField(lasStructure, 0, "extendedvariables");
+
+	if (nullptr != pExtVLRfield && HasExtVLR())
+	{
+		for (size_t i = 0; i < m_headerExt4.numberOfExtendedVariableLengthRecords; ++i)
+		{
+			mxArray* pRecordLength = mxGetField(pExtVLRfield, i, "record_length");
+			fileSize += 60;
+
+			if (nullptr != pRecordLength) {
+				fileSize += static_cast<unsigned long long>(mxGetScalar(pRecordLength));
+			}
+		}
+	}
+
+	return fileSize;
+}
+
+bool LASdataWriter::PreallocateFile(const char* filePath, unsigned long long fileSize)
+{
+#if defined(_WIN32)
+	HANDLE hFile = CreateFileA(filePath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) { return false; }
+
+	// Moving the end of file reserves the clusters without writing them
+	LARGE_INTEGER size;
+	size.QuadPart = static_cast<LONGLONG>(fileSize);
+	bool success = SetFilePointerEx(hFile, size, NULL, FILE_BEGIN) && SetEndOfFile(hFile);
+
+	CloseHandle(hFile);
+	return success;
+#else
+	int fileDescriptor = open(filePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fileDescriptor < 0) { return false; }
+
+	bool success = false;
+#if defined(__APPLE__)
+	success = ftruncate(fileDescriptor, static_cast<off_t>(fileSize)) == 0;
+#else
+	// posix_fallocate allocates the blocks, fall back to a sparse file if the file system does not support it
+	success = posix_fallocate(fileDescriptor, 0, static_cast<off_t>(fileSize)) == 0;
+	if (!success) {
+		success = ftruncate(fileDescriptor, static_cast<off_t>(fileSize)) == 0;
+	}
+#endif
+	close(fileDescriptor);
+	return success;
+#endif
+}
+
+bool LASdataWriter::TruncateFile(const char* filePath, unsigned long long fileSize)
+{
+#if defined(_WIN32)
+	HANDLE hFile = CreateFileA(filePath, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) { return false; }
+
+	LARGE_INTEGER size;
+	size.QuadPart = static_cast<LONGLONG>(fileSize);
+	bool success = SetFilePointerEx(hFile, size, NULL, FILE_BEGIN) && SetEndOfFile(hFile);
+
+	CloseHandle(hFile);
+	return success;
+#else
+	return truncate(filePath, static_cast<off_t>(fileSize)) == 0;
+#endif
+}
+
+void LASdataWriter::GetHeader(const mxArray* prhs)
+{
+	mxDouble* pMXDouble;
+	mxChar* pMXChar;
+
+	mxArray* pMxHeader = mxGetField(prhs, 0, "header");
+	m_mxStructPointer.pMXheader = pMxHeader;
+
+	if (nullptr == pMxHeader) {
+		mexErrMsgIdAndTxt("MEX:GetHeader:nullptr", "Could not access header field of LAS structure!");
+	}
+
+	m_header.sourceID		  = static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "source_id")));
+	m_header.globalEncoding   = static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "global_encoding")));
+	m_header.projectID_GUID_1 = static_cast<unsigned long>(*GetDoubles(mxGetField(pMxHeader, 0, "project_id_guid1")));
+	m_header.projectID_GUID_2 = static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "project_id_guid2")));
+	m_header.projectID_GUID_3 = static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "project_id_guid3")));
+
+	pMXDouble = GetDoubles(mxGetField(pMxHeader, 0, "project_id_guid4"));
+	for (int i = 0; i < 8; ++i) { m_header.projectID_GUID_4[i] = static_cast<uint8_t>(pMXDouble[i]); }
+
+	m_header.versionMajor = static_cast<unsigned char>(*GetDoubles(mxGetField(pMxHeader, 0, "version_major")));
+	m_header.versionMinor = static_cast<unsigned char>(*GetDoubles(mxGetField(pMxHeader, 0, "version_minor")));
+
+	m_header.fileCreationDayOfYear			= static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "file_creation_day_of_year")));
+	m_header.fileCreationYear				= static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "file_creation_year")));
+	m_header.headerSize						= static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "header_size")));
+	m_header.offsetToPointData				= static_cast<unsigned long>(*GetDoubles(mxGetField(pMxHeader, 0, "offset_to_point_data")));
+	m_header.numberOfVariableLengthRecords	= static_cast<unsigned long>(*GetDoubles(mxGetField(pMxHeader, 0, "number_of_variable_records")));
+	m_header.LegacyNumberOfPointRecords		= 0;
+
+	m_header.PointDataRecordFormat = static_cast<unsigned char>(*GetDoubles(mxGetField(pMxHeader, 0, "point_data_format")));
+	m_header.PointDataRecordLength = static_cast<unsigned short>(*GetDoubles(mxGetField(pMxHeader, 0, "point_data_record_length")));
+	m_header.xScaleFactor = *GetDoubles(mxGetField(pMxHeader, 0, "scale_factor_x"));
+	m_header.yScaleFactor = *GetDoubles(mxGetField(pMxHeader, 0, "scale_factor_y"));
+	m_header.zScaleFactor = *GetDoubles(mxGetField(pMxHeader, 0, "scale_factor_z"));
+	m_header.xOffset = *GetDoubles(mxGetField(pMxHeader, 0, "x_offset"));
+	m_header.yOffset = *GetDoubles(mxGetField(pMxHeader, 0, "y_offset"));
+	m_header.zOffset = *GetDoubles(mxGetField(pMxHeader, 0, "z_offset"));
+	m_header.maxX = *GetDoubles(mxGetField(pMxHeader, 0, "max_x"));
+	m_header.minX = *GetDoubles(mxGetField(pMxHeader, 0, "min_x"));
+	m_header.maxY = *GetDoubles(mxGetField(pMxHeader, 0, "max_y"));
+	m_header.minY = *GetDoubles(mxGetField(pMxHeader, 0, "min_y"));
+	m_header.maxZ = *GetDoubles(mxGetField(pMxHeader, 0, "max_z"));
+	m_header.minZ = *GetDoubles(mxGetField(pMxHeader, 0, "min_z"));
+
+	// Get number of point records
+	m_numberOfPointsToWrite = static_cast<unsigned long long>(*GetDoubles(mxGetField(pMxHeader, 0, "number_of_point_records")));
+
+	if (m_numberOfPointsToWrite < ULONG_MAX) // max is 4294967296
+	{
+		m_header.LegacyNumberOfPointRecords = static_cast<unsigned long>(m_numberOfPointsToWrite);
+	}
+
+	// Get version exclusive features
+	if (m_header.versionMajor == 1 && m_header.versionMinor < 4)
+	{
+		pMXDouble = GetDoubles(mxGetField(pMxHeader, 0, "number_of_points_by_return"));
+		for (int i = 0; i < 5; ++i) { m_header.LegacyNumberOfPointByReturn[i] = static_cast<unsigned long>(pMXDouble[i]); }
+	}
+
+	if (m_header.versionMajor == 1 && m_header.versionMinor > 2)
+	{
+		m_headerExt3.startOfWaveFormData = static_cast<unsigned long long>(*GetDoubles(mxGetField(pMxHeader, 0, "start_of_waveform_data")));
+	}
+
+	if (m_header.versionMajor == 1 && m_header.versionMinor > 3)
+	{
+		m_headerExt4.numberOfPointRecords = m_numberOfPointsToWrite;
+		m_headerExt4.startOfFirstExtendedVariableLengthRecord	= static_cast<unsigned long long>(*GetDoubles(mxGetField(pMxHeader, 0, "start_of_extended_variable_length_record")));
+		m_headerExt4.numberOfExtendedVariableLengthRecords		= static_cast<unsigned long>(*GetDoubles(mxGetField(pMxHeader, 0, "number_of_extended_variable_length_record")));
+
+		pMXDouble = GetDoubles(mxGetField(pMxHeader, 0, "number_of_points_by_return"));
+		for (int i = 0; i < 15; ++i) { m_headerExt4.numberOfPointsByReturn[i] = static_cast<unsigned long long>(pMXDouble[i]); }
+	}
+
+	// Copy system identifier and generating software char by char until null character or end of array is reached
+	pMXChar = GetChars(mxGetField(pMxHeader, 0, "system_identifier"));
+	copyMXCharToArray(&m_header.systemIdentifier[0], pMXChar, 32);
+
+	pMXChar = GetChars(mxGetField(pMxHeader, 0, "generating_software"));
+	copyMXCharToArray(&m_header.generatingSoftware[0], pMXChar, 32);
+
+	// Points of the matlab structure keep their format, the header describes the file that is written
+	m_sourcePointDataRecordFormat = m_header.PointDataRecordFormat;
+	setSourceFields();
+	convertHeaderToTarget();
+
+	// The octree hierarchy is written after the extended VLRs of the structure and replaces an outdated hierarchy among them
+	m_structureExtVLRCount = m_headerExt4.numberOfExtendedVariableLengthRecords;
+
+	if (m_options.lodOctree)
+	{
+		mxArray* pExtVLRfield = mxGetField(prhs, 0, "extendedvariables");
+		unsigned long keptRecordCount = 0;
+
+		for (size_t i = 0; i < m_structureExtVLRCount && nullptr != pExtVLRfield; ++i)
+		{
+			getExtVLRHeader(pExtVLRfield, i);
+			if (!isOctreeHierarchy(m_ExtVLRHeader.userID, m_ExtVLRHeader.recordID)) { ++keptRecordCount; }
+		}
+
+		m_headerExt4.numberOfExtendedVariableLengthRecords = keptRecordCount + 1;
+	}
 }
 
 void LASdataWriter::GetData(const mxArray* prhs) {
@@ -382,7 +1688,7 @@ void LASdataWriter::GetData(const mxArray* prhs) {
 	m_mxStructPointer.pIntensity = GetUint16(mxGetField(prhs, 0, "intensity"));
 	m_mxStructPointer.pBits		 = GetUint8(mxGetField(prhs, 0, "bits"));
 
-	if (m_header.PointDataRecordFormat > 5)
+	if (m_source.isExtended)
 	{
 		m_mxStructPointer.pBits2 = GetUint8(mxGetField(prhs, 0, "bits2"));
 	}
@@ -391,7 +1697,7 @@ void LASdataWriter::GetData(const mxArray* prhs) {
 	m_mxStructPointer.pUserData			= GetUint8(mxGetField(prhs, 0, "user_data"));
 
 
-	if (m_header.PointDataRecordFormat < 6)
+	if (!m_source.isExtended)
 	{
 		m_mxStructPointer.pScanAngle = GetInt8(mxGetField(prhs, 0, "scan_angle"));
 	}
@@ -402,18 +1708,18 @@ void LASdataWriter::GetData(const mxArray* prhs) {
 
 	m_mxStructPointer.pPointSourceID = GetUint16(mxGetField(prhs, 0, "point_source_id"));
 
-	if (m_containsTime) {
+	if (m_source.hasTime) {
 		m_mxStructPointer.pGPS_Time = GetDoubles(mxGetField(prhs, 0, "gps_time"));
 	}
 
-	if (m_containsColors)
+	if (m_source.hasColors)
 	{
 		m_mxStructPointer.pRed		= GetUint16(mxGetField(prhs, 0, "red"));
 		m_mxStructPointer.pGreen	= GetUint16(mxGetField(prhs, 0, "green"));
 		m_mxStructPointer.pBlue		= GetUint16(mxGetField(prhs, 0, "blue"));
 	}
 
-	if (m_containsWavepackets)
+	if (m_source.hasWavePackets)
 	{
 		m_mxStructPointer.pWavePacketDescriptor = GetUint8(mxGetField(prhs, 0, "wave_packet_descriptor"));
 		m_mxStructPointer.pWaveByteOffset		= GetUint64(mxGetField(prhs, 0, "wave_byte_offset"));
@@ -424,7 +1730,7 @@ void LASdataWriter::GetData(const mxArray* prhs) {
 		m_mxStructPointer.pWaveZt = GetSingles(mxGetField(prhs, 0, "Zt"));
 	}
 
-	if (m_containsNIR)
+	if (m_source.hasNIR)
 	{
 		m_mxStructPointer.pNIR = GetUint16(mxGetField(prhs, 0, "nir"));
 	}
@@ -452,7 +1758,7 @@ void LASdataWriter::isDataValid() const
 	if (nullptr == m_mxStructPointer.pBits) {
 		mexErrMsgIdAndTxt("MEX:LASWriter:isDataValid", "Pointer to Bitfield invalid!");
 	}
-	if (m_header.PointDataRecordFormat > 5)
+	if (m_source.isExtended)
 	{
 		if (nullptr == m_mxStructPointer.pBits2) {
 			mexErrMsgIdAndTxt("MEX:LASWriter:isDataValid", "Pointer to second Bitfield invalid!");
@@ -464,7 +1770,7 @@ void LASdataWriter::isDataValid() const
 	if (nullptr == m_mxStructPointer.pUserData) {
 		mexErrMsgIdAndTxt("MEX:LASWriter:isDataValid", "Pointer to User Data invalid!");
 	}
-	if (m_header.PointDataRecordFormat < 6)
+	if (!m_source.isExtended)
 	{
 		if (nullptr == m_mxStructPointer.pScanAngle) {
 			mexErrMsgIdAndTxt("MEX:LASWriter:isDataValid", "Pointer to 8bit Scan Angle invalid!");
@@ -479,12 +1785,12 @@ void LASdataWriter::isDataValid() const
 	if (nullptr == m_mxStructPointer.pPointSourceID) {
 		mexErrMsgIdAndTxt("MEX:LASWriter:isDataValid", "Pointer to Point Source ID invalid!");
 	}
-	if (m_containsTime) {
+	if (m_source.hasTime) {
 		if (nullptr == m_mxStructPointer.pGPS_Time) {
 			mexErrMsgIdAndTxt("MEX:LASWriter:isDataValid", "Pointer to GPS Time invalid!");
 		}
 	}
-	if (m_containsColors)
+	if (m_source.hasColors)
 	{
 		if (nullptr == m_mxStructPointer.pRed) {
 			mexErrMsgIdAndTxt("MEX:LASWriter:isDataValid", "Pointer to Red Channel invalid!");
@@ -496,7 +1802,7 @@ void LASdataWriter::isDataValid() const
 			mexErrMsgIdAndTxt("MEX:LASWriter:isDataValid", "Pointer to Blue Channel invalid!");
 		}
 	}
-	if (m_containsWavepackets)
+	if (m_source.hasWavePackets)
 	{
 		if (nullptr == m_mxStructPointer.pWavePacketDescriptor) {
 			mexErrMsgIdAndTxt("MEX:LASWriter:isDataValid", "Pointer to Wave Packet Descriptor invalid!");
@@ -520,7 +1826,7 @@ void LASdataWriter::isDataValid() const
 			mexErrMsgIdAndTxt("MEX:LASWriter:isDataValid", "Pointer to Parametric dZ invalid!");
 		}
 	}
-	if (m_containsNIR)
+	if (m_source.hasNIR)
 	{
 		if (nullptr == m_mxStructPointer.pNIR) {
 			mexErrMsgIdAndTxt("MEX:LASWriter:isDataValid", "Pointer to Near Infrared Channel invalid!");
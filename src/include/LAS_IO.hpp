@@ -7,9 +7,24 @@
 
 #include "mex.h"
 #include <array>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "SpatialSort.hpp"
+#include "LevelOfDetail.hpp"
 
-// Ths is the header fle for base class LAS_IO and derived classes LASDataReader and LASDataWriter
+// Polygon filter of the transcoder, defined in PointInPolygon.hpp
+template<typename T> struct PolygonEdgeIndex;
+
+// Raster of the transcoder, defined in Rasterizer.hpp
+class PointRaster;
+
+// Ths is the header fle for base class LAS_IO and derived classes LASDataReader, LASDataWriter and LASdataTranscoder
 // Info: private and protected methods start with lower case letter. Publc methods start with upper case letter.
 
 // Check if datatype sizes are LAS conform during compilation. 
@@ -181,6 +196,16 @@ protected:
 	// Set Flags for colors, time, wave packets, NIR, VLR and extrabytes
 	inline void setContentFlags();
 
+	// Parse the first 375 bytes of a LAS-File into the header struct and its extensions
+	static inline void parseLASheader(const char* pHeaderBuf, LASheader& header, LASheaderExt3& headerExt3, LASheaderExt4& headerExt4);
+
+	// Parse the name of a space filling curve ('none', 'morton' or 'hilbert') from a matlab char array (Throws Matlab Error if invalid)
+	static inline SpatialOrder getSpatialOrder(const mxArray* pField);
+
+	// Replace bounding box, point counts and points by return of m_header and m_headerExt4 with the statistics of the
+	// written points. Legacy counts are 0 if they do not fit into 32 bit or the point data record format is 6-10
+	inline void applyHeaderStatistics(const int32_t minXYZ[3], const int32_t maxXYZ[3], unsigned long long pointCount, const unsigned long long pointsByReturn[15]);
+
 public:
 	/// <summary>
 	/// Returns true if LAS-File has variable length records and false if not
@@ -213,6 +238,12 @@ private:
 	//Flag for reading of XYZ and intensity only, if specified by user, point data record format is not supported or point data record length is smaller than specification for pdrf
 	bool m_XYZIntOnly = false;
 
+	// Ranges of point records (first point, point count) that are read. Empty if all points are read
+	std::vector<std::pair<uint64_t, uint64_t>> m_readRanges;
+
+	// Read pointCount point records starting at record firstPoint into the output struct, advancing its data pointers
+	void readPointRange(std::ifstream& lasBin, char* buffer, size_t bufferSize, uint_fast64_t firstPoint, uint_fast64_t pointCount);
+
 	// Reads one Variable Length Record Header from file to class member m_VLRHeader. The ifstream position has to point to the beginning of a variable length record header!
 	void readVLRHeader(std::ifstream& lasBin);
 
@@ -240,6 +271,10 @@ public:
 	// Read Point Data from LAS-File stream using header information and write them to output struct
 	void ReadPointData(std::ifstream& lasBin);
 
+	// Restrict reading to the nodes of the level of detail octree, that the options select by bounding box and maximum
+	// depth. Has to be called before the output structure is allocated (Throws Matlab Error if the file has no octree)
+	void SelectOctreeNodes(std::ifstream& lasBin, const mxArray* pOptions);
+
 	// Checks header consistency. 
 	// The file stream is used to determine the file size and how many bytes could be reserved for points.
 	// If an header error is not too severe then return headerGood = false. 
@@ -316,6 +351,137 @@ private:
 	// Record lengths of Point Data Formats according to specifications
 	const size_t m_record_lengths_size = m_record_lengths.size();
 
+	// Optional writer settings from the options struct of the caller
+	struct WriterOptions
+	{
+		bool asyncWrite		 = false;	// Encode next chunk while a background thread writes the previous one
+		bool preallocateFile = false;	// Reserve the final file size on disk before writing
+		bool computeHeaderStats = false; // Compute bounding box and point counts while encoding and correct the header
+		bool append			 = false;	// Append the points to the point data of an existing LAS-File
+		int  targetPointFormat	= -1;	// Point data record format the points are converted to while encoding (-1 keeps the format)
+		int  targetVersionMinor	= -1;	// Version minor of the written file (-1 keeps the version)
+		SpatialOrder spatialSort = SpatialOrder::None;	// Write the points in the order of a space filling curve
+		bool   useCoordinatePrecision = false;			// Choose scale factors and offsets from the extent of the points
+		double coordinatePrecision[3] = { 0, 0, 0 };	// Largest scale factor per axis that is accepted
+		bool   compress = false;						// Write a LASzip compressed file (LAZ) instead of raw point records
+		bool   lodOctree = false;						// Write the points node by node of a level of detail octree with hierarchy EVLR
+		size_t lodNodePoints = 16384;					// Nodes with more points keep a sample and hand the rest down to their children
+	} m_options;
+
+	// Point data record format of the matlab structure. Differs from the written format if the points are converted
+	unsigned char m_sourcePointDataRecordFormat = 0;
+
+	// Fields the matlab structure provides according to its point data record format
+	struct SourceFields
+	{
+		bool hasTime			= false;
+		bool hasColors			= false;
+		bool hasNIR				= false;
+		bool hasWavePackets		= false;
+		bool isExtended			= false;	// Second bit field and 16 bit scan angle of point data record format 6-10
+	} m_source;
+
+	// Byte offsets and flags of the point data record that is written
+	struct RecordLayout
+	{
+		int  recordLength			= 0;
+		int  extradata_Byte			= 0;
+		int  bits2_Byte				= 0;
+		int  classification_Byte	= 0;
+		int  scanAngle_Byte			= 0;
+		int  userData_Byte			= 0;
+		int  pointSourceID_Byte		= 0;
+		int  time_Byte				= 0;
+		int  color_Byte				= 0;
+		int  NIR_Byte				= 0;
+		int  wavePackets_Byte		= 0;
+		bool doWriteBits2			= false;
+		bool doWriteTime			= false;
+		bool doWriteColor			= false;
+		bool doWriteNIR				= false;
+		bool doWriteWavePackets		= false;
+		bool isScanAngle16Bit		= false;
+		bool isSourceExtended		= false;	// Source points have the bit fields and scan angle of format 6-10
+	} m_layout;
+
+	// Quantized X, Y and Z values of the chunk that is currently encoded
+	std::vector<int32_t> m_quantizedXYZ;
+
+	// Indices of the points in the order they are written (empty if the points are written in their original order)
+	std::vector<size_t> m_pointOrder;
+
+	// Level of detail octree of the written points, written as hierarchy EVLR after the extended VLRs of the matlab structure
+	OctreeHierarchy m_octree;
+
+	// Number of extended VLRs in the matlab structure (the hierarchy EVLR of the octree is not part of it)
+	size_t m_structureExtVLRCount = 0;
+
+	// Coordinates and bit fields of the chunk that is currently encoded, gathered in the order of m_pointOrder
+	std::vector<double>  m_orderedXYZ;
+	std::vector<uint8_t> m_orderedBits;
+
+	// Bounding box of the quantized coordinates and point counts of the written points
+	struct HeaderStatistics
+	{
+		int32_t				minXYZ[3] = { INT32_MAX, INT32_MAX, INT32_MAX };
+		int32_t				maxXYZ[3] = { INT32_MIN, INT32_MIN, INT32_MIN };
+		unsigned long long	pointCount = 0;
+		unsigned long long	pointsByReturn[15] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+		// Combine with the statistics of another set of points
+		void Merge(const HeaderStatistics& other);
+	} m_statistics;
+
+	// Statistics of the points that are already in the file when appending
+	HeaderStatistics m_existingStatistics;
+
+	// File position after the existing point records at which appended points are written (0 if not appending)
+	unsigned long long m_appendOffset = 0;
+
+	// Add the quantized coordinates and return numbers (from the bit fields pBits) of pointCount points to m_statistics
+	void accumulateStatistics(const int32_t* const pQuantized[3], const uint8_t* pBits, size_t pointCount);
+
+	// Quantize pointCount coordinates of each axis. pointNumbers maps to the point numbers used in error messages
+	// (nullptr if the coordinates start at point index pointOffset)
+	void quantizePoints(const double* const pCoordinates[3], int32_t* const pQuantized[3], size_t pointCount, size_t pointOffset, const size_t* pPointNumbers) const;
+
+	// Quantize all coordinates once without encoding them (Throws std::range_error if a coordinate does not fit)
+	void validateQuantization() const;
+
+	// Set scale factors and offsets of m_header from the extent of the points and the coordinate precision of the options
+	void optimizeQuantization();
+
+	// Sort the points along the space filling curve of the options by the grid cells of their quantized coordinates
+	// and store the permutation in m_pointOrder
+	void computePointOrder();
+
+	// Keys of the points along the space filling curve order and the grid of the bounding box of their quantized coordinates
+	void computeSpatialKeys(SpatialOrder order, std::vector<uint64_t>& keys, SpatialGrid& grid);
+
+	// Arrange the points into the level of detail octree, store the permutation in m_pointOrder and the nodes in m_octree
+	void computeOctreeOrder();
+
+	// Write m_octree as hierarchy EVLR to file/stream
+	void writeOctreeHierarchy(std::ofstream& lasBin);
+
+	// Fill m_layout from the current point data record format and record length
+	void setRecordLayout();
+
+	// Fill m_source from the point data record format of the matlab structure
+	void setSourceFields();
+
+	// Change point data record format and version of m_header to the target of the options and adjust the dependent header fields
+	void convertHeaderToTarget();
+
+	// Encode pointCount points starting at point index pointOffset into the write buffer
+	void encodePointChunk(char* pBuffer, size_t pointOffset, size_t pointCount);
+
+	// Encode and write the m_numberOfPointsToWrite points that m_mxStructPointer points to at the current stream position
+	void writePoints(std::ofstream& lasBin);
+
+	// Do all point fields of a chunk have at least as many elements as its coordinates (Throws Matlab Error if not)
+	void isChunkSizeValid(const mxArray* lasChunk) const;
+
 	// Copies count characters from mxChar array to char array. Stops if a null character is encountered
 	inline void copyMXCharToArray(char* pCharDestination, const mxChar* const pMXCharSource, size_t count);
 
@@ -332,9 +498,51 @@ private:
 	void getExtVLRHeader(mxArray* pVLRfield, size_t VLRindex);
 
 public:
+	// Copy writer settings from matlab options struct to m_options
+	void GetOptions(const mxArray* options);
+
 	// Copy LAS header content from matlab structure to m_header and its extended forms if applicable
 	void GetHeader(const mxArray* lasStructure);
 
+	// Size of the LAS-File in bytes after header, VLRs, point data and extended VLRs have been written
+	unsigned long long GetExpectedFileSize(const mxArray* lasStructure) const;
+
+	// Creates or truncates the file at filePath and reserves fileSize bytes for it on disk
+	// Returns:
+	//    success : True if the space could be reserved, false otherwise
+	static bool PreallocateFile(const char* filePath, unsigned long long fileSize);
+
+	// Shrinks the file at filePath to fileSize bytes, e.g. after preallocation reserved too much space
+	static bool TruncateFile(const char* filePath, unsigned long long fileSize);
+
+	// Returns true if the file should be preallocated before writing
+	bool DoPreallocateFile() const;
+
+	// Returns true if the points are appended to an existing file
+	bool DoAppend() const;
+
+	// Returns true if a LASzip compressed file (LAZ) is written
+	bool DoCompress() const;
+
+	// Returns true if the points are written in the order of a space filling curve
+	bool DoSpatialSort() const;
+
+	// Returns true if scale factors and offsets are chosen from the extent of the points
+	bool DoCoordinatePrecision() const;
+
+	// Returns true if the points are written node by node of a level of detail octree
+	bool DoLODOctree() const;
+
+	// Write header, VLRs, points and extended VLRs of the matlab LAS structure as LASzip compressed file to filePath.
+	// GetData has to be called before. Only available if compiled with LAS_WITH_LASZIP
+	void WriteCompressed(const char* filePath, const mxArray* lasStructure);
+
+	// Checks if the existing file at filePath is compatible with the header of the points to append and if all points
+	// of the matlab LAS structure can be encoded with its scale factors and offsets. Only then the data after its point
+	// records (e.g. extended VLRs) is moved back to make room and its header is taken over. The point count is the
+	// number of elements of x, the header of the file is patched after the points are written
+	void PrepareAppend(const char* filePath, const mxArray* lasStructure);
+
 	// Point the pointers in m_mxStructPointer to the respective data fields of the matlab LAS structure
 	void GetData(const mxArray* lasStructure);
 
@@ -344,6 +552,20 @@ public:
 	// Write point data, that m_mxStructPointer points to, to file/stream
 	void WriteLASdata(std::ofstream& lasBin);
 
+	// Prepare the record layout and move the stream to the start of the point data
+	// Returns:
+	//    success : False if the point data record format is not supported
+	bool BeginPointData(std::ofstream& lasBin);
+
+	// Write the points of a matlab LAS structure chunk after the points that have been written before
+	void WritePointChunk(std::ofstream& lasBin, const mxArray* lasChunk);
+
+	// Check the stream and correct header statistics and offset to extended VLRs after the last point was written
+	void EndPointData(std::ofstream& lasBin);
+
+	// Turn computation of header statistics on or off, overrides the options struct
+	void SetComputeHeaderStats(bool computeHeaderStats);
+
 	// Write VLR data in m_VLRHeader to file/stream
 	void WriteVLR(std::ofstream& lasBin, const mxArray* lasStructure);
 
@@ -352,6 +574,245 @@ public:
 
 };
 
+
+class LASdataTranscoder : public LAS_IO
+{
+private:
+	// Filters and transformations that are applied to the raw point records
+	struct TranscodeOptions
+	{
+		bool	useBoundingBox		= false;	// Keep only points inside of boxMin and boxMax
+		double	boxMin[3]			= { 0, 0, 0 };
+		double	boxMax[3]			= { 0, 0, 0 };
+		bool	useTimeWindow		= false;	// Keep only points with a GPS time inside of timeWindow
+		double	timeWindow[2]		= { 0, 0 };
+		bool	usePolygon			= false;	// Keep only points inside of the polygon (winding number)
+		std::shared_ptr<const PolygonEdgeIndex<double>> polygon;	// Edge index of the polygon, shared by the inputs of a merge
+		std::vector<bool> keepClass;			// Classes to keep (empty keeps all)
+		std::vector<bool> keepReturn;			// Return numbers to keep (empty keeps all)
+		bool	useScale			= false;	// Quantize coordinates with new scale factors
+		bool	useOffset			= false;	// Quantize coordinates with new offsets
+		double	scale[3]			= { 0, 0, 0 };
+		double	offset[3]			= { 0, 0, 0 };
+		int		targetPointFormat	= -1;		// Point data record format of the output (-1 keeps the format)
+		bool	dropExtraBytes		= false;	// Do not copy the extra bytes of the records
+		SpatialOrder spatialSort	= SpatialOrder::None;	// Write the points in the order of a space filling curve
+		size_t	sortRunPoints		= 4194304;	// Points sorted in memory at once, more points are merged from sorted runs
+		double	tileSize			= 0;		// Edge length of the square tiles
+		double	tileOrigin[2]		= { 0, 0 };	// Lower left corner of the tile in column 0 and row 0
+		double	tileOverlap			= 0;		// Points closer than this to a neighbouring tile are written to it as well
+		size_t	tileBufferBytes		= 268435456;	// Records buffered for all tiles together before the largest buffer is written
+	} m_options;
+
+	// Position and point count of a sorted run in the temporary file
+	struct SortedRun
+	{
+		unsigned long long filePosition	= 0;
+		unsigned long long pointCount	= 0;
+	};
+
+	// Path of the temporary file that holds the sorted runs if the points do not fit into one run
+	std::string m_temporaryPath;
+
+	// Output file of a tile with its buffered records and the statistics of its points
+	struct TileFile
+	{
+		long long			column	= 0;
+		long long			row		= 0;
+		std::string			path;
+		std::vector<char>	buffer;
+		bool				isCreated = false;	// Header and VLRs have been written to the file
+		std::unique_ptr<std::ofstream>	stream;			// Open file of the tile, nullptr if it was closed to save handles
+		unsigned long long				lastFlush = 0;	// Number of the last flush of the tile, the oldest open file is closed first
+		int32_t				minXYZ[3] = { INT32_MAX, INT32_MAX, INT32_MAX };
+		int32_t				maxXYZ[3] = { INT32_MIN, INT32_MIN, INT32_MIN };
+		unsigned long long	pointCount = 0;
+		unsigned long long	pointsByReturn[15] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	};
+
+	std::vector<TileFile> m_tiles;
+
+	// Index in m_tiles of the tile in a column and row and of the tile that was requested last
+	std::map<std::pair<long long, long long>, size_t> m_tileIndices;
+	size_t m_lastTileIndex = 0;
+
+	// At most maxOpenTiles tile files are kept open between flushes. The largest buffers are flushed first, so the
+	// tiles with the most points keep their files open and are not reopened and sought to their end on every flush
+	static const size_t maxOpenTiles = 64;
+	size_t m_openTileCount = 0;
+	unsigned long long m_tileFlushCount = 0;
+
+	// Header and VLRs that start every tile file
+	std::string m_tilePrefix;
+
+	// Header of the input file. m_header and its extensions describe the output file
+	LASheader		m_inputHeader;
+	LASheaderExt3	m_inputHeaderExt3;
+	LASheaderExt4	m_inputHeaderExt4;
+	unsigned long long m_inputPointCount = 0;
+
+	// Byte offsets of the input and output records (0 if the format does not contain the field)
+	struct RecordOffsets
+	{
+		int  recordLength		= 0;
+		int  extraBytesCount	= 0;
+		int  extradata_Byte		= 0;
+		int  bits2_Byte			= 0;
+		int  classification_Byte = 0;
+		int  scanAngle_Byte		= 0;
+		int  userData_Byte		= 0;
+		int  pointSourceID_Byte	= 0;
+		int  time_Byte			= 0;
+		int  color_Byte			= 0;
+		int  NIR_Byte			= 0;
+		int  wavePackets_Byte	= 0;
+		bool isExtended			= false;	// Point data record format 6-10
+	} m_in, m_out;
+
+	// Bounding box of the polygon option in quantized input coordinates, widened to whole units
+	int32_t				m_polygonMinXY[2] = { INT32_MIN, INT32_MIN };
+	int32_t				m_polygonMaxXY[2] = { INT32_MAX, INT32_MAX };
+
+	// Bounding box of the quantized output coordinates and point counts of the written points
+	int32_t				m_minXYZ[3] = { INT32_MAX, INT32_MAX, INT32_MAX };
+	int32_t				m_maxXYZ[3] = { INT32_MIN, INT32_MIN, INT32_MIN };
+	unsigned long long	m_pointCount = 0;
+	unsigned long long	m_pointsByReturn[15] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+	// Are the coordinates quantized again because scale factors or offsets change
+	bool m_doRequantize = false;
+
+	// Output coordinates are computed exactly as input * factor + shift if scale factors and offsets allow it
+	bool		m_isIntegerRequantize	= false;
+	long long	m_requantizeFactor[3]	= { 1, 1, 1 };
+	long long	m_requantizeShift[3]	= { 0, 0, 0 };
+
+	// Coordinates of the points that passed the filters, used if the points are quantized again
+	std::vector<double>  m_coordinates;
+	std::vector<int32_t> m_quantized;
+
+	// Read and check the header of the input file and derive the output header. Returns the size of the input file
+	unsigned long long readInputHeader(std::ifstream& inBin);
+
+	// Fill offsets from the byte offset tables for a point data record format
+	void setRecordOffsets(RecordOffsets& offsets, unsigned char pointDataRecordFormat, int extraBytesCount) const;
+
+	// Derive the output header from the input header and the options (Throws Matlab Error if not possible)
+	void setOutputHeader();
+
+	// Decide from input and output header if and how the coordinates are quantized again
+	void setRequantization();
+
+	// Quantize the bounding box of the polygon option with the scale factors and offsets of the input
+	void setPolygonBounds();
+
+	// Does a raw input record pass all filters?
+	inline bool isRecordKept(const char* pRecord) const;
+
+	// Copy the fields of a raw input record to an output record
+	inline void transcodeRecord(const char* pIn, char* pOut) const;
+
+	// Filter and transcode count input records. Returns the number of output records
+	size_t transcodeChunk(const char* pIn, char* pOut, size_t count);
+
+	// Filter and transcode the point records chunk wise from input to output
+	void streamPoints(std::ifstream& inBin, std::ofstream& outBin);
+
+	// Filter and transcode the point records and write them in the order of the space filling curve of the options.
+	// Runs of sortRunPoints points are sorted in memory, if there is more than one they are merged via the temporary file
+	void sortPoints(std::ifstream& inBin, std::ofstream& outBin);
+
+	// Grid of the space filling curve from the bounding box of the input header in output coordinates
+	SpatialGrid getSpatialGrid() const;
+
+	// Merge the sorted runs of [key, record] entries in runFile by their keys and write the records to the output
+	void mergeRuns(std::fstream& runFile, const std::vector<SortedRun>& runs, std::ofstream& outBin) const;
+
+	// Copy the VLRs of the input file to the output. The extra bytes VLR is dropped together with the extra bytes
+	void copyVLRs(std::ifstream& inBin, std::ostream& outBin);
+
+	// Read the extended VLRs of the input file except of waveform data, which can not be split into tiles.
+	// Returns the records as they are stored in the file, count is set to their number
+	std::vector<char> readExtendedVLRs(std::ifstream& inBin, unsigned long long fileSize, unsigned long& count) const;
+
+	// A VLR or extended VLR of an input file with its header as stored in the file
+	struct VariableRecord
+	{
+		std::vector<char> header;
+		std::vector<char> data;
+	};
+
+	// Read the VLRs of the input file
+	std::vector<VariableRecord> readVLRs(std::ifstream& inBin) const;
+
+	// Split extended VLRs as returned by readExtendedVLRs into single records
+	static std::vector<VariableRecord> splitExtendedVLRs(const std::vector<char>& records);
+
+	// Append the records of an input to the merged records. Records with a user id and record id that is already
+	// merged are skipped, a warning is issued if a skipped coordinate reference system differs from the merged one
+	static void mergeVariableRecords(std::vector<VariableRecord>& merged, const std::vector<VariableRecord>& records, bool dropExtraBytesDescription);
+
+	// Choose point data record format, version, scale factors and offsets of the merge output from the input headers
+	// and derive m_header from the first input. extraBytesCount is 0 if the extra bytes are not merged
+	void setMergeHeader(const std::vector<std::unique_ptr<LASdataTranscoder>>& inputs, int extraBytesCount);
+
+	// Prepare the transcoder of one merge input to convert its records to the output format of merger
+	void prepareMergeInput(const LASdataTranscoder& merger);
+
+	// Read and convert the point records of the inputs concurrently and write them to the output in input order
+	void mergePoints(const std::vector<std::unique_ptr<LASdataTranscoder>>& inputs, const std::vector<std::string>& inputPaths, std::ofstream& outBin);
+
+	// Index of the tile in column and row in m_tiles, the tile is added if it does not exist yet
+	size_t getTileIndex(long long column, long long row, const std::string& outputPrefix);
+
+	// Append the buffered records of a tile to its file. The file is created with m_tilePrefix on the first call.
+	// The file stays open, the least recently flushed tile file is closed if maxOpenTiles files are open
+	void flushTile(TileFile& tile);
+
+	// Write statistics, extended VLRs and offsets of a completely written tile
+	void closeTile(const TileFile& tile, const std::vector<char>& extendedVLRs, unsigned long extendedVLRCount);
+
+	// Stream the records of the input file that pass the filters into the cells of the raster
+	void rasterizePoints(const std::string& inputPath, PointRaster& raster) const;
+
+	// Copy waveform data and extended VLRs after the point records of the input file to the output
+	void copyTrailingData(std::ifstream& inBin, std::ofstream& outBin, unsigned long long fileSize);
+
+	// Write m_header and its extensions to the start of the output file
+	void writeHeader(std::ostream& outBin);
+
+public:
+
+	// Copy filters and transformations from matlab options struct to m_options
+	void GetOptions(const mxArray* options);
+
+	// Stream all point records from input to output file while filtering and transcoding them
+	void Transcode(std::ifstream& inBin, std::ofstream& outBin);
+
+	// Set the path of the temporary file used to sort inputs with more than sortRunPoints points
+	void SetTemporaryPath(const std::string& temporaryPath);
+
+	// Read the input file once and route every record that passes the filters into the file of its tile.
+	// Tile files are named outputPrefix_<x>_<y>.las after the lower left corner of the tile
+	void Tile(std::ifstream& inBin, const std::string& outputPrefix);
+
+	// Paths and point counts of the written tile files
+	void GetTiles(std::vector<std::string>& paths, std::vector<unsigned long long>& pointCounts) const;
+
+	// Concatenate the point records of all input files into the output file with a common point data record format,
+	// scale factors and offsets. VLRs, extended VLRs and header statistics of the inputs are merged
+	void Merge(const std::vector<std::string>& inputPaths, std::ofstream& outBin);
+
+	// Bin the point records of all input files that pass the filters into the cells of the raster. The extent of the
+	// raster is snapped around the bounding boxes of the input headers if useHeaderExtent is true. The inputs are read
+	// once and once more for every band of rows of the percentiles, only the raster and one chunk are held in memory
+	void Rasterize(const std::vector<std::string>& inputPaths, PointRaster& raster, bool useHeaderExtent);
+
+	// Number of points written to the output file
+	unsigned long long GetWrittenPointCount() const;
+
+};
+
 #include "LAS_IO.ipp"
 
 #endif
\ No newline at end of file
@@ -61,6 +61,118 @@ inline void LAS_IO::setContentFlags()
 	}
 }
 
+// Parse the name of a space filling curve from a matlab char array
+inline SpatialOrder LAS_IO::getSpatialOrder(const mxArray* pField)
+{
+	if (!mxIsChar(pField)) {
+		mexErrMsgIdAndTxt("MEX:GetOptions:spatialSort", "Option spatialSort has to be 'none', 'morton' or 'hilbert'!");
+	}
+
+	char* name = mxArrayToString(pField);
+	const std::string curve = nullptr != name ? name : "";
+	mxFree(name);
+
+	if (curve == "none")	{ return SpatialOrder::None; }
+	if (curve == "morton")	{ return SpatialOrder::Morton; }
+	if (curve == "hilbert")	{ return SpatialOrder::Hilbert; }
+
+	mexErrMsgIdAndTxt("MEX:GetOptions:spatialSort", "Option spatialSort has to be 'none', 'morton' or 'hilbert'!");
+	return SpatialOrder::None;
+}
+
+// Replace bounding box and point counts of the header and its extension with the statistics of the written points
+inline void LAS_IO::applyHeaderStatistics(const int32_t minXYZ[3], const int32_t maxXYZ[3], unsigned long long pointCount, const unsigned long long pointsByReturn[15])
+{
+	if (pointCount > 0)
+	{
+		m_header.minX = minXYZ[0] * m_header.xScaleFactor + m_header.xOffset;
+		m_header.minY = minXYZ[1] * m_header.yScaleFactor + m_header.yOffset;
+		m_header.minZ = minXYZ[2] * m_header.zScaleFactor + m_header.zOffset;
+		m_header.maxX = maxXYZ[0] * m_header.xScaleFactor + m_header.xOffset;
+		m_header.maxY = maxXYZ[1] * m_header.yScaleFactor + m_header.yOffset;
+		m_header.maxZ = maxXYZ[2] * m_header.zScaleFactor + m_header.zOffset;
+	}
+	else
+	{
+		m_header.minX = m_header.minY = m_header.minZ = 0;
+		m_header.maxX = m_header.maxY = m_header.maxZ = 0;
+	}
+
+	// Legacy fields can only hold the counts if they fit into 32 bit and the point data record format is 0-5,
+	// LAS 1.4 requires them to be 0 for point data record format 6-10
+	const bool isLegacyCompatible = pointCount <= ULONG_MAX && m_header.PointDataRecordFormat < 6;
+
+	m_header.LegacyNumberOfPointRecords = isLegacyCompatible ? static_cast<unsigned long>(pointCount) : 0;
+	for (int i = 0; i < 5; ++i)
+	{
+		m_header.LegacyNumberOfPointByReturn[i] = isLegacyCompatible ? static_cast<unsigned long>(pointsByReturn[i]) : 0;
+	}
+
+	if (m_header.versionMajor == 1 && m_header.versionMinor > 3)
+	{
+		m_headerExt4.numberOfPointRecords = pointCount;
+		for (int i = 0; i < 15; ++i) { m_headerExt4.numberOfPointsByReturn[i] = pointsByReturn[i]; }
+	}
+}
+
+// Parse the first 375 bytes of a LAS-File into the header struct and its extensions
+inline void LAS_IO::parseLASheader(const char* pHeaderBuf, LASheader& header, LASheaderExt3& headerExt3, LASheaderExt4& headerExt4)
+{
+	std::memcpy(header.fileSignature, pHeaderBuf, 4);
+
+	header.sourceID			= *reinterpret_cast<const uint16_t*>(pHeaderBuf + 4);
+	header.globalEncoding		= *reinterpret_cast<const uint16_t*>(pHeaderBuf + 6);
+	header.projectID_GUID_1	= *reinterpret_cast<const uint32_t*>(pHeaderBuf + 8);
+	header.projectID_GUID_2	= *reinterpret_cast<const uint16_t*>(pHeaderBuf + 12);
+	header.projectID_GUID_3	= *reinterpret_cast<const uint16_t*>(pHeaderBuf + 14);
+
+	// Copy chars into projectID_GUID_4
+	std::memcpy(header.projectID_GUID_4, pHeaderBuf + 16, 8);
+
+	header.versionMajor = *reinterpret_cast<const uint8_t*>(pHeaderBuf + 24);
+	header.versionMinor = *reinterpret_cast<const uint8_t*>(pHeaderBuf + 25);
+
+	// Copy chars into System identifier and Generating Software
+	std::memcpy(header.systemIdentifier, pHeaderBuf + 26, 32);
+	std::memcpy(header.generatingSoftware, pHeaderBuf + 58, 32);
+
+	header.fileCreationDayOfYear			= *reinterpret_cast<const uint16_t*>(pHeaderBuf + 90);
+	header.fileCreationYear				= *reinterpret_cast<const uint16_t*>(pHeaderBuf + 92);
+	header.headerSize						= *reinterpret_cast<const uint16_t*>(pHeaderBuf + 94);
+	header.offsetToPointData				= *reinterpret_cast<const uint32_t*>(pHeaderBuf + 96);
+	header.numberOfVariableLengthRecords	= *reinterpret_cast<const uint32_t*>(pHeaderBuf + 100);
+	header.PointDataRecordFormat			= *reinterpret_cast<const uint8_t*> (pHeaderBuf + 104);
+	header.PointDataRecordLength			= *reinterpret_cast<const uint16_t*>(pHeaderBuf + 105);
+	header.LegacyNumberOfPointRecords		= *reinterpret_cast<const uint32_t*>(pHeaderBuf + 107);
+
+	std::memcpy(header.LegacyNumberOfPointByReturn, pHeaderBuf + 111, 20);
+
+	header.xScaleFactor	= *reinterpret_cast<const double*>(pHeaderBuf + 131);
+	header.yScaleFactor	= *reinterpret_cast<const double*>(pHeaderBuf + 139);
+	header.zScaleFactor	= *reinterpret_cast<const double*>(pHeaderBuf + 147);
+	header.xOffset		= *reinterpret_cast<const double*>(pHeaderBuf + 155);
+	header.yOffset		= *reinterpret_cast<const double*>(pHeaderBuf + 163);
+	header.zOffset		= *reinterpret_cast<const double*>(pHeaderBuf + 171);
+	header.maxX			= *reinterpret_cast<const double*>(pHeaderBuf + 179);
+	header.minX			= *reinterpret_cast<const double*>(pHeaderBuf + 187);
+	header.maxY			= *reinterpret_cast<const double*>(pHeaderBuf + 195);
+	header.minY			= *reinterpret_cast<const double*>(pHeaderBuf + 203);
+	header.maxZ			= *reinterpret_cast<const double*>(pHeaderBuf + 211);
+	header.minZ			= *reinterpret_cast<const double*>(pHeaderBuf + 219);
+
+	if (header.versionMinor > 2) 
+	{
+		headerExt3.startOfWaveFormData = *reinterpret_cast<const uint64_t*>(pHeaderBuf + 227);
+	}
+	if (header.versionMinor > 3)
+	{
+		headerExt4.startOfFirstExtendedVariableLengthRecord	= *reinterpret_cast<const uint64_t*>(pHeaderBuf + 235);
+		headerExt4.numberOfExtendedVariableLengthRecords	= *reinterpret_cast<const uint32_t*>(pHeaderBuf + 243);
+		headerExt4.numberOfPointRecords						= *reinterpret_cast<const uint64_t*>(pHeaderBuf + 247);
+		std::memcpy(headerExt4.numberOfPointsByReturn, pHeaderBuf + 255, 120);
+	}
+}
+
 /* Read methods for fields of the point data record*/
 // Read XYZ Point Data,Intensities, advance the data and buffer pointer
 inline void LASdataReader::readXYZInt(char*& pBuffer)
@@ -0,0 +1,296 @@
+#if _MSC_VER > 1400
+#pragma once
+#endif
+
+#ifndef LEVEL_OF_DETAIL_H
+#define LEVEL_OF_DETAIL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "SpatialSort.hpp"
+
+// Level of detail octree over the grid of the space filling curves. Every node keeps a coarse sample of the points
+// below it, so reading all nodes down to some depth gives an evenly thinned version of the cloud. Points are
+// written node by node, coarse depths first, and the hierarchy EVLR maps every node to its range of point records.
+//
+// Hierarchy EVLR (user ID "LASLibraryMatlab", record ID 1, little endian):
+//    uint32 version (1), uint32 deepest depth, double root minimum [3], double root edge length [3], uint64 node count,
+//    then per node: int32 depth, int32 x, int32 y, int32 z, uint64 first point record, uint64 point record count
+
+constexpr char		octreeHierarchyUserID[]		= "LASLibraryMatlab";
+constexpr uint16_t	octreeHierarchyRecordID		= 1;
+constexpr uint32_t	octreeHierarchyVersion		= 1;
+constexpr size_t	octreeHierarchyHeaderSize	= 64;
+constexpr size_t	octreeHierarchyNodeSize		= 32;
+
+// Node of the octree. Depth and the cell indices x, y and z of the node among the 2^depth cells per axis identify its cube
+struct OctreeNode
+{
+	int32_t  depth		= 0;
+	int32_t  x			= 0;
+	int32_t  y			= 0;
+	int32_t  z			= 0;
+	uint64_t firstPoint = 0;	// Index of the first point record of the node
+	uint64_t pointCount = 0;
+};
+
+struct OctreeHierarchy
+{
+	double rootMin[3]	= { 0, 0, 0 };	// Corner of the root cube in real world coordinates
+	double rootSize[3]	= { 0, 0, 0 };	// Edge lengths of the root cube (cubic in quantized units, scale factors may differ)
+	std::vector<OctreeNode> nodes;		// Nodes sorted by depth, nodes of the same depth in Morton order
+};
+
+// Is the (extended) VLR with userID and recordID an octree hierarchy
+inline bool isOctreeHierarchy(const char* userID, uint16_t recordID)
+{
+	return recordID == octreeHierarchyRecordID && std::strncmp(userID, octreeHierarchyUserID, 16) == 0;
+}
+
+// Arranges the points into the octree. sortedKeys are the Morton keys of the points in ascending order and sortedIndices
+// the point indices in that order. A node with more than nodePointLimit points keeps the first point of every occupied
+// cell of a sampling grid inside of its cube and hands the others down to its children. The grid is the finest one with
+// at most nodePointLimit occupied cells, so the sample is even for surfaces as well as for volumes.
+// Returns the point indices in the written order in pointOrder and the nodes in the order of their points in nodes
+inline void buildOctree(const std::vector<uint64_t>& sortedKeys, const std::vector<size_t>& sortedIndices, size_t nodePointLimit,
+	std::vector<size_t>& pointOrder, std::vector<OctreeNode>& nodes)
+{
+	// Points of a node that are not sampled yet, as range of positions in the sorted arrays
+	struct Segment
+	{
+		uint64_t key;		// Morton key of the node cube at its depth
+		size_t	 begin;
+		size_t	 end;
+	};
+
+	const size_t pointCount = sortedKeys.size();
+
+	pointOrder.clear();
+	pointOrder.reserve(pointCount);
+	nodes.clear();
+
+	std::vector<size_t> remaining(pointCount);
+	for (size_t i = 0; i < pointCount; ++i) { remaining[i] = i; }
+
+	std::vector<Segment> level;
+	if (pointCount > 0) { level.push_back({ 0, 0, pointCount }); }
+
+	std::vector<size_t> next;
+	std::vector<Segment> nextLevel;
+
+	for (int depth = 0; !level.empty(); ++depth)
+	{
+		next.clear();
+		nextLevel.clear();
+
+		const int levelsBelow = spatialGridBits - depth;
+		const int childShift  = 3 * (levelsBelow - 1);
+
+		for (const Segment& segment : level)
+		{
+			OctreeNode node;
+			node.depth = depth;
+			node.firstPoint = pointOrder.size();
+
+			// Cell indices of the node are the bits of its key, x is the most significant of each triple
+			for (int bit = 0; bit < depth; ++bit)
+			{
+				node.x |= static_cast<int32_t>((segment.key >> (3 * bit + 2)) & 1) << bit;
+				node.y |= static_cast<int32_t>((segment.key >> (3 * bit + 1)) & 1) << bit;
+				node.z |= static_cast<int32_t>((segment.key >> (3 * bit)) & 1) << bit;
+			}
+
+			if (segment.end - segment.begin <= nodePointLimit || depth == spatialGridBits)
+			{
+				// Leaf node keeps all of its points
+				for (size_t i = segment.begin; i < segment.end; ++i) { pointOrder.push_back(sortedIndices[remaining[i]]); }
+			}
+			else
+			{
+				// Two neighbours in key order fall into different cells of all grids with at least as many cells per axis as the
+				// first level their keys differ in. Counting these levels gives the occupied cells of every grid in one pass
+				size_t newCellsAtLevel[spatialGridBits + 1] = {};
+
+				for (size_t i = segment.begin + 1; i < segment.end; ++i)
+				{
+					const uint64_t difference = sortedKeys[remaining[i]] ^ sortedKeys[remaining[i - 1]];
+					if (difference == 0) {
+						continue;
+					}
+
+					// Highest differing bit triple, counted from the finest level
+					int triple = 0;
+					for (uint64_t rest = difference >> 3; rest != 0; rest >>= 3) { ++triple; }
+
+					++newCellsAtLevel[levelsBelow - triple];
+				}
+
+				int samplingLevel = 1;
+				size_t occupiedCells = 1 + newCellsAtLevel[1];
+
+				while (samplingLevel < levelsBelow && occupiedCells + newCellsAtLevel[samplingLevel + 1] <= nodePointLimit)
+				{
+					++samplingLevel;
+					occupiedCells += newCellsAtLevel[samplingLevel];
+				}
+
+				const int cellShift = 3 * (levelsBelow - samplingLevel);
+				const size_t childBegin = next.size();
+				uint64_t previousCell = UINT64_MAX;
+
+				for (size_t i = segment.begin; i < segment.end; ++i)
+				{
+					const size_t position = remaining[i];
+					const uint64_t cell = sortedKeys[position] >> cellShift;
+
+					if (cell != previousCell)
+					{
+						pointOrder.push_back(sortedIndices[position]);
+						previousCell = cell;
+					}
+					else
+					{
+						next.push_back(position);
+					}
+				}
+
+				// Points that are handed down stay in key order, so every child is a contiguous range
+				for (size_t i = childBegin; i < next.size(); )
+				{
+					const uint64_t childKey = sortedKeys[next[i]] >> childShift;
+					size_t end = i + 1;
+					while (end < next.size() && (sortedKeys[next[end]] >> childShift) == childKey) { ++end; }
+
+					nextLevel.push_back({ childKey, i, end });
+					i = end;
+				}
+			}
+
+			node.pointCount = pointOrder.size() - node.firstPoint;
+			nodes.push_back(node);
+		}
+
+		remaining.swap(next);
+		level.swap(nextLevel);
+	}
+}
+
+// Serializes the hierarchy into the data of the hierarchy EVLR
+inline std::vector<char> encodeOctreeHierarchy(const OctreeHierarchy& hierarchy)
+{
+	std::vector<char> data(octreeHierarchyHeaderSize + hierarchy.nodes.size() * octreeHierarchyNodeSize, 0);
+	char* pData = data.data();
+
+	uint32_t deepestDepth = 0;
+	for (const OctreeNode& node : hierarchy.nodes) { deepestDepth = std::max(deepestDepth, static_cast<uint32_t>(node.depth)); }
+
+	const uint64_t nodeCount = hierarchy.nodes.size();
+	std::memcpy(pData, &octreeHierarchyVersion, 4);
+	std::memcpy(pData + 4, &deepestDepth, 4);
+	std::memcpy(pData + 8, hierarchy.rootMin, 24);
+	std::memcpy(pData + 32, hierarchy.rootSize, 24);
+	std::memcpy(pData + 56, &nodeCount, 8);
+
+	pData += octreeHierarchyHeaderSize;
+	for (const OctreeNode& node : hierarchy.nodes)
+	{
+		std::memcpy(pData, &node.depth, 4);
+		std::memcpy(pData + 4, &node.x, 4);
+		std::memcpy(pData + 8, &node.y, 4);
+		std::memcpy(pData + 12, &node.z, 4);
+		std::memcpy(pData + 16, &node.firstPoint, 8);
+		std::memcpy(pData + 24, &node.pointCount, 8);
+		pData += octreeHierarchyNodeSize;
+	}
+
+	return data;
+}
+
+// Parses the data of a hierarchy EVLR
+// Returns:
+//    success : False if the data is too short or of an unknown version
+inline bool decodeOctreeHierarchy(const char* pData, size_t length, OctreeHierarchy& hierarchy)
+{
+	uint32_t version = 0;
+	uint64_t nodeCount = 0;
+
+	if (length < octreeHierarchyHeaderSize) {
+		return false;
+	}
+
+	std::memcpy(&version, pData, 4);
+	std::memcpy(hierarchy.rootMin, pData + 8, 24);
+	std::memcpy(hierarchy.rootSize, pData + 32, 24);
+	std::memcpy(&nodeCount, pData + 56, 8);
+
+	if (version != octreeHierarchyVersion || nodeCount > (length - octreeHierarchyHeaderSize) / octreeHierarchyNodeSize) {
+		return false;
+	}
+
+	hierarchy.nodes.resize(static_cast<size_t>(nodeCount));
+	pData += octreeHierarchyHeaderSize;
+
+	for (OctreeNode& node : hierarchy.nodes)
+	{
+		std::memcpy(&node.depth, pData, 4);
+		std::memcpy(&node.x, pData + 4, 4);
+		std::memcpy(&node.y, pData + 8, 4);
+		std::memcpy(&node.z, pData + 12, 4);
+		std::memcpy(&node.firstPoint, pData + 16, 8);
+		std::memcpy(&node.pointCount, pData + 24, 8);
+		pData += octreeHierarchyNodeSize;
+	}
+
+	return true;
+}
+
+// Point record ranges (first point, point count) of the nodes that are not deeper than maxDepth and whose cube intersects
+// the box. Ranges are sorted by their first point and adjacent ranges are joined, so they can be read with few seeks
+inline std::vector<std::pair<uint64_t, uint64_t>> selectOctreeNodes(const OctreeHierarchy& hierarchy, const double boxMin[3], const double boxMax[3], int maxDepth)
+{
+	std::vector<std::pair<uint64_t, uint64_t>> ranges;
+
+	for (const OctreeNode& node : hierarchy.nodes)
+	{
+		if (node.depth > maxDepth || node.pointCount == 0) {
+			continue;
+		}
+
+		const double cellsPerAxis = std::ldexp(1.0, node.depth);
+		const int32_t cell[3] = { node.x, node.y, node.z };
+		bool intersects = true;
+
+		for (int axis = 0; axis < 3 && intersects; ++axis)
+		{
+			const double edge = hierarchy.rootSize[axis] / cellsPerAxis;
+			const double nodeMin = hierarchy.rootMin[axis] + cell[axis] * edge;
+			intersects = nodeMin <= boxMax[axis] && nodeMin + edge >= boxMin[axis];
+		}
+
+		if (intersects) {
+			ranges.push_back(std::make_pair(node.firstPoint, node.pointCount));
+		}
+	}
+
+	std::sort(ranges.begin(), ranges.end());
+
+	std::vector<std::pair<uint64_t, uint64_t>> joined;
+	for (const std::pair<uint64_t, uint64_t>& range : ranges)
+	{
+		if (!joined.empty() && joined.back().first + joined.back().second == range.first) {
+			joined.back().second += range.second;
+		}
+		else {
+			joined.push_back(range);
+		}
+	}
+
+	return joined;
+}
+
+#endif // !LEVEL_OF_DETAIL_H
@@ -0,0 +1,291 @@
+#if _MSC_VER > 1400
+#pragma once
+#endif
+
+#ifndef POINT_CLEANING_H
+#define POINT_CLEANING_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "KdTree.hpp"
+#include "VoxelGrid.hpp"
+
+// Cleaning of point clouds: duplicate points and statistical outliers.
+//
+// Duplicates are points with the same quantized coordinates and optionally the same quantized GPS time. A value is
+// quantized to floor(value / tolerance), or taken as it is if its tolerance is zero, so exact duplicates are found
+// with a tolerance of zero and near duplicates share a cell of the tolerance. Every point gets the first point of
+// its cell in input order, which is the point that is kept. The points are partitioned by the hash of their key,
+// so the partitions are searched in parallel without locks and the result does not depend on the number of threads.
+//
+// Outliers are points whose mean distance to their k nearest neighbours is larger than the mean of these distances
+// of all points plus stdRatio times their standard deviation (statistical outlier removal).
+
+constexpr int duplicateKeyWords = 4;
+
+// Quantized x, y, z and GPS time of a point
+struct DuplicateKey
+{
+	uint64_t	words[duplicateKeyWords];
+
+	inline bool operator==(const DuplicateKey& other) const
+	{
+		return std::memcmp(words, other.words, sizeof(words)) == 0;
+	}
+};
+
+// Values and tolerances of the duplicate search. The GPS time is optional
+struct DuplicateInput
+{
+	const double*	values[duplicateKeyWords]		= { nullptr, nullptr, nullptr, nullptr };
+	double			tolerances[duplicateKeyWords]	= { 0, 0, 0, 0 };
+	size_t			count							= 0;
+};
+
+// Gets the quantized key of a point. Quantized values are integers in double precision, whose bits are unique
+// as well, and negative zero is mapped to zero by the addition
+//	Returns: false if a value is undefined (NaN)
+inline bool duplicateKey(const DuplicateInput& input, const size_t point, DuplicateKey& key)
+{
+	for (int word = 0; word < duplicateKeyWords; ++word)
+	{
+		double value = input.values[word] != nullptr ? input.values[word][point] : 0;
+
+		if (value != value)
+			return false;
+
+		if (input.tolerances[word] > 0)
+			value = std::floor(value / input.tolerances[word]);
+
+		value += 0.0;
+		std::memcpy(&key.words[word], &value, sizeof(double));
+	}
+
+	return true;
+}
+
+// Mixes the words of a key into one hash. The high bits select the partition and the low bits the slot
+inline uint64_t hashDuplicateKey(const DuplicateKey& key)
+{
+	uint64_t hash = 0;
+
+	for (int word = 0; word < duplicateKeyWords; ++word) {
+		hash = hashVoxelKey(hash ^ key.words[word]);
+	}
+
+	return hash;
+}
+
+// Finds the first point of the key of every point. Points with an undefined value get the index undefinedPoint.
+// The hash, a flag and the position in its partition are held for every point, 9 + sizeof(Index) bytes per point
+template<typename Index>
+void findDuplicatePoints(const DuplicateInput& input, Index* __restrict firstPoints, const Index undefinedPoint, const int threadCount)
+{
+	const size_t count = input.count;
+
+	int partitionBits = 0;
+	while (threadCount > 1 && (1 << partitionBits) < 4 * threadCount) ++partitionBits;
+
+	const size_t partitionCount = static_cast<size_t>(1) << partitionBits;
+	const int shift = 64 - partitionBits;
+	std::vector<uint64_t> hashes(count);
+	std::vector<uint8_t> isDefined(count);
+
+	// Every block counts the points of every partition, so the blocks can scatter their points in input order.
+	// Blocks are assigned by worksharing loops, so all points are processed if fewer threads are granted
+	std::vector<size_t> blockPartitionStart(threadCount * partitionCount + 1, 0);
+	std::vector<Index> order(count);
+	std::vector<size_t> partitionStart(partitionCount + 1, 0);
+
+#pragma omp parallel num_threads(threadCount)
+	{
+#pragma omp for schedule(static)
+		for (int block = 0; block < threadCount; ++block)
+		{
+			const size_t begin = count * block / threadCount;
+			const size_t end = count * (block + 1) / threadCount;
+			size_t* pCounts = blockPartitionStart.data() + block * partitionCount;
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				DuplicateKey key;
+				isDefined[i] = duplicateKey(input, i, key) ? 1 : 0;
+
+				if (!isDefined[i])
+					continue;
+
+				hashes[i] = hashDuplicateKey(key);
+				++pCounts[partitionBits > 0 ? hashes[i] >> shift : 0];
+			}
+		}
+
+#pragma omp single
+		{
+			// Partition major, then block, so the points of a partition are in input order
+			size_t offset = 0;
+
+			for (size_t p = 0; p < partitionCount; ++p)
+			{
+				partitionStart[p] = offset;
+
+				for (int t = 0; t < threadCount; ++t) {
+					const size_t blockCount = blockPartitionStart[t * partitionCount + p];
+					blockPartitionStart[t * partitionCount + p] = offset;
+					offset += blockCount;
+				}
+			}
+
+			partitionStart[partitionCount] = offset;
+		}
+
+#pragma omp for schedule(static)
+		for (int block = 0; block < threadCount; ++block)
+		{
+			const size_t begin = count * block / threadCount;
+			const size_t end = count * (block + 1) / threadCount;
+			size_t* pCounts = blockPartitionStart.data() + block * partitionCount;
+
+			for (size_t i = begin; i < end; ++i) {
+				if (isDefined[i])
+					order[pCounts[partitionBits > 0 ? hashes[i] >> shift : 0]++] = static_cast<Index>(i);
+				else
+					firstPoints[i] = undefinedPoint;
+			}
+		}
+
+		// Open addressing with linear probing, a slot holds the first point of a key. Keys are compared after
+		// their hashes, so a key is only built again for points with the same hash
+		std::vector<Index> slots;
+
+#pragma omp for schedule(dynamic)
+		for (long long p = 0; p < static_cast<long long>(partitionCount); ++p)
+		{
+			const size_t partitionBegin = partitionStart[p];
+			const size_t partitionEnd = partitionStart[p + 1];
+
+			size_t capacity = 16;
+			while (capacity < 2 * (partitionEnd - partitionBegin)) capacity *= 2;
+
+			slots.assign(capacity, undefinedPoint);
+			const size_t mask = capacity - 1;
+
+			for (size_t position = partitionBegin; position < partitionEnd; ++position)
+			{
+				const Index point = order[position];
+				const uint64_t hash = hashes[point];
+				size_t slot = hash & mask;
+				DuplicateKey key;
+				bool hasKey = false;
+
+				for (; slots[slot] != undefinedPoint; slot = (slot + 1) & mask)
+				{
+					const Index first = slots[slot];
+					if (hashes[first] != hash)
+						continue;
+
+					DuplicateKey firstKey;
+					if (!hasKey) {
+						duplicateKey(input, point, key);
+						hasKey = true;
+					}
+					duplicateKey(input, first, firstKey);
+
+					if (firstKey == key)
+						break;
+				}
+
+				if (slots[slot] == undefinedPoint)
+					slots[slot] = point;
+
+				firstPoints[point] = slots[slot];
+			}
+		}
+	}
+}
+
+// Gets the mean distance of every point of the tree to its k nearest neighbours, the point itself excluded.
+// The distances are indexed by the input index of the points. Points that are not in the tree or have no neighbour
+// keep their values
+template<typename Index>
+void meanNeighbourDistances(const KdTree<Index>& tree, const size_t k, double* __restrict meanDistances)
+{
+	const long long treeSize = static_cast<long long>(tree.Size());
+
+	// The points are processed in tree order, so the neighbourhoods of consecutive points share their cache lines
+#pragma omp parallel if (treeSize > 10000)
+	{
+		std::vector<KdNeighbour> neighbours;
+		neighbours.reserve(k + 1);
+
+#pragma omp for schedule(dynamic, 1024)
+		for (long long position = 0; position < treeSize; ++position)
+		{
+			const KdTreePoint<Index>& point = tree.Point(static_cast<size_t>(position));
+			tree.Nearest(point.xyz, k + 1, std::numeric_limits<double>::infinity(), neighbours);
+
+			// The point is its own first neighbour, unless coincident points come first in tree order
+			double sum = 0;
+			size_t used = 0;
+
+			for (size_t n = 0; n < neighbours.size() && used < k; ++n)
+			{
+				if (neighbours[n].position == static_cast<size_t>(position))
+					continue;
+
+				sum += std::sqrt(neighbours[n].squaredDistance);
+				++used;
+			}
+
+			if (used > 0)
+				meanDistances[point.index] = sum / static_cast<double>(used);
+		}
+	}
+}
+
+// Flags the points whose mean distance is larger than the mean of all defined mean distances plus stdRatio
+// times their sample standard deviation. The sums are taken in input order, so the threshold is the same
+// for any number of threads
+//	Returns: threshold of the mean distances, NaN if no point has a mean distance
+inline double flagOutliers(const double* __restrict meanDistances, const size_t count, const double stdRatio, bool* __restrict isOutlier)
+{
+	double sum = 0;
+	size_t defined = 0;
+
+	for (size_t i = 0; i < count; ++i) {
+		if (meanDistances[i] == meanDistances[i]) {
+			sum += meanDistances[i];
+			++defined;
+		}
+	}
+
+	if (defined == 0) {
+		std::fill(isOutlier, isOutlier + count, false);
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+
+	const double mean = sum / static_cast<double>(defined);
+	double squares = 0;
+
+	for (size_t i = 0; i < count; ++i) {
+		if (meanDistances[i] == meanDistances[i]) {
+			squares += (meanDistances[i] - mean) * (meanDistances[i] - mean);
+		}
+	}
+
+	const double deviation = defined > 1 ? std::sqrt(squares / static_cast<double>(defined - 1)) : 0;
+	const double threshold = mean + stdRatio * deviation;
+
+#pragma omp parallel for if (count > 100000)
+	for (long long i = 0; i < static_cast<long long>(count); ++i) {
+		isOutlier[i] = meanDistances[i] > threshold;
+	}
+
+	return threshold;
+}
+
+#endif // !POINT_CLEANING_H
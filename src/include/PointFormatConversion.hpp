@@ -0,0 +1,56 @@
+#if _MSC_VER > 1400
+#pragma once
+#endif
+
+#ifndef POINT_FORMAT_CONVERSION_H
+#define POINT_FORMAT_CONVERSION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Conversion of the fields that differ between the legacy point data record formats 0-5 and the formats 6-10:
+// bit fields, classification and scan angle. All other fields keep their meaning and only move inside the record
+
+// Converts bit field, classification and scan angle of a point of record format 0-5 to the fields of format 6-10
+inline void legacyToExtendedFields(uint8_t bits, uint8_t classification, int8_t scanAngle,
+	uint8_t& extBits, uint8_t& extBits2, uint8_t& extClassification, int16_t& extScanAngle)
+{
+	// Return number and number of returns get four bits each
+	extBits = static_cast<uint8_t>((bits & 0x07) | ((bits >> 3 & 0x07) << 4));
+
+	// Synthetic, key-point and withheld move from classification bits 5-7 to the classification flags.
+	// Scan direction and edge of flight line keep bits 6 and 7, scanner channel is zero
+	extBits2 = static_cast<uint8_t>((classification >> 5 & 0x07) | (bits & 0xC0));
+	extClassification = static_cast<uint8_t>(classification & 0x1F);
+
+	// Class 12 (overlap) is reserved in formats 6-10 and becomes the overlap flag (bit 3 of the classification
+	// flags). The class of the point is not known, so it becomes unclassified (1)
+	if (extClassification == 12)
+	{
+		extBits2 |= 0x08;
+		extClassification = 1;
+	}
+
+	// Whole degrees to increments of 0.006 degrees
+	extScanAngle = static_cast<int16_t>(std::lround(scanAngle / 0.006));
+}
+
+// Converts bit fields, classification and scan angle of a point of record format 6-10 to the fields of format 0-5
+inline void extendedToLegacyFields(uint8_t bits, uint8_t bits2, uint8_t classification, int16_t scanAngle,
+	uint8_t& legBits, uint8_t& legClassification, int8_t& legScanAngle)
+{
+	// Return numbers above 7 can not be represented and are clamped
+	const int returnNumber	  = std::min(bits & 0x0F, 7);
+	const int numberOfReturns = std::min(bits >> 4, 7);
+	legBits = static_cast<uint8_t>(returnNumber | (numberOfReturns << 3) | (bits2 & 0xC0));
+
+	// Classes above 31 do not exist in the legacy formats and become unclassified (1).
+	// Synthetic, key-point and withheld flags go to classification bits 5-7, overlap flag and scanner channel are dropped
+	legClassification = static_cast<uint8_t>((classification < 32 ? classification : 1) | ((bits2 & 0x07) << 5));
+
+	// Increments of 0.006 degrees to whole degrees, limited to the valid range of -90 to 90 degrees
+	legScanAngle = static_cast<int8_t>(std::max(-90L, std::min(90L, std::lround(scanAngle * 0.006))));
+}
+
+#endif
@@ -0,0 +1,401 @@
+#if _MSC_VER > 1400
+#pragma once
+#endif
+
+#ifndef POINT_IN_POLYGON_H
+#define POINT_IN_POLYGON_H
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// Point in polygon tests against a polygon whose edges are binned into horizontal slabs. A polygon consists of
+// rings (outer rings and holes) separated by vertices with an undefined coordinate (NaN). The tests of all
+// edges of a slab give the same result as testing every edge of the polygon.
+// Polygons quantized to the integer coordinates of a LAS-File are tested with long long. Their rings are
+// separated by quantizedRingBreak and all products of the tests are exact if the polygon extent fits into
+// 31 bits and the points are inside of its bounding box.
+
+enum searchAlgorithm { WindingNumber, WindingNumberIncludeEdges, Raycast };
+
+const long long quantizedRingBreak = std::numeric_limits<long long>::min();
+
+// Edges of a polygon binned into horizontal slabs of equal height. Every edge is stored in all slabs
+// that its closed y-range touches, so a query point only has to test the edges of its own slab.
+// The edges are kept as a structure of arrays together with the coefficients of the tests, that only
+// depend on the edge, so they are computed once when the polygon is prepared and not for every point.
+template<typename T>
+struct PolygonEdgeIndex
+{
+	T minX, maxX, minY, maxY;				// Bounding box of the polygon
+	double slabScale;						// Number of slabs per unit in y
+	int slabCount;
+	std::vector<size_t> slabStart;			// Offset of the first edge of every slab (slabCount + 1 entries)
+
+	// Edges of all slabs in order of the slabs and then of the polygon. Edge k goes from vertex j (x1, y1)
+	// to vertex i (x2, y2) of a ring
+	std::vector<T> x1, y1, x2, y2;
+	std::vector<T> deltaX, deltaY;			// x2 - x1 and y2 - y1 for the side of line
+	std::vector<T> inverseSlope;			// (x1 - x2) / (y1 - y2) for the intersection of the ray
+};
+
+// Edges of one slab of the index
+template<typename T>
+struct SlabEdges
+{
+	const T* __restrict x1;
+	const T* __restrict y1;
+	const T* __restrict x2;
+	const T* __restrict y2;
+	const T* __restrict deltaX;
+	const T* __restrict deltaY;
+	const T* __restrict inverseSlope;
+	size_t count;
+};
+
+template<typename T>
+inline bool isInPolygon(const PolygonEdgeIndex<T>& index, const int& algorithm, const T& pointX, const T& pointY);
+template<typename T>
+void buildEdgeIndex(PolygonEdgeIndex<T>& index, const T* __restrict polyX, const T* __restrict polyY, const int polyCount);
+template<typename T>
+inline bool isRingVertex(const T x, const T y);
+inline bool isRingVertex(const long long x, const long long y);
+template<typename T>
+inline T inverseSlopeOf(const T deltaX, const T deltaY);
+inline long long inverseSlopeOf(const long long deltaX, const long long deltaY);
+template<typename T, typename EdgeFunction>
+inline void forEachEdge(const T* __restrict polyX, const T* __restrict polyY, const int polyCount, EdgeFunction edgeFunction);
+template<typename T>
+inline int slabOf(const PolygonEdgeIndex<T>& index, const T& y);
+template<typename T>
+inline SlabEdges<T> slabEdges(const PolygonEdgeIndex<T>& index, const int slab);
+template<typename T>
+inline bool raycast(const SlabEdges<T>& edges, const T& pointX, const T& pointY);
+inline bool raycast(const SlabEdges<long long>& edges, const long long& pointX, const long long& pointY);
+template<typename T>
+inline bool windingNumber(const SlabEdges<T>& edges, const T& pointX, const T& pointY);
+template<typename T>
+inline bool windingNumberIncludeEdges(const SlabEdges<T>& edges, const T& pointX, const T& pointY);
+
+template<typename T>
+inline T isLeft(const T polyX_1, const T polyY_1, const T deltaX, const T deltaY, const T queryX, const T queryY);
+
+// Tests a point against the slab index of a polygon with the selected algorithm.
+// Points outside of the bounding box of the polygon are never inside.
+//	Returns: true if point inside polygon, false if otherwise
+template<typename T>
+inline bool isInPolygon(const PolygonEdgeIndex<T>& index, const int& algorithm, const T& pointX, const T& pointY)
+{
+	if (!(pointX >= index.minX && pointX <= index.maxX))
+		return false;
+
+	const int slab = slabOf(index, pointY);
+	if (slab < 0)
+		return false;
+
+	const SlabEdges<T> edges = slabEdges(index, slab);
+
+	switch (algorithm)
+	{
+	case searchAlgorithm::WindingNumberIncludeEdges:
+		return windingNumberIncludeEdges(edges, pointX, pointY);
+	case searchAlgorithm::Raycast:
+		return raycast(edges, pointX, pointY);
+	default:
+		return windingNumber(edges, pointX, pointY);
+	}
+}
+
+// Builds the slab index of a polygon. The number of slabs starts at the number of edges and is halved
+// until long edges, that are stored in many slabs, need no more than four times the memory of the edges.
+// The edges of all rings share one index, so holes and multipolygons are tested in a single pass.
+template<typename T>
+void buildEdgeIndex(PolygonEdgeIndex<T>& index, const T* __restrict polyX, const T* __restrict polyY, const int polyCount)
+{
+	const T largest = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+	index.minX = index.minY = largest;
+	index.maxX = index.maxY = -largest;
+
+	for (int i = 0; i < polyCount; ++i) {
+		if (!isRingVertex(polyX[i], polyY[i]))
+			continue;
+
+		if (polyX[i] < index.minX) index.minX = polyX[i];
+		if (polyX[i] > index.maxX) index.maxX = polyX[i];
+		if (polyY[i] < index.minY) index.minY = polyY[i];
+		if (polyY[i] > index.maxY) index.maxY = polyY[i];
+	}
+
+	// Use a single slab if the polygon has no finite height
+	const double height = static_cast<double>(index.maxY) - static_cast<double>(index.minY);
+	const bool canSplit = height > 0 && height < std::numeric_limits<double>::infinity();
+	const size_t edgeLimit = 4 * static_cast<size_t>(polyCount);
+
+	index.slabCount = canSplit ? polyCount : 1;
+	std::vector<size_t> slabEdges;
+
+	for (;;) {
+		index.slabScale = index.slabCount > 1 ? index.slabCount / height : 0.0;
+		slabEdges.assign(static_cast<size_t>(index.slabCount) + 1, 0);
+		size_t edgeCount = 0;
+
+		forEachEdge(polyX, polyY, polyCount, [&](const int j, const int i) {
+			const int first = slabOf(index, polyY[i] < polyY[j] ? polyY[i] : polyY[j]);
+			const int last = slabOf(index, polyY[i] < polyY[j] ? polyY[j] : polyY[i]);
+			slabEdges[first] += 1;
+			slabEdges[static_cast<size_t>(last) + 1] -= 1;
+			edgeCount += static_cast<size_t>(last - first) + 1;
+		});
+
+		if (edgeCount <= edgeLimit || index.slabCount == 1)
+			break;
+
+		index.slabCount /= 2;
+	}
+
+	// Prefix sum of the edge counts per slab to get the first edge of every slab
+	index.slabStart.assign(static_cast<size_t>(index.slabCount) + 1, 0);
+	size_t activeEdges = 0;
+	for (int s = 0; s < index.slabCount; ++s) {
+		activeEdges += slabEdges[s];
+		index.slabStart[static_cast<size_t>(s) + 1] = index.slabStart[s] + activeEdges;
+	}
+
+	// Fill the slabs in order of the polygon edges
+	const size_t entryCount = index.slabStart[index.slabCount];
+	index.x1.resize(entryCount);
+	index.y1.resize(entryCount);
+	index.x2.resize(entryCount);
+	index.y2.resize(entryCount);
+	index.deltaX.resize(entryCount);
+	index.deltaY.resize(entryCount);
+	index.inverseSlope.resize(entryCount);
+	std::vector<size_t> slabFill(index.slabStart.begin(), index.slabStart.end() - 1);
+
+	forEachEdge(polyX, polyY, polyCount, [&](const int j, const int i) {
+		const int first = slabOf(index, polyY[i] < polyY[j] ? polyY[i] : polyY[j]);
+		const int last = slabOf(index, polyY[i] < polyY[j] ? polyY[j] : polyY[i]);
+
+		// Horizontal edges get an infinite slope, the ray never crosses them
+		const T inverseSlope = inverseSlopeOf(polyX[j] - polyX[i], polyY[j] - polyY[i]);
+
+		for (int s = first; s <= last; ++s) {
+			const size_t k = slabFill[s]++;
+			index.x1[k] = polyX[j];
+			index.y1[k] = polyY[j];
+			index.x2[k] = polyX[i];
+			index.y2[k] = polyY[i];
+			index.deltaX[k] = polyX[i] - polyX[j];
+			index.deltaY[k] = polyY[i] - polyY[j];
+			index.inverseSlope[k] = inverseSlope;
+		}
+	});
+}
+
+// Tests if a vertex belongs to a ring or separates two rings
+//	Returns: true if both coordinates are defined
+template<typename T>
+inline bool isRingVertex(const T x, const T y)
+{
+	return x == x && y == y;
+}
+
+inline bool isRingVertex(const long long x, const long long y)
+{
+	return x != quantizedRingBreak && y != quantizedRingBreak;
+}
+
+// Gets the inverse slope of an edge for the raycast. Quantized polygons use the exact raycast without slope
+template<typename T>
+inline T inverseSlopeOf(const T deltaX, const T deltaY)
+{
+	return deltaX / deltaY;
+}
+
+inline long long inverseSlopeOf(const long long, const long long)
+{
+	return 0;
+}
+
+// Calls edgeFunction(j, i) for every edge from vertex j to vertex i. Rings (outer rings and holes) are
+// separated by vertices with an undefined coordinate and every ring is closed on its own.
+template<typename T, typename EdgeFunction>
+inline void forEachEdge(const T* __restrict polyX, const T* __restrict polyY, const int polyCount, EdgeFunction edgeFunction)
+{
+	int ringStart = 0;
+
+	for (int end = 0; end <= polyCount; ++end) {
+		if (end < polyCount && isRingVertex(polyX[end], polyY[end]))
+			continue;
+
+		for (int i = ringStart, j = end - 1; i < end; j = i++) {
+			edgeFunction(j, i);
+		}
+		ringStart = end + 1;
+	}
+}
+
+// Gets the slab of a y-coordinate. The mapping is monotonic, so any y within the y-range of an edge
+// falls into one of the slabs that the edge was stored in.
+//	Returns: slab index or -1 if y is outside of the bounding box (no edge can be crossed)
+template<typename T>
+inline int slabOf(const PolygonEdgeIndex<T>& index, const T& y)
+{
+	if (!(y >= index.minY && y <= index.maxY))
+		return -1;
+
+	const double slab = (static_cast<double>(y) - static_cast<double>(index.minY)) * index.slabScale;
+
+	return slab < index.slabCount - 1 ? static_cast<int>(slab) : index.slabCount - 1;
+}
+
+// Gets the edges of a slab of the index
+template<typename T>
+inline SlabEdges<T> slabEdges(const PolygonEdgeIndex<T>& index, const int slab)
+{
+	const size_t first = index.slabStart[slab];
+	const SlabEdges<T> edges = { index.x1.data() + first, index.y1.data() + first, index.x2.data() + first, index.y2.data() + first,
+		index.deltaX.data() + first, index.deltaY.data() + first, index.inverseSlope.data() + first, index.slabStart[slab + 1] - first };
+
+	return edges;
+}
+
+// Tests if point is in polygon using the raycast algorithm. The intersection of the ray uses the
+// precomputed inverse slope of the edge instead of a division per point
+//	Returns: true if point inside polygon, false if otherwise
+template<typename T>
+inline bool raycast(const SlabEdges<T>& edges, const T& pointX, const T& pointY)
+{
+	bool inside = false;
+
+	for (size_t k = 0; k < edges.count; ++k) {
+		if (((edges.y2[k] > pointY) != (edges.y1[k] > pointY)) 
+			&& (pointX < edges.inverseSlope[k] * (pointY - edges.y2[k]) + edges.x2[k])) 
+		{
+			// Invert inside
+			inside = !inside;
+		}
+	}
+
+	return inside;
+}
+
+// Tests if a quantized point is in a quantized polygon using the raycast algorithm. Instead of computing the
+// intersection of the ray, both sides of the comparison are multiplied by the y-difference of the edge, so the
+// test is exact and points on an edge never flip it
+//	Returns: true if point inside polygon, false if otherwise
+inline bool raycast(const SlabEdges<long long>& edges, const long long& pointX, const long long& pointY)
+{
+	bool inside = false;
+
+	for (size_t k = 0; k < edges.count; ++k) {
+		if ((edges.y2[k] > pointY) != (edges.y1[k] > pointY)) {
+			const long long sideOfLine = (pointX - edges.x2[k]) * (edges.y1[k] - edges.y2[k]) - (edges.x1[k] - edges.x2[k]) * (pointY - edges.y2[k]);
+
+			// Invert inside if point is left of the intersection
+			if (edges.y1[k] > edges.y2[k] ? sideOfLine < 0 : sideOfLine > 0)
+				inside = !inside;
+		}
+	}
+
+	return inside;
+}
+
+// Tests if the winding number for a query point and a polygon is unequal to zero. 
+// If so then the point is fully inside the polygon
+//	Returns: true if point inside polygon, false if otherwise
+template<typename T>
+inline bool windingNumber(const SlabEdges<T>& edges, const T& pointX, const T& pointY)
+{
+	int winding_num = 0;  // Winding number counter
+
+	for (size_t k = 0; k < edges.count; ++k)
+	{
+		if (edges.y1[k] <= pointY) {
+
+			if (pointY < edges.y2[k]) {
+				if (isLeft(edges.x1[k], edges.y1[k], edges.deltaX[k], edges.deltaY[k], pointX, pointY) > 0)
+				{
+					// If point on the left then increase winding number
+					++winding_num;
+				}
+			}
+		}
+		else { // Ray crosses an downwards line
+			if (edges.y2[k] <= pointY) {
+				if (isLeft(edges.x1[k], edges.y1[k], edges.deltaX[k], edges.deltaY[k], pointX, pointY) < 0)
+				{
+					// If point on the right then decrease winding number
+					--winding_num;
+				}
+			}
+		}
+	}
+	return winding_num != 0;  // Only if winding_num is 0 then point is outside polygon
+};
+
+// Tests if the winding number for a query point and a polygon is unequal to zero or if point is on border
+// If so then the point is fully inside the polygon
+//	Returns: true if point inside polygon or on border, false if otherwise
+template<typename T>
+inline bool windingNumberIncludeEdges(const SlabEdges<T>& edges, const T& pointX, const T& pointY)
+{
+	int winding_num = 0;  // Winding number counter
+
+	for (size_t k = 0; k < edges.count; ++k)
+	{
+		// If query point is on vertex then count it as inside
+		if (edges.x2[k] == pointX && edges.y2[k] == pointY)
+		{
+			winding_num = 1;
+			break;
+		}
+
+		// Early continue to avoid costly calculation of point direction if ray does not intersect the segment
+		if (!((edges.y2[k] > pointY) != (edges.y1[k] > pointY)))
+			continue;
+
+		const T sideOfLine = isLeft(edges.x1[k], edges.y1[k], edges.deltaX[k], edges.deltaY[k], pointX, pointY);
+
+		// Check if the point lies on the polygon edge. If so then count as inside
+		if (sideOfLine == 0)
+		{
+			winding_num = 1;
+			break;
+		}
+
+		if (edges.y1[k] <= pointY) {
+
+			if (pointY < edges.y2[k]) {
+				if (sideOfLine > 0)
+				{
+					// If point on the left then increase winding number
+					++winding_num;
+				}
+			}
+		}
+		else { // Ray crosses an downwards line
+			if (edges.y2[k] <= pointY) {
+				if (sideOfLine < 0)
+				{
+					// If point on the right then decrease winding number
+					--winding_num;
+				}
+			}
+		}
+	}
+	return winding_num != 0;  // Only if winding_num is 0 then point is outside polygon
+};
+
+// Tests if a point is Left, Right or On a line
+//    Input:  X and Y of first point of line, X and Y difference to the second point, X and Y of query point
+//    Returns: >0 if query point is left of the line
+//             =0 if query point is on the line
+//             <0 if query point is right of the line
+template<typename T>
+inline T isLeft(const T polyX_1, const T polyY_1, const T deltaX, const T deltaY, const T queryX, const T queryY)
+{
+	return (queryY - polyY_1) * deltaX - (queryX - polyX_1) * deltaY;
+};
+
+#endif
@@ -0,0 +1,137 @@
+// Vector kernels of the point in polygon tests. This file is included once per instruction set into a namespace
+// that defines the lane types DoubleLanes and FloatLanes, so it has no include guard. Every lane computes the
+// same operations in the same order as the scalar tests in PointInPolygon.hpp.
+
+template<typename T> struct LanesOf;
+template<> struct LanesOf<double> { typedef DoubleLanes type; };
+template<> struct LanesOf<float> { typedef FloatLanes type; };
+
+// isLeft for all lanes with the precomputed deltas of the edge
+template<typename L>
+inline typename L::Vector isLeftLanes(const typename L::Vector x1, const typename L::Vector y1, const typename L::Vector deltaX, const typename L::Vector deltaY,
+	const typename L::Vector pointX, const typename L::Vector pointY)
+{
+	return L::sub(L::mul(L::sub(pointY, y1), deltaX), L::mul(L::sub(pointX, x1), deltaY));
+}
+
+// Raycast of all lanes against the edges of a slab
+template<typename L>
+inline typename L::Mask raycastLanes(const SlabEdges<typename L::Scalar>& edges, const typename L::Vector pointX, const typename L::Vector pointY)
+{
+	typename L::Mask inside = L::none();
+
+	for (size_t k = 0; k < edges.count; ++k) {
+		const typename L::Vector y2 = L::set(edges.y2[k]);
+
+		const typename L::Mask crosses = L::maskXor(L::greater(y2, pointY), L::greater(L::set(edges.y1[k]), pointY));
+		const typename L::Vector intersectionX = L::add(L::mul(L::set(edges.inverseSlope[k]), L::sub(pointY, y2)), L::set(edges.x2[k]));
+
+		// Invert inside of the lanes whose ray crosses the edge
+		inside = L::maskXor(inside, L::maskAnd(crosses, L::less(pointX, intersectionX)));
+	}
+
+	return inside;
+}
+
+// Winding number of all lanes against the edges of a slab
+template<typename L>
+inline typename L::Mask windingNumberLanes(const SlabEdges<typename L::Scalar>& edges, const typename L::Vector pointX, const typename L::Vector pointY)
+{
+	const typename L::Vector zero = L::set(0);
+	const typename L::Vector one = L::set(1);
+	typename L::Vector winding = zero;
+
+	for (size_t k = 0; k < edges.count; ++k) {
+		const typename L::Vector y1 = L::set(edges.y1[k]);
+		const typename L::Vector y2 = L::set(edges.y2[k]);
+		const typename L::Vector sideOfLine = isLeftLanes<L>(L::set(edges.x1[k]), y1, L::set(edges.deltaX[k]), L::set(edges.deltaY[k]), pointX, pointY);
+
+		// Point left of an upwards edge increases and right of a downwards edge decreases the winding number
+		const typename L::Mask startsBelow = L::lessEqual(y1, pointY);
+		const typename L::Mask upwards = L::maskAnd(L::maskAnd(startsBelow, L::less(pointY, y2)), L::greater(sideOfLine, zero));
+		const typename L::Mask downwards = L::maskAnd(L::maskAndNot(L::lessEqual(y2, pointY), startsBelow), L::less(sideOfLine, zero));
+
+		winding = L::subWhere(L::addWhere(winding, upwards, one), downwards, one);
+	}
+
+	return L::notEqual(winding, zero);
+}
+
+// Winding number of all lanes against the edges of a slab, lanes on a vertex or an edge count as inside
+template<typename L>
+inline typename L::Mask windingNumberIncludeEdgesLanes(const SlabEdges<typename L::Scalar>& edges, const typename L::Vector pointX, const typename L::Vector pointY)
+{
+	const typename L::Vector zero = L::set(0);
+	const typename L::Vector one = L::set(1);
+	typename L::Vector winding = zero;
+	typename L::Mask onBorder = L::none();
+
+	for (size_t k = 0; k < edges.count; ++k) {
+		const typename L::Vector y1 = L::set(edges.y1[k]);
+		const typename L::Vector y2 = L::set(edges.y2[k]);
+
+		// Point on the vertex
+		onBorder = L::maskOr(onBorder, L::maskAnd(L::equal(L::set(edges.x2[k]), pointX), L::equal(y2, pointY)));
+
+		// Point on the edge
+		const typename L::Mask crosses = L::maskXor(L::greater(y2, pointY), L::greater(y1, pointY));
+		const typename L::Vector sideOfLine = isLeftLanes<L>(L::set(edges.x1[k]), y1, L::set(edges.deltaX[k]), L::set(edges.deltaY[k]), pointX, pointY);
+		onBorder = L::maskOr(onBorder, L::maskAnd(crosses, L::equal(sideOfLine, zero)));
+
+		const typename L::Mask startsBelow = L::lessEqual(y1, pointY);
+		const typename L::Mask upwards = L::maskAnd(L::maskAnd(L::maskAnd(crosses, startsBelow), L::less(pointY, y2)), L::greater(sideOfLine, zero));
+		const typename L::Mask downwards = L::maskAnd(L::maskAnd(L::maskAndNot(crosses, startsBelow), L::lessEqual(y2, pointY)), L::less(sideOfLine, zero));
+
+		winding = L::subWhere(L::addWhere(winding, upwards, one), downwards, one);
+	}
+
+	return L::maskOr(onBorder, L::notEqual(winding, zero));
+}
+
+// Tests count points of one slab against the edges of that slab. The last partial vector is padded with the last
+// point, so every point goes through the vector kernels.
+//	Output: inside : 1 if point inside polygon, 0 if otherwise
+template<typename T>
+void testSlabPoints(const int algorithm, const SlabEdges<T>& edges,
+	const T* __restrict pointsX, const T* __restrict pointsY, const size_t count, uint8_t* __restrict inside)
+{
+	typedef typename LanesOf<T>::type L;
+	T paddedX[L::lanes];
+	T paddedY[L::lanes];
+
+	for (size_t first = 0; first < count; first += L::lanes) {
+		const size_t laneCount = count - first < static_cast<size_t>(L::lanes) ? count - first : static_cast<size_t>(L::lanes);
+		const T* x = pointsX + first;
+		const T* y = pointsY + first;
+
+		if (laneCount < static_cast<size_t>(L::lanes)) {
+			for (size_t l = 0; l < static_cast<size_t>(L::lanes); ++l) {
+				paddedX[l] = x[l < laneCount ? l : laneCount - 1];
+				paddedY[l] = y[l < laneCount ? l : laneCount - 1];
+			}
+			x = paddedX;
+			y = paddedY;
+		}
+
+		const typename L::Vector pointX = L::load(x);
+		const typename L::Vector pointY = L::load(y);
+		typename L::Mask result;
+
+		switch (algorithm)
+		{
+		case searchAlgorithm::WindingNumberIncludeEdges:
+			result = windingNumberIncludeEdgesLanes<L>(edges, pointX, pointY);
+			break;
+		case searchAlgorithm::Raycast:
+			result = raycastLanes<L>(edges, pointX, pointY);
+			break;
+		default:
+			result = windingNumberLanes<L>(edges, pointX, pointY);
+		}
+
+		const int bits = L::bits(result);
+		for (size_t l = 0; l < laneCount; ++l) {
+			inside[first + l] = static_cast<uint8_t>((bits >> l) & 1);
+		}
+	}
+}
@@ -0,0 +1,315 @@
+#if _MSC_VER > 1400
+#pragma once
+#endif
+
+#ifndef POINT_IN_POLYGON_SIMD_H
+#define POINT_IN_POLYGON_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "PointInPolygon.hpp"
+
+// Point in polygon tests that run 4 to 16 points through the edges of a slab in lockstep with AVX2 or AVX-512.
+// The points of a chunk are sorted by their slab first, so all lanes of a vector share the same edges.
+// Every lane computes the same operations as the scalar tests, so the results are identical. Contraction into
+// FMA is switched off for the kernels, because it would change the rounding of isLeft.
+//
+// The kernels are compiled for their instruction set only and chosen at runtime, so the mex file still runs on
+// machines without AVX2. Other platforms always use the scalar tests.
+
+enum class SimdLevel { None = 0, AVX2 = 1, AVX512 = 2 };
+
+// Number of points that are sorted by slab at once
+constexpr int simdChunkPoints = 16384;
+
+// Polygons with more slabs than this leave too few points per slab and chunk to fill the lanes
+constexpr int simdMaxSlabCount = simdChunkPoints / 16;
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LAS_PIP_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef LAS_PIP_SIMD
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace pipAvx2
+{
+	// Four double lanes with compare results as all-bits-set lanes
+	struct DoubleLanes
+	{
+		typedef double Scalar;
+		typedef __m256d Vector;
+		typedef __m256d Mask;
+		enum { lanes = 4 };
+
+		static inline Vector set(const double value) { return _mm256_set1_pd(value); }
+		static inline Vector load(const double* values) { return _mm256_loadu_pd(values); }
+		static inline Vector add(const Vector a, const Vector b) { return _mm256_add_pd(a, b); }
+		static inline Vector sub(const Vector a, const Vector b) { return _mm256_sub_pd(a, b); }
+		static inline Vector mul(const Vector a, const Vector b) { return _mm256_mul_pd(a, b); }
+		static inline Mask less(const Vector a, const Vector b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+		static inline Mask lessEqual(const Vector a, const Vector b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+		static inline Mask greater(const Vector a, const Vector b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+		static inline Mask equal(const Vector a, const Vector b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+		static inline Mask notEqual(const Vector a, const Vector b) { return _mm256_cmp_pd(a, b, _CMP_NEQ_OQ); }
+		static inline Mask none() { return _mm256_setzero_pd(); }
+		static inline Mask maskAnd(const Mask a, const Mask b) { return _mm256_and_pd(a, b); }
+		static inline Mask maskOr(const Mask a, const Mask b) { return _mm256_or_pd(a, b); }
+		static inline Mask maskXor(const Mask a, const Mask b) { return _mm256_xor_pd(a, b); }
+		static inline Mask maskAndNot(const Mask a, const Mask b) { return _mm256_andnot_pd(b, a); }
+		static inline Vector addWhere(const Vector sum, const Mask mask, const Vector one) { return _mm256_add_pd(sum, _mm256_and_pd(mask, one)); }
+		static inline Vector subWhere(const Vector sum, const Mask mask, const Vector one) { return _mm256_sub_pd(sum, _mm256_and_pd(mask, one)); }
+		static inline int bits(const Mask mask) { return _mm256_movemask_pd(mask); }
+	};
+
+	// Eight float lanes with compare results as all-bits-set lanes
+	struct FloatLanes
+	{
+		typedef float Scalar;
+		typedef __m256 Vector;
+		typedef __m256 Mask;
+		enum { lanes = 8 };
+
+		static inline Vector set(const float value) { return _mm256_set1_ps(value); }
+		static inline Vector load(const float* values) { return _mm256_loadu_ps(values); }
+		static inline Vector add(const Vector a, const Vector b) { return _mm256_add_ps(a, b); }
+		static inline Vector sub(const Vector a, const Vector b) { return _mm256_sub_ps(a, b); }
+		static inline Vector mul(const Vector a, const Vector b) { return _mm256_mul_ps(a, b); }
+		static inline Mask less(const Vector a, const Vector b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static inline Mask lessEqual(const Vector a, const Vector b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		static inline Mask greater(const Vector a, const Vector b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static inline Mask equal(const Vector a, const Vector b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+		static inline Mask notEqual(const Vector a, const Vector b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_OQ); }
+		static inline Mask none() { return _mm256_setzero_ps(); }
+		static inline Mask maskAnd(const Mask a, const Mask b) { return _mm256_and_ps(a, b); }
+		static inline Mask maskOr(const Mask a, const Mask b) { return _mm256_or_ps(a, b); }
+		static inline Mask maskXor(const Mask a, const Mask b) { return _mm256_xor_ps(a, b); }
+		static inline Mask maskAndNot(const Mask a, const Mask b) { return _mm256_andnot_ps(b, a); }
+		static inline Vector addWhere(const Vector sum, const Mask mask, const Vector one) { return _mm256_add_ps(sum, _mm256_and_ps(mask, one)); }
+		static inline Vector subWhere(const Vector sum, const Mask mask, const Vector one) { return _mm256_sub_ps(sum, _mm256_and_ps(mask, one)); }
+		static inline int bits(const Mask mask) { return _mm256_movemask_ps(mask); }
+	};
+
+#include "PointInPolygonLanes.ipp"
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace pipAvx512
+{
+	// Eight double lanes with compare results in mask registers
+	struct DoubleLanes
+	{
+		typedef double Scalar;
+		typedef __m512d Vector;
+		typedef __mmask8 Mask;
+		enum { lanes = 8 };
+
+		static inline Vector set(const double value) { return _mm512_set1_pd(value); }
+		static inline Vector load(const double* values) { return _mm512_loadu_pd(values); }
+		static inline Vector add(const Vector a, const Vector b) { return _mm512_add_pd(a, b); }
+		static inline Vector sub(const Vector a, const Vector b) { return _mm512_sub_pd(a, b); }
+		static inline Vector mul(const Vector a, const Vector b) { return _mm512_mul_pd(a, b); }
+		static inline Mask less(const Vector a, const Vector b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+		static inline Mask lessEqual(const Vector a, const Vector b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+		static inline Mask greater(const Vector a, const Vector b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+		static inline Mask equal(const Vector a, const Vector b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+		static inline Mask notEqual(const Vector a, const Vector b) { return _mm512_cmp_pd_mask(a, b, _CMP_NEQ_OQ); }
+		static inline Mask none() { return 0; }
+		static inline Mask maskAnd(const Mask a, const Mask b) { return static_cast<Mask>(a & b); }
+		static inline Mask maskOr(const Mask a, const Mask b) { return static_cast<Mask>(a | b); }
+		static inline Mask maskXor(const Mask a, const Mask b) { return static_cast<Mask>(a ^ b); }
+		static inline Mask maskAndNot(const Mask a, const Mask b) { return static_cast<Mask>(a & ~b); }
+		static inline Vector addWhere(const Vector sum, const Mask mask, const Vector one) { return _mm512_mask_add_pd(sum, mask, sum, one); }
+		static inline Vector subWhere(const Vector sum, const Mask mask, const Vector one) { return _mm512_mask_sub_pd(sum, mask, sum, one); }
+		static inline int bits(const Mask mask) { return static_cast<int>(mask); }
+	};
+
+	// Sixteen float lanes with compare results in mask registers
+	struct FloatLanes
+	{
+		typedef float Scalar;
+		typedef __m512 Vector;
+		typedef __mmask16 Mask;
+		enum { lanes = 16 };
+
+		static inline Vector set(const float value) { return _mm512_set1_ps(value); }
+		static inline Vector load(const float* values) { return _mm512_loadu_ps(values); }
+		static inline Vector add(const Vector a, const Vector b) { return _mm512_add_ps(a, b); }
+		static inline Vector sub(const Vector a, const Vector b) { return _mm512_sub_ps(a, b); }
+		static inline Vector mul(const Vector a, const Vector b) { return _mm512_mul_ps(a, b); }
+		static inline Mask less(const Vector a, const Vector b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+		static inline Mask lessEqual(const Vector a, const Vector b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+		static inline Mask greater(const Vector a, const Vector b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+		static inline Mask equal(const Vector a, const Vector b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+		static inline Mask notEqual(const Vector a, const Vector b) { return _mm512_cmp_ps_mask(a, b, _CMP_NEQ_OQ); }
+		static inline Mask none() { return 0; }
+		static inline Mask maskAnd(const Mask a, const Mask b) { return static_cast<Mask>(a & b); }
+		static inline Mask maskOr(const Mask a, const Mask b) { return static_cast<Mask>(a | b); }
+		static inline Mask maskXor(const Mask a, const Mask b) { return static_cast<Mask>(a ^ b); }
+		static inline Mask maskAndNot(const Mask a, const Mask b) { return static_cast<Mask>(a & ~b); }
+		static inline Vector addWhere(const Vector sum, const Mask mask, const Vector one) { return _mm512_mask_add_ps(sum, mask, sum, one); }
+		static inline Vector subWhere(const Vector sum, const Mask mask, const Vector one) { return _mm512_mask_sub_ps(sum, mask, sum, one); }
+		static inline int bits(const Mask mask) { return static_cast<int>(mask); }
+	};
+
+#include "PointInPolygonLanes.ipp"
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif // LAS_PIP_SIMD
+
+// Detects the widest instruction set that the CPU and the operating system support
+inline SimdLevel detectSimdLevel()
+{
+#if defined(LAS_PIP_SIMD) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return SimdLevel::None;
+
+	// AVX and saved YMM registers (OSXSAVE) are required for any of the kernels
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+		return SimdLevel::None;
+
+	const unsigned long long enabledState = _xgetbv(0);
+	if ((enabledState & 0x6) != 0x6)
+		return SimdLevel::None;
+
+	__cpuidex(info, 7, 0);
+	if ((info[1] & (1 << 16)) != 0 && (enabledState & 0xE6) == 0xE6)
+		return SimdLevel::AVX512;
+	if ((info[1] & (1 << 5)) != 0)
+		return SimdLevel::AVX2;
+
+	return SimdLevel::None;
+#elif defined(LAS_PIP_SIMD)
+	// Also checks that the operating system saves the registers
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return SimdLevel::AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return SimdLevel::AVX2;
+
+	return SimdLevel::None;
+#else
+	return SimdLevel::None;
+#endif
+}
+
+// Gets the instruction set of the kernels, detected once
+inline SimdLevel getSimdLevel()
+{
+	static const SimdLevel level = detectSimdLevel();
+	return level;
+}
+
+// Buffers of one thread to sort the points of a chunk by slab
+template<typename T>
+struct SlabChunk
+{
+	std::vector<int> slab;			// Slab of every point (-1 if rejected)
+	std::vector<int> order;			// Points sorted by slab
+	std::vector<size_t> slabFirst;	// First sorted point of every slab (slabCount + 1 entries)
+	std::vector<size_t> slabFill;	// Next free sorted position of every slab
+	std::vector<T> x, y;			// Coordinates in sorted order
+	std::vector<uint8_t> inside;	// Results in sorted order
+};
+
+// Tests count points against the slab index with the vector kernels of the given level. The points are sorted by
+// slab, every slab is tested with its own edges and the results are written back in the original order.
+// The level has to be one of the detected instruction sets, not SimdLevel::None.
+//	Output: result : true if point inside polygon, false if otherwise
+template<typename T>
+void testPointsSimd(const PolygonEdgeIndex<T>& index, const int algorithm, const SimdLevel level,
+	const T* __restrict pointsX, const T* __restrict pointsY, const int count, bool* __restrict result, SlabChunk<T>& chunk)
+{
+	chunk.slab.resize(count);
+	chunk.order.resize(count);
+	chunk.x.resize(count);
+	chunk.y.resize(count);
+	chunk.inside.resize(count);
+	chunk.slabFirst.assign(static_cast<size_t>(index.slabCount) + 1, 0);
+
+	// Same early rejects as the scalar tests: outside of the slabs, and right of the box for the winding number
+	const bool rejectRight = algorithm != searchAlgorithm::WindingNumberIncludeEdges && algorithm != searchAlgorithm::Raycast;
+
+	for (int i = 0; i < count; ++i) {
+		const int slab = rejectRight && !(pointsX[i] <= index.maxX) ? -1 : slabOf(index, pointsY[i]);
+		chunk.slab[i] = slab;
+		result[i] = false;
+
+		if (slab >= 0)
+			++chunk.slabFirst[static_cast<size_t>(slab) + 1];
+	}
+
+	for (int s = 0; s < index.slabCount; ++s) {
+		chunk.slabFirst[static_cast<size_t>(s) + 1] += chunk.slabFirst[s];
+	}
+
+	chunk.slabFill.assign(chunk.slabFirst.begin(), chunk.slabFirst.end() - 1);
+
+	for (int i = 0; i < count; ++i) {
+		if (chunk.slab[i] < 0)
+			continue;
+
+		const size_t position = chunk.slabFill[chunk.slab[i]]++;
+		chunk.order[position] = i;
+		chunk.x[position] = pointsX[i];
+		chunk.y[position] = pointsY[i];
+	}
+
+	// Test the points of every slab against its edges
+	for (int s = 0; s < index.slabCount; ++s) {
+		const size_t first = chunk.slabFirst[s];
+		const size_t slabPoints = chunk.slabFirst[static_cast<size_t>(s) + 1] - first;
+		if (slabPoints == 0)
+			continue;
+
+		const SlabEdges<T> edges = slabEdges(index, s);
+
+#ifdef LAS_PIP_SIMD
+		if (level == SimdLevel::AVX512)
+			pipAvx512::testSlabPoints(algorithm, edges, chunk.x.data() + first, chunk.y.data() + first, slabPoints, chunk.inside.data() + first);
+		else
+			pipAvx2::testSlabPoints(algorithm, edges, chunk.x.data() + first, chunk.y.data() + first, slabPoints, chunk.inside.data() + first);
+#endif
+	}
+
+	const size_t sortedCount = chunk.slabFirst[index.slabCount];
+	for (size_t k = 0; k < sortedCount; ++k) {
+		result[chunk.order[k]] = chunk.inside[k] != 0;
+	}
+}
+
+#endif
@@ -0,0 +1,204 @@
+#if _MSC_VER > 1400
+#pragma once
+#endif
+
+#ifndef POINT_NORMALS_H
+#define POINT_NORMALS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "KdTree.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Normal and curvature estimation of point clouds from the covariance of the neighbourhood of every point.
+// The normal is the eigenvector of the smallest eigenvalue of the covariance and the curvature is the surface
+// variation: smallest eigenvalue / sum of the eigenvalues. It is 0 for points on a plane and at most 1/3.
+// The neighbourhood are the k nearest neighbours of a point within a radius, or all points within the radius.
+// The point itself is part of its neighbourhood. A normal needs at least three neighbours that do not all coincide,
+// otherwise it is NaN.
+//
+// The sign of an eigenvector is arbitrary, so the normals are flipped towards a viewpoint, e.g. the position of
+// the scanner, or upwards (positive z) without a viewpoint.
+
+// Sums of the coordinates and their products of a neighbourhood relative to its query point.
+// The query point is close to its neighbours, so the sums keep their precision for large coordinates
+struct NeighbourhoodMoments
+{
+	double	sum[3]			= { 0, 0, 0 };
+	double	products[6]		= { 0, 0, 0, 0, 0, 0 };		// xx, xy, xz, yy, yz, zz
+	size_t	count			= 0;
+
+	inline void Add(const double point[3], const double query[3])
+	{
+		const double dx = point[0] - query[0];
+		const double dy = point[1] - query[1];
+		const double dz = point[2] - query[2];
+
+		sum[0] += dx; sum[1] += dy; sum[2] += dz;
+		products[0] += dx * dx; products[1] += dx * dy; products[2] += dx * dz;
+		products[3] += dy * dy; products[4] += dy * dz; products[5] += dz * dz;
+		++count;
+	}
+};
+
+// Gets the eigenvalues and eigenvectors of a symmetric 3x3 matrix with cyclic Jacobi rotations.
+// The matrix is overwritten. The eigenvectors are the columns of vectors, vectors[row][column]
+inline void symmetricEigen3(double matrix[3][3], double values[3], double vectors[3][3])
+{
+	for (int row = 0; row < 3; ++row) {
+		for (int column = 0; column < 3; ++column) {
+			vectors[row][column] = row == column ? 1 : 0;
+		}
+	}
+
+	for (int sweep = 0; sweep < 50; ++sweep)
+	{
+		const double offDiagonal = std::fabs(matrix[0][1]) + std::fabs(matrix[0][2]) + std::fabs(matrix[1][2]);
+		const double diagonal = std::fabs(matrix[0][0]) + std::fabs(matrix[1][1]) + std::fabs(matrix[2][2]);
+
+		if (offDiagonal <= diagonal * std::numeric_limits<double>::epsilon() * 1e-3 || offDiagonal == 0)
+			break;
+
+		for (int p = 0; p < 2; ++p) {
+			for (int q = p + 1; q < 3; ++q)
+			{
+				if (matrix[p][q] == 0)
+					continue;
+
+				// Rotation that zeroes the element (p, q), the smaller angle is taken for stability
+				const double theta = (matrix[q][q] - matrix[p][p]) / (2 * matrix[p][q]);
+				const double t = (theta >= 0 ? 1 : -1) / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+				const double c = 1 / std::sqrt(t * t + 1);
+				const double s = t * c;
+
+				matrix[p][p] -= t * matrix[p][q];
+				matrix[q][q] += t * matrix[p][q];
+				matrix[p][q] = matrix[q][p] = 0;
+
+				const int r = 3 - p - q;
+				const double rp = matrix[r][p];
+				const double rq = matrix[r][q];
+				matrix[r][p] = matrix[p][r] = c * rp - s * rq;
+				matrix[r][q] = matrix[q][r] = s * rp + c * rq;
+
+				for (int row = 0; row < 3; ++row) {
+					const double vp = vectors[row][p];
+					const double vq = vectors[row][q];
+					vectors[row][p] = c * vp - s * vq;
+					vectors[row][q] = s * vp + c * vq;
+				}
+			}
+		}
+	}
+
+	for (int axis = 0; axis < 3; ++axis) {
+		values[axis] = matrix[axis][axis];
+	}
+}
+
+// Gets the normal and curvature of a neighbourhood. The normal points towards the direction
+//	Returns: false if the neighbourhood has less than three points or all of them coincide
+inline bool normalOfNeighbourhood(const NeighbourhoodMoments& moments, const double direction[3], double normal[3], double& curvature)
+{
+	if (moments.count < 3)
+		return false;
+
+	const double n = static_cast<double>(moments.count);
+	const double mean[3] = { moments.sum[0] / n, moments.sum[1] / n, moments.sum[2] / n };
+
+	double covariance[3][3];
+	covariance[0][0] = moments.products[0] / n - mean[0] * mean[0];
+	covariance[0][1] = covariance[1][0] = moments.products[1] / n - mean[0] * mean[1];
+	covariance[0][2] = covariance[2][0] = moments.products[2] / n - mean[0] * mean[2];
+	covariance[1][1] = moments.products[3] / n - mean[1] * mean[1];
+	covariance[1][2] = covariance[2][1] = moments.products[4] / n - mean[1] * mean[2];
+	covariance[2][2] = moments.products[5] / n - mean[2] * mean[2];
+
+	double values[3], vectors[3][3];
+	symmetricEigen3(covariance, values, vectors);
+
+	int smallest = 0;
+	for (int axis = 1; axis < 3; ++axis) {
+		if (values[axis] < values[smallest]) smallest = axis;
+	}
+
+	// Rounding can make an eigenvalue of a plane slightly negative. Coincident points have no normal
+	const double clamped[3] = { std::max(values[0], 0.0), std::max(values[1], 0.0), std::max(values[2], 0.0) };
+	const double total = clamped[0] + clamped[1] + clamped[2];
+
+	if (!(total > 0))
+		return false;
+
+	curvature = clamped[smallest] / total;
+
+	const double sign = vectors[0][smallest] * direction[0] + vectors[1][smallest] * direction[1] + vectors[2][smallest] * direction[2] < 0 ? -1 : 1;
+
+	for (int axis = 0; axis < 3; ++axis) {
+		normal[axis] = sign * vectors[axis][smallest];
+	}
+
+	return true;
+}
+
+// Estimates the normal and curvature of every point of the tree. Neighbourhoods are the k nearest neighbours within
+// the radius, or all points within the radius if k is zero. Normals are flipped towards the viewpoint or upwards
+// if it is null. The outputs are indexed by the input index of the points, normals has three columns of count rows.
+// Points that are not in the tree and points without a normal keep their values
+template<typename Index>
+void estimatePointNormals(const KdTree<Index>& tree, const size_t count, const size_t k, const double radius, const double* viewpoint,
+	double* __restrict normals, double* __restrict curvatures)
+{
+	const long long treeSize = static_cast<long long>(tree.Size());
+	const double squaredRadius = radius * radius;
+
+	// The points are processed in tree order, so the neighbourhoods of consecutive points share their cache lines
+#pragma omp parallel if (treeSize > 10000)
+	{
+		std::vector<KdNeighbour> neighbours;
+		neighbours.reserve(k);
+
+#pragma omp for schedule(dynamic, 1024)
+		for (long long position = 0; position < treeSize; ++position)
+		{
+			const KdTreePoint<Index>& point = tree.Point(static_cast<size_t>(position));
+			NeighbourhoodMoments moments;
+
+			if (k > 0) {
+				tree.Nearest(point.xyz, k, squaredRadius, neighbours);
+
+				for (size_t n = 0; n < neighbours.size(); ++n) {
+					moments.Add(tree.Point(neighbours[n].position).xyz, point.xyz);
+				}
+			}
+			else {
+				auto addNeighbour = [&](const size_t neighbour, const double) { moments.Add(tree.Point(neighbour).xyz, point.xyz); };
+				tree.Within(point.xyz, squaredRadius, addNeighbour);
+			}
+
+			double direction[3] = { 0, 0, 1 };
+			if (viewpoint != nullptr) {
+				for (int axis = 0; axis < 3; ++axis) {
+					direction[axis] = viewpoint[axis] - point.xyz[axis];
+				}
+			}
+
+			double normal[3], curvature;
+			if (!normalOfNeighbourhood(moments, direction, normal, curvature))
+				continue;
+
+			const size_t index = static_cast<size_t>(point.index);
+			normals[index] = normal[0];
+			normals[count + index] = normal[1];
+			normals[2 * count + index] = normal[2];
+			curvatures[index] = curvature;
+		}
+	}
+}
+
+#endif // !POINT_NORMALS_H
@@ -0,0 +1,30 @@
+#if _MSC_VER > 1400
+#pragma once
+#endif
+
+#ifndef PROCESSING_THREADS_H
+#define PROCESSING_THREADS_H
+
+#include "mex.h"
+#include <thread>
+
+// Gets the number of processing threads from the given argument (0-based) of a mex function
+//	Returns: argument or available threads, depending on which is smaller. Values below 1 select all available
+//	threads, a missing or empty argument selects 1 thread
+inline int getNumberOfThreads(const mxArray* prhs[], int nrhs, int argument)
+{
+	int numberOfThreads = 1;
+
+	// Set number of threads according to argument or available threads, depending on which is smaller
+	if (nrhs > argument && !mxIsEmpty(prhs[argument])) {
+		const int machine_num_threads = std::thread::hardware_concurrency();
+		const int inputThreadNumber = static_cast<int>(mxGetScalar(prhs[argument]));
+
+		numberOfThreads = inputThreadNumber < machine_num_threads ? inputThreadNumber : machine_num_threads;
+		numberOfThreads = numberOfThreads < 1 ? machine_num_threads : numberOfThreads;
+	}
+
+	return numberOfThreads;
+}
+
+#endif // !PROCESSING_THREADS_H
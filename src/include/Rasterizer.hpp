@@ -0,0 +1,347 @@
+#if _MSC_VER > 1400
+#pragma once
+#endif
+
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Rasterization of point records into a regular 2D grid of square cells. Every layer of the raster reduces the
+// z coordinates or intensities of the points of a cell to one value: minimum, maximum, mean, count or a percentile.
+// Row 1 of the raster is the top row (largest y) and column 1 the left column (smallest x), like an image.
+//
+// Minimum, maximum, mean and count are accumulated while the points are streamed, so they only need memory for the
+// cells. Percentiles need all values of a cell. They are collected in bands of rows after the counts of the cells are
+// known: every band holds at most valueBudget bytes of values (but at least one row) and the points are streamed
+// once more for every band. The percentile is the value of nearest rank ceil(p / 100 * n) of the n values of a cell.
+//
+// Grid and bands are checked against memoryLimit before they are allocated: the output, the counts and the offsets
+// of a band of one row have to fit at once, and so do the values of the first row of a band if they alone exceed
+// valueBudget. Otherwise std::length_error is thrown.
+
+enum class RasterReducer { Min = 0, Max = 1, Mean = 2, Count = 3, Percentile = 4 };
+enum class RasterField { Z = 0, Intensity = 1 };
+
+constexpr int rasterFieldCount = 2;
+
+struct RasterLayer
+{
+	RasterReducer	reducer		= RasterReducer::Count;
+	RasterField		field		= RasterField::Z;
+	double			percentile	= 50;		// Percentile in [0 100] of the Percentile reducer
+};
+
+class PointRaster
+{
+public:
+	// Allocates the output of the raster with rows * columns * layers elements, e.g. as Matlab array
+	typedef std::function<double* (size_t rows, size_t columns, size_t layers)> Allocator;
+
+	PointRaster(const std::vector<RasterLayer>& layers, double cellSize, size_t valueBudget, double memoryLimit)
+		: m_layers(layers), m_cellSize(cellSize), m_valueBudget(valueBudget), m_memoryLimit(memoryLimit) {}
+
+	// Sets the extent of the grid. The extent is widened to whole cells, points outside of it are ignored.
+	// Rows and columns are computed in double precision, so the size is checked before it is converted
+	void SetExtent(double minX, double minY, double maxX, double maxY)
+	{
+		const double columns = std::max(std::ceil((maxX - minX) / m_cellSize), 1.0);
+		const double rows = std::max(std::ceil((maxY - minY) / m_cellSize), 1.0);
+
+		// Output and counts of every cell and offsets and write positions of a band of one row
+		const double gridBytes = columns * rows * static_cast<double>((m_layers.size() + 1) * sizeof(double)) + 2 * (columns + 1) * sizeof(size_t);
+
+		if (!(gridBytes <= m_memoryLimit)) {
+			throw std::length_error("Raster of the extent and cell size needs more memory than available!");
+		}
+
+		m_columns = static_cast<size_t>(columns);
+		m_rows = static_cast<size_t>(rows);
+		m_gridBytes = gridBytes;
+		m_minX = minX;
+		m_minY = minY;
+		m_maxX = minX + static_cast<double>(m_columns) * m_cellSize;
+		m_maxY = minY + static_cast<double>(m_rows) * m_cellSize;
+	}
+
+	// Sets the extent to whole multiples of the cell size around a bounding box, so rasters of neighbouring
+	// files or deliveries share their cell borders
+	void SnapExtent(double minX, double minY, double maxX, double maxY)
+	{
+		const double snappedMinX = std::floor(minX / m_cellSize) * m_cellSize;
+		const double snappedMinY = std::floor(minY / m_cellSize) * m_cellSize;
+		const double snappedMaxX = (std::floor(maxX / m_cellSize) + 1) * m_cellSize;
+		const double snappedMaxY = (std::floor(maxY / m_cellSize) + 1) * m_cellSize;
+		SetExtent(snappedMinX, snappedMinY, snappedMaxX, snappedMaxY);
+	}
+
+	void SetAllocator(const Allocator& allocator) { m_allocator = allocator; }
+
+	// Allocates the output and the accumulators of all cells. Points added afterwards are accumulated
+	void BeginAccumulation()
+	{
+		const size_t cellCount = CellCount();
+		const size_t layerCount = m_layers.size();
+
+		if (m_allocator) {
+			m_output = m_allocator(m_rows, m_columns, layerCount);
+		}
+		else {
+			m_ownOutput.assign(cellCount * layerCount, 0);
+			m_output = m_ownOutput.data();
+		}
+
+		for (size_t layer = 0; layer < layerCount; ++layer)
+		{
+			const RasterReducer reducer = m_layers[layer].reducer;
+			const double initial = reducer == RasterReducer::Min ? std::numeric_limits<double>::infinity()
+				: (reducer == RasterReducer::Max ? -std::numeric_limits<double>::infinity() : 0);
+
+			std::fill(m_output + layer * cellCount, m_output + (layer + 1) * cellCount, initial);
+		}
+
+		m_counts.assign(cellCount, 0);
+		m_isCollecting = false;
+	}
+
+	// Adds a point to its cell
+	inline void Add(const double x, const double y, const double z, const double intensity)
+	{
+		double column = std::floor((x - m_minX) / m_cellSize);
+		double row = std::floor((m_maxY - y) / m_cellSize);
+
+		// Cells hold their left and top border, the right and bottom border of the extent belong to the last column and row
+		if (column == static_cast<double>(m_columns) && x <= m_maxX) column -= 1;
+		if (row == static_cast<double>(m_rows) && y >= m_minY) row -= 1;
+
+		if (!(column >= 0 && column < static_cast<double>(m_columns) && row >= 0 && row < static_cast<double>(m_rows)))
+			return;
+
+		const size_t c = static_cast<size_t>(column);
+		const size_t r = static_cast<size_t>(row);
+		const double values[rasterFieldCount] = { z, intensity };
+
+		if (m_isCollecting) {
+			collect(r, c, values);
+			return;
+		}
+
+		const size_t cell = c * m_rows + r;
+		const size_t cellCount = CellCount();
+		++m_counts[cell];
+
+		for (size_t layer = 0; layer < m_layers.size(); ++layer)
+		{
+			double& result = m_output[layer * cellCount + cell];
+			const double value = values[static_cast<int>(m_layers[layer].field)];
+
+			switch (m_layers[layer].reducer)
+			{
+			case RasterReducer::Min:	if (value < result) result = value; break;
+			case RasterReducer::Max:	if (value > result) result = value; break;
+			case RasterReducer::Mean:	result += value; break;
+			default: break;
+			}
+		}
+	}
+
+	// Turns the sums into means and sets the count layers. Empty cells are NaN except of counts
+	void EndAccumulation()
+	{
+		const long long cellCount = static_cast<long long>(CellCount());
+		const double undefined = std::numeric_limits<double>::quiet_NaN();
+
+		for (size_t layer = 0; layer < m_layers.size(); ++layer)
+		{
+			double* pLayer = m_output + layer * CellCount();
+			const RasterReducer reducer = m_layers[layer].reducer;
+
+#pragma omp parallel for if (cellCount > 100000)
+			for (long long cell = 0; cell < cellCount; ++cell)
+			{
+				const double count = static_cast<double>(m_counts[cell]);
+
+				if (reducer == RasterReducer::Count)
+					pLayer[cell] = count;
+				else if (count == 0)
+					pLayer[cell] = undefined;
+				else if (reducer == RasterReducer::Mean)
+					pLayer[cell] /= count;
+			}
+		}
+
+		m_nextBandRow = 0;
+	}
+
+	// Prepares the collection of the values of the next band of rows for the percentiles
+	//	Returns: false if all bands are done or no layer needs the values
+	bool NextBand()
+	{
+		m_isCollecting = false;
+
+		bool needsField[rasterFieldCount] = { false, false };
+		for (const RasterLayer& layer : m_layers) {
+			if (layer.reducer == RasterReducer::Percentile) needsField[static_cast<int>(layer.field)] = true;
+		}
+
+		m_bandFieldCount = 0;
+		for (int field = 0; field < rasterFieldCount; ++field) {
+			m_bandFieldSlot[field] = needsField[field] ? m_bandFieldCount++ : -1;
+		}
+
+		if (m_bandFieldCount == 0 || m_nextBandRow >= m_rows)
+			return false;
+
+		// Rows are added to the band while its values, offsets and write positions fit into the budget and next to the grid
+		const double bandLimit = std::min(static_cast<double>(m_valueBudget), m_memoryLimit - m_gridBytes);
+		m_bandFirstRow = m_nextBandRow;
+		m_bandRows = 0;
+		size_t bandBytes = 0;
+
+		while (m_bandFirstRow + m_bandRows < m_rows)
+		{
+			size_t rowValues = 0;
+			for (size_t c = 0; c < m_columns; ++c) {
+				rowValues += static_cast<size_t>(m_counts[c * m_rows + m_bandFirstRow + m_bandRows]);
+			}
+
+			const size_t rowBytes = rowValues * m_bandFieldCount * sizeof(double) + 2 * m_columns * sizeof(size_t);
+			if (m_bandRows > 0 && static_cast<double>(bandBytes + rowBytes) > bandLimit)
+				break;
+
+			// A row is collected even if it exceeds the budget, but not if it does not fit next to the grid
+			if (m_bandRows == 0 && static_cast<double>(rowBytes) > m_memoryLimit - m_gridBytes)
+				throw std::length_error("Values of a row of the raster need more memory than available, use a larger cell size!");
+
+			bandBytes += rowBytes;
+			++m_bandRows;
+		}
+
+		m_nextBandRow = m_bandFirstRow + m_bandRows;
+
+		// Values of a cell are stored one after another, the cells of the band in column major order
+		const size_t bandCells = m_bandRows * m_columns;
+		m_bandOffsets.assign(bandCells + 1, 0);
+
+		for (size_t c = 0; c < m_columns; ++c) {
+			for (size_t r = 0; r < m_bandRows; ++r) {
+				const size_t bandCell = c * m_bandRows + r;
+				m_bandOffsets[bandCell + 1] = m_bandOffsets[bandCell] + static_cast<size_t>(m_counts[c * m_rows + m_bandFirstRow + r]);
+			}
+		}
+
+		m_bandPositions.assign(m_bandOffsets.begin(), m_bandOffsets.end() - 1);
+		m_bandValues.assign(m_bandOffsets[bandCells] * m_bandFieldCount, 0);
+		m_isCollecting = true;
+		return true;
+	}
+
+	// Selects the percentiles of the cells of the collected band
+	void ReduceBand()
+	{
+		const size_t bandCells = m_bandRows * m_columns;
+		const size_t bandValueCount = m_bandOffsets[bandCells];
+		const size_t cellCount = CellCount();
+
+		for (size_t layer = 0; layer < m_layers.size(); ++layer)
+		{
+			if (m_layers[layer].reducer != RasterReducer::Percentile)
+				continue;
+
+			double* pValues = m_bandValues.data() + m_bandFieldSlot[static_cast<int>(m_layers[layer].field)] * bandValueCount;
+			double* pLayer = m_output + layer * cellCount;
+			const double fraction = m_layers[layer].percentile / 100;
+
+#pragma omp parallel for schedule(dynamic, 256) if (bandValueCount > 100000)
+			for (long long bandCell = 0; bandCell < static_cast<long long>(bandCells); ++bandCell)
+			{
+				const size_t c = static_cast<size_t>(bandCell) / m_bandRows;
+				const size_t r = m_bandFirstRow + static_cast<size_t>(bandCell) % m_bandRows;
+				double* pBegin = pValues + m_bandOffsets[bandCell];
+				const size_t count = m_bandOffsets[bandCell + 1] - m_bandOffsets[bandCell];
+
+				if (count == 0)
+					continue;
+
+				// Nearest rank, the values of earlier percentiles are partially sorted which does not matter
+				const double rank = std::ceil(fraction * static_cast<double>(count));
+				const size_t k = rank < 1 ? 0 : std::min(static_cast<size_t>(rank) - 1, count - 1);
+				std::nth_element(pBegin, pBegin + k, pBegin + count);
+				pLayer[c * m_rows + r] = pBegin[k];
+			}
+		}
+	}
+
+	inline size_t Rows() const { return m_rows; }
+	inline size_t Columns() const { return m_columns; }
+	inline size_t CellCount() const { return m_rows * m_columns; }
+	inline size_t LayerCount() const { return m_layers.size(); }
+	inline bool IsCollecting() const { return m_isCollecting; }
+
+	// Extent of the grid as [minX minY maxX maxY]
+	void GetExtent(double extent[4]) const
+	{
+		extent[0] = m_minX;
+		extent[1] = m_minY;
+		extent[2] = m_maxX;
+		extent[3] = m_maxY;
+	}
+
+	const double* Output() const { return m_output; }
+
+private:
+	inline void collect(const size_t r, const size_t c, const double values[rasterFieldCount])
+	{
+		if (r < m_bandFirstRow || r >= m_bandFirstRow + m_bandRows)
+			return;
+
+		const size_t bandCell = c * m_bandRows + (r - m_bandFirstRow);
+		const size_t position = m_bandPositions[bandCell]++;
+		const size_t bandValueCount = m_bandOffsets.back();
+
+		for (int field = 0; field < rasterFieldCount; ++field) {
+			if (m_bandFieldSlot[field] >= 0) m_bandValues[m_bandFieldSlot[field] * bandValueCount + position] = values[field];
+		}
+	}
+
+	std::vector<RasterLayer>	m_layers;
+	double						m_cellSize		= 1;
+	size_t						m_valueBudget	= 0;
+	double						m_memoryLimit	= 0;	// Bytes the grid and a band may allocate
+	double						m_gridBytes		= 0;	// Bytes of the grid and of the offsets of a band of one row
+	double						m_minX			= 0;	// Borders of the grid
+	double						m_minY			= 0;
+	double						m_maxX			= 1;
+	double						m_maxY			= 1;
+	size_t						m_rows			= 1;
+	size_t						m_columns		= 1;
+
+	Allocator					m_allocator;
+	double*						m_output		= nullptr;	// Layers one after another, cells in column major order
+	std::vector<double>			m_ownOutput;
+	std::vector<uint64_t>		m_counts;
+
+	// Band of rows whose values are collected for the percentiles
+	bool						m_isCollecting	= false;
+	size_t						m_nextBandRow	= 0;
+	size_t						m_bandFirstRow	= 0;
+	size_t						m_bandRows		= 0;
+	int							m_bandFieldCount = 0;
+	int							m_bandFieldSlot[rasterFieldCount] = { -1, -1 };	// Position of the values of a field in m_bandValues or -1
+	std::vector<size_t>			m_bandOffsets;		// First value of every cell of the band
+	std::vector<size_t>			m_bandPositions;	// Next free value of every cell of the band
+	std::vector<double>			m_bandValues;		// Values of the fields one after another
+};
+
+#endif // !RASTERIZER_H
@@ -0,0 +1,224 @@
+#if _MSC_VER > 1400
+#pragma once
+#endif
+
+#ifndef SPATIAL_SORT_H
+#define SPATIAL_SORT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Keys of space filling curves and a parallel radix sort to order points spatially.
+// Quantized coordinates are mapped onto a grid of 2^21 cells per axis inside of the bounding box, so a key of
+// a 3D curve fits into 63 bits. Points that are close in the key order are close in space, which makes
+// bounding box and polygon queries, compression and neighbourhood searches on the sorted points faster.
+
+enum class SpatialOrder { None = 0, Morton = 1, Hilbert = 2 };
+
+constexpr int		spatialGridBits		= 21;
+constexpr uint32_t	spatialGridMaxCell	= (1u << spatialGridBits) - 1;
+
+// Maps the quantized coordinates of the bounding box onto the grid. One factor for all axes keeps the cells cubic
+struct SpatialGrid
+{
+	int32_t minXYZ[3]		= { 0, 0, 0 };
+	double	cellsPerUnit	= 0;
+
+	SpatialGrid() = default;
+
+	SpatialGrid(const int32_t minimum[3], const int32_t maximum[3])
+	{
+		double largestExtent = 1.0;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			minXYZ[axis] = minimum[axis];
+			largestExtent = std::max(largestExtent, static_cast<double>(maximum[axis]) - static_cast<double>(minimum[axis]));
+		}
+
+		cellsPerUnit = spatialGridMaxCell / largestExtent;
+	}
+
+	// Grid cell of a quantized coordinate, values outside of the bounding box are clamped to the border cells
+	inline uint32_t Cell(int32_t value, int axis) const
+	{
+		const double cell = (static_cast<double>(value) - minXYZ[axis]) * cellsPerUnit;
+
+		if (!(cell > 0)) { return 0; }
+		if (cell >= spatialGridMaxCell) { return spatialGridMaxCell; }
+		return static_cast<uint32_t>(cell);
+	}
+};
+
+// Spreads the lower 21 bits of value so that two zero bits follow each bit
+inline uint64_t spreadBits3(uint32_t value)
+{
+	uint64_t x = value & 0x1FFFFF;
+	x = (x | x << 32) & 0x001F00000000FFFFull;
+	x = (x | x << 16) & 0x001F0000FF0000FFull;
+	x = (x | x << 8)  & 0x100F00F00F00F00Full;
+	x = (x | x << 4)  & 0x10C30C30C30C30C3ull;
+	x = (x | x << 2)  & 0x1249249249249249ull;
+	return x;
+}
+
+// Morton (Z-order) key of a grid cell. Bits of x are the most significant of each triple
+inline uint64_t mortonKey(uint32_t x, uint32_t y, uint32_t z)
+{
+	return (spreadBits3(x) << 2) | (spreadBits3(y) << 1) | spreadBits3(z);
+}
+
+// Hilbert key of a grid cell (J. Skilling, Programming the Hilbert curve, AIP Conf. Proc. 707, 2004).
+// The axes are transformed into the transposed Hilbert index, whose interleaved bits are the key
+inline uint64_t hilbertKey(uint32_t x, uint32_t y, uint32_t z)
+{
+	uint32_t X[3] = { x, y, z };
+	const uint32_t M = 1u << (spatialGridBits - 1);
+
+	// Inverse undo
+	for (uint32_t Q = M; Q > 1; Q >>= 1)
+	{
+		const uint32_t P = Q - 1;
+
+		for (int i = 0; i < 3; ++i)
+		{
+			if (X[i] & Q)
+			{
+				X[0] ^= P;
+			}
+			else
+			{
+				const uint32_t t = (X[0] ^ X[i]) & P;
+				X[0] ^= t;
+				X[i] ^= t;
+			}
+		}
+	}
+
+	// Gray encode
+	X[1] ^= X[0];
+	X[2] ^= X[1];
+
+	uint32_t t = 0;
+	for (uint32_t Q = M; Q > 1; Q >>= 1)
+	{
+		if (X[2] & Q) { t ^= Q - 1; }
+	}
+
+	X[0] ^= t;
+	X[1] ^= t;
+	X[2] ^= t;
+
+	return mortonKey(X[0], X[1], X[2]);
+}
+
+// Key of a grid cell along the chosen curve
+inline uint64_t spatialKey(SpatialOrder order, uint32_t x, uint32_t y, uint32_t z)
+{
+	return order == SpatialOrder::Hilbert ? hilbertKey(x, y, z) : mortonKey(x, y, z);
+}
+
+// Sorts keys ascending and applies the same permutation to values. Stable LSD radix sort with 8 bit digits.
+// The input is split into a fixed number of contiguous blocks, which are counted and scattered by the threads of
+// a worksharing loop. The result does not depend on how many threads OpenMP grants. Digits that are equal for all
+// keys are skipped
+template <typename Value>
+inline void radixSortPairs(std::vector<uint64_t>& keys, std::vector<Value>& values)
+{
+	const size_t count = keys.size();
+
+	if (count < 2) {
+		return;
+	}
+
+	std::vector<uint64_t> keyBuffer(count);
+	std::vector<Value> valueBuffer(count);
+
+#ifdef _OPENMP
+	const int blockCount = count > 65536 ? omp_get_max_threads() : 1;
+#else
+	const int blockCount = 1;
+#endif
+
+	std::vector<size_t> offsets(static_cast<size_t>(blockCount) * 256);
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		const uint64_t* pKeys = keys.data();
+		const Value* pValues = values.data();
+		uint64_t* pKeyBuffer = keyBuffer.data();
+		Value* pValueBuffer = valueBuffer.data();
+		size_t* pOffsets = offsets.data();
+		bool skipPass = false;
+
+		std::fill(offsets.begin(), offsets.end(), static_cast<size_t>(0));
+
+#pragma omp parallel num_threads(blockCount)
+		{
+#pragma omp for schedule(static)
+			for (int block = 0; block < blockCount; ++block)
+			{
+				const size_t begin = count * block / blockCount;
+				const size_t end = count * (block + 1) / blockCount;
+				size_t* pBlockOffsets = pOffsets + static_cast<size_t>(block) * 256;
+
+				for (size_t i = begin; i < end; ++i) {
+					++pBlockOffsets[(pKeys[i] >> shift) & 0xFF];
+				}
+			}
+
+			// Turn the counts into start positions, ordered by digit and then by block to keep the sort stable
+#pragma omp single
+			{
+				size_t position = 0;
+
+				for (int digit = 0; digit < 256; ++digit)
+				{
+					size_t digitCount = 0;
+
+					for (int b = 0; b < blockCount; ++b)
+					{
+						const size_t blockDigitCount = pOffsets[static_cast<size_t>(b) * 256 + digit];
+						pOffsets[static_cast<size_t>(b) * 256 + digit] = position;
+						position += blockDigitCount;
+						digitCount += blockDigitCount;
+					}
+
+					if (digitCount == count) { skipPass = true; }
+				}
+			}
+
+			if (!skipPass)
+			{
+#pragma omp for schedule(static)
+				for (int block = 0; block < blockCount; ++block)
+				{
+					const size_t begin = count * block / blockCount;
+					const size_t end = count * (block + 1) / blockCount;
+					size_t* pBlockOffsets = pOffsets + static_cast<size_t>(block) * 256;
+
+					for (size_t i = begin; i < end; ++i)
+					{
+						const size_t target = pBlockOffsets[(pKeys[i] >> shift) & 0xFF]++;
+						pKeyBuffer[target] = pKeys[i];
+						pValueBuffer[target] = pValues[i];
+					}
+				}
+			}
+		}
+
+		if (!skipPass)
+		{
+			keys.swap(keyBuffer);
+			values.swap(valueBuffer);
+		}
+	}
+}
+
+#endif
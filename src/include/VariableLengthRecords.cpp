@@ -273,11 +273,18 @@ void LASdataWriter::getExtVLRHeader(mxArray* pVLRfield, size_t VLRindex) {
 void LASdataWriter::WriteExtVLR(std::ofstream& lasBin, const mxArray* matlabInput)
 {
 	mxArray* pExtVLRfield = mxGetField(matlabInput, 0, "extendedvariables");
+	const size_t structureRecordCount = m_options.lodOctree ? m_structureExtVLRCount : m_headerExt4.numberOfExtendedVariableLengthRecords;
 
-	for (size_t i = 0; i < m_headerExt4.numberOfExtendedVariableLengthRecords; ++i) {
+	for (size_t i = 0; i < structureRecordCount; ++i) {
 
 		// Get header, write header, then write data
 		getExtVLRHeader(pExtVLRfield, i);
+
+		// An outdated octree hierarchy is replaced by the one of the written points
+		if (m_options.lodOctree && isOctreeHierarchy(m_ExtVLRHeader.userID, m_ExtVLRHeader.recordID)) {
+			continue;
+		}
+
 		lasBin.write(m_ExtVLRHeader.extvlrhBytes, 60);
 
 		// Get and write data
@@ -286,4 +293,24 @@ void LASdataWriter::WriteExtVLR(std::ofstream& lasBin, const mxArray* matlabInpu
 			lasBin.write((char*)dataPointer, m_ExtVLRHeader.recordLengthAfterHeader);
 		}
 	}
+
+	if (m_options.lodOctree) {
+		writeOctreeHierarchy(lasBin);
+	}
+}
+
+void LASdataWriter::writeOctreeHierarchy(std::ofstream& lasBin)
+{
+	const std::vector<char> data = encodeOctreeHierarchy(m_octree);
+	const unsigned long long recordLength = data.size();
+	const char description[] = "Level of detail octree";
+	char extvlrhBytes[60] = { '\0' };
+
+	std::memcpy(extvlrhBytes + 2, octreeHierarchyUserID, 16);
+	std::memcpy(extvlrhBytes + 18, &octreeHierarchyRecordID, 2);
+	std::memcpy(extvlrhBytes + 20, &recordLength, 8);
+	std::memcpy(extvlrhBytes + 28, description, sizeof(description) - 1);
+
+	lasBin.write(extvlrhBytes, 60);
+	lasBin.write(data.data(), static_cast<std::streamsize>(data.size()));
 }
@@ -0,0 +1,573 @@
+#if _MSC_VER > 1400
+#pragma once
+#endif
+
+#ifndef VOXEL_GRID_H
+#define VOXEL_GRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "SpatialSort.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Voxel grid subsampling of point clouds. Every point gets the linear index of its voxel as key and the points of
+// a voxel are reduced to one representative: its first point, the point closest to its centroid or the point
+// closest to the center of the voxel. Representatives are indices into the input, so all attributes of a point
+// can be carried along.
+//
+// The points are grouped by voxel either with hash tables or by sorting the keys. With hash tables every thread
+// reads a contiguous block of the points once and the voxels of the blocks are merged afterwards. That is fastest if
+// there are many points per voxel and the points are in acquisition or spatial order. The voxels are returned in the
+// order of their first points. The sorted grouping is a stable radix sort of the keys and returns the voxels in the
+// order of their keys. Its sums are always computed in input order, so it gives the same centroids and
+// representatives for any number of threads, and it is faster if almost every point has its own voxel.
+
+enum class VoxelRepresentative { First = 0, Centroid = 1, Center = 2 };
+
+constexpr uint64_t emptyVoxelKey = std::numeric_limits<uint64_t>::max();
+
+// Grid of voxels with its origin in the minimum of the points. Axes with an infinite voxel size have one layer
+struct VoxelGrid
+{
+	double		minXYZ[3]	= { 0, 0, 0 };
+	double		size[3]		= { 1, 1, 1 };
+	uint64_t	cells[3]	= { 1, 1, 1 };
+};
+
+// Voxel with its representative point. The centroid is relative to the origin of the grid
+struct Voxel
+{
+	uint64_t	key;
+	size_t		first;				// First point of the voxel in input order
+	size_t		representative;
+	size_t		count;
+	double		centroid[3];
+};
+
+// Sets the origin and the number of voxels of the grid for the points. Undefined coordinates are ignored
+//	Returns: false if the voxels can't be numbered with 63 bits
+inline bool buildVoxelGrid(VoxelGrid& grid, const double* __restrict x, const double* __restrict y, const double* __restrict z, const size_t count, const double size[3])
+{
+	const double* coordinates[3] = { x, y, z };
+	double minimum[3], maximum[3];
+
+	for (int axis = 0; axis < 3; ++axis) {
+		minimum[axis] = std::numeric_limits<double>::infinity();
+		maximum[axis] = -std::numeric_limits<double>::infinity();
+	}
+
+	// Every thread gets the bounding box of its points, they are merged at the end
+#pragma omp parallel if (count > 100000)
+	{
+		double threadMinimum[3] = { minimum[0], minimum[1], minimum[2] };
+		double threadMaximum[3] = { maximum[0], maximum[1], maximum[2] };
+
+#pragma omp for
+		for (long long i = 0; i < static_cast<long long>(count); ++i) {
+			for (int axis = 0; axis < 3; ++axis) {
+				const double value = coordinates[axis][i];
+				if (value < threadMinimum[axis]) threadMinimum[axis] = value;
+				if (value > threadMaximum[axis]) threadMaximum[axis] = value;
+			}
+		}
+
+#pragma omp critical
+		{
+			for (int axis = 0; axis < 3; ++axis) {
+				minimum[axis] = std::min(minimum[axis], threadMinimum[axis]);
+				maximum[axis] = std::max(maximum[axis], threadMaximum[axis]);
+			}
+		}
+	}
+
+	double voxelCount = 1;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		// Without defined coordinates every point is undefined and the grid stays empty
+		const bool isDefined = minimum[axis] <= maximum[axis];
+		const double cells = std::isinf(size[axis]) || !isDefined ? 1 : std::floor((maximum[axis] - minimum[axis]) / size[axis]) + 1;
+
+		if (!(cells < 9.2e18))
+			return false;
+
+		grid.minXYZ[axis] = isDefined ? minimum[axis] : 0;
+		grid.size[axis] = size[axis];
+		grid.cells[axis] = static_cast<uint64_t>(cells);
+		voxelCount *= cells;
+	}
+
+	return voxelCount < 9.2e18;
+}
+
+// Gets the linear index of the voxel of a point, x changes fastest
+//	Returns: key of the voxel or emptyVoxelKey if a coordinate is undefined
+inline uint64_t voxelKey(const VoxelGrid& grid, const double x, const double y, const double z)
+{
+	const double point[3] = { x, y, z };
+	uint64_t key = 0;
+
+	for (int axis = 2; axis >= 0; --axis) {
+		if (point[axis] != point[axis])
+			return emptyVoxelKey;
+
+		// Rounding of the division can't move a point out of the grid
+		const double cell = std::floor((point[axis] - grid.minXYZ[axis]) / grid.size[axis]);
+		const uint64_t index = cell > 0 ? std::min(static_cast<uint64_t>(cell), grid.cells[axis] - 1) : 0;
+
+		key = key * grid.cells[axis] + index;
+	}
+
+	return key;
+}
+
+// Mixes the bits of a voxel key (finalizer of splitmix64). The high bits select the partition of a point
+// and the low bits the slot of the hash table
+inline uint64_t hashVoxelKey(uint64_t key)
+{
+	key ^= key >> 30;
+	key *= 0xBF58476D1CE4E5B9ull;
+	key ^= key >> 27;
+	key *= 0x94D049BB133111EBull;
+	key ^= key >> 31;
+	return key;
+}
+
+// Counts the set bits of a word
+inline int bitCount(uint64_t bits)
+{
+	int count = 0;
+
+	for (; bits != 0; bits &= bits - 1) {
+		++count;
+	}
+
+	return count;
+}
+
+// Gets the point that the representative of a voxel is closest to, relative to the origin of the grid.
+// The centroid of the voxel has to be known. Axes with a single layer have no center
+inline void voxelTarget(const VoxelGrid& grid, const Voxel& voxel, const VoxelRepresentative representative, double target[3], bool useAxis[3])
+{
+	uint64_t cell = voxel.key;
+
+	for (int axis = 0; axis < 3; ++axis) {
+		const uint64_t index = cell % grid.cells[axis];
+		cell /= grid.cells[axis];
+
+		if (representative == VoxelRepresentative::Centroid) {
+			target[axis] = voxel.centroid[axis];
+			useAxis[axis] = true;
+		}
+		else {
+			target[axis] = (static_cast<double>(index) + 0.5) * grid.size[axis];
+			useAxis[axis] = !std::isinf(grid.size[axis]);
+		}
+	}
+}
+
+// Gets the squared distance of a point to the target of its voxel
+inline double squaredTargetDistance(const VoxelGrid& grid, const double point[3], const double target[3], const bool useAxis[3])
+{
+	double distance = 0;
+
+	for (int axis = 0; axis < 3; ++axis) {
+		const double delta = point[axis] - grid.minXYZ[axis] - target[axis];
+		distance += useAxis[axis] ? delta * delta : 0;
+	}
+
+	return distance;
+}
+
+// Reduces the points of one voxel, given in input order, to their centroid and representative. Ties of the
+// distances keep the earlier point
+template<typename Index>
+inline void reduceVoxel(Voxel& voxel, const VoxelGrid& grid, const double* __restrict x, const double* __restrict y, const double* __restrict z,
+	const Index* __restrict points, const size_t pointCount, const uint64_t key, const VoxelRepresentative representative)
+{
+	double sum[3] = { 0, 0, 0 };
+
+	voxel.key = key;
+	voxel.first = points[0];
+	voxel.representative = points[0];
+	voxel.count = pointCount;
+
+	for (size_t k = 0; k < pointCount; ++k) {
+		sum[0] += x[points[k]] - grid.minXYZ[0];
+		sum[1] += y[points[k]] - grid.minXYZ[1];
+		sum[2] += z[points[k]] - grid.minXYZ[2];
+	}
+
+	for (int axis = 0; axis < 3; ++axis) {
+		voxel.centroid[axis] = sum[axis] / static_cast<double>(pointCount);
+	}
+
+	if (representative == VoxelRepresentative::First)
+		return;
+
+	double target[3];
+	bool useAxis[3];
+	voxelTarget(grid, voxel, representative, target, useAxis);
+
+	double bestDistance = std::numeric_limits<double>::infinity();
+
+	for (size_t k = 0; k < pointCount; ++k) {
+		const double point[3] = { x[points[k]], y[points[k]], z[points[k]] };
+		const double distance = squaredTargetDistance(grid, point, target, useAxis);
+
+		if (distance < bestDistance) {
+			bestDistance = distance;
+			voxel.representative = points[k];
+		}
+	}
+}
+
+// Hash table from voxel keys to the positions of the voxels in a list. Open addressing with linear probing,
+// the table is doubled if it gets half full. Key and position share a slot, so a lookup touches one cache line
+template<typename Index>
+struct VoxelTable
+{
+	struct Slot
+	{
+		uint64_t	key;
+		Index		voxel;
+	};
+
+	std::vector<Slot> slots;
+
+	void clear(const size_t capacity)
+	{
+		const Slot empty = { emptyVoxelKey, 0 };
+		slots.assign(capacity, empty);
+	}
+
+	// Gets the slot of a key, or the empty slot where it has to be added
+	inline size_t slotOf(const uint64_t key) const
+	{
+		const size_t mask = slots.size() - 1;
+		size_t slot = hashVoxelKey(key) & mask;
+
+		while (slots[slot].key != emptyVoxelKey && slots[slot].key != key)
+			slot = (slot + 1) & mask;
+
+		return slot;
+	}
+
+	// Gets the voxel of a key and adds an empty voxel with the point as first point if the list has none
+	//	Returns: position of the voxel in the list
+	inline Index findOrAdd(std::vector<Voxel>& list, const uint64_t key, const size_t point)
+	{
+		const size_t slot = slotOf(key);
+
+		if (slots[slot].key == key)
+			return slots[slot].voxel;
+
+		const Voxel voxel = { key, point, point, 0, { 0, 0, 0 } };
+		slots[slot].key = key;
+		slots[slot].voxel = static_cast<Index>(list.size());
+		list.push_back(voxel);
+
+		if (2 * list.size() > slots.size())
+		{
+			clear(2 * slots.size());
+
+			for (size_t v = 0; v < list.size(); ++v) {
+				const size_t rehashed = slotOf(list[v].key);
+				slots[rehashed].key = list[v].key;
+				slots[rehashed].voxel = static_cast<Index>(v);
+			}
+		}
+
+		return static_cast<Index>(list.size() - 1);
+	}
+};
+
+// Groups the points into voxels with hash tables. The points are split into threadCount contiguous blocks, whose
+// voxels are summed up by the threads of a worksharing loop. Then the voxels of all blocks are merged in the order
+// of the blocks, with one table per partition of the keys. For the centroid or center every block remembers the
+// voxel of its points and searches the closest point of its voxels in a second pass. The voxels are returned in the
+// order of their first points. The order of the sums depends on the number of threads, so points with almost the
+// same distance to the centroid can be chosen differently
+template<typename Index>
+void groupVoxelsByHash(std::vector<Voxel>& voxels, const VoxelGrid& grid, const double* __restrict x, const double* __restrict y, const double* __restrict z,
+	const size_t count, const VoxelRepresentative representative, const int threadCount)
+{
+	const Index undefinedPoint = std::numeric_limits<Index>::max();
+	std::vector<std::vector<Voxel>> blockVoxels(threadCount);
+	std::vector<Index> voxelOfPoint(representative != VoxelRepresentative::First ? count : 0);
+
+	// Blocks are assigned by the loop, not by thread number, so all points are grouped if fewer threads are granted
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+	for (int block = 0; block < threadCount; ++block)
+	{
+		const size_t begin = count * block / threadCount;
+		const size_t end = count * (block + 1) / threadCount;
+		std::vector<Voxel>& list = blockVoxels[block];
+		VoxelTable<Index> table;
+		const bool rememberVoxel = !voxelOfPoint.empty();
+
+		// The centroid holds the sum of the points until all of them are added
+		table.clear(1024);
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			const uint64_t key = voxelKey(grid, x[i], y[i], z[i]);
+
+			if (key == emptyVoxelKey) {
+				if (rememberVoxel) voxelOfPoint[i] = undefinedPoint;
+				continue;
+			}
+
+			const Index v = table.findOrAdd(list, key, i);
+			if (rememberVoxel) voxelOfPoint[i] = v;
+
+			Voxel& voxel = list[v];
+			voxel.count += 1;
+			voxel.centroid[0] += x[i] - grid.minXYZ[0];
+			voxel.centroid[1] += y[i] - grid.minXYZ[1];
+			voxel.centroid[2] += z[i] - grid.minXYZ[2];
+		}
+	}
+
+	// Merge the voxels of the blocks. Every voxel of a block gets the position of its merged voxel
+	std::vector<Voxel> merged;
+	std::vector<std::vector<size_t>> mergedOf(threadCount);
+
+	if (threadCount == 1)
+	{
+		merged.swap(blockVoxels[0]);
+		mergedOf[0].resize(merged.size());
+
+		for (size_t v = 0; v < merged.size(); ++v) {
+			mergedOf[0][v] = v;
+		}
+	}
+	else
+	{
+		int partitionBits = 0;
+		while ((1 << partitionBits) < 4 * threadCount) ++partitionBits;
+
+		const size_t partitionCount = static_cast<size_t>(1) << partitionBits;
+		std::vector<std::vector<Voxel>> partitionVoxels(partitionCount);
+		std::vector<size_t> partitionStart(partitionCount + 1, 0);
+
+		for (int t = 0; t < threadCount; ++t) {
+			mergedOf[t].resize(blockVoxels[t].size());
+		}
+
+		// Every partition visits the blocks in order, so the first point of a voxel comes from the first block
+#pragma omp parallel num_threads(threadCount)
+		{
+			VoxelTable<Index> table;
+
+#pragma omp for schedule(dynamic)
+			for (long long p = 0; p < static_cast<long long>(partitionCount); ++p)
+			{
+				std::vector<Voxel>& list = partitionVoxels[p];
+				table.clear(1024);
+
+				for (int t = 0; t < threadCount; ++t) {
+					for (size_t v = 0; v < blockVoxels[t].size(); ++v)
+					{
+						const Voxel& blockVoxel = blockVoxels[t][v];
+						if (static_cast<long long>(hashVoxelKey(blockVoxel.key) >> (64 - partitionBits)) != p)
+							continue;
+
+						const size_t position = table.findOrAdd(list, blockVoxel.key, blockVoxel.first);
+						Voxel& voxel = list[position];
+						voxel.count += blockVoxel.count;
+						voxel.centroid[0] += blockVoxel.centroid[0];
+						voxel.centroid[1] += blockVoxel.centroid[1];
+						voxel.centroid[2] += blockVoxel.centroid[2];
+						mergedOf[t][v] = position;
+					}
+				}
+			}
+		}
+
+		for (size_t p = 0; p < partitionCount; ++p) {
+			partitionStart[p + 1] = partitionStart[p] + partitionVoxels[p].size();
+		}
+
+		merged.resize(partitionStart[partitionCount]);
+
+#pragma omp parallel for num_threads(threadCount)
+		for (int t = 0; t < threadCount; ++t) {
+			for (size_t v = 0; v < blockVoxels[t].size(); ++v) {
+				mergedOf[t][v] += partitionStart[hashVoxelKey(blockVoxels[t][v].key) >> (64 - partitionBits)];
+			}
+			std::vector<Voxel>().swap(blockVoxels[t]);
+		}
+
+		for (size_t p = 0; p < partitionCount; ++p) {
+			std::copy(partitionVoxels[p].begin(), partitionVoxels[p].end(), merged.begin() + partitionStart[p]);
+			std::vector<Voxel>().swap(partitionVoxels[p]);
+		}
+	}
+
+	const long long mergedCount = static_cast<long long>(merged.size());
+
+#pragma omp parallel for num_threads(threadCount) if (mergedCount > 10000)
+	for (long long v = 0; v < mergedCount; ++v) {
+		for (int axis = 0; axis < 3; ++axis) {
+			merged[v].centroid[axis] /= static_cast<double>(merged[v].count);
+		}
+	}
+
+	if (representative != VoxelRepresentative::First)
+	{
+		// Every block finds the point closest to the target of its voxels. The targets are copied into the order
+		// of the voxels of the block, so the search doesn't jump between the merged voxels
+		struct BlockTarget { double target[3]; bool useAxis[3]; double distance; size_t point; };
+		std::vector<std::vector<BlockTarget>> blockTargets(threadCount);
+
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+		for (int block = 0; block < threadCount; ++block)
+		{
+			const size_t begin = count * block / threadCount;
+			const size_t end = count * (block + 1) / threadCount;
+			std::vector<BlockTarget>& targets = blockTargets[block];
+
+			targets.resize(mergedOf[block].size());
+
+			for (size_t v = 0; v < targets.size(); ++v) {
+				voxelTarget(grid, merged[mergedOf[block][v]], representative, targets[v].target, targets[v].useAxis);
+				targets[v].distance = std::numeric_limits<double>::infinity();
+			}
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				if (voxelOfPoint[i] == undefinedPoint)
+					continue;
+
+				BlockTarget& target = targets[voxelOfPoint[i]];
+				const double point[3] = { x[i], y[i], z[i] };
+				const double distance = squaredTargetDistance(grid, point, target.target, target.useAxis);
+
+				if (distance < target.distance) {
+					target.distance = distance;
+					target.point = i;
+				}
+			}
+		}
+
+		// Blocks are merged in order, so ties keep the earlier point. Voxels of one block have different merged voxels
+		std::vector<double> mergedDistance(merged.size(), std::numeric_limits<double>::infinity());
+
+		for (int t = 0; t < threadCount; ++t)
+		{
+			const long long blockCount = static_cast<long long>(mergedOf[t].size());
+
+#pragma omp parallel for num_threads(threadCount) if (blockCount > 10000)
+			for (long long v = 0; v < blockCount; ++v) {
+				const size_t m = mergedOf[t][v];
+
+				if (blockTargets[t][v].distance < mergedDistance[m]) {
+					mergedDistance[m] = blockTargets[t][v].distance;
+					merged[m].representative = blockTargets[t][v].point;
+				}
+			}
+		}
+	}
+
+	// Marking all first points in a bit mask gives the position of every voxel in the order of their first points
+	std::vector<uint64_t> isFirst(count / 64 + 1, 0);
+	std::vector<size_t> firstsBefore(isFirst.size() + 1, 0);
+
+	for (const Voxel& voxel : merged) {
+		isFirst[voxel.first / 64] |= static_cast<uint64_t>(1) << (voxel.first % 64);
+	}
+
+	for (size_t w = 0; w < isFirst.size(); ++w) {
+		firstsBefore[w + 1] = firstsBefore[w] + bitCount(isFirst[w]);
+	}
+
+	voxels.resize(merged.size());
+
+#pragma omp parallel for num_threads(threadCount) if (mergedCount > 10000)
+	for (long long v = 0; v < mergedCount; ++v) {
+		const Voxel& voxel = merged[v];
+		const uint64_t lowerBits = (static_cast<uint64_t>(1) << (voxel.first % 64)) - 1;
+		voxels[firstsBefore[voxel.first / 64] + bitCount(isFirst[voxel.first / 64] & lowerBits)] = voxel;
+	}
+}
+
+// Groups the points into voxels by sorting their keys. The sort is stable, so the points of a voxel stay in input
+// order. The voxels are returned in the order of their keys
+template<typename Index>
+void groupVoxelsBySort(std::vector<Voxel>& voxels, const VoxelGrid& grid, const double* __restrict x, const double* __restrict y, const double* __restrict z,
+	std::vector<uint64_t>& keys, const VoxelRepresentative representative, const int threadCount)
+{
+	std::vector<Index> order(keys.size());
+
+#pragma omp parallel for num_threads(threadCount) if (keys.size() > 10000)
+	for (long long i = 0; i < static_cast<long long>(keys.size()); ++i) {
+		order[i] = static_cast<Index>(i);
+	}
+
+	radixSortPairs(keys, order);
+
+	// Undefined points have the largest key and are sorted to the end
+	const size_t count = static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), emptyVoxelKey) - keys.begin());
+	const uint64_t* pKeys = keys.data();
+	std::vector<std::vector<Voxel>> sortedBlockVoxels(threadCount);
+
+	// Every block of the sorted points reduces the voxels that start within it. Blocks are assigned by the loop,
+	// so all voxels are reduced if fewer threads are granted
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+	for (int block = 0; block < threadCount; ++block)
+	{
+		size_t begin = count * block / threadCount;
+		size_t end = count * (block + 1) / threadCount;
+
+		while (begin > 0 && begin < count && pKeys[begin] == pKeys[begin - 1]) ++begin;
+		while (end > 0 && end < count && pKeys[end] == pKeys[end - 1]) ++end;
+
+		std::vector<Voxel>& blockVoxels = sortedBlockVoxels[block];
+
+		for (size_t k = begin; k < end; )
+		{
+			size_t voxelEnd = k + 1;
+			while (voxelEnd < end && pKeys[voxelEnd] == pKeys[k]) ++voxelEnd;
+
+			blockVoxels.emplace_back();
+			reduceVoxel(blockVoxels.back(), grid, x, y, z, order.data() + k, voxelEnd - k, pKeys[k], representative);
+			k = voxelEnd;
+		}
+	}
+
+	voxels.clear();
+	for (int t = 0; t < threadCount; ++t) {
+		voxels.insert(voxels.end(), sortedBlockVoxels[t].begin(), sortedBlockVoxels[t].end());
+	}
+}
+
+// Reduces the points of a cloud to one representative per voxel. Index has to hold the number of points
+//	Output: voxels : voxels in the order of their first points, or of their keys if sorted
+template<typename Index>
+void voxelGridFilter(std::vector<Voxel>& voxels, const VoxelGrid& grid, const double* __restrict x, const double* __restrict y, const double* __restrict z,
+	const size_t count, const VoxelRepresentative representative, const bool sorted, const int threadCount)
+{
+	if (!sorted) {
+		groupVoxelsByHash<Index>(voxels, grid, x, y, z, count, representative, threadCount);
+		return;
+	}
+
+	std::vector<uint64_t> keys(count);
+
+#pragma omp parallel for num_threads(threadCount) if (count > 10000)
+	for (long long i = 0; i < static_cast<long long>(count); ++i) {
+		keys[i] = voxelKey(grid, x[i], y[i], z[i]);
+	}
+
+	groupVoxelsBySort<Index>(voxels, grid, x, y, z, keys, representative, threadCount);
+}
+
+#endif
@@ -1,48 +1,106 @@
 #include "mex.h"
-#include <thread>
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <cstring>
 #include <omp.h>
+#include "PointInPolygonSimd.hpp"
+#include "ProcessingThreads.hpp"
 
 #if MX_HAS_INTERLEAVED_COMPLEX
 
 #define GetDoubles	mxGetDoubles
 #define GetSingles	mxGetSingles
 #define GetLogicals	mxGetLogicals
+#define GetUint32	mxGetUint32s
+#define GetUint8	mxGetUint8s
+#define GetUint64	mxGetUint64s
+#define GetInt32	mxGetInt32s
 
 #else
 
 #define GetDoubles	(mxDouble*)	mxGetPr
 #define GetSingles	(mxSingle*)	mxGetPr
 #define GetLogicals	(mxLogical*)mxGetPr
+#define GetUint32	(mxUint32*) mxGetPr
+#define GetUint8	(mxUint8*)	mxGetPr
+#define GetUint64	(mxUint64*) mxGetPr
+#define GetInt32	(mxInt32*)	mxGetPr
 
 #endif
 
+// Output of the test of a single polygon: logical mask, 1-based indices of the inside points (uint64)
+// or mask packed into 8 points per byte (uint8, point i in bit (i - 1) % 8 of byte floor((i - 1) / 8) + 1)
+enum class OutputMode { Mask, Indices, Bits };
+
+// Uniform grid of square cells over the bounding boxes of many polygons. Every cell lists the polygons
+// whose bounding box overlaps it, so a query point only has to test the polygons of its own cell.
+struct PolygonGrid
+{
+	double minX, maxX, minY, maxY;	// Bounding box of all polygons
+	double cellScale;				// Number of cells per unit in x and y
+	int columns, rows;
+	std::vector<size_t> cellStart;	// Offset of the first polygon of every cell (columns * rows + 1 entries)
+	std::vector<int> polygons;		// Polygons of all cells in order of the cells and then of the polygons
+};
+
+// Slab index of a polygon that is kept between the calls of this mex function, so the polygon is only
+// prepared once for many sets of points. Only the index of the type of the polygon is filled. Polygons that
+// are quantized with the scale and offset of a LAS-File are tested against the int32 coordinates of its records
+struct PreparedPolygon
+{
+	mxClassID classID;
+	int vertexCount;
+	PolygonEdgeIndex<double> indexDouble;
+	PolygonEdgeIndex<float> indexSingle;
+	PolygonEdgeIndex<long long> indexQuantized;
+};
+
+static std::map<unsigned long long, std::unique_ptr<PreparedPolygon>> preparedPolygons;
+static unsigned long long nextHandle = 1;
+
+static void runCommand(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]);
+inline OutputMode getOutputMode(const mxArray* prhs[], int nrhs);
 template<typename T>
 inline void Compute(mxArray* plhs[], const mxArray* prhs[], int nrhs, const T* __restrict polyX, const T* __restrict polyY, const T* __restrict pointsX, const T* __restrict pointsY);
+static void quantizePolygon(PolygonEdgeIndex<long long>& index, const double* __restrict polyX, const double* __restrict polyY, const int polyCount, const double* __restrict quantization);
+template<typename T, typename P>
+inline void ComputeIndex(mxArray* plhs[], const mxArray* prhs[], int nrhs, const PolygonEdgeIndex<T>& index, const int size_polyX, const P* __restrict pointsX, const P* __restrict pointsY);
 template<typename T>
-inline bool raycast(const T*  polyX, const T* __restrict polyY, const T& pointX, const T& pointY, const int& polyCount);
+inline void testBlock(const PolygonEdgeIndex<T>& index, const int algorithm, const SimdLevel simdLevel, const T* __restrict pointsX, const T* __restrict pointsY, const int count, bool* __restrict result, SlabChunk<T>& chunk);
+inline void testBlock(const PolygonEdgeIndex<long long>& index, const int algorithm, const SimdLevel simdLevel, const int32_t* __restrict pointsX, const int32_t* __restrict pointsY, const int count, bool* __restrict result, SlabChunk<long long>& chunk);
 template<typename T>
-inline bool windingNumber(const T* __restrict polyX, const T* __restrict polyY, const T& pointX, const T& pointY, const int& polyCount);
+inline void testPoints(const PolygonEdgeIndex<T>& index, const int algorithm, const T* __restrict pointsX, const T* __restrict pointsY, const int count, bool* __restrict result);
 template<typename T>
-inline bool windingNumberIncludeEdges(const T* __restrict polyX, const T* __restrict polyY, const T& pointX, const T& pointY, const int& polyCount);
-
+inline void ComputeLabels(mxArray* plhs[], const mxArray* prhs[], int nrhs, const T* __restrict pointsX, const T* __restrict pointsY);
 template<typename T>
-inline T isLeft(const T polyX_1, const T polyY_1, const T polyX_2, const T polyY_2, const T queryX, const T queryY);
-
-enum searchAlgorithm { WindingNumber, WindingNumberIncludeEdges, Raycast };
+void buildPolygonGrid(PolygonGrid& grid, const std::vector<PolygonEdgeIndex<T>>& polygons);
+inline int cellOf(const PolygonGrid& grid, const double x, const double y);
 
 
 void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) 
 {				
-	
-	if (nrhs < 4 || nrhs > 6) {
-		mexErrMsgIdAndTxt("MEX:isPointInPolygon:nargin", "This function allows four to six input arguments!");
+	// Prepared polygons are handled by the commands 'prepare', 'test' and 'release'
+	if (nrhs > 0 && mxIsChar(prhs[0])) {
+		runCommand(nlhs, plhs, nrhs, prhs);
+		return;
+	}
+
+	if (nrhs < 4 || nrhs > 7) {
+		mexErrMsgIdAndTxt("MEX:isPointInPolygon:nargin", "This function allows four to seven input arguments!");
 	}
 	if (nlhs > 1) {
 		mexErrMsgIdAndTxt("MEX:isPointInPolygon:nargout", "This function allows exactly one output argument");
 	}
 
-	if (!mxIsNumeric(prhs[0]) || !mxIsNumeric(prhs[1]) || !mxIsNumeric(prhs[2]) || !mxIsNumeric(prhs[3])) { 
-		mexErrMsgIdAndTxt("MEX:isPointInPolygon:typeargin", "First four arguments have to be numeric!");
+	// Polygons in cell arrays label every point with the first polygon that contains it
+	const bool labelPolygons = mxIsCell(prhs[0]) && mxIsCell(prhs[1]);
+
+	if ((!labelPolygons && (!mxIsNumeric(prhs[0]) || !mxIsNumeric(prhs[1]))) || !mxIsNumeric(prhs[2]) || !mxIsNumeric(prhs[3])) { 
+		mexErrMsgIdAndTxt("MEX:isPointInPolygon:typeargin", "First four arguments have to be numeric! Many polygons can be passed as two cell arrays!");
 	}
 
 	if (mxIsComplex(prhs[0]) || mxIsComplex(prhs[1]) || mxIsComplex(prhs[2]) || mxIsComplex(prhs[3])) {
@@ -63,11 +121,30 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 		mexErrMsgIdAndTxt("MEX:isPointInPolygon:sizeargin", "Input points have to be of same size and larger than a size of zero!");
 	}
 
-	// If input cloud or polygon has more than INT32_MAX points then cancel, because not implemented
-	if (size_pointsX > INT32_MAX || size_polyX > INT32_MAX) {
+	// If polygon has more than INT32_MAX vertices then cancel, because not implemented
+	if (size_polyX > INT32_MAX) {
 		mexErrMsgIdAndTxt("MEX:isPointInPolygon:sizeargin", "Input with more elements than %d not implemented!", INT32_MAX);
 	}
 
+	// Label points according to the type of the points. The polygons are checked against it
+	if (labelPolygons)
+	{
+		if (nrhs > 6) {
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:nargin", "Output modes are only supported for a single polygon!");
+		}
+
+		if (mxIsDouble(prhs[2])) {
+			ComputeLabels(plhs, prhs, nrhs, GetDoubles(prhs[2]), GetDoubles(prhs[3]));
+		}
+		else if (mxIsSingle(prhs[2])) {
+			ComputeLabels(plhs, prhs, nrhs, GetSingles(prhs[2]), GetSingles(prhs[3]));
+		}
+		else {
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:argin", "Input arrays must be single or double precision float and of the same type!");
+		}
+		return;
+	}
+
 	// Compute Points In Polygon according to input type
 	if (mxIsDouble(prhs[0]))
 	{
@@ -95,28 +172,205 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 	
 }
 
-template<typename T>
-inline void Compute(mxArray* plhs[], const mxArray* prhs[], int nrhs, const T* __restrict polyX, const T* __restrict polyY, const T* __restrict pointsX, const T* __restrict pointsY)
+// Release all prepared polygons if the mex function is cleared or Matlab exits
+static void releaseAllPolygons()
 {
-	int numberOfThreads = 1;										// Number of processing threads
-	int algorithmInput = WindingNumber;								// Standard algorithm is winding number without including borders
+	preparedPolygons.clear();
+}
+
+// Returns the prepared polygon of the handle in prhs or throws a Matlab error if there is none
+static PreparedPolygon& getPreparedPolygon(const mxArray* pHandle, unsigned long long& handle)
+{
+	if (!mxIsNumeric(pHandle) || mxGetNumberOfElements(pHandle) != 1) {
+		mexErrMsgIdAndTxt("MEX:isPointInPolygon:typeargin", "Second argument has to be a scalar polygon handle!");
+	}
 
-	// Set number if threads according to argument or available threads, depending on which is smaller
-	if (nrhs > 4) {
-		const int machine_num_threads = std::thread::hardware_concurrency();
-		const int inputThreadNumber = static_cast<int>(mxGetScalar(prhs[4]));
+	handle = static_cast<unsigned long long>(mxGetScalar(pHandle));
+	auto it = preparedPolygons.find(handle);
 
-		numberOfThreads = inputThreadNumber < machine_num_threads ? inputThreadNumber : machine_num_threads;
-		numberOfThreads = numberOfThreads < 1 ? machine_num_threads : numberOfThreads;
+	if (it == preparedPolygons.end()) {
+		mexErrMsgIdAndTxt("MEX:isPointInPolygon:invalidHandle", "Polygon handle is not valid or was already released!");
 	}
 
-	if (nrhs > 5) {
-		algorithmInput = static_cast<int>(mxGetScalar(prhs[5]));
+	return *it->second;
+}
+
+// Commands for prepared polygons:
+//	handle = isPointInPolygon_cpp('prepare', polyX, polyY)
+//	handle = isPointInPolygon_cpp('prepare', polyX, polyY, [xScale yScale xOffset yOffset])
+//	in = isPointInPolygon_cpp('test', handle, pointsX, pointsY, numThreads, algorithm, outputMode)
+//	isPointInPolygon_cpp('release', handle)
+static void runCommand(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+	char* command = mxArrayToString(prhs[0]);
+	const bool isPrepare = std::strcmp(command, "prepare") == 0;
+	const bool isTest = std::strcmp(command, "test") == 0;
+	const bool isRelease = std::strcmp(command, "release") == 0;
+	mxFree(command);
+
+	if (nlhs > 1) {
+		mexErrMsgIdAndTxt("MEX:isPointInPolygon:nargout", "This function allows exactly one output argument");
 	}
 
+	if (isPrepare)
+	{
+		if (nrhs < 3 || nrhs > 4) {
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:nargin", "Command prepare needs the X and Y coordinates of the polygon and optionally its quantization!");
+		}
+		if (!mxIsNumeric(prhs[1]) || !mxIsNumeric(prhs[2]) || mxIsComplex(prhs[1]) || mxIsComplex(prhs[2])
+			|| mxGetClassID(prhs[1]) != mxGetClassID(prhs[2]) || !(mxIsDouble(prhs[1]) || mxIsSingle(prhs[1])))
+		{
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:argin", "Input arrays must be single or double precision float and of the same type!");
+		}
+
+		const size_t size_polyX = mxGetNumberOfElements(prhs[1]);
+		if (size_polyX != mxGetNumberOfElements(prhs[2]) || size_polyX < 1) {
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:sizeargin", "Input polygon has to be of same size and larger than a size of zero!");
+		}
+		if (size_polyX > INT32_MAX) {
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:sizeargin", "Input with more elements than %d not implemented!", INT32_MAX);
+		}
+
+		std::unique_ptr<PreparedPolygon> polygon(new PreparedPolygon());
+		polygon->classID = mxGetClassID(prhs[1]);
+		polygon->vertexCount = static_cast<int>(size_polyX);
+
+		// Quantize the polygon with the scale and offset of a LAS-File, so the records can be tested without scaling
+		if (nrhs == 4)
+		{
+			if (!mxIsDouble(prhs[1]) || !mxIsDouble(prhs[3]) || mxIsComplex(prhs[3]) || mxGetNumberOfElements(prhs[3]) != 4) {
+				mexErrMsgIdAndTxt("MEX:isPointInPolygon:argin", "Quantization needs a double polygon and [xScale yScale xOffset yOffset]!");
+			}
+
+			polygon->classID = mxINT32_CLASS;
+			quantizePolygon(polygon->indexQuantized, GetDoubles(prhs[1]), GetDoubles(prhs[2]), polygon->vertexCount, GetDoubles(prhs[3]));
+		}
+		else if (mxIsDouble(prhs[1]))
+			buildEdgeIndex(polygon->indexDouble, GetDoubles(prhs[1]), GetDoubles(prhs[2]), polygon->vertexCount);
+		else
+			buildEdgeIndex(polygon->indexSingle, GetSingles(prhs[1]), GetSingles(prhs[2]), polygon->vertexCount);
+
+		if (preparedPolygons.empty()) {
+			mexAtExit(releaseAllPolygons);
+		}
+
+		const unsigned long long handle = nextHandle++;
+		preparedPolygons[handle] = std::move(polygon);
+
+		plhs[0] = mxCreateDoubleScalar(static_cast<double>(handle));
+	}
+	else if (isTest)
+	{
+		if (nrhs < 4 || nrhs > 7) {
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:nargin", "Command test needs the polygon handle and the X and Y coordinates of the points!");
+		}
+
+		unsigned long long handle = 0;
+		const PreparedPolygon& polygon = getPreparedPolygon(prhs[1], handle);
+
+		if (mxGetClassID(prhs[2]) != polygon.classID || mxGetClassID(prhs[3]) != polygon.classID || mxIsComplex(prhs[2]) || mxIsComplex(prhs[3])) {
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:typeargin", "Points have to be real and of the same type as the prepared polygon!");
+		}
+
+		const size_t size_pointsX = mxGetNumberOfElements(prhs[2]);
+		if (size_pointsX != mxGetNumberOfElements(prhs[3]) || size_pointsX < 1) {
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:sizeargin", "Input points have to be of same size and larger than a size of zero!");
+		}
+
+		// Points and options are at the same positions as for an unprepared polygon
+		if (polygon.classID == mxDOUBLE_CLASS)
+			ComputeIndex(plhs, prhs, nrhs, polygon.indexDouble, polygon.vertexCount, GetDoubles(prhs[2]), GetDoubles(prhs[3]));
+		else if (polygon.classID == mxINT32_CLASS)
+			ComputeIndex(plhs, prhs, nrhs, polygon.indexQuantized, polygon.vertexCount, GetInt32(prhs[2]), GetInt32(prhs[3]));
+		else
+			ComputeIndex(plhs, prhs, nrhs, polygon.indexSingle, polygon.vertexCount, GetSingles(prhs[2]), GetSingles(prhs[3]));
+	}
+	else if (isRelease)
+	{
+		if (nrhs != 2) {
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:nargin", "Command release needs the polygon handle!");
+		}
+
+		unsigned long long handle = 0;
+		getPreparedPolygon(prhs[1], handle);
+		preparedPolygons.erase(handle);
+	}
+	else
+	{
+		mexErrMsgIdAndTxt("MEX:isPointInPolygon:valueargin", "Unknown command! Valid commands are 'prepare', 'test' and 'release'");
+	}
+}
+
+// Quantizes the vertices of a polygon with round((v - offset) / scale) and builds its slab index. Undefined
+// vertices become ring breaks. Quantized coordinates beyond 2^53 or a polygon extent of 2^31 or more would
+// make the integer tests inexact, so they throw a Matlab error.
+static void quantizePolygon(PolygonEdgeIndex<long long>& index, const double* __restrict polyX, const double* __restrict polyY, const int polyCount, const double* __restrict quantization)
+{
+	const double scaleX = quantization[0];
+	const double scaleY = quantization[1];
+
+	if (!(scaleX != 0 && scaleY != 0) || quantization[2] != quantization[2] || quantization[3] != quantization[3]) {
+		mexErrMsgIdAndTxt("MEX:isPointInPolygon:valueargin", "Quantization needs nonzero scales and defined offsets!");
+	}
+
+	const double largestExact = 9007199254740992.0;		// 2^53
+	std::vector<long long> quantizedX(static_cast<size_t>(polyCount));
+	std::vector<long long> quantizedY(static_cast<size_t>(polyCount));
+
+	for (int i = 0; i < polyCount; ++i) {
+		if (polyX[i] != polyX[i] || polyY[i] != polyY[i]) {
+			quantizedX[i] = quantizedY[i] = quantizedRingBreak;
+			continue;
+		}
+
+		const double x = std::round((polyX[i] - quantization[2]) / scaleX);
+		const double y = std::round((polyY[i] - quantization[3]) / scaleY);
+
+		if (!(std::abs(x) < largestExact && std::abs(y) < largestExact)) {
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:sizeargin", "Polygon can't be quantized with this scale and offset!");
+		}
+
+		quantizedX[i] = static_cast<long long>(x);
+		quantizedY[i] = static_cast<long long>(y);
+	}
+
+	buildEdgeIndex(index, quantizedX.data(), quantizedY.data(), polyCount);
+
+	const long long largestExtent = 2147483647;		// 2^31 - 1
+	if (index.maxX - index.minX > largestExtent || index.maxY - index.minY > largestExtent) {
+		mexErrMsgIdAndTxt("MEX:isPointInPolygon:sizeargin", "Extent of the quantized polygon has to be smaller than 2^31!");
+	}
+}
+
+// Gets the output mode from the seventh argument 'mask', 'indices' or 'bits'
+//	Returns: selected mode and the logical mask without argument
+inline OutputMode getOutputMode(const mxArray* prhs[], int nrhs)
+{
+	if (nrhs < 7)
+		return OutputMode::Mask;
+
+	if (!mxIsChar(prhs[6])) {
+		mexErrMsgIdAndTxt("MEX:isPointInPolygon:typeargin", "Output mode has to be 'mask', 'indices' or 'bits'!");
+	}
+
+	char* mode = mxArrayToString(prhs[6]);
+	const bool isMask = std::strcmp(mode, "mask") == 0;
+	const bool isIndices = std::strcmp(mode, "indices") == 0;
+	const bool isBits = std::strcmp(mode, "bits") == 0;
+	mxFree(mode);
+
+	if (!isMask && !isIndices && !isBits) {
+		mexErrMsgIdAndTxt("MEX:isPointInPolygon:valueargin", "Output mode has to be 'mask', 'indices' or 'bits'!");
+	}
+
+	return isIndices ? OutputMode::Indices : (isBits ? OutputMode::Bits : OutputMode::Mask);
+}
+
+template<typename T>
+inline void Compute(mxArray* plhs[], const mxArray* prhs[], int nrhs, const T* __restrict polyX, const T* __restrict polyY, const T* __restrict pointsX, const T* __restrict pointsY)
+{
 	// Use int for sizes because of openMP. Overflow would have been caught in parent function
 	const int size_polyX = static_cast<int>(mxGetNumberOfElements(prhs[0]));	// Number of Polygon X - Coordinates
-	const int size_pointsX = static_cast<int>(mxGetNumberOfElements(prhs[2]));	// Number of Point Data X - Coordinates
 
 	// Check for nullptr
 	if (polyX == nullptr || polyY == nullptr || pointsX == nullptr || pointsY == nullptr) {
@@ -124,155 +378,324 @@ inline void Compute(mxArray* plhs[], const mxArray* prhs[], int nrhs, const T* _
 		return;
 	}
 
-	// Allocate Output
-	plhs[0] = mxCreateLogicalMatrix(size_pointsX, 1);
-	mxLogical* result = mxGetLogicals(plhs[0]);
+	// Bin the polygon edges into slabs, so every point only tests the edges that cross its scanline
+	PolygonEdgeIndex<T> index;
+	buildEdgeIndex(index, polyX, polyY, size_polyX);
+
+	ComputeIndex(plhs, prhs, nrhs, index, size_polyX, pointsX, pointsY);
+}
+
+// Tests the points of the third and fourth argument against the slab index of a polygon. The points are tested
+// in blocks, so the inside points of every block can be collected on its own and concatenated in order
+template<typename T, typename P>
+inline void ComputeIndex(mxArray* plhs[], const mxArray* prhs[], int nrhs, const PolygonEdgeIndex<T>& index, const int size_polyX, const P* __restrict pointsX, const P* __restrict pointsY)
+{
+	const int numberOfThreads = getNumberOfThreads(prhs, nrhs, 4);		// Number of processing threads
+	int algorithmInput = WindingNumber;								// Standard algorithm is winding number without including borders
+
+	if (nrhs > 5) {
+		algorithmInput = static_cast<int>(mxGetScalar(prhs[5]));
+	}
+
+	const OutputMode outputMode = getOutputMode(prhs, nrhs);
+
+	// Signed 64 bit indices for openMP, so clouds with more than INT32_MAX points can be tested
+	const long long size_pointsX = static_cast<long long>(mxGetNumberOfElements(prhs[2]));	// Number of Point Data X - Coordinates
+
+	if (pointsX == nullptr || pointsY == nullptr) {
+		mexErrMsgIdAndTxt("MEX:isPointInPolygon:argin", "Can't get a valid pointer to all of the the input data! Do they have the same type?");
+		return;
+	}
+
+	// Allocate the output that is written while testing. The index list is allocated when the inside points are known
+	mxLogical* resultMask = nullptr;
+	mxUint8* resultBits = nullptr;
+
+	if (outputMode == OutputMode::Mask) {
+		plhs[0] = mxCreateLogicalMatrix(static_cast<size_t>(size_pointsX), 1);
+		resultMask = GetLogicals(plhs[0]);
+	}
+	else if (outputMode == OutputMode::Bits) {
+		plhs[0] = mxCreateNumericMatrix(static_cast<size_t>((size_pointsX + 7) / 8), 1, mxUINT8_CLASS, mxREAL);
+		resultBits = GetUint8(plhs[0]);
+	}
 
 	/*Run Point in Poly algorithm*/
-	// Every thread gets a chunk of 2% of points to process and dynamically switch to next when chunk is finished
-	const int threadChunksize = numberOfThreads > 1 ? static_cast<int>((size_pointsX / (numberOfThreads * 50)) + 1) : static_cast<int>(size_pointsX);
+	// Blocks are a multiple of 8 points, so every block writes whole bytes of the bit mask
+	const long long blockCount = (size_pointsX - 1) / simdChunkPoints + 1;
+	std::vector<std::vector<mxUint64>> blockIndices(outputMode == OutputMode::Indices ? static_cast<size_t>(blockCount) : 0);
 	omp_set_num_threads(numberOfThreads);
 
-	switch (algorithmInput)
+	// Test the points of a block in lockstep with AVX2 or AVX-512 if the polygon has few enough slabs to fill the lanes
+	const SimdLevel simdLevel = index.slabCount <= simdMaxSlabCount ? getSimdLevel() : SimdLevel::None;
+
+#pragma omp parallel default(shared) if (size_pointsX > 10000 || size_polyX > 150)
 	{
-	case searchAlgorithm::WindingNumberIncludeEdges:
+		SlabChunk<T> chunk;
+		std::vector<uint8_t> blockResult(outputMode == OutputMode::Mask ? 0 : simdChunkPoints);
+
+		// Every thread dynamically switches to the next block when its block is finished
+#pragma omp for schedule(dynamic)
+		for (long long b = 0; b < blockCount; ++b) {
+			const long long first = b * simdChunkPoints;
+			const int count = static_cast<int>(size_pointsX - first < simdChunkPoints ? size_pointsX - first : simdChunkPoints);
+			bool* result = outputMode == OutputMode::Mask ? reinterpret_cast<bool*>(resultMask + first) : reinterpret_cast<bool*>(blockResult.data());
+
+			testBlock(index, algorithmInput, simdLevel, pointsX + first, pointsY + first, count, result, chunk);
+
+			if (outputMode == OutputMode::Bits) {
+				for (int i = 0; i < count; ++i) {
+					resultBits[(first + i) / 8] |= static_cast<mxUint8>(result[i] ? 1 << (i % 8) : 0);
+				}
+			}
+			else if (outputMode == OutputMode::Indices) {
+				for (int i = 0; i < count; ++i) {
+					if (result[i])
+						blockIndices[b].push_back(static_cast<mxUint64>(first + i) + 1);
+				}
+			}
+		}
+	}
+
+	if (outputMode != OutputMode::Indices)
+		return;
+
+	// Concatenate the indices of the blocks in order
+	std::vector<size_t> blockStart(static_cast<size_t>(blockCount) + 1, 0);
+	for (long long b = 0; b < blockCount; ++b) {
+		blockStart[b + 1] = blockStart[b] + blockIndices[b].size();
+	}
+
+	plhs[0] = mxCreateNumericMatrix(blockStart[blockCount], 1, mxUINT64_CLASS, mxREAL);
+	mxUint64* resultIndices = GetUint64(plhs[0]);
 
-#pragma omp parallel for schedule(dynamic, threadChunksize) default(shared) if (size_pointsX > 10000 || size_polyX > 150)
-		for (int i = 0; i < size_pointsX; ++i) {
-			result[i] = windingNumberIncludeEdges(polyX, polyY, pointsX[i], pointsY[i], size_polyX);
+	for (long long b = 0; b < blockCount; ++b) {
+		std::copy(blockIndices[b].begin(), blockIndices[b].end(), resultIndices + blockStart[b]);
+	}
+}
+
+// Tests a block of points with SIMD lanes or one by one
+//	Output: result : true if point inside polygon, false if otherwise
+template<typename T>
+inline void testBlock(const PolygonEdgeIndex<T>& index, const int algorithm, const SimdLevel simdLevel, const T* __restrict pointsX, const T* __restrict pointsY, const int count, bool* __restrict result, SlabChunk<T>& chunk)
+{
+	if (simdLevel != SimdLevel::None)
+		testPointsSimd(index, algorithm, simdLevel, pointsX, pointsY, count, result, chunk);
+	else
+		testPoints(index, algorithm, pointsX, pointsY, count, result);
+}
+
+// Tests a block of int32 record coordinates against a quantized polygon. The full bounding box test keeps all
+// differences of the exact integer tests within 31 bits, so their products can't overflow
+//	Output: result : true if point inside polygon, false if otherwise
+inline void testBlock(const PolygonEdgeIndex<long long>& index, const int algorithm, const SimdLevel, const int32_t* __restrict pointsX, const int32_t* __restrict pointsY, const int count, bool* __restrict result, SlabChunk<long long>&)
+{
+	for (int i = 0; i < count; ++i) {
+		result[i] = isInPolygon(index, algorithm, static_cast<long long>(pointsX[i]), static_cast<long long>(pointsY[i]));
+	}
+}
+
+// Tests count points against the slab index one by one
+//	Output: result : true if point inside polygon, false if otherwise
+template<typename T>
+inline void testPoints(const PolygonEdgeIndex<T>& index, const int algorithm, const T* __restrict pointsX, const T* __restrict pointsY, const int count, bool* __restrict result)
+{
+	switch (algorithm)
+	{
+	case searchAlgorithm::WindingNumberIncludeEdges:
+		for (int i = 0; i < count; ++i) {
+			const int slab = slabOf(index, pointsY[i]);
+			result[i] = slab >= 0 
+				&& windingNumberIncludeEdges(slabEdges(index, slab), pointsX[i], pointsY[i]);
 		}
 		break;
 
 	case searchAlgorithm::Raycast:
-
-#pragma omp parallel for schedule(dynamic, threadChunksize) default(shared) if (size_pointsX > 10000 || size_polyX > 150)
-		for (int i = 0; i < size_pointsX; ++i) {
-			result[i] = raycast(polyX, polyY, pointsX[i], pointsY[i], size_polyX);
+		for (int i = 0; i < count; ++i) {
+			const int slab = slabOf(index, pointsY[i]);
+			result[i] = slab >= 0 
+				&& raycast(slabEdges(index, slab), pointsX[i], pointsY[i]);
 		}
 		break;
 
 	default:
-
-#pragma omp parallel for schedule(dynamic, threadChunksize) default(shared) if (size_pointsX > 10000 || size_polyX > 150)
-		for (int i = 0; i < size_pointsX; ++i) {
-			result[i] = windingNumber(polyX, polyY, pointsX[i], pointsY[i], size_polyX);
+		for (int i = 0; i < count; ++i) {
+			// No edge can be left of a point right of the bounding box, even with rounding
+			const int slab = pointsX[i] <= index.maxX ? slabOf(index, pointsY[i]) : -1;
+			result[i] = slab >= 0 
+				&& windingNumber(slabEdges(index, slab), pointsX[i], pointsY[i]);
 		}
 	}
-
 }
 
-// Tests if point is in polygon using the raycast algorithm
-//	Returns: true if point inside polygon, false if otherwise
+// Labels every point with the index of the first polygon of the cell arrays that contains it (0 if none)
 template<typename T>
-inline bool raycast(const T* __restrict polyX, const T* __restrict polyY, const T& pointX, const T& pointY, const int& polyCount)
+inline void ComputeLabels(mxArray* plhs[], const mxArray* prhs[], int nrhs, const T* __restrict pointsX, const T* __restrict pointsY)
 {
-	bool inside = false;
+	const int numberOfThreads = getNumberOfThreads(prhs, nrhs, 4);		// Number of processing threads
+	const int algorithmInput = nrhs > 5 ? static_cast<int>(mxGetScalar(prhs[5])) : WindingNumber;
+
+	// Use int for the polygons and signed 64 bit for the points because of openMP. Overflow would have been caught in parent function
+	const int polygonCount = static_cast<int>(mxGetNumberOfElements(prhs[0]));
+	const long long size_pointsX = static_cast<long long>(mxGetNumberOfElements(prhs[2]));
 
-	for (int i = 0, j = polyCount - 1; i < polyCount; j = i++) {
-		if (((polyY[i] > pointY) != (polyY[j] > pointY)) 
-			&& (pointX < (polyX[j] - polyX[i]) * (pointY - polyY[i]) / (polyY[j] - polyY[i]) + polyX[i])) 
+	if (pointsX == nullptr || pointsY == nullptr) {
+		mexErrMsgIdAndTxt("MEX:isPointInPolygon:argin", "Can't get a valid pointer to all of the the input data! Do they have the same type?");
+		return;
+	}
+
+	// Bin the edges of every polygon into slabs. Empty cells are polygons without vertices
+	std::vector<PolygonEdgeIndex<T>> polygons(polygonCount);
+
+	for (int p = 0; p < polygonCount; ++p) {
+		const mxArray* cellX = mxGetCell(prhs[0], p);
+		const mxArray* cellY = mxGetCell(prhs[1], p);
+		const size_t vertexCount = cellX != nullptr ? mxGetNumberOfElements(cellX) : 0;
+
+		if ((cellX == nullptr) != (cellY == nullptr) || (cellY != nullptr && mxGetNumberOfElements(cellY) != vertexCount)) {
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:sizeargin", "X and Y of polygon %d have to be of same size!", p + 1);
+		}
+		if (vertexCount > INT32_MAX) {
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:sizeargin", "Input with more elements than %d not implemented!", INT32_MAX);
+		}
+		if (vertexCount > 0 && (mxGetClassID(cellX) != mxGetClassID(prhs[2]) || mxGetClassID(cellY) != mxGetClassID(prhs[2])
+			|| mxIsComplex(cellX) || mxIsComplex(cellY)))
 		{
-			// Invert inside
-			inside = !inside;
+			mexErrMsgIdAndTxt("MEX:isPointInPolygon:typeargin", "Polygon %d has to be real and of the same type as the points!", p + 1);
 		}
+
+		const T* polyX = vertexCount > 0 ? static_cast<const T*>(mxGetData(cellX)) : nullptr;
+		const T* polyY = vertexCount > 0 ? static_cast<const T*>(mxGetData(cellY)) : nullptr;
+		buildEdgeIndex(polygons[p], polyX, polyY, static_cast<int>(vertexCount));
 	}
 
-	return inside;
-}
+	// Grid over the bounding boxes of the polygons to find the candidates of a point
+	PolygonGrid grid;
+	buildPolygonGrid(grid, polygons);
+	const size_t* __restrict cellStart = grid.cellStart.data();
+	const int* __restrict cellPolygons = grid.polygons.data();
 
-// Tests if the winding number for a query point and a polygon is unequal to zero. 
-// If so then the point is fully inside the polygon
-//	Returns: true if point inside polygon, false if otherwise
-template<typename T>
-inline bool windingNumber(const T* __restrict polyX, const T* __restrict polyY, const T& pointX, const T& pointY, const int& polyCount)
-{
-	int winding_num = 0;  // Winding number counter
+	// Allocate Output
+	plhs[0] = mxCreateNumericMatrix(static_cast<size_t>(size_pointsX), 1, mxUINT32_CLASS, mxREAL);
+	mxUint32* result = GetUint32(plhs[0]);
 
-	for (int i = 0, j = polyCount - 1; i < polyCount; j = i++)
-	{
-		if (polyY[j] <= pointY) {
+	// Every thread gets a chunk of 2% of points to process and dynamically switch to next when chunk is finished
+	const long long threadChunksize = numberOfThreads > 1 ? (size_pointsX / (numberOfThreads * 50)) + 1 : size_pointsX;
+	omp_set_num_threads(numberOfThreads);
 
-			if (pointY < polyY[i]) {
-				if (isLeft(polyX[j], polyY[j], polyX[i], polyY[i], pointX, pointY) > 0)
-				{
-					// If point on the left then increase winding number
-					++winding_num;
-				}
-			}
-		}
-		else { // Ray crosses an downwards line
-			if (polyY[i] <= pointY) {
-				if (isLeft(polyX[j], polyY[j], polyX[i], polyY[i], pointX, pointY) < 0)
-				{
-					// If point on the right then decrease winding number
-					--winding_num;
-				}
+#pragma omp parallel for schedule(dynamic, threadChunksize) default(shared) if (size_pointsX > 10000)
+	for (long long i = 0; i < size_pointsX; ++i) {
+		const int cell = cellOf(grid, pointsX[i], pointsY[i]);
+		if (cell < 0)
+			continue;
+
+		// Polygons of a cell are in ascending order, so the first hit is the label
+		for (size_t k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+			if (isInPolygon(polygons[cellPolygons[k]], algorithmInput, pointsX[i], pointsY[i])) {
+				result[i] = static_cast<mxUint32>(cellPolygons[k]) + 1;
+				break;
 			}
 		}
 	}
-	return winding_num != 0;  // Only if winding_num is 0 then point is outside polygon
-};
+}
 
-// Tests if the winding number for a query point and a polygon is unequal to zero or if point is on border
-// If so then the point is fully inside the polygon
-//	Returns: true if point inside polygon or on border, false if otherwise
+// Builds the grid over the bounding boxes of the polygons with about one cell per polygon. The cell size is
+// doubled until large polygons, that are stored in many cells, need no more than four entries per polygon.
 template<typename T>
-inline bool windingNumberIncludeEdges(const T* __restrict polyX, const T* __restrict polyY, const T& pointX, const T& pointY, const int& polyCount)
+void buildPolygonGrid(PolygonGrid& grid, const std::vector<PolygonEdgeIndex<T>>& polygons)
 {
-	int winding_num = 0;  // Winding number counter
+	const int polygonCount = static_cast<int>(polygons.size());
 
-	for (int i = 0, j = polyCount - 1; i < polyCount; j = i++)
-	{
-		// If query point is on vertex then count it as inside
-		if (polyX[i] == pointX && polyY[i] == pointY)
-		{
-			winding_num = 1;
-			break;
-		}
+	grid.minX = grid.minY = std::numeric_limits<double>::infinity();
+	grid.maxX = grid.maxY = -std::numeric_limits<double>::infinity();
 
-		// Early continue to avoid costly calculation of point direction if ray does not intersect the segment
-		if (!((polyY[i] > pointY) != (polyY[j] > pointY)))
+	for (int p = 0; p < polygonCount; ++p) {
+		if (!(polygons[p].minX <= polygons[p].maxX && polygons[p].minY <= polygons[p].maxY))
 			continue;
 
-		const double& sideOfLine = isLeft(polyX[j], polyY[j], polyX[i], polyY[i], pointX, pointY);
+		if (polygons[p].minX < grid.minX) grid.minX = polygons[p].minX;
+		if (polygons[p].maxX > grid.maxX) grid.maxX = polygons[p].maxX;
+		if (polygons[p].minY < grid.minY) grid.minY = polygons[p].minY;
+		if (polygons[p].maxY > grid.maxY) grid.maxY = polygons[p].maxY;
+	}
 
-		// Check if the point lies on the polygon edge. If so then count as inside
-		if (sideOfLine == 0)
-		{
-			winding_num = 1;
-			break;
-		}
+	// Use a single cell if the polygons don't span a finite area
+	const double width = grid.maxX - grid.minX;
+	const double height = grid.maxY - grid.minY;
+	const bool canSplit = width < std::numeric_limits<double>::infinity() && height < std::numeric_limits<double>::infinity();
+	const double longSide = width > height ? width : height;
+	const size_t entryLimit = 4 * static_cast<size_t>(polygonCount);
+
+	if (!canSplit || !(longSide > 0))
+		grid.cellScale = 0.0;
+	else if (width > 0 && height > 0)
+		grid.cellScale = std::sqrt(polygonCount / (width * height));
+	else
+		grid.cellScale = polygonCount / longSide;
+
+	std::vector<size_t> cellEntries;
 
-		if (polyY[j] <= pointY) {
+	for (;;) {
+		grid.columns = grid.cellScale > 0 ? static_cast<int>(std::min<double>(width * grid.cellScale, polygonCount)) + 1 : 1;
+		grid.rows = grid.cellScale > 0 ? static_cast<int>(std::min<double>(height * grid.cellScale, polygonCount)) + 1 : 1;
+		cellEntries.assign(static_cast<size_t>(grid.columns) * grid.rows + 1, 0);
+		size_t entryCount = 0;
 
-			if (pointY < polyY[i]) {
-				if (sideOfLine > 0)
-				{
-					// If point on the left then increase winding number
-					++winding_num;
+		for (int p = 0; p < polygonCount; ++p) {
+			if (!(polygons[p].minX <= polygons[p].maxX && polygons[p].minY <= polygons[p].maxY))
+				continue;
+
+			const int first = cellOf(grid, polygons[p].minX, polygons[p].minY);
+			const int last = cellOf(grid, polygons[p].maxX, polygons[p].maxY);
+			for (int row = first / grid.columns; row <= last / grid.columns; ++row) {
+				for (int column = first % grid.columns; column <= last % grid.columns; ++column) {
+					cellEntries[static_cast<size_t>(row) * grid.columns + column] += 1;
 				}
 			}
+			entryCount += static_cast<size_t>(last / grid.columns - first / grid.columns + 1) * (last % grid.columns - first % grid.columns + 1);
 		}
-		else { // Ray crosses an downwards line
-			if (polyY[i] <= pointY) {
-				if (sideOfLine < 0)
-				{
-					// If point on the right then decrease winding number
-					--winding_num;
-				}
+
+		if (entryCount <= entryLimit || (grid.columns == 1 && grid.rows == 1))
+			break;
+
+		grid.cellScale /= 2;
+	}
+
+	// Prefix sum of the entries per cell to get the first polygon of every cell
+	const size_t cellCount = static_cast<size_t>(grid.columns) * grid.rows;
+	grid.cellStart.assign(cellCount + 1, 0);
+	for (size_t c = 0; c < cellCount; ++c) {
+		grid.cellStart[c + 1] = grid.cellStart[c] + cellEntries[c];
+	}
+
+	// Fill the cells in order of the polygons
+	grid.polygons.resize(grid.cellStart[cellCount]);
+	std::vector<size_t> cellFill(grid.cellStart.begin(), grid.cellStart.end() - 1);
+
+	for (int p = 0; p < polygonCount; ++p) {
+		if (!(polygons[p].minX <= polygons[p].maxX && polygons[p].minY <= polygons[p].maxY))
+			continue;
+
+		const int first = cellOf(grid, polygons[p].minX, polygons[p].minY);
+		const int last = cellOf(grid, polygons[p].maxX, polygons[p].maxY);
+		for (int row = first / grid.columns; row <= last / grid.columns; ++row) {
+			for (int column = first % grid.columns; column <= last % grid.columns; ++column) {
+				grid.polygons[cellFill[static_cast<size_t>(row) * grid.columns + column]++] = p;
 			}
 		}
 	}
-	return winding_num != 0;  // Only if winding_num is 0 then point is outside polygon
-};
+}
 
-// Tests if a point is Left, Right or On a line
-//    Input:  X and Y of first and second point of line, X and Y of query point
-//    Returns: >0 if query point is left of the line
-//             =0 if query point is on the line
-//             <0 if query point is right of the line
-template<typename T>
-inline T isLeft(const T polyX_1, const T polyY_1, const T polyX_2, const T polyY_2, const T queryX, const T queryY)
+// Gets the grid cell of a point. Like the slabs, the mapping is monotonic in x and y
+//	Returns: cell index (row * columns + column) or -1 if the point is outside of the grid
+inline int cellOf(const PolygonGrid& grid, const double x, const double y)
 {
-	return (queryY - polyY_1) * (polyX_2 - polyX_1) - (queryX - polyX_1) * (polyY_2 - polyY_1);
-};
+	if (!(x >= grid.minX && x <= grid.maxX && y >= grid.minY && y <= grid.maxY))
+		return -1;
+
+	const double column = (x - grid.minX) * grid.cellScale;
+	const double row = (y - grid.minY) * grid.cellScale;
+
+	return (row < grid.rows - 1 ? static_cast<int>(row) : grid.rows - 1) * grid.columns
+		+ (column < grid.columns - 1 ? static_cast<int>(column) : grid.columns - 1);
+}
@@ -0,0 +1,101 @@
+/*%==========================================================
+% mergeLASfiles_cpp.cpp
+%
+% Copyright (c) 2022, Patrick Kmmerle
+% Licence: see the included file
+%
+%========================================================*/
+#include "mex.h"
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "LAS_IO.hpp"
+
+
+/* The gateway function. */
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
+
+	/* Check for proper number of arguments */
+	if (nrhs < 2 || nrhs > 3) {
+		mexErrMsgIdAndTxt("MEX:mergeLASfiles_mex:nargin", "Two or three input arguments required!");
+	}
+	if (nlhs > 1) {
+		mexErrMsgIdAndTxt("MEX:mergeLASfiles_mex:nargout", "This function returns at most one output argument");
+	}
+
+	if (!mxIsCell(prhs[0]) || mxIsEmpty(prhs[0]) || !mxIsChar(prhs[1])) {
+		mexErrMsgIdAndTxt("MEX:mergeLASfiles_mex:typeargin", "First argument has to be a cell array of input LAS-File paths and second argument the path to the output LAS-File as char array!");
+	}
+
+	if (nrhs > 2 && !mxIsStruct(prhs[2])) {
+		mexErrMsgIdAndTxt("MEX:mergeLASfiles_mex:typeargin", "Third argument has to be a struct containing merge options!");
+	}
+
+	const size_t inputCount = mxGetNumberOfElements(prhs[0]);
+
+	for (size_t i = 0; i < inputCount; ++i)
+	{
+		const mxArray* pPath = mxGetCell(prhs[0], i);
+
+		if (nullptr == pPath || !mxIsChar(pPath)) {
+			mexErrMsgIdAndTxt("MEX:mergeLASfiles_mex:typeargin", "Every input path has to be a char array!");
+		}
+	}
+
+	// Initialize instance of lasDataTranscoder class and get options before the files are opened
+	LASdataTranscoder lasTranscoder;
+
+	if (nrhs > 2) {
+		lasTranscoder.GetOptions(prhs[2]);
+	}
+
+	// Get Paths from input. Output would be truncated before the inputs are read if it is one of them
+	char* outputPath = mxArrayToString(prhs[1]);
+	std::vector<std::string> inputPaths;
+
+	for (size_t i = 0; i < inputCount; ++i)
+	{
+		char* inputPath = mxArrayToString(mxGetCell(prhs[0], i));
+		inputPaths.push_back(inputPath);
+		mxFree(inputPath);
+
+		if (inputPaths.back() == outputPath)
+		{
+			mxFree(outputPath);
+			mexErrMsgIdAndTxt("MEX:mergeLASfiles_mex:samefile", "Output file has to be different from all input files!");
+		}
+	}
+
+	std::ofstream outBin(outputPath, std::ios::out | std::ios::binary);
+	mxFree(outputPath);
+
+	if (outBin.is_open()) {
+		try {
+			lasTranscoder.Merge(inputPaths, outBin);
+			outBin.close();
+		}
+		catch (const std::bad_alloc& ba) {
+			mexErrMsgIdAndTxt("MEX:mergeLASfiles_mex:bad_alloc", ba.what());
+		}
+		catch (const std::range_error& re) {
+			mexErrMsgIdAndTxt("MEX:mergeLASfiles_mex:coordinateOverflow", re.what());
+		}
+		catch (const std::ios_base::failure& iof) {
+			mexErrMsgIdAndTxt("MEX:mergeLASfiles_mex:iofailure", iof.what());
+		}
+		catch (const std::system_error& se) {
+			mexErrMsgIdAndTxt("MEX:mergeLASfiles_mex:threads", se.what());
+		}
+	}
+	else
+	{
+		mexErrMsgIdAndTxt("MEX:mergeLASfiles_mex:invalidArgumentException", "Output file could not be opened for writing");
+	}
+
+	if (nlhs > 0) {
+		plhs[0] = mxCreateDoubleScalar(static_cast<double>(lasTranscoder.GetWrittenPointCount()));
+	}
+};
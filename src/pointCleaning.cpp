@@ -0,0 +1,212 @@
+#include "mex.h"
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <omp.h>
+#include "PointCleaning.hpp"
+#include "ProcessingThreads.hpp"
+
+#if MX_HAS_INTERLEAVED_COMPLEX
+
+#define GetDoubles	mxGetDoubles
+#define GetUint64	mxGetUint64s
+#define GetLogicals	mxGetLogicals
+
+#else
+
+#define GetDoubles	(mxDouble*)	mxGetPr
+#define GetUint64	(mxUint64*) mxGetPr
+#define GetLogicals	(mxLogical*)mxGetPr
+
+#endif
+
+enum class CleaningCommand { Duplicates, Outliers };
+
+inline CleaningCommand getCommand(const mxArray* prhs[]);
+template<typename Index>
+inline void ComputeDuplicates(int nlhs, mxArray* plhs[], const mxArray* prhs[], int nrhs, const size_t pointCount, const int numberOfThreads);
+template<typename Index>
+inline void ComputeOutliers(int nlhs, mxArray* plhs[], const mxArray* prhs[], int nrhs, const size_t pointCount);
+
+
+// Cleaning of point clouds:
+//	[isDuplicate, firstIndices] = pointCleaning_cpp('duplicates', x, y, z, tolerance, numThreads, gpsTime, timeTolerance)
+//	[isOutlier, meanDistances, threshold] = pointCleaning_cpp('outliers', x, y, z, k, stdRatio, numThreads)
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+	if (nrhs < 5 || nrhs > 8) {
+		mexErrMsgIdAndTxt("MEX:pointCleaning:nargin", "This function allows five to eight input arguments!");
+	}
+	if (nlhs > 3) {
+		mexErrMsgIdAndTxt("MEX:pointCleaning:nargout", "This function allows up to three output arguments");
+	}
+
+	const CleaningCommand command = getCommand(prhs);
+
+	for (int i = 1; i < 5; ++i) {
+		if (!mxIsDouble(prhs[i]) || mxIsComplex(prhs[i])) {
+			mexErrMsgIdAndTxt("MEX:pointCleaning:typeargin", "Coordinates and the tolerance or number of neighbours have to be real double arrays!");
+		}
+	}
+
+	const size_t pointCount = mxGetNumberOfElements(prhs[1]);
+	if (pointCount != mxGetNumberOfElements(prhs[2]) || pointCount != mxGetNumberOfElements(prhs[3])) {
+		mexErrMsgIdAndTxt("MEX:pointCleaning:sizeargin", "Input coordinates have to be of same size!");
+	}
+
+	const int numberOfThreads = getNumberOfThreads(prhs, nrhs, command == CleaningCommand::Outliers ? 6 : 5);		// Number of processing threads
+	omp_set_num_threads(numberOfThreads);
+
+	// Smaller point indices save a third of the memory of the duplicate search and shrink the tree by a quarter.
+	// The largest index marks points with undefined values
+	if (command == CleaningCommand::Duplicates) {
+		if (pointCount < UINT32_MAX)
+			ComputeDuplicates<uint32_t>(nlhs, plhs, prhs, nrhs, pointCount, numberOfThreads);
+		else
+			ComputeDuplicates<uint64_t>(nlhs, plhs, prhs, nrhs, pointCount, numberOfThreads);
+	}
+	else {
+		if (pointCount <= UINT32_MAX)
+			ComputeOutliers<uint32_t>(nlhs, plhs, prhs, nrhs, pointCount);
+		else
+			ComputeOutliers<uint64_t>(nlhs, plhs, prhs, nrhs, pointCount);
+	}
+}
+
+// Gets the command from the first argument 'duplicates' or 'outliers'
+inline CleaningCommand getCommand(const mxArray* prhs[])
+{
+	if (!mxIsChar(prhs[0])) {
+		mexErrMsgIdAndTxt("MEX:pointCleaning:typeargin", "First argument has to be the command 'duplicates' or 'outliers'!");
+	}
+
+	char* name = mxArrayToString(prhs[0]);
+	const bool isDuplicates = std::strcmp(name, "duplicates") == 0;
+	const bool isOutliers = std::strcmp(name, "outliers") == 0;
+	mxFree(name);
+
+	if (!isDuplicates && !isOutliers) {
+		mexErrMsgIdAndTxt("MEX:pointCleaning:valueargin", "First argument has to be the command 'duplicates' or 'outliers'!");
+	}
+
+	return isDuplicates ? CleaningCommand::Duplicates : CleaningCommand::Outliers;
+}
+
+// Writes the duplicate flag [nx1 logical] and the 1-based index of the first point with the same key [nx1 uint64]
+// of every point. The first point of a key is no duplicate. Points with an undefined value are no duplicates and
+// have the index 0
+template<typename Index>
+inline void ComputeDuplicates(int nlhs, mxArray* plhs[], const mxArray* prhs[], int nrhs, const size_t pointCount, const int numberOfThreads)
+{
+	if (nrhs > 8 || nrhs == 7) {
+		mexErrMsgIdAndTxt("MEX:pointCleaning:nargin", "Command duplicates allows five, six or eight input arguments!");
+	}
+
+	DuplicateInput input;
+	input.count = pointCount;
+
+	for (int axis = 0; axis < 3; ++axis) {
+		input.values[axis] = GetDoubles(prhs[axis + 1]);
+	}
+
+	// One tolerance for all axes or one per axis
+	const size_t toleranceCount = mxGetNumberOfElements(prhs[4]);
+	const double* tolerances = GetDoubles(prhs[4]);
+
+	if (toleranceCount != 1 && toleranceCount != 3) {
+		mexErrMsgIdAndTxt("MEX:pointCleaning:valueargin", "Tolerance has to be a scalar or [xTolerance yTolerance zTolerance]!");
+	}
+
+	for (int axis = 0; axis < 3; ++axis) {
+		input.tolerances[axis] = tolerances[toleranceCount == 3 ? axis : 0];
+	}
+
+	if (nrhs > 7 && !mxIsEmpty(prhs[6]))
+	{
+		if (!mxIsDouble(prhs[6]) || mxIsComplex(prhs[6]) || mxGetNumberOfElements(prhs[6]) != pointCount) {
+			mexErrMsgIdAndTxt("MEX:pointCleaning:sizeargin", "GPS time has to be a real double array of the size of the coordinates!");
+		}
+		if (!mxIsDouble(prhs[7]) || mxGetNumberOfElements(prhs[7]) != 1) {
+			mexErrMsgIdAndTxt("MEX:pointCleaning:typeargin", "Time tolerance has to be a double scalar!");
+		}
+
+		input.values[3] = GetDoubles(prhs[6]);
+		input.tolerances[3] = mxGetScalar(prhs[7]);
+	}
+
+	for (int word = 0; word < duplicateKeyWords; ++word) {
+		if (!(input.tolerances[word] >= 0)) {
+			mexErrMsgIdAndTxt("MEX:pointCleaning:valueargin", "Tolerances have to be zero or larger!");
+		}
+	}
+
+	const Index undefinedPoint = std::numeric_limits<Index>::max();
+	std::vector<Index> firstPoints(pointCount);
+
+	findDuplicatePoints(input, firstPoints.data(), undefinedPoint, numberOfThreads);
+
+	plhs[0] = mxCreateLogicalMatrix(pointCount, 1);
+	mxLogical* isDuplicate = GetLogicals(plhs[0]);
+	mxUint64* firstIndices = nullptr;
+
+	if (nlhs > 1) {
+		plhs[1] = mxCreateNumericMatrix(pointCount, 1, mxUINT64_CLASS, mxREAL);
+		firstIndices = GetUint64(plhs[1]);
+	}
+
+#pragma omp parallel for if (pointCount > 100000)
+	for (long long i = 0; i < static_cast<long long>(pointCount); ++i)
+	{
+		const Index first = firstPoints[i];
+		isDuplicate[i] = first != undefinedPoint && static_cast<long long>(first) != i;
+
+		if (firstIndices != nullptr)
+			firstIndices[i] = first != undefinedPoint ? static_cast<mxUint64>(first) + 1 : 0;
+	}
+}
+
+// Writes the outlier flag [nx1 logical] and the mean distance to the k nearest neighbours [nx1 double] of every
+// point and the threshold of the mean distances. Points with an undefined coordinate have the mean distance NaN
+// and are no outliers
+template<typename Index>
+inline void ComputeOutliers(int nlhs, mxArray* plhs[], const mxArray* prhs[], int nrhs, const size_t pointCount)
+{
+	if (nrhs > 7) {
+		mexErrMsgIdAndTxt("MEX:pointCleaning:nargin", "Command outliers allows five to seven input arguments!");
+	}
+
+	const double kValue = mxGetScalar(prhs[4]);
+	if (!(kValue >= 1) || std::isinf(kValue) || mxGetNumberOfElements(prhs[4]) != 1) {
+		mexErrMsgIdAndTxt("MEX:pointCleaning:valueargin", "Number of neighbours k has to be a finite scalar of at least one!");
+	}
+
+	double stdRatio = 1;
+	if (nrhs > 5 && !mxIsEmpty(prhs[5])) {
+		if (!mxIsDouble(prhs[5]) || mxGetNumberOfElements(prhs[5]) != 1 || !std::isfinite(mxGetScalar(prhs[5]))) {
+			mexErrMsgIdAndTxt("MEX:pointCleaning:valueargin", "Ratio of the standard deviation has to be a finite double scalar!");
+		}
+		stdRatio = mxGetScalar(prhs[5]);
+	}
+
+	KdTree<Index> tree;
+	tree.Build(GetDoubles(prhs[1]), GetDoubles(prhs[2]), GetDoubles(prhs[3]), pointCount);
+
+	// A point has at most all other points as neighbours
+	const size_t k = std::min(static_cast<size_t>(kValue), std::max(tree.Size(), static_cast<size_t>(2)) - 1);
+
+	plhs[1] = mxCreateDoubleMatrix(pointCount, 1, mxREAL);
+	double* meanDistances = GetDoubles(plhs[1]);
+	std::fill(meanDistances, meanDistances + pointCount, std::numeric_limits<double>::quiet_NaN());
+
+	meanNeighbourDistances(tree, k, meanDistances);
+
+	plhs[0] = mxCreateLogicalMatrix(pointCount, 1);
+	const double threshold = flagOutliers(meanDistances, pointCount, stdRatio, GetLogicals(plhs[0]));
+
+	if (nlhs > 2) {
+		plhs[2] = mxCreateDoubleScalar(threshold);
+	}
+}
@@ -0,0 +1,346 @@
+#include "mex.h"
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <omp.h>
+#include "PointNormals.hpp"
+#include "ProcessingThreads.hpp"
+
+#if MX_HAS_INTERLEAVED_COMPLEX
+
+#define GetDoubles	mxGetDoubles
+#define GetUint64	mxGetUint64s
+
+#else
+
+#define GetDoubles	(mxDouble*)	mxGetPr
+#define GetUint64	(mxUint64*) mxGetPr
+
+#endif
+
+// Query points of the nearest neighbour and radius search. Without query points the points of the tree are
+// queried themselves, in tree order, so consecutive queries find the same neighbours in the cache
+struct QueryPoints
+{
+	const double* xyz = nullptr;	// Columns x, y and z of the query points or null for the points of the tree
+	size_t count = 0;
+};
+
+enum class NeighbourCommand { Nearest, Radius, Normals };
+
+inline NeighbourCommand getCommand(const mxArray* prhs[]);
+inline QueryPoints getQueryPoints(const mxArray* prhs[], int nrhs, const size_t pointCount);
+template<typename Index>
+inline void Compute(int nlhs, mxArray* plhs[], const mxArray* prhs[], int nrhs, const NeighbourCommand command, const size_t pointCount);
+template<typename Index>
+inline void ComputeNearest(mxArray* plhs[], const mxArray* prhs[], int nrhs, const KdTree<Index>& tree, const size_t pointCount);
+template<typename Index>
+inline void ComputeRadius(int nlhs, mxArray* plhs[], const mxArray* prhs[], int nrhs, const KdTree<Index>& tree, const size_t pointCount);
+template<typename Index>
+inline void ComputeNormals(int nlhs, mxArray* plhs[], const mxArray* prhs[], int nrhs, const KdTree<Index>& tree, const size_t pointCount);
+template<typename Index>
+inline void queryPoint(const KdTree<Index>& tree, const QueryPoints& queries, const size_t q, double query[3], size_t& row);
+
+
+// Neighbourhood queries on a KD-tree of the points:
+//	[indices, distances] = pointNeighbours_cpp('knn', x, y, z, k, numThreads, queryXYZ)
+//	[indices, counts, distances] = pointNeighbours_cpp('radius', x, y, z, radius, numThreads, queryXYZ)
+//	[normals, curvature] = pointNeighbours_cpp('normals', x, y, z, k, radius, numThreads, viewpoint)
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+	if (nrhs < 5 || nrhs > 8) {
+		mexErrMsgIdAndTxt("MEX:pointNeighbours:nargin", "This function allows five to eight input arguments!");
+	}
+	if (nlhs > 3) {
+		mexErrMsgIdAndTxt("MEX:pointNeighbours:nargout", "This function allows up to three output arguments");
+	}
+
+	const NeighbourCommand command = getCommand(prhs);
+
+	for (int i = 1; i < 5; ++i) {
+		if (!mxIsDouble(prhs[i]) || mxIsComplex(prhs[i])) {
+			mexErrMsgIdAndTxt("MEX:pointNeighbours:typeargin", "Coordinates and the size of the neighbourhood have to be real double arrays!");
+		}
+	}
+
+	const size_t pointCount = mxGetNumberOfElements(prhs[1]);
+	if (pointCount != mxGetNumberOfElements(prhs[2]) || pointCount != mxGetNumberOfElements(prhs[3])) {
+		mexErrMsgIdAndTxt("MEX:pointNeighbours:sizeargin", "Input coordinates have to be of same size!");
+	}
+
+	const int numberOfThreads = getNumberOfThreads(prhs, nrhs, command == NeighbourCommand::Normals ? 6 : 5);		// Number of processing threads
+	omp_set_num_threads(numberOfThreads);
+
+	// Smaller point indices shrink the tree by a quarter
+	if (pointCount <= UINT32_MAX)
+		Compute<uint32_t>(nlhs, plhs, prhs, nrhs, command, pointCount);
+	else
+		Compute<uint64_t>(nlhs, plhs, prhs, nrhs, command, pointCount);
+}
+
+// Gets the command from the first argument 'knn', 'radius' or 'normals'
+inline NeighbourCommand getCommand(const mxArray* prhs[])
+{
+	if (!mxIsChar(prhs[0])) {
+		mexErrMsgIdAndTxt("MEX:pointNeighbours:typeargin", "First argument has to be the command 'knn', 'radius' or 'normals'!");
+	}
+
+	char* name = mxArrayToString(prhs[0]);
+	const bool isNearest = std::strcmp(name, "knn") == 0;
+	const bool isRadius = std::strcmp(name, "radius") == 0;
+	const bool isNormals = std::strcmp(name, "normals") == 0;
+	mxFree(name);
+
+	if (!isNearest && !isRadius && !isNormals) {
+		mexErrMsgIdAndTxt("MEX:pointNeighbours:valueargin", "First argument has to be the command 'knn', 'radius' or 'normals'!");
+	}
+
+	return isNearest ? NeighbourCommand::Nearest : (isRadius ? NeighbourCommand::Radius : NeighbourCommand::Normals);
+}
+
+// Gets the query points of a nearest neighbour or radius search from the seventh argument, an [m x 3] matrix.
+// An empty or missing argument queries the points themselves
+inline QueryPoints getQueryPoints(const mxArray* prhs[], int nrhs, const size_t pointCount)
+{
+	QueryPoints queries;
+	queries.count = pointCount;
+
+	if (nrhs < 7 || mxIsEmpty(prhs[6]))
+		return queries;
+
+	if (!mxIsDouble(prhs[6]) || mxIsComplex(prhs[6]) || mxGetN(prhs[6]) != 3) {
+		mexErrMsgIdAndTxt("MEX:pointNeighbours:typeargin", "Query points have to be a real double matrix [x y z]!");
+	}
+
+	queries.xyz = GetDoubles(prhs[6]);
+	queries.count = mxGetM(prhs[6]);
+	return queries;
+}
+
+template<typename Index>
+inline void Compute(int nlhs, mxArray* plhs[], const mxArray* prhs[], int nrhs, const NeighbourCommand command, const size_t pointCount)
+{
+	KdTree<Index> tree;
+	tree.Build(GetDoubles(prhs[1]), GetDoubles(prhs[2]), GetDoubles(prhs[3]), pointCount);
+
+	if (command == NeighbourCommand::Nearest) {
+		if (nrhs > 7) {
+			mexErrMsgIdAndTxt("MEX:pointNeighbours:nargin", "Command knn allows five to seven input arguments!");
+		}
+		ComputeNearest(plhs, prhs, nrhs, tree, pointCount);
+	}
+	else if (command == NeighbourCommand::Radius) {
+		if (nrhs > 7) {
+			mexErrMsgIdAndTxt("MEX:pointNeighbours:nargin", "Command radius allows five to seven input arguments!");
+		}
+		ComputeRadius(nlhs, plhs, prhs, nrhs, tree, pointCount);
+	}
+	else {
+		ComputeNormals(nlhs, plhs, prhs, nrhs, tree, pointCount);
+	}
+}
+
+// Gets the coordinates of query q and the row of its results. Queries of the points themselves are in tree order
+template<typename Index>
+inline void queryPoint(const KdTree<Index>& tree, const QueryPoints& queries, const size_t q, double query[3], size_t& row)
+{
+	if (queries.xyz == nullptr) {
+		const KdTreePoint<Index>& point = tree.Point(q);
+		query[0] = point.xyz[0]; query[1] = point.xyz[1]; query[2] = point.xyz[2];
+		row = static_cast<size_t>(point.index);
+	}
+	else {
+		query[0] = queries.xyz[q]; query[1] = queries.xyz[queries.count + q]; query[2] = queries.xyz[2 * queries.count + q];
+		row = q;
+	}
+}
+
+// Writes the 1-based indices and distances of the k nearest neighbours of every query point, one row per query.
+// Missing neighbours have the index 0 and the distance Inf
+template<typename Index>
+inline void ComputeNearest(mxArray* plhs[], const mxArray* prhs[], int nrhs, const KdTree<Index>& tree, const size_t pointCount)
+{
+	const double kValue = mxGetScalar(prhs[4]);
+	if (!(kValue >= 1) || std::isinf(kValue) || mxGetNumberOfElements(prhs[4]) != 1) {
+		mexErrMsgIdAndTxt("MEX:pointNeighbours:valueargin", "Number of neighbours k has to be a finite scalar of at least one!");
+	}
+
+	const QueryPoints queries = getQueryPoints(prhs, nrhs, pointCount);
+	const size_t k = std::min(static_cast<size_t>(kValue), std::max(tree.Size(), static_cast<size_t>(1)));
+	const size_t rows = queries.count;
+
+	plhs[0] = mxCreateNumericMatrix(rows, k, mxUINT64_CLASS, mxREAL);
+	plhs[1] = mxCreateDoubleMatrix(rows, k, mxREAL);
+	mxUint64* indices = GetUint64(plhs[0]);
+	double* distances = GetDoubles(plhs[1]);
+
+	std::fill(distances, distances + rows * k, std::numeric_limits<double>::infinity());
+
+	// Points that are not in the tree have no neighbours
+	const long long queryCount = static_cast<long long>(queries.xyz == nullptr ? tree.Size() : queries.count);
+
+#pragma omp parallel if (queryCount > 10000)
+	{
+		std::vector<KdNeighbour> neighbours;
+		neighbours.reserve(k);
+
+#pragma omp for schedule(dynamic, 1024)
+		for (long long q = 0; q < queryCount; ++q)
+		{
+			double query[3];
+			size_t row;
+			queryPoint(tree, queries, static_cast<size_t>(q), query, row);
+
+			tree.Nearest(query, k, std::numeric_limits<double>::infinity(), neighbours);
+
+			for (size_t n = 0; n < neighbours.size(); ++n) {
+				indices[n * rows + row] = static_cast<mxUint64>(tree.Point(neighbours[n].position).index) + 1;
+				distances[n * rows + row] = std::sqrt(neighbours[n].squaredDistance);
+			}
+		}
+	}
+}
+
+// Writes the 1-based indices of the neighbours within the radius of all query points one after another, the
+// number of neighbours of every query point and their distances. The neighbours of a query point are sorted by distance
+template<typename Index>
+inline void ComputeRadius(int nlhs, mxArray* plhs[], const mxArray* prhs[], int nrhs, const KdTree<Index>& tree, const size_t pointCount)
+{
+	const double radius = mxGetScalar(prhs[4]);
+	if (!(radius >= 0) || std::isinf(radius) || mxGetNumberOfElements(prhs[4]) != 1) {
+		mexErrMsgIdAndTxt("MEX:pointNeighbours:valueargin", "Radius has to be a finite scalar of at least zero!");
+	}
+
+	const QueryPoints queries = getQueryPoints(prhs, nrhs, pointCount);
+	const size_t rows = queries.count;
+	const double squaredRadius = radius * radius;
+
+	plhs[1] = mxCreateNumericMatrix(rows, 1, mxUINT64_CLASS, mxREAL);
+	mxUint64* counts = GetUint64(plhs[1]);
+
+	// Blocks of consecutive queries collect their neighbours in query order, so the blocks can be concatenated.
+	// Queries of the points themselves are done in input order here, because the output is in input order
+	const size_t blockCount = std::min(rows, static_cast<size_t>(64) * omp_get_max_threads());
+	std::vector<std::vector<mxUint64>> blockIndices(blockCount);
+	std::vector<std::vector<double>> blockDistances(blockCount);
+	const double* x = GetDoubles(prhs[1]);
+	const double* y = GetDoubles(prhs[2]);
+	const double* z = GetDoubles(prhs[3]);
+
+#pragma omp parallel if (rows > 10000)
+	{
+		std::vector<KdNeighbour> neighbours;
+
+#pragma omp for schedule(dynamic)
+		for (long long b = 0; b < static_cast<long long>(blockCount); ++b)
+		{
+			const size_t begin = rows * b / blockCount;
+			const size_t end = rows * (b + 1) / blockCount;
+
+			for (size_t q = begin; q < end; ++q)
+			{
+				double query[3];
+				if (queries.xyz == nullptr) {
+					query[0] = x[q]; query[1] = y[q]; query[2] = z[q];
+				}
+				else {
+					query[0] = queries.xyz[q]; query[1] = queries.xyz[rows + q]; query[2] = queries.xyz[2 * rows + q];
+				}
+
+				neighbours.clear();
+				auto addNeighbour = [&neighbours](const size_t position, const double squaredDistance) {
+					const KdNeighbour neighbour = { squaredDistance, position };
+					neighbours.push_back(neighbour);
+				};
+				tree.Within(query, squaredRadius, addNeighbour);
+				std::sort(neighbours.begin(), neighbours.end());
+
+				for (size_t n = 0; n < neighbours.size(); ++n) {
+					blockIndices[b].push_back(static_cast<mxUint64>(tree.Point(neighbours[n].position).index) + 1);
+					blockDistances[b].push_back(std::sqrt(neighbours[n].squaredDistance));
+				}
+				counts[q] = static_cast<mxUint64>(neighbours.size());
+			}
+		}
+	}
+
+	std::vector<size_t> blockStart(blockCount + 1, 0);
+	for (size_t b = 0; b < blockCount; ++b) {
+		blockStart[b + 1] = blockStart[b] + blockIndices[b].size();
+	}
+
+	plhs[0] = mxCreateNumericMatrix(blockStart[blockCount], 1, mxUINT64_CLASS, mxREAL);
+	mxUint64* indices = GetUint64(plhs[0]);
+	double* distances = nullptr;
+
+	if (nlhs > 2) {
+		plhs[2] = mxCreateDoubleMatrix(blockStart[blockCount], 1, mxREAL);
+		distances = GetDoubles(plhs[2]);
+	}
+
+	for (size_t b = 0; b < blockCount; ++b)
+	{
+		std::copy(blockIndices[b].begin(), blockIndices[b].end(), indices + blockStart[b]);
+		if (distances != nullptr)
+			std::copy(blockDistances[b].begin(), blockDistances[b].end(), distances + blockStart[b]);
+
+		std::vector<mxUint64>().swap(blockIndices[b]);
+		std::vector<double>().swap(blockDistances[b]);
+	}
+}
+
+// Writes the normal [nx3] and the curvature [nx1] of every point. The neighbourhood are the k nearest neighbours within
+// the radius, or all neighbours within the radius if k is Inf. Normals point towards the viewpoint or upwards without it
+template<typename Index>
+inline void ComputeNormals(int nlhs, mxArray* plhs[], const mxArray* prhs[], int nrhs, const KdTree<Index>& tree, const size_t pointCount)
+{
+	if (nrhs < 6) {
+		mexErrMsgIdAndTxt("MEX:pointNeighbours:nargin", "Command normals needs the number of neighbours k and a radius!");
+	}
+	if (!mxIsDouble(prhs[5]) || mxIsComplex(prhs[5]) || mxGetNumberOfElements(prhs[4]) != 1 || mxGetNumberOfElements(prhs[5]) != 1) {
+		mexErrMsgIdAndTxt("MEX:pointNeighbours:typeargin", "Number of neighbours k and radius have to be real double scalars!");
+	}
+
+	const double kValue = mxGetScalar(prhs[4]);
+	const double radius = mxGetScalar(prhs[5]);
+
+	if (!(kValue >= 3)) {
+		mexErrMsgIdAndTxt("MEX:pointNeighbours:valueargin", "A normal needs at least three neighbours, k has to be three or more!");
+	}
+	if (!(radius > 0) || (std::isinf(kValue) && std::isinf(radius))) {
+		mexErrMsgIdAndTxt("MEX:pointNeighbours:valueargin", "Radius has to be larger than zero and finite if k is Inf!");
+	}
+
+	const double* viewpoint = nullptr;
+	if (nrhs > 7 && !mxIsEmpty(prhs[7])) {
+		if (!mxIsDouble(prhs[7]) || mxIsComplex(prhs[7]) || mxGetNumberOfElements(prhs[7]) != 3) {
+			mexErrMsgIdAndTxt("MEX:pointNeighbours:typeargin", "Viewpoint has to be a real double vector [x y z]!");
+		}
+		viewpoint = GetDoubles(prhs[7]);
+	}
+
+	// Zero selects all neighbours within the radius
+	const size_t k = std::isinf(kValue) ? 0 : static_cast<size_t>(kValue);
+
+	plhs[0] = mxCreateDoubleMatrix(pointCount, 3, mxREAL);
+	double* normals = GetDoubles(plhs[0]);
+	std::vector<double> curvatureBuffer;
+	double* curvatures = nullptr;
+
+	if (nlhs > 1) {
+		plhs[1] = mxCreateDoubleMatrix(pointCount, 1, mxREAL);
+		curvatures = GetDoubles(plhs[1]);
+	}
+	else {
+		curvatureBuffer.resize(pointCount);
+		curvatures = curvatureBuffer.data();
+	}
+
+	std::fill(normals, normals + 3 * pointCount, std::numeric_limits<double>::quiet_NaN());
+	std::fill(curvatures, curvatures + pointCount, std::numeric_limits<double>::quiet_NaN());
+
+	estimatePointNormals(tree, pointCount, k, radius, viewpoint, normals, curvatures);
+}
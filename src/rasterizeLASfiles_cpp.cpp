@@ -0,0 +1,259 @@
+/*%==========================================================
+% rasterizeLASfiles_cpp.cpp
+%
+% Copyright (c) 2022, Patrick Kmmerle
+% Licence: see the included file
+%
+%========================================================*/
+#include "mex.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "LAS_IO.hpp"
+#include "Rasterizer.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#if MX_HAS_INTERLEAVED_COMPLEX
+#define GetDoubles mxGetDoubles
+#else
+#define GetDoubles mxGetPr
+#endif
+
+// Gets the bytes the raster may allocate: the physical memory of the machine, but at most half of the address
+// space, so sizes of the raster can not overflow size_t
+static double rasterMemoryLimit()
+{
+	double physicalBytes = 0;
+
+#if defined(_WIN32)
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	if (GlobalMemoryStatusEx(&status)) {
+		physicalBytes = static_cast<double>(status.ullTotalPhys);
+	}
+#else
+	const long pages = sysconf(_SC_PHYS_PAGES);
+	const long pageSize = sysconf(_SC_PAGE_SIZE);
+	if (pages > 0 && pageSize > 0) {
+		physicalBytes = static_cast<double>(pages) * static_cast<double>(pageSize);
+	}
+#endif
+
+	const double addressableBytes = static_cast<double>(SIZE_MAX / 2);
+	return physicalBytes > 0 ? std::min(physicalBytes, addressableBytes) : addressableBytes;
+}
+
+// Parses a reducer name: 'min', 'max', 'mean', 'count' or 'p' followed by the percentile, e.g. 'p50'
+static RasterLayer parseReducer(const mxArray* pName)
+{
+	if (!mxIsChar(pName)) {
+		mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:reducers", "Reducers have to be char arrays!");
+	}
+
+	char* name = mxArrayToString(pName);
+	RasterLayer layer;
+	bool isValid = true;
+
+	if (std::strcmp(name, "min") == 0) layer.reducer = RasterReducer::Min;
+	else if (std::strcmp(name, "max") == 0) layer.reducer = RasterReducer::Max;
+	else if (std::strcmp(name, "mean") == 0) layer.reducer = RasterReducer::Mean;
+	else if (std::strcmp(name, "count") == 0) layer.reducer = RasterReducer::Count;
+	else if (name[0] == 'p' && name[1] != '\0')
+	{
+		char* pEnd = nullptr;
+		layer.reducer = RasterReducer::Percentile;
+		layer.percentile = std::strtod(name + 1, &pEnd);
+		isValid = *pEnd == '\0' && layer.percentile >= 0 && layer.percentile <= 100;
+	}
+	else isValid = false;
+
+	mxFree(name);
+
+	if (!isValid) {
+		mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:reducers", "Reducers have to be 'min', 'max', 'mean', 'count' or a percentile 'p0' to 'p100'!");
+	}
+
+	return layer;
+}
+
+// Parses a field name of a layer: 'z' or 'intensity'
+static RasterField parseField(const mxArray* pName)
+{
+	char* name = mxIsChar(pName) ? mxArrayToString(pName) : nullptr;
+	const bool isZ = name != nullptr && std::strcmp(name, "z") == 0;
+	const bool isIntensity = name != nullptr && std::strcmp(name, "intensity") == 0;
+	mxFree(name);
+
+	if (!isZ && !isIntensity) {
+		mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:values", "Values have to be 'z' or 'intensity'!");
+	}
+
+	return isZ ? RasterField::Z : RasterField::Intensity;
+}
+
+/* The gateway function. */
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
+
+	/* Check for proper number of arguments */
+	if (nrhs != 2) {
+		mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:nargin", "Two input arguments required!");
+	}
+	if (nlhs > 2) {
+		mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:nargout", "This function returns at most two output arguments");
+	}
+
+	if (!mxIsCell(prhs[0]) || mxIsEmpty(prhs[0]) || !mxIsStruct(prhs[1])) {
+		mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:typeargin", "First argument has to be a cell array of input LAS-File paths and second argument a struct containing raster options!");
+	}
+
+	const size_t inputCount = mxGetNumberOfElements(prhs[0]);
+
+	for (size_t i = 0; i < inputCount; ++i)
+	{
+		const mxArray* pPath = mxGetCell(prhs[0], i);
+
+		if (nullptr == pPath || !mxIsChar(pPath)) {
+			mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:typeargin", "Every input path has to be a char array!");
+		}
+	}
+
+	// Cell size is required, the other raster options have defaults
+	const mxArray* pCellSize = mxGetField(prhs[1], 0, "cellSize");
+
+	if (nullptr == pCellSize || !mxIsDouble(pCellSize) || mxGetNumberOfElements(pCellSize) != 1 || !(GetDoubles(pCellSize)[0] > 0) || std::isinf(GetDoubles(pCellSize)[0])) {
+		mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:cellSize", "Option cellSize has to be a positive finite double scalar!");
+	}
+
+	std::vector<RasterLayer> layers;
+	const mxArray* pReducers = mxGetField(prhs[1], 0, "reducers");
+
+	if (nullptr == pReducers) {
+		layers.push_back(RasterLayer());
+		layers.back().reducer = RasterReducer::Max;
+	}
+	else if (mxIsCell(pReducers) && !mxIsEmpty(pReducers)) {
+		for (size_t i = 0; i < mxGetNumberOfElements(pReducers); ++i) {
+			layers.push_back(parseReducer(mxGetCell(pReducers, i)));
+		}
+	}
+	else if (mxIsChar(pReducers)) {
+		layers.push_back(parseReducer(pReducers));
+	}
+	else {
+		mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:reducers", "Option reducers has to be a char array or a non empty cell array of char arrays!");
+	}
+
+	// One field for all layers or one per layer
+	const mxArray* pValues = mxGetField(prhs[1], 0, "values");
+
+	if (nullptr != pValues && mxIsCell(pValues)) {
+		if (mxGetNumberOfElements(pValues) != layers.size()) {
+			mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:values", "Option values needs one entry per reducer!");
+		}
+
+		for (size_t i = 0; i < layers.size(); ++i) {
+			layers[i].field = parseField(mxGetCell(pValues, i));
+		}
+	}
+	else if (nullptr != pValues) {
+		const RasterField field = parseField(pValues);
+		for (RasterLayer& layer : layers) {
+			layer.field = field;
+		}
+	}
+
+	size_t valueBudget = 268435456;
+	const mxArray* pBudget = mxGetField(prhs[1], 0, "rasterBufferBytes");
+
+	if (nullptr != pBudget) {
+		if (!mxIsDouble(pBudget) || mxGetNumberOfElements(pBudget) != 1 || !(GetDoubles(pBudget)[0] >= 0)) {
+			mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:rasterBufferBytes", "Option rasterBufferBytes has to be a non negative double scalar!");
+		}
+		valueBudget = static_cast<size_t>(std::min(GetDoubles(pBudget)[0], 9.0e18));
+	}
+
+	PointRaster raster(layers, GetDoubles(pCellSize)[0], valueBudget, rasterMemoryLimit());
+
+	const mxArray* pExtent = mxGetField(prhs[1], 0, "extent");
+	const bool useHeaderExtent = nullptr == pExtent || mxIsEmpty(pExtent);
+
+	if (!useHeaderExtent)
+	{
+		const double* extent = mxIsDouble(pExtent) && mxGetNumberOfElements(pExtent) == 4 ? GetDoubles(pExtent) : nullptr;
+
+		if (nullptr == extent || !(extent[0] < extent[2]) || !(extent[1] < extent[3]) || std::isinf(extent[0] + extent[1] + extent[2] + extent[3])) {
+			mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:extent", "Option extent has to be a finite [xmin ymin xmax ymax] with xmin < xmax and ymin < ymax!");
+		}
+
+		// The size is checked before any file is read, so a typo in the cell size fails early
+		try {
+			raster.SetExtent(extent[0], extent[1], extent[2], extent[3]);
+		}
+		catch (const std::length_error& le) {
+			mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:rasterSize", le.what());
+		}
+	}
+
+	// The output is allocated as Matlab array, so it is not copied when it is returned
+	mxArray* pOutput = nullptr;
+
+	raster.SetAllocator([&pOutput](size_t rows, size_t columns, size_t layerCount) -> double*
+	{
+		const mwSize dims[3] = { rows, columns, layerCount };
+		pOutput = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+		return GetDoubles(pOutput);
+	});
+
+	// Initialize instance of lasDataTranscoder class with the filters of the options
+	LASdataTranscoder lasTranscoder;
+	lasTranscoder.GetOptions(prhs[1]);
+
+	std::vector<std::string> inputPaths;
+
+	for (size_t i = 0; i < inputCount; ++i)
+	{
+		char* inputPath = mxArrayToString(mxGetCell(prhs[0], i));
+		inputPaths.push_back(inputPath);
+		mxFree(inputPath);
+	}
+
+	try {
+		lasTranscoder.Rasterize(inputPaths, raster, useHeaderExtent);
+	}
+	catch (const std::length_error& le) {
+		mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:rasterSize", le.what());
+	}
+	catch (const std::bad_alloc& ba) {
+		mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:bad_alloc", ba.what());
+	}
+	catch (const std::ios_base::failure& iof) {
+		mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:iofailure", iof.what());
+	}
+	catch (const std::system_error& se) {
+		mexErrMsgIdAndTxt("MEX:rasterizeLASfiles_mex:threads", se.what());
+	}
+
+	plhs[0] = pOutput;
+
+	if (nlhs > 1) {
+		plhs[1] = mxCreateDoubleMatrix(1, 4, mxREAL);
+		raster.GetExtent(GetDoubles(plhs[1]));
+	}
+};
@@ -13,8 +13,8 @@
 void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
 
 	/* Check for proper number of arguments */
-	if (nrhs != 1 && nrhs != 2) {
-		mexErrMsgIdAndTxt("MEX:readLasFile:nargin", "This function allows one or two input arguments!");
+	if (nrhs < 1 || nrhs > 3) {
+		mexErrMsgIdAndTxt("MEX:readLasFile:nargin", "This function allows one to three input arguments!");
 	}
 	if (nlhs != 1) {
 		mexErrMsgIdAndTxt("MEX:readLasFile:nargout", "This function allows exactly one output argument");
@@ -30,7 +30,12 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
 		mexErrMsgIdAndTxt("MEX:readLasFile:typeargin", "Argument has to be path to LAS-File as char array!");
 	}
 
-	if (nrhs == 2) { // if second argument given
+	// Third argument selects nodes of the level of detail octree
+	if (nrhs == 3 && !mxIsStruct(prhs[2])) {
+		mexErrMsgIdAndTxt("MEX:readLasFile:typeargin", "If third Argument is given then it has to be a struct with the level of detail options!");
+	}
+
+	if (nrhs > 1) { // if second argument given
 
 		if (mxIsChar(prhs[1])) { // If second argument is char array
 
@@ -109,6 +114,11 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
 				lasReader.SetReadXYZIntOnly(XYZIntOnly);
 			}
 
+			// Read only the points of the selected octree nodes
+			if (nrhs == 3) {
+				lasReader.SelectOctreeNodes(lasBin, prhs[2]);
+			}
+
 			// Allocate Rest of the Point Data if load only header is not chosen
 			lasReader.AllocateOutputStructure(plhs[0], lasBin);
 
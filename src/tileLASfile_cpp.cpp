@@ -0,0 +1,95 @@
+/*%==========================================================
+% tileLASfile_cpp.cpp
+%
+% Copyright (c) 2022, Patrick Kmmerle
+% Licence: see the included file
+%
+%========================================================*/
+#include "mex.h"
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "LAS_IO.hpp"
+
+#if MX_HAS_INTERLEAVED_COMPLEX
+
+#define GetDoubles	mxGetDoubles
+
+#else
+
+#define GetDoubles	(mxDouble*)	mxGetPr
+
+#endif
+
+/* The gateway function. */
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
+
+	/* Check for proper number of arguments */
+	if (nrhs != 3) {
+		mexErrMsgIdAndTxt("MEX:tileLASfile_mex:nargin", "Three input arguments required!");
+	}
+	if (nlhs > 2) {
+		mexErrMsgIdAndTxt("MEX:tileLASfile_mex:nargout", "This function returns at most two output arguments");
+	}
+
+	if (!mxIsChar(prhs[0]) || !mxIsChar(prhs[1])) {
+		mexErrMsgIdAndTxt("MEX:tileLASfile_mex:typeargin", "First and second argument have to be the path to the input LAS-File and the prefix of the tile files as char arrays!");
+	}
+
+	if (!mxIsStruct(prhs[2])) {
+		mexErrMsgIdAndTxt("MEX:tileLASfile_mex:typeargin", "Third argument has to be a struct containing tile size and transcoder options!");
+	}
+
+	// Initialize instance of lasDataTranscoder class and get options before the file is opened
+	LASdataTranscoder lasTranscoder;
+	lasTranscoder.GetOptions(prhs[2]);
+
+	char* inputPath = mxArrayToString(prhs[0]);
+	char* outputPrefix = mxArrayToString(prhs[1]);
+	const std::string prefix(outputPrefix);
+	mxFree(outputPrefix);
+
+	std::ifstream inBin;
+	inBin.rdbuf()->pubsetbuf(0, 0);
+	inBin.open(inputPath, std::ios::in | std::ios::binary);
+	mxFree(inputPath);
+
+	if (!inBin.is_open()) {
+		mexErrMsgIdAndTxt("MEX:tileLASfile_mex:invalidArgumentException", "Input file could not be opened!");
+	}
+
+	try {
+		lasTranscoder.Tile(inBin, prefix);
+		inBin.close();
+	}
+	catch (const std::bad_alloc& ba) {
+		mexErrMsgIdAndTxt("MEX:tileLASfile_mex:bad_alloc", ba.what());
+	}
+	catch (const std::range_error& re) {
+		mexErrMsgIdAndTxt("MEX:tileLASfile_mex:coordinateOverflow", re.what());
+	}
+	catch (const std::ios_base::failure& iof) {
+		mexErrMsgIdAndTxt("MEX:tileLASfile_mex:iofailure", iof.what());
+	}
+
+	// Paths of the tile files as cell array and their point counts
+	std::vector<std::string> paths;
+	std::vector<unsigned long long> pointCounts;
+	lasTranscoder.GetTiles(paths, pointCounts);
+
+	plhs[0] = mxCreateCellMatrix(paths.size(), 1);
+	for (size_t i = 0; i < paths.size(); ++i) {
+		mxSetCell(plhs[0], i, mxCreateString(paths[i].c_str()));
+	}
+
+	if (nlhs > 1)
+	{
+		plhs[1] = mxCreateDoubleMatrix(pointCounts.size(), 1, mxREAL);
+		double* pCounts = GetDoubles(plhs[1]);
+		for (size_t i = 0; i < pointCounts.size(); ++i) {
+			pCounts[i] = static_cast<double>(pointCounts[i]);
+		}
+	}
+};
@@ -0,0 +1,94 @@
+/*%==========================================================
+% transcodeLASfile_cpp.cpp
+%
+% Copyright (c) 2022, Patrick Kmmerle
+% Licence: see the included file
+%
+%========================================================*/
+#include "mex.h"
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "LAS_IO.hpp"
+
+
+/* The gateway function. */
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
+
+	/* Check for proper number of arguments */
+	if (nrhs < 2 || nrhs > 3) {
+		mexErrMsgIdAndTxt("MEX:transcodeLASfile_mex:nargin", "Two or three input arguments required!");
+	}
+	if (nlhs > 1) {
+		mexErrMsgIdAndTxt("MEX:transcodeLASfile_mex:nargout", "This function returns at most one output argument");
+	}
+
+	if (!mxIsChar(prhs[0]) || !mxIsChar(prhs[1])) {
+		mexErrMsgIdAndTxt("MEX:transcodeLASfile_mex:typeargin", "First and second argument have to be paths to the input and output LAS-File as char arrays!");
+	}
+
+	if (nrhs > 2 && !mxIsStruct(prhs[2])) {
+		mexErrMsgIdAndTxt("MEX:transcodeLASfile_mex:typeargin", "Third argument has to be a struct containing transcoder options!");
+	}
+
+	// Initialize instance of lasDataTranscoder class and get options before the files are opened
+	LASdataTranscoder lasTranscoder;
+
+	if (nrhs > 2) {
+		lasTranscoder.GetOptions(prhs[2]);
+	}
+
+	// Get Paths from input. Output would be truncated before the input is read if both are the same file
+	char* inputPath = mxArrayToString(prhs[0]);
+	char* outputPath = mxArrayToString(prhs[1]);
+
+	if (std::strcmp(inputPath, outputPath) == 0)
+	{
+		mxFree(inputPath);
+		mxFree(outputPath);
+		mexErrMsgIdAndTxt("MEX:transcodeLASfile_mex:samefile", "Input and output file have to be different!");
+	}
+
+	std::ifstream inBin;
+	inBin.rdbuf()->pubsetbuf(0, 0);
+	inBin.open(inputPath, std::ios::in | std::ios::binary);
+	mxFree(inputPath);
+
+	if (!inBin.is_open())
+	{
+		mxFree(outputPath);
+		mexErrMsgIdAndTxt("MEX:transcodeLASfile_mex:invalidArgumentException", "Input file could not be opened!");
+	}
+
+	std::ofstream outBin(outputPath, std::ios::out | std::ios::binary);
+
+	// Sorted runs of large inputs are merged via a temporary file next to the output
+	lasTranscoder.SetTemporaryPath(std::string(outputPath) + ".sortruns.tmp");
+	mxFree(outputPath);
+
+	if (outBin.is_open()) {
+		try {
+			lasTranscoder.Transcode(inBin, outBin);
+			outBin.close();
+			inBin.close();
+		}
+		catch (const std::bad_alloc& ba) {
+			mexErrMsgIdAndTxt("MEX:transcodeLASfile_mex:bad_alloc", ba.what());
+		}
+		catch (const std::range_error& re) {
+			mexErrMsgIdAndTxt("MEX:transcodeLASfile_mex:coordinateOverflow", re.what());
+		}
+		catch (const std::ios_base::failure& iof) {
+			mexErrMsgIdAndTxt("MEX:transcodeLASfile_mex:iofailure", iof.what());
+		}
+	}
+	else
+	{
+		mexErrMsgIdAndTxt("MEX:transcodeLASfile_mex:invalidArgumentException", "Output file could not be opened for writing");
+	}
+
+	if (nlhs > 0) {
+		plhs[0] = mxCreateDoubleScalar(static_cast<double>(lasTranscoder.GetWrittenPointCount()));
+	}
+};
@@ -0,0 +1,147 @@
+#include "mex.h"
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <omp.h>
+#include "VoxelGrid.hpp"
+#include "ProcessingThreads.hpp"
+
+#if MX_HAS_INTERLEAVED_COMPLEX
+
+#define GetDoubles	mxGetDoubles
+#define GetUint64	mxGetUint64s
+
+#else
+
+#define GetDoubles	(mxDouble*)	mxGetPr
+#define GetUint64	(mxUint64*) mxGetPr
+
+#endif
+
+inline VoxelRepresentative getRepresentative(const mxArray* prhs[], int nrhs);
+template<typename Index>
+inline void Compute(int nlhs, mxArray* plhs[], const mxArray* prhs[], int nrhs, const VoxelGrid& grid, const size_t pointCount, const int numberOfThreads);
+
+
+// Reduces a point cloud to one point per voxel:
+//	[indices, centroids, counts] = voxelGridFilter_cpp(x, y, z, voxelSize, representative, numThreads, sorted)
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+	if (nrhs < 4 || nrhs > 7) {
+		mexErrMsgIdAndTxt("MEX:voxelGridFilter:nargin", "This function allows four to seven input arguments!");
+	}
+	if (nlhs > 3) {
+		mexErrMsgIdAndTxt("MEX:voxelGridFilter:nargout", "This function allows up to three output arguments");
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		if (!mxIsDouble(prhs[i]) || mxIsComplex(prhs[i])) {
+			mexErrMsgIdAndTxt("MEX:voxelGridFilter:typeargin", "Coordinates and voxel size have to be real double arrays!");
+		}
+	}
+
+	const size_t pointCount = mxGetNumberOfElements(prhs[0]);
+	if (pointCount != mxGetNumberOfElements(prhs[1]) || pointCount != mxGetNumberOfElements(prhs[2])) {
+		mexErrMsgIdAndTxt("MEX:voxelGridFilter:sizeargin", "Input coordinates have to be of same size!");
+	}
+
+	// One size for all axes or one per axis. Infinite sizes put all points into one layer of the axis
+	const size_t sizeCount = mxGetNumberOfElements(prhs[3]);
+	if (sizeCount != 1 && sizeCount != 3) {
+		mexErrMsgIdAndTxt("MEX:voxelGridFilter:sizeargin", "Voxel size has to be a scalar or [xSize ySize zSize]!");
+	}
+
+	const double* voxelSize = GetDoubles(prhs[3]);
+	double size[3];
+
+	for (int axis = 0; axis < 3; ++axis) {
+		size[axis] = voxelSize[sizeCount == 3 ? axis : 0];
+
+		if (!(size[axis] > 0)) {
+			mexErrMsgIdAndTxt("MEX:voxelGridFilter:valueargin", "Voxel size has to be larger than zero!");
+		}
+	}
+
+	const int numberOfThreads = getNumberOfThreads(prhs, nrhs, 5);		// Number of processing threads
+	omp_set_num_threads(numberOfThreads);
+
+	VoxelGrid grid;
+	if (!buildVoxelGrid(grid, GetDoubles(prhs[0]), GetDoubles(prhs[1]), GetDoubles(prhs[2]), pointCount, size)) {
+		mexErrMsgIdAndTxt("MEX:voxelGridFilter:sizeargin", "Voxel size is too small for the extent of the points! Voxels can't be numbered with 63 bits");
+	}
+
+	// Smaller point indices halve the memory of the grouping
+	if (pointCount <= UINT32_MAX)
+		Compute<uint32_t>(nlhs, plhs, prhs, nrhs, grid, pointCount, numberOfThreads);
+	else
+		Compute<uint64_t>(nlhs, plhs, prhs, nrhs, grid, pointCount, numberOfThreads);
+}
+
+// Gets the representative of a voxel from the fifth argument 'first', 'centroid' or 'center'
+//	Returns: selected representative and the first point without argument
+inline VoxelRepresentative getRepresentative(const mxArray* prhs[], int nrhs)
+{
+	if (nrhs < 5)
+		return VoxelRepresentative::First;
+
+	if (!mxIsChar(prhs[4])) {
+		mexErrMsgIdAndTxt("MEX:voxelGridFilter:typeargin", "Representative has to be 'first', 'centroid' or 'center'!");
+	}
+
+	char* name = mxArrayToString(prhs[4]);
+	const bool isFirst = std::strcmp(name, "first") == 0;
+	const bool isCentroid = std::strcmp(name, "centroid") == 0;
+	const bool isCenter = std::strcmp(name, "center") == 0;
+	mxFree(name);
+
+	if (!isFirst && !isCentroid && !isCenter) {
+		mexErrMsgIdAndTxt("MEX:voxelGridFilter:valueargin", "Representative has to be 'first', 'centroid' or 'center'!");
+	}
+
+	return isCentroid ? VoxelRepresentative::Centroid : (isCenter ? VoxelRepresentative::Center : VoxelRepresentative::First);
+}
+
+// Groups the points by voxel and writes the 1-based indices of the representatives, the centroids and the
+// number of points of every voxel
+template<typename Index>
+inline void Compute(int nlhs, mxArray* plhs[], const mxArray* prhs[], int nrhs, const VoxelGrid& grid, const size_t pointCount, const int numberOfThreads)
+{
+	const VoxelRepresentative representative = getRepresentative(prhs, nrhs);
+	const bool sorted = nrhs > 6 && mxGetScalar(prhs[6]) != 0;
+
+	std::vector<Voxel> voxels;
+	voxelGridFilter<Index>(voxels, grid, GetDoubles(prhs[0]), GetDoubles(prhs[1]), GetDoubles(prhs[2]), pointCount, representative, sorted, numberOfThreads);
+
+	const size_t voxelCount = voxels.size();
+	const long long signedVoxelCount = static_cast<long long>(voxelCount);
+
+	plhs[0] = mxCreateNumericMatrix(voxelCount, 1, mxUINT64_CLASS, mxREAL);
+	mxUint64* indices = GetUint64(plhs[0]);
+
+#pragma omp parallel for if (voxelCount > 10000)
+	for (long long v = 0; v < signedVoxelCount; ++v) {
+		indices[v] = static_cast<mxUint64>(voxels[v].representative) + 1;
+	}
+
+	// Centroids in the coordinates of the input, one row per voxel
+	if (nlhs > 1) {
+		plhs[1] = mxCreateDoubleMatrix(voxelCount, 3, mxREAL);
+		double* centroids = GetDoubles(plhs[1]);
+
+#pragma omp parallel for if (voxelCount > 10000)
+		for (long long v = 0; v < signedVoxelCount; ++v) {
+			for (int axis = 0; axis < 3; ++axis) {
+				centroids[axis * voxelCount + v] = grid.minXYZ[axis] + voxels[v].centroid[axis];
+			}
+		}
+	}
+
+	if (nlhs > 2) {
+		plhs[2] = mxCreateNumericMatrix(voxelCount, 1, mxUINT64_CLASS, mxREAL);
+		mxUint64* counts = GetUint64(plhs[2]);
+
+		for (size_t v = 0; v < voxelCount; ++v) {
+			counts[v] = static_cast<mxUint64>(voxels[v].count);
+		}
+	}
+}
@@ -7,6 +7,7 @@
 %========================================================*/
 #include "mex.h"
 #include <fstream>
+#include <stdexcept>
 #include "LAS_IO.hpp"
 
 
@@ -32,42 +33,127 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
 		mexErrMsgIdAndTxt("MEX:writeLASFile_mex:typeargin", "First argument has to be a LAS struture!");
 	}
 
-	// Get Path from input and open file
+	if (nrhs > 2 && !mxIsStruct(prhs[2])) {
+		mexErrMsgIdAndTxt("MEX:writeLASFile_mex:typeargin", "Third argument has to be a struct containing writer options!");
+	}
+
+	// Initialize instance of lasDataWriter class and get header and options before the file is opened
+	LASdataWriter lasWriter;
+
+	if (nrhs > 2) {
+		lasWriter.GetOptions(prhs[2]);
+	}
+
+	lasWriter.GetHeader(prhs[0]);
+
+	// Get Path from input
 	char* filePath = mxArrayToString(prhs[1]);
-	std::ofstream lasBin(filePath, std::ios::out | std::ios::binary);
-	mxFree(filePath);										// Deallocate memory of path after opening file because it is not needed anymore
 
-	if (lasBin.is_open()) {
+	// LASzip creates and writes the compressed file itself, preallocation does not apply
+	if (lasWriter.DoCompress())
+	{
+		try {
+			lasWriter.GetData(prhs[0]);
+			lasWriter.WriteCompressed(filePath, prhs[0]);
+			mxFree(filePath);
+		}
+		catch (const std::bad_alloc& ba) {
+			mxFree(filePath);
+			mexErrMsgIdAndTxt("MEX:writeLASFile_mex:bad_alloc", ba.what());
+		}
+		catch (const std::range_error& re) {
+			mxFree(filePath);
+			mexErrMsgIdAndTxt("MEX:writeLASFile_mex:coordinateOverflow", re.what());
+		}
+		catch (const std::ofstream::failure& of) {
+			mxFree(filePath);
+			mexErrMsgIdAndTxt("MEX:writeLASFile_mex:ofstreamfailure", of.what());
+		}
+		return;
+	}
+
+	std::ios_base::openmode openMode = std::ios::out | std::ios::binary;
+	unsigned long long expectedFileSize = 0;
+
+	// Appending validates the points, then moves the data after the existing point records and takes over the
+	// existing header. The file must not be truncated
+	if (lasWriter.DoAppend())
+	{
 		try {
-			// Initialize instance of lasDataWriter class
-			LASdataWriter lasWriter;
+			lasWriter.PrepareAppend(filePath, prhs[0]);
+		}
+		catch (const std::bad_alloc& ba) {
+			mxFree(filePath);
+			mexErrMsgIdAndTxt("MEX:writeLASFile_mex:bad_alloc", ba.what());
+		}
+		catch (const std::range_error& re) {
+			mxFree(filePath);
+			mexErrMsgIdAndTxt("MEX:writeLASFile_mex:coordinateOverflow", re.what());
+		}
+		openMode |= std::ios::in;
+	}
+	// Reserve disk space for the whole file. The preallocated file must not be truncated when it is opened
+	else if (lasWriter.DoPreallocateFile())
+	{
+		expectedFileSize = lasWriter.GetExpectedFileSize(prhs[0]);
+
+		if (LASdataWriter::PreallocateFile(filePath, expectedFileSize)) {
+			openMode |= std::ios::in;
+		}
+		else {
+			mexWarnMsgIdAndTxt("MEX:writeLASFile_mex:preallocation", "File could not be preallocated! Writing without preallocation!");
+			expectedFileSize = 0;
+		}
+	}
+
+	std::ofstream lasBin(filePath, openMode);
 
-			lasWriter.GetHeader(prhs[0]);
-			lasWriter.WriteLASheader(lasBin);
+	if (lasBin.is_open()) {
+		try {
+			// Header and VLRs of the existing file are kept when appending
+			if (!lasWriter.DoAppend())
+			{
+				lasWriter.WriteLASheader(lasBin);
 
-			if (lasWriter.HasVLR()) {
-				lasWriter.WriteVLR(lasBin, prhs[0]);
+				if (lasWriter.HasVLR()) {
+					lasWriter.WriteVLR(lasBin, prhs[0]);
+				}
 			}
 				
 			lasWriter.GetData(prhs[0]);
 			lasWriter.WriteLASdata(lasBin);
 
-			if (lasWriter.HasExtVLR())
+			if (!lasWriter.DoAppend() && lasWriter.HasExtVLR())
 			{
 				lasWriter.WriteExtVLR(lasBin, prhs[0]);
 			}
 
+			// If less than the preallocated space was needed then the rest has to be cut off
+			unsigned long long writtenFileSize = static_cast<unsigned long long>(lasBin.tellp());
 			lasBin.close();
+
+			if (expectedFileSize > writtenFileSize) {
+				LASdataWriter::TruncateFile(filePath, writtenFileSize);
+			}
+			mxFree(filePath);
 		}
 		catch (const std::bad_alloc& ba) {
+			mxFree(filePath);
 			mexErrMsgIdAndTxt("MEX:writeLASFile_mex:bad_alloc", ba.what());
 		}
+		catch (const std::range_error& re) {
+			lasBin.close();
+			mxFree(filePath);
+			mexErrMsgIdAndTxt("MEX:writeLASFile_mex:coordinateOverflow", re.what());
+		}
 		catch (const std::ofstream::failure(&of)) {
+			mxFree(filePath);
 			mexErrMsgIdAndTxt("MEX:writeLASFile_mex:ofstreamfailure", of.what());
 		}
 	}
 	else
 	{
+		mxFree(filePath);
 		mexErrMsgIdAndTxt("MEX:writeLASFile_mex:invalidArgumentException", "File could not be opened for writing");
 	}
 };
@@ -0,0 +1,277 @@
+/*%==========================================================
+% writeLASstream_cpp.cpp
+%
+% Copyright (c) 2022, Patrick Kmmerle
+% Licence: see the included file
+%
+%========================================================*/
+#include "mex.h"
+#include <fstream>
+#include <map>
+#include <memory>
+#include <cstring>
+#include <stdexcept>
+#include "LAS_IO.hpp"
+
+// Persistent writer state of an opened LAS-File. Lives between the calls of this mex function
+struct StreamSession
+{
+	LASdataWriter	writer;
+	std::ofstream	lasBin;
+	mxArray*		pExtVLR = nullptr;		// Persistent struct with field extendedvariables, written on close
+	bool			isFailed = false;		// A chunk failed while it was written, the point data is incomplete
+};
+
+static std::map<unsigned long long, std::unique_ptr<StreamSession>> openSessions;
+static unsigned long long nextHandle = 1;
+
+// Write statistics, header and extended VLRs, then close the file
+static void finishSession(StreamSession& session)
+{
+	session.writer.EndPointData(session.lasBin);
+
+	if (nullptr != session.pExtVLR)
+	{
+		session.writer.WriteExtVLR(session.lasBin, session.pExtVLR);
+		mxDestroyArray(session.pExtVLR);
+		session.pExtVLR = nullptr;
+	}
+
+	session.lasBin.close();
+}
+
+// Close the file of a failed session without writing statistics and extended VLRs
+static void abortSession(StreamSession& session)
+{
+	if (nullptr != session.pExtVLR)
+	{
+		mxDestroyArray(session.pExtVLR);
+		session.pExtVLR = nullptr;
+	}
+
+	session.lasBin.close();
+}
+
+// Finish all open files if the mex function is cleared or Matlab exits
+static void closeAllSessions()
+{
+	for (auto& entry : openSessions)
+	{
+		if (entry.second->isFailed)
+		{
+			abortSession(*entry.second);
+			mexWarnMsgIdAndTxt("MEX:writeLASstream_mex:closeAll", "LAS-File of handle %llu is incomplete because a chunk failed!", entry.first);
+			continue;
+		}
+
+		try {
+			finishSession(*entry.second);
+		}
+		catch (const std::exception&) {
+			mexWarnMsgIdAndTxt("MEX:writeLASstream_mex:closeAll", "LAS-File of handle %llu could not be finished!", entry.first);
+		}
+	}
+
+	openSessions.clear();
+}
+
+// Returns the session of the handle in prhs or throws a Matlab error if there is none
+static StreamSession& getSession(const mxArray* pHandle, unsigned long long& handle)
+{
+	if (!mxIsNumeric(pHandle) || mxGetNumberOfElements(pHandle) != 1) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:typeargin", "Second argument has to be a scalar writer handle!");
+	}
+
+	handle = static_cast<unsigned long long>(mxGetScalar(pHandle));
+	auto it = openSessions.find(handle);
+
+	if (it == openSessions.end()) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:invalidHandle", "Writer handle is not valid or was already closed!");
+	}
+
+	return *it->second;
+}
+
+// handle = writeLASstream_cpp('open', las, filePath, options)
+static void openStream(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+	if (nrhs < 3) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:nargin", "Command open needs a LAS structure and the file path!");
+	}
+	if (nlhs != 1) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:nargout", "Command open returns exactly one output argument!");
+	}
+	if (!mxIsStruct(prhs[1])) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:typeargin", "Second argument has to be a LAS struture!");
+	}
+	if (!mxIsChar(prhs[2])) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:typeargin", "Third argument has to be path to target LAS-File as char array!");
+	}
+	if (nrhs > 3 && !mxIsStruct(prhs[3])) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:typeargin", "Fourth argument has to be a struct containing writer options!");
+	}
+
+	std::unique_ptr<StreamSession> session(new StreamSession());
+
+	if (nrhs > 3) {
+		session->writer.GetOptions(prhs[3]);
+	}
+
+	if (session->writer.DoCompress()) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:compress", "Compressed output is not supported when writing chunks!");
+	}
+
+	// A new file is written and every chunk is written as it comes, so the points can neither be appended nor sorted
+	if (session->writer.DoAppend()) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:append", "Appending is not supported when writing chunks!");
+	}
+
+	if (session->writer.DoSpatialSort()) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:spatialSort", "Spatial sorting is not supported when writing chunks!");
+	}
+
+	// Quantization and octree need the extent or all of the points before the first chunk
+	if (session->writer.DoCoordinatePrecision()) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:coordinatePrecision", "Coordinate precision is not supported when writing chunks, set scale factors and offsets in the header!");
+	}
+
+	if (session->writer.DoLODOctree()) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:lodOctree", "Level of detail octree is not supported when writing chunks!");
+	}
+
+	// Point counts and bounding box are unknown until the last chunk has been written
+	session->writer.SetComputeHeaderStats(true);
+	session->writer.GetHeader(prhs[1]);
+
+	char* filePath = mxArrayToString(prhs[2]);
+	session->lasBin.open(filePath, std::ios::out | std::ios::binary);
+	mxFree(filePath);
+
+	if (!session->lasBin.is_open()) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:invalidArgumentException", "File could not be opened for writing");
+	}
+
+	try {
+		session->writer.WriteLASheader(session->lasBin);
+
+		if (session->writer.HasVLR()) {
+			session->writer.WriteVLR(session->lasBin, prhs[1]);
+		}
+
+		if (!session->writer.BeginPointData(session->lasBin)) {
+			session->lasBin.close();
+			mexErrMsgIdAndTxt("MEX:writeLASstream_mex:invalidPointDataRecordFormat", "Point Data Record Format not supported!");
+		}
+	}
+	catch (const std::ofstream::failure& of) {
+		session->lasBin.close();
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:ofstreamfailure", of.what());
+	}
+
+	// Extended VLRs are written after the last point, so keep a copy of them until then
+	if (session->writer.HasExtVLR())
+	{
+		const char* fieldNames[] = { "extendedvariables" };
+		session->pExtVLR = mxCreateStructMatrix(1, 1, 1, fieldNames);
+		mxSetField(session->pExtVLR, 0, "extendedvariables", mxDuplicateArray(mxGetField(prhs[1], 0, "extendedvariables")));
+		mexMakeArrayPersistent(session->pExtVLR);
+	}
+
+	if (openSessions.empty()) {
+		mexAtExit(closeAllSessions);
+	}
+
+	const unsigned long long handle = nextHandle++;
+	openSessions[handle] = std::move(session);
+
+	plhs[0] = mxCreateDoubleScalar(static_cast<double>(handle));
+}
+
+// writeLASstream_cpp('write', handle, lasChunk)
+static void writeStream(int nrhs, const mxArray* prhs[])
+{
+	if (nrhs < 3) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:nargin", "Command write needs the writer handle and a LAS structure!");
+	}
+
+	unsigned long long handle = 0;
+	StreamSession& session = getSession(prhs[1], handle);
+
+	if (session.isFailed) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:failedStream", "A previous chunk failed, the writer handle only accepts close!");
+	}
+
+	// A chunk can fail after some of its points have been written, so the session accepts no further chunks
+	try {
+		session.writer.WritePointChunk(session.lasBin, prhs[2]);
+	}
+	catch (const std::bad_alloc& ba) {
+		session.isFailed = true;
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:bad_alloc", ba.what());
+	}
+	catch (const std::range_error& re) {
+		session.isFailed = true;
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:coordinateOverflow", re.what());
+	}
+	catch (const std::ofstream::failure& of) {
+		session.isFailed = true;
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:ofstreamfailure", of.what());
+	}
+}
+
+// writeLASstream_cpp('close', handle)
+static void closeStream(int nrhs, const mxArray* prhs[])
+{
+	if (nrhs < 2) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:nargin", "Command close needs the writer handle!");
+	}
+
+	unsigned long long handle = 0;
+	getSession(prhs[1], handle);
+
+	// Remove the session first, so a failing close does not leave an unusable handle behind
+	std::unique_ptr<StreamSession> session = std::move(openSessions[handle]);
+	openSessions.erase(handle);
+
+	if (session->isFailed)
+	{
+		abortSession(*session);
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:failedStream", "LAS-File is incomplete because a chunk failed!");
+	}
+
+	try {
+		finishSession(*session);
+	}
+	catch (const std::ofstream::failure& of) {
+		if (nullptr != session->pExtVLR) { mxDestroyArray(session->pExtVLR); }
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:ofstreamfailure", of.what());
+	}
+}
+
+/* The gateway function. */
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
+
+	/* Check for proper number of arguments */
+	if (nrhs < 1 || !mxIsChar(prhs[0])) {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:nargin", "First argument has to be one of the commands 'open', 'write' or 'close'!");
+	}
+
+	char* command = mxArrayToString(prhs[0]);
+	const bool isOpen  = std::strcmp(command, "open") == 0;
+	const bool isWrite = std::strcmp(command, "write") == 0;
+	const bool isClose = std::strcmp(command, "close") == 0;
+	mxFree(command);
+
+	if (isOpen) {
+		openStream(nlhs, plhs, nrhs, prhs);
+	}
+	else if (isWrite) {
+		writeStream(nrhs, prhs);
+	}
+	else if (isClose) {
+		closeStream(nrhs, prhs);
+	}
+	else {
+		mexErrMsgIdAndTxt("MEX:writeLASstream_mex:valueargin", "Unknown command! Valid commands are 'open', 'write' and 'close'");
+	}
+};